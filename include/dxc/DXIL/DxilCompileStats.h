@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompileStats.h                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Machine-readable compile statistics for a DXIL module.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace hlsl {
+
+class DxilModule;
+
+/// Named counters recorded by passes while compiling (for example, the number
+/// of loop iterations unrolled). Ordered so the JSON output is deterministic.
+using DxilCompileStatMap = std::map<std::string, uint64_t>;
+
+/// Adds Value to the counter Name, creating it if necessary.
+inline void AddDxilCompileStat(DxilCompileStatMap &Stats, llvm::StringRef Name,
+                               uint64_t Value) {
+  Stats[Name.str()] += Value;
+}
+
+/// Writes the statistics for DM as a single JSON object. Covers instruction
+/// counts by dx.op class and LLVM opcode, basic block and loop counts, dx.op
+/// calls per resource, alloca and groupshared sizes, signature rows, an
+/// estimate of register pressure, and the counters recorded by passes.
+void WriteDxilCompileStatsJson(DxilModule &DM, llvm::raw_ostream &OS);
+
+} // namespace hlsl
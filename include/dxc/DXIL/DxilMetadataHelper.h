@@ -91,11 +91,16 @@ public:
   // Subobjects
   static const char kDxilSubobjectsMDName[];
 
+  // Constant array buffer data, for intermediate use, not valid in final DXIL
+  // module.
+  static const char kDxilConstantArrayDataMDName[];
+
   // Source info.
   static const char kDxilSourceContentsMDName[];
   static const char kDxilSourceDefinesMDName[];
   static const char kDxilSourceMainFileNameMDName[];
   static const char kDxilSourceArgsMDName[];
+  static const char kDxilSourceStoreMDName[];
 
   static const unsigned kDxilEntryPointNumFields  = 5;
   static const unsigned kDxilEntryPointFunction   = 0;  // Entry point function symbol.
@@ -338,6 +343,8 @@ public:
   llvm::MDTuple *EmitSignatureElement(const DxilSignatureElement &SE);
   void LoadSignatureElement(const llvm::MDOperand &MDO, DxilSignatureElement &SE);
   void LoadRootSignature(std::vector<uint8_t> &SerializedRootSignature);
+  void EmitConstantArrayData(const std::vector<uint8_t> &Data);
+  void LoadConstantArrayData(std::vector<uint8_t> &Data);
 
   // Resources.
   llvm::MDTuple *EmitDxilResourceTuple(llvm::MDTuple *pSRVs, llvm::MDTuple *pUAVs, 
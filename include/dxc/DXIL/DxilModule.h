@@ -14,6 +14,7 @@
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/DXIL/DxilMetadataHelper.h"
 #include "dxc/DXIL/DxilCBuffer.h"
+#include "dxc/DXIL/DxilCompileStats.h"
 #include "dxc/DXIL/DxilResource.h"
 #include "dxc/DXIL/DxilSampler.h"
 #include "dxc/DXIL/DxilShaderFlags.h"
@@ -153,6 +154,7 @@ public:
   bool StripRootSignatureFromMetadata();
   // Remove Subobjects from module metadata, return true if changed
   bool StripSubobjectsFromMetadata();
+  bool StripConstantArrayDataFromMetadata();
   // Update validator version metadata to current setting
   void UpdateValidatorVersionMetadata();
 
@@ -296,6 +298,16 @@ public:
   DxilSubobjects *ReleaseSubobjects();
   void ResetSubobjects(DxilSubobjects *subobjects);
 
+  // Counters recorded by passes, reported with -fstats-json.
+  void AddCompileStat(llvm::StringRef Name, uint64_t Value);
+  const DxilCompileStatMap &GetCompileStats() const;
+  void SetCompileStats(const DxilCompileStatMap &Stats);
+
+  // Contents of the buffer generated for constant arrays, kept in metadata
+  // until written to the DFCC_ConstantArrayData part.
+  const std::vector<uint8_t> &GetConstantArrayData() const;
+  void SetConstantArrayData(std::vector<uint8_t> &&Data);
+
 private:
   // Signatures.
   std::vector<uint8_t> m_SerializedRootSignature;
@@ -364,6 +376,9 @@ private:
   uint32_t m_AutoBindingSpace;
 
   std::unique_ptr<DxilSubobjects> m_pSubobjects;
+
+  DxilCompileStatMap m_CompileStats;
+  std::vector<uint8_t> m_ConstantArrayData;
 };
 
 } // namespace hlsl
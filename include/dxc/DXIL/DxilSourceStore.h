@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSourceStore.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Helpers to keep debug source contents in a shared store.                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace llvm {
+class Module;
+}
+
+namespace hlsl {
+
+// A source store is a directory holding one file per distinct source, named
+// by the MD5 of its contents in hex. Debug information that refers to the
+// store lists each source in dx.source.contents as !{name, !"", hash} instead
+// of !{name, contents}, and names the store in dx.source.store.
+
+/// Writes the sources in dx.source.contents of M that are not in the store
+/// yet, and replaces their contents with references into the store. The
+/// store is named by its absolute path.
+void MoveDebugSourcesToStore(llvm::Module &M, llvm::StringRef StoreDir);
+
+/// Gets the store named in dx.source.store of M, or an empty string.
+llvm::StringRef GetDebugSourceStore(const llvm::Module &M);
+
+/// Reads a source from the store. Returns false if it is not there or its
+/// contents do not match the hash.
+bool LoadDebugSourceFromStore(llvm::StringRef StoreDir, llvm::StringRef Hash,
+                              std::string &Contents);
+
+} // namespace hlsl
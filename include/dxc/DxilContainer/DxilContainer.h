@@ -51,6 +51,30 @@ typedef struct DxilShaderHash {
   uint8_t Digest[DxilContainerHashSize];
 } DxcShaderHash;
 
+enum class DxilShaderFingerprintFlags : uint32_t {
+  None = 0,             // Fingerprint of a fully compiled shader.
+  IdenticalToKnown = 1, // The module matched a known fingerprint; the name of
+                        // the matching shader follows, and the container has
+                        // no other parts.
+};
+
+/// Fingerprint of the optimized module, ignoring value names and debug info.
+/// When Flags has IdenticalToKnown, the struct is followed by the
+/// null-terminated name of the known shader, padded to a 4-byte boundary.
+struct DxilShaderFingerprint {
+  uint32_t Flags; // DxilShaderFingerprintFlags
+  uint8_t Digest[DxilContainerHashSize];
+};
+
+/// Contents of the buffer that constant arrays were moved into with
+/// -const-array-buffer-space. The struct is followed by DataSize bytes, to be
+/// uploaded to the ByteAddressBuffer bound at t<LowerBound>, space<Space>.
+struct DxilConstantArrayDataHeader {
+  uint32_t Space;
+  uint32_t LowerBound;
+  uint32_t DataSize;
+};
+
 struct DxilContainerVersion {
   uint16_t Major;
   uint16_t Minor;
@@ -95,6 +119,9 @@ enum DxilFourCC {
   DFCC_PipelineStateValidation  = DXIL_FOURCC('P', 'S', 'V', '0'),
   DFCC_RuntimeData              = DXIL_FOURCC('R', 'D', 'A', 'T'),
   DFCC_ShaderHash               = DXIL_FOURCC('H', 'A', 'S', 'H'),
+  DFCC_ShaderFingerprint        = DXIL_FOURCC('F', 'P', 'R', 'T'),
+  DFCC_ConstantArrayData        = DXIL_FOURCC('C', 'A', 'D', 'T'),
+  DFCC_CompileStatistics        = DXIL_FOURCC('S', 'T', 'J', 'S'), // JSON compile statistics (-fstats-json)
 };
 
 #undef DXIL_FOURCC
@@ -403,12 +430,32 @@ inline bool GetDxilShaderDebugName(const DxilPartHeader *pDebugNamePart,
   return true;
 }
 
+inline bool GetDxilShaderFingerprint(const DxilPartHeader *pPart,
+  const DxilShaderFingerprint **ppFingerprint, const char **ppIdenticalTo) {
+  *ppFingerprint = nullptr;
+  *ppIdenticalTo = nullptr;
+  if (pPart->PartFourCC != DFCC_ShaderFingerprint ||
+      pPart->PartSize < sizeof(DxilShaderFingerprint))
+    return false;
+  const DxilShaderFingerprint *pContent = reinterpret_cast<const DxilShaderFingerprint *>(GetDxilPartData(pPart));
+  if (pContent->Flags & (uint32_t)DxilShaderFingerprintFlags::IdenticalToKnown) {
+    const char *pName = (const char *)(pContent + 1);
+    uint32_t MaxLen = pPart->PartSize - sizeof(DxilShaderFingerprint);
+    if (MaxLen == 0 || pName[MaxLen - 1] != '\0')
+      return false;
+    *ppIdenticalTo = pName;
+  }
+  *ppFingerprint = pContent;
+  return true;
+}
+
 enum class SerializeDxilFlags : uint32_t {
   None = 0,                         // No flags defined.
   IncludeDebugInfoPart = 1,         // Include the debug info part in the container.
   IncludeDebugNamePart = 2,         // Include the debug name part in the container.
   DebugNameDependOnSource = 4,      // Make the debug name depend on source (and not just final module).
   StripReflectionFromDxilPart = 8,  // Strip Reflection info from DXIL part.
+  IncludeStatisticsPart = 16,       // Include the JSON compile statistics part.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
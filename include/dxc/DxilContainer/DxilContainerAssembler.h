@@ -15,6 +15,10 @@
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "llvm/ADT/StringRef.h"
 
+namespace llvm {
+class Module;
+}
+
 namespace hlsl {
 
 class AbstractMemoryStream;
@@ -51,8 +55,20 @@ void SerializeDxilContainerForModule(hlsl::DxilModule *pModule,
                                      AbstractMemoryStream *pStream,
                                      llvm::StringRef DebugName,
                                      SerializeDxilFlags Flags,
-                                     DxilShaderHash *pShaderHashOut = nullptr);
+                                     DxilShaderHash *pShaderHashOut = nullptr,
+                                     const DxilShaderFingerprint *pFingerprint = nullptr);
 void SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
                                      AbstractMemoryStream *pStream);
 
+// Computes a fingerprint of the optimized module that ignores value names,
+// debug info and embedded source, so permutations that optimize to the same
+// program compare equal.
+void ComputeDxilModuleFingerprint(const llvm::Module &M,
+                                  DxilShaderFingerprint &Fingerprint);
+// Writes a container holding only a fingerprint part that names the known
+// shader the module is identical to.
+void SerializeDxilContainerForFingerprint(const DxilShaderFingerprint &Fingerprint,
+                                          llvm::StringRef IdenticalTo,
+                                          AbstractMemoryStream *pStream);
+
 } // namespace hlsl
\ No newline at end of file
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderPack.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides declarations for shader packs, which store many DXIL containers  //
+// with each distinct part stored once.                                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/DxilContainer/DxilContainer.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace hlsl {
+
+// A shader pack is laid out as follows. Offsets are in bytes from the start
+// of the pack, and tables are 8-byte aligned, so a pack can be read in place
+// from a memory-mapped file:
+//
+//   DxilShaderPackHeader
+//   DxilShaderPackShader Shaders[ShaderCount]
+//   uint32_t Buckets[BucketCount]      - hash table over the shader hashes
+//   uint32_t PartRefs[PartRefCount]    - part indices of each shader, in order
+//   uint64_t PartOffsets[PartCount]    - offset of each distinct part
+//   parts, each a DxilPartHeader followed by its data, 4-byte aligned
+//
+// A bucket holds a shader index plus one, or zero when empty. A shader hash
+// goes in the bucket given by its first four bytes, or the next free one.
+
+static const uint32_t DxilShaderPackMagic = 0x4B505844; // 'DXPK'
+static const uint32_t DxilShaderPackVersion = 1;
+
+struct DxilShaderPackHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint64_t PackSizeInBytes;
+  uint32_t ShaderCount;
+  uint32_t BucketCount; // A power of two, larger than ShaderCount.
+  uint32_t PartRefCount;
+  uint32_t PartCount;
+  uint64_t ShaderTableOffset;
+  uint64_t BucketTableOffset;
+  uint64_t PartRefTableOffset;
+  uint64_t PartOffsetTableOffset;
+};
+
+/// Describes one container in a shader pack.
+struct DxilShaderPackShader {
+  /// The digest of the shader hash part, or an MD5 of the whole container if
+  /// it has none.
+  uint8_t ShaderHash[DxilContainerHashSize];
+  DxilContainerHash ContainerHash; // From the container header.
+  DxilContainerVersion Version;    // From the container header.
+  uint32_t ContainerSizeInBytes;
+  uint32_t FirstPartRef;
+  uint32_t PartCount;
+};
+
+/// Use this type to build a shader pack.
+class DxilShaderPackWriter {
+public:
+  /// Adds a container, keeping only the parts that are not in the pack yet.
+  /// Returns false if a shader with the same hash is already in the pack.
+  /// Throws DXC_E_CONTAINER_INVALID if the container is invalid, or if its
+  /// parts do not directly follow the offset table in order, since then it
+  /// could not be rebuilt byte for byte.
+  bool AddContainer(const DxilContainerHeader *pHeader, size_t length);
+
+  /// Writes the pack.
+  void Write(llvm::raw_ostream &OS) const;
+
+  uint32_t GetShaderCount() const { return m_Shaders.size(); }
+  uint32_t GetPartRefCount() const { return m_PartRefs.size(); }
+  uint32_t GetDistinctPartCount() const { return m_Parts.size(); }
+
+private:
+  std::vector<DxilShaderPackShader> m_Shaders;
+  std::vector<uint32_t> m_PartRefs;
+  std::vector<std::string> m_Parts; // DxilPartHeader followed by its data.
+  std::unordered_multimap<std::string, uint32_t> m_PartsByDigest;
+  std::unordered_map<std::string, uint32_t> m_ShadersByHash;
+};
+
+/// Use this type to read a shader pack in place.
+class DxilShaderPackReader {
+public:
+  /// Checks that the pack is valid and in bounds. The reader does not copy
+  /// the data, which must outlive it.
+  bool Init(const void *pData, size_t length);
+
+  uint32_t GetShaderCount() const { return m_pHeader->ShaderCount; }
+  const DxilShaderPackShader &GetShader(uint32_t index) const {
+    return m_pShaders[index];
+  }
+
+  /// Looks up a shader by hash. Returns false if it is not in the pack.
+  bool FindShader(const uint8_t *pShaderHash, uint32_t *pIndex) const;
+
+  /// Gets a part of a shader. The part points into the pack data.
+  const DxilPartHeader *GetPart(uint32_t shaderIndex,
+                                uint32_t partIndex) const;
+  /// Gets a part of a shader by fourCC, or nullptr if it has none.
+  const DxilPartHeader *GetPartByType(uint32_t shaderIndex,
+                                      DxilFourCC fourCC) const;
+
+  /// Writes the container of a shader as it was added to the pack.
+  void WriteContainer(uint32_t shaderIndex, llvm::raw_ostream &OS) const;
+
+private:
+  const char *m_pData = nullptr;
+  const DxilShaderPackHeader *m_pHeader = nullptr;
+  const DxilShaderPackShader *m_pShaders = nullptr;
+  const uint32_t *m_pBuckets = nullptr;
+  const uint32_t *m_pPartRefs = nullptr;
+  const uint64_t *m_pPartOffsets = nullptr;
+};
+
+} // namespace hlsl
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDivergenceAnalysis.h                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Finds the values of a DXIL function that may differ between threads.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/DenseSet.h"
+
+#include <vector>
+
+namespace llvm {
+  class Function;
+  class Instruction;
+  class LoopInfo;
+  class Value;
+}
+
+namespace hlsl {
+
+class DxilDivergenceAnalysis {
+public:
+  enum class Scope {
+    Wave,        // Uniform over the active lanes of a wave.
+    ThreadGroup, // Uniform over the threads of a compute thread group.
+  };
+
+  // Analyzes F. LI must describe the loops of F; it is not kept.
+  DxilDivergenceAnalysis(llvm::Function &F, llvm::LoopInfo &LI, Scope S);
+
+  // Returns true if V is known to be the same in every thread of the scope
+  // that computes it. Values created after the analysis are not known.
+  bool IsUniform(llvm::Value *V) const;
+
+private:
+  Scope m_Scope;
+  llvm::DenseSet<llvm::Value *> m_Divergent;
+  llvm::DenseSet<llvm::Value *> m_Analyzed;
+
+  bool IsUniformSource(llvm::Instruction *I) const;
+  bool PropagatesUniformity(llvm::Instruction *I) const;
+  void MarkDivergent(llvm::Value *V, std::vector<llvm::Value *> &Worklist);
+  void MarkPathDependentValues(llvm::Function &F, llvm::LoopInfo &LI,
+                               std::vector<llvm::Value *> &Worklist);
+};
+
+} // namespace hlsl
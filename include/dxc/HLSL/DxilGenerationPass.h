@@ -53,7 +53,13 @@ ModulePass *createHLEmitMetadataPass();
 ModulePass *createHLEnsureMetadataPass();
 ModulePass *createDxilFinalizeModulePass();
 ModulePass *createDxilEmitMetadataPass();
-FunctionPass *createDxilExpandTrigIntrinsicsPass();
+FunctionPass *createDxilExpandTrigIntrinsicsPass(bool FastTranscendentals = false);
+FunctionPass *createDxilFormDotMadPass();
+ModulePass *createDxilConstArrayToBufferPass(unsigned Space);
+ModulePass *createDxilLowerIndexedArraysPass();
+FunctionPass *createDxilIfConversionPass();
+ModulePass *createDxilGroupsharedBankConflictsPass(bool Report = false, bool Pad = false);
+ModulePass *createDxilHotColdSplitPass(bool Split = false);
 ModulePass *createDxilConvergentMarkPass();
 ModulePass *createDxilConvergentClearPass();
 ModulePass *createDxilDeadFunctionEliminationPass();
@@ -67,6 +73,8 @@ ModulePass *createDxilLegalizeResources();
 ModulePass *createDxilLegalizeEvalOperationsPass();
 FunctionPass *createDxilLegalizeSampleOffsetPass();
 FunctionPass *createDxilSimpleGVNHoistPass();
+ModulePass *createDxilWaveAggregateAtomicsPass();
+ModulePass *createDxilRemoveRedundantBarriersPass();
 ModulePass *createInvalidateUndefResourcesPass();
 FunctionPass *createSimplifyInstPass();
 ModulePass *createDxilTranslateRawBuffer();
@@ -86,6 +94,12 @@ void initializeHLEmitMetadataPass(llvm::PassRegistry&);
 void initializeDxilFinalizeModulePass(llvm::PassRegistry&);
 void initializeDxilEmitMetadataPass(llvm::PassRegistry&);
 void initializeDxilExpandTrigIntrinsicsPass(llvm::PassRegistry&);
+void initializeDxilFormDotMadPass(llvm::PassRegistry&);
+void initializeDxilConstArrayToBufferPass(llvm::PassRegistry&);
+void initializeDxilLowerIndexedArraysPass(llvm::PassRegistry&);
+void initializeDxilIfConversionPass(llvm::PassRegistry&);
+void initializeDxilGroupsharedBankConflictsPass(llvm::PassRegistry&);
+void initializeDxilHotColdSplitPass(llvm::PassRegistry&);
 void initializeDxilDeadFunctionEliminationPass(llvm::PassRegistry&);
 void initializeHLDeadFunctionEliminationPass(llvm::PassRegistry&);
 void initializeHLPreprocessPass(llvm::PassRegistry&);
@@ -99,6 +113,8 @@ void initializeDxilLegalizeResourcesPass(llvm::PassRegistry&);
 void initializeDxilLegalizeEvalOperationsPass(llvm::PassRegistry&);
 void initializeDxilLegalizeSampleOffsetPassPass(llvm::PassRegistry&);
 void initializeDxilSimpleGVNHoistPass(llvm::PassRegistry&);
+void initializeDxilWaveAggregateAtomicsPass(llvm::PassRegistry&);
+void initializeDxilRemoveRedundantBarriersPass(llvm::PassRegistry&);
 void initializeInvalidateUndefResourcesPass(llvm::PassRegistry&);
 void initializeSimplifyInstPass(llvm::PassRegistry&);
 void initializeDxilTranslateRawBufferPass(llvm::PassRegistry&);
@@ -45,8 +45,11 @@ public:
   virtual bool DetachLib(llvm::StringRef name) = 0;
   virtual void DetachAll() = 0;
 
+  // When bOptimize is set, a linked shader is optimized across library
+  // boundaries after its helper functions are inlined.
   virtual std::unique_ptr<llvm::Module>
-  Link(llvm::StringRef entry, llvm::StringRef profile, dxilutil::ExportMap &exportMap) = 0;
+  Link(llvm::StringRef entry, llvm::StringRef profile,
+       dxilutil::ExportMap &exportMap, bool bOptimize = false) = 0;
 
 protected:
   DxilLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor) : m_ctx(Ctx), m_valMajor(valMajor), m_valMinor(valMinor) {}
@@ -14,6 +14,7 @@
 #include "dxc/Support/Global.h"
 #include "dxc/DXIL/DxilMetadataHelper.h"
 #include "dxc/DXIL/DxilConstants.h"
+#include "dxc/DXIL/DxilCompileStats.h"
 #include "dxc/HLSL/HLResource.h"
 #include "dxc/HLSL/HLOperations.h"
 #include "dxc/DXIL/DxilSampler.h"
@@ -251,6 +252,10 @@ public:
   DxilSubobjects *ReleaseSubobjects();
   void ResetSubobjects(DxilSubobjects *subobjects);
 
+  // Counters recorded by passes, reported with -fstats-json.
+  void AddCompileStat(llvm::StringRef Name, uint64_t Value);
+  const DxilCompileStatMap &GetCompileStats() const;
+
 private:
   // Signatures.
   std::vector<uint8_t> m_SerializedRootSignature;
@@ -290,6 +295,7 @@ private:
   uint32_t m_AutoBindingSpace;
   DXIL::DefaultLinkage m_DefaultLinkage;
   std::unique_ptr<DxilSubobjects> m_pSubobjects;
+  DxilCompileStatMap m_CompileStats;
 
   // DXIL metadata serialization/deserialization.
   llvm::MDTuple *EmitHLResources();
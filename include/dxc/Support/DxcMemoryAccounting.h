@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcMemoryAccounting.h                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides an allocator that accounts for and limits memory use.            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/microcom.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/// Forwards to another IMalloc while tracking the bytes currently allocated
+/// and their high-water mark. When a limit is set, allocations that would
+/// exceed it fail and the active trace phase (see DxcTrace.h) is recorded.
+///
+/// The size of each block is recorded when it is charged, so the inner
+/// allocator need not be able to report sizes, and blocks this allocator did
+/// not charge are freed without being accounted for.
+///
+/// Install with DxcThreadMalloc for the duration of an operation to account
+/// for what the operation allocates on that thread, and with a
+/// DxcMemoryAccountingScope to also account for operator new where it does
+/// not go through this allocator.
+class DxcMemoryAccountingMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::atomic<uint64_t> m_CurrentBytes;
+  std::atomic<uint64_t> m_PeakBytes;
+  std::atomic<uint64_t> m_LimitBytes;
+  std::atomic<bool> m_LimitExceeded;
+  const char *m_pLimitPhase = nullptr;
+
+  // Sizes of the charged blocks, in an open-addressed table allocated from
+  // the inner allocator so that recording a size never re-enters operator
+  // new.
+  struct SizeEntry {
+    void *pBlock;
+    uint64_t Size;
+  };
+  std::mutex m_SizesLock;
+  SizeEntry *m_pSizes = nullptr;
+  size_t m_SizesCapacity = 0;
+  size_t m_SizesUsed = 0; // Live and deleted entries.
+
+  bool TryReserve(uint64_t cb);
+  void Unreserve(uint64_t cb);
+  SizeEntry *FindSize(void *pv);
+  bool GrowSizes();
+  bool RecordSize(void *pv, uint64_t cb);
+  uint64_t TakeSize(void *pv);
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcMemoryAccountingMalloc)
+  DxcMemoryAccountingMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_CurrentBytes(0), m_PeakBytes(0),
+        m_LimitBytes(0), m_LimitExceeded(false) {}
+  ~DxcMemoryAccountingMalloc();
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override;
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override;
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override;
+#ifdef _WIN32
+  SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ void *pv) override;
+  int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv) override;
+  void STDMETHODCALLTYPE HeapMinimize(void) override;
+#endif
+
+  /// Sets the number of bytes that may be allocated at once; zero removes
+  /// the limit.
+  void SetLimit(uint64_t limitBytes) { m_LimitBytes = limitBytes; }
+  uint64_t GetLimit() const { return m_LimitBytes; }
+  uint64_t GetCurrentBytes() const { return m_CurrentBytes; }
+  uint64_t GetPeakBytes() const { return m_PeakBytes; }
+  /// True once an allocation has failed because of the limit.
+  bool LimitExceeded() const { return m_LimitExceeded; }
+  /// Phase active when the limit was first exceeded, or nullptr if unknown.
+  const char *GetLimitPhase() const { return m_pLimitPhase; }
+
+  /// Accounts for the cb-byte block pv allocated elsewhere; returns false,
+  /// and accounts for nothing, if that would exceed the limit.
+  bool ChargeBlock(void *pv, uint64_t cb);
+  /// Accounts for the block pv being freed, if it was charged.
+  void UnchargeBlock(void *pv);
+};
+
+/// Charges operator new and delete on this thread to an accounting allocator
+/// while in scope, whichever allocator is installed with DxcThreadMalloc;
+/// blocks allocated by the accounting allocator itself are not charged twice.
+class DxcMemoryAccountingScope {
+public:
+  explicit DxcMemoryAccountingScope(DxcMemoryAccountingMalloc *pMalloc) throw();
+  ~DxcMemoryAccountingScope();
+
+private:
+  DxcMemoryAccountingMalloc *m_pPrior;
+};
+
+// Used by operator new and delete to allocate (with the thread allocator on
+// Windows, and malloc elsewhere, as memory crosses the library boundary)
+// while charging the thread's DxcMemoryAccountingScope, if any. The
+// allocating forms return nullptr when out of memory or over the limit.
+void *DxcAccountedNew(size_t cb) throw();
+void DxcAccountedDelete(void *pv) throw();
+void *DxcAccountedNewAligned(size_t cb, size_t alignment) throw();
+void DxcAccountedDeleteAligned(void *pv) throw();
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcTrace.h                                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides portable begin/end tracing of compiler phases.                   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Tracing support.
+//
+// Phases of a compilation report a begin and an end event through this
+// mechanism. Events are delivered to a callback installed by the library
+// user (see DxcSetTraceCallback in dxcapi.h) and, when the DXC_TRACE_FILE
+// environment variable names a file, appended to it in the Chrome
+// trace-event JSON format (loadable in chrome://tracing or Perfetto).
+//
+// Each thread also keeps the names of its active phases, whether or not
+// tracing is enabled, so that failures can name the phase they occurred in.
+// Names must remain valid until the phase ends.
+//
+// On Windows the top-level phases reported by the DxcEtw_* macros go to ETW;
+// elsewhere the macros below route them through this mechanism.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+/// Opens the trace file named by DXC_TRACE_FILE, if set. Called when the
+/// library is loaded.
+void DxcTraceInitialize() throw();
+/// Installs or clears (pCallback == nullptr) the in-process trace callback.
+void DxcSetTraceCallbackImpl(DxcTraceCallbackProc pCallback,
+                             void *pUserData) throw();
+/// Returns true if any trace consumer is active.
+bool DxcIsTraceEnabled() throw();
+void DxcTraceBegin(const char *pName) throw();
+void DxcTraceEnd(const char *pName, HRESULT status = S_OK) throw();
+/// Returns the innermost active phase on this thread, or nullptr.
+const char *DxcTraceGetCurrentPhase() throw();
+/// Flushes and closes the trace file, if one is open.
+void DxcTraceShutdown() throw();
+
+/// Reports a begin event on construction and an end event on destruction.
+class DxcTraceScope {
+  const char *m_pName;
+  HRESULT m_Status = S_OK;
+
+public:
+  explicit DxcTraceScope(const char *pName) throw() : m_pName(pName) {
+    DxcTraceBegin(m_pName);
+  }
+  ~DxcTraceScope() { DxcTraceEnd(m_pName, m_Status); }
+  void SetStatus(HRESULT status) { m_Status = status; }
+
+  DxcTraceScope(const DxcTraceScope &) = delete;
+  DxcTraceScope &operator=(const DxcTraceScope &) = delete;
+};
+
+#ifndef _WIN32
+#define DxcEtw_DXCompilerCreateInstance_Start() DxcTraceBegin("DXCompilerCreateInstance")
+#define DxcEtw_DXCompilerCreateInstance_Stop(hr) DxcTraceEnd("DXCompilerCreateInstance", hr)
+#define DxcEtw_DXCompilerCompile_Start() DxcTraceBegin("DXCompilerCompile")
+#define DxcEtw_DXCompilerCompile_Stop(hr) DxcTraceEnd("DXCompilerCompile", hr)
+#define DxcEtw_DXCompilerDisassemble_Start() DxcTraceBegin("DXCompilerDisassemble")
+#define DxcEtw_DXCompilerDisassemble_Stop(hr) DxcTraceEnd("DXCompilerDisassemble", hr)
+#define DxcEtw_DXCompilerPreprocess_Start() DxcTraceBegin("DXCompilerPreprocess")
+#define DxcEtw_DXCompilerPreprocess_Stop(hr) DxcTraceEnd("DXCompilerPreprocess", hr)
+#define DxcEtw_DXCompilerInitialization_Start() DxcTraceBegin("DXCompilerInitialization")
+#define DxcEtw_DXCompilerInitialization_Stop(hr) DxcTraceEnd("DXCompilerInitialization", hr)
+#define DxcEtw_DXCompilerShutdown_Start() DxcTraceBegin("DXCompilerShutdown")
+#define DxcEtw_DXCompilerShutdown_Stop(hr) DxcTraceEnd("DXCompilerShutdown", hr)
+#define DxcEtw_DxcValidation_Start() DxcTraceBegin("DxcValidation")
+#define DxcEtw_DxcValidation_Stop(hr) DxcTraceEnd("DxcValidation", hr)
+#endif // !_WIN32
@@ -124,6 +124,11 @@ void ReadBinaryFile(_In_z_ LPCWSTR pFileName,
 void WriteBinaryFile(_In_z_ LPCWSTR pFileName,
                      _In_reads_bytes_(DataSize) const void *pData,
                      _In_ DWORD DataSize);
+// Writes the file under a temporary name next to it, then moves it into
+// place. Readers see either the previous file or the complete new one.
+void WriteBinaryFileAtomically(_In_z_ LPCWSTR pFileName,
+                               _In_reads_bytes_(DataSize) const void *pData,
+                               _In_ DWORD DataSize);
 
 ///////////////////////////////////////////////////////////////////////////////
 // Blob and encoding manipulation functions.
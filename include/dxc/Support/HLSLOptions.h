@@ -103,6 +103,7 @@ public:
   llvm::StringRef OutputObject; // OPT_Fo
   llvm::StringRef OutputWarningsFile; // OPT_Fe
   llvm::StringRef Preprocess; // OPT_P
+  llvm::StringRef StatsFile; // OPT_Fstats
   llvm::StringRef TargetProfile; // OPT_target_profile
   llvm::StringRef VariableName; // OPT_Vn
   llvm::StringRef PrivateSource; // OPT_setprivate
@@ -111,7 +112,13 @@ public:
   llvm::StringRef RootSignatureDefine; // OPT_rootsig_define
   llvm::StringRef FloatDenormalMode; // OPT_denorm
   std::vector<std::string> Exports; // OPT_exports
+  std::vector<std::string> DedupKnown; // OPT_fdedup_known
+  llvm::StringRef DedupTable; // OPT_fdedup_table
   llvm::StringRef DefaultLinkage; // OPT_default_linkage
+  llvm::StringRef ServerSocket; // OPT_server
+  llvm::StringRef ConnectSocket; // OPT_connect
+  llvm::StringRef SourceStore; // OPT_Qsource_store
+  llvm::StringRef LinkCacheDir; // OPT_flink_cache_dir
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
   bool AstDump = false; // OPT_ast_dump
@@ -162,18 +169,34 @@ public:
   bool LegacyMacroExpansion = false; // OPT_flegacy_macro_expansion
   bool LegacyResourceReservation = false; // OPT_flegacy_resource_reservation
   unsigned long AutoBindingSpace = UINT_MAX; // OPT_auto_binding_space
+  unsigned ConstArrayBufferSpace = UINT_MAX; // OPT_const_array_buffer_space
+  uint64_t MemoryLimitMB = 0; // OPT_memory_limit
   bool ExportShadersOnly = false; // OPT_export_shaders_only
   bool ResMayAlias = false; // OPT_res_may_alias
-
-  bool IsRootSignatureProfile();
-  bool IsLibraryProfile();
+  bool FormDotMad = false; // OPT_fform_dot_mad
+  bool FastTranscendentals = false; // OPT_ffast_transcendentals
+  bool LowerIndexedArrays = false; // OPT_flower_indexed_arrays
+  bool IfConversion = false; // OPT_fif_conversion
+  bool WaveAggregateAtomics = false; // OPT_fwave_aggregate_atomics
+  bool RemoveRedundantBarriers = false; // OPT_fremove_redundant_barriers
+  bool GroupsharedBankReport = false; // OPT_fgroupshared_bank_report
+  bool PadGroupshared = false; // OPT_fpad_groupshared
+  bool HotColdSplit = false; // OPT_fhot_cold_split
+  bool HotColdReport = false; // OPT_fhot_cold_report
+  bool LinkOptimize = false; // OPT_flink_optimize
+  bool LinkCache = false; // OPT_flink_cache
+  bool StatsJson = false; // OPT_fstats_json
+  bool Dedup = false; // OPT_fdedup
+
+  bool IsRootSignatureProfile() const;
+  bool IsLibraryProfile() const;
 
   // Helpers to clarify interpretation of flags for behavior in implementation
-  bool IsDebugInfoEnabled();    // Zi
-  bool EmbedDebugInfo();        // Qembed_debug
-  bool EmbedPDBName();          // Zi or Fd
-  bool DebugFileIsDirectory();  // Fd ends in '\\'
-  llvm::StringRef GetPDBName(); // Fd name
+  bool IsDebugInfoEnabled() const;    // Zi
+  bool EmbedDebugInfo() const;        // Qembed_debug
+  bool EmbedPDBName() const;          // Zi or Fd
+  bool DebugFileIsDirectory() const;  // Fd ends in '\\'
+  llvm::StringRef GetPDBName() const; // Fd name
 
   // SPIRV Change Starts
 #ifdef ENABLE_SPIRV_CODEGEN
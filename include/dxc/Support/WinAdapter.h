@@ -103,6 +103,7 @@
 // Map these errors to equivalent errnos.
 #define ERROR_SUCCESS 0L
 #define ERROR_ARITHMETIC_OVERFLOW EOVERFLOW
+#define ERROR_FILE_EXISTS EEXIST
 #define ERROR_FILE_NOT_FOUND ENOENT
 #define ERROR_FUNCTION_NOT_CALLED ENOSYS
 #define ERROR_IO_DEVICE EIO
@@ -162,12 +163,18 @@
 #define OPEN_EXISTING 3
 #define TRUNCATE_EXISTING 5
 
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+
 #define FILE_SHARE_DELETE 0x00000004
 #define FILE_SHARE_READ 0x00000001
 #define FILE_SHARE_WRITE 0x00000002
 
 #define GENERIC_READ 0x80000000
 #define GENERIC_WRITE 0x40000000
+#define FILE_APPEND_DATA 0x00000004
+
+#define PAGE_READONLY 0x02
+#define FILE_MAP_READ 0x0004
 
 #define _atoi64 atoll
 #define sprintf_s snprintf
@@ -191,19 +198,8 @@
 #define CaptureStackBackTrace(FramesToSkip, FramesToCapture, BackTrace, BackTraceHash)\
   backtrace(BackTrace, FramesToCapture)
 
-// Event Tracing for Windows (ETW) provides application programmers the ability
-// to start and stop event tracing sessions, instrument an application to
-// provide trace events, and consume trace events.
-#define DxcEtw_DXCompilerCreateInstance_Start()
-#define DxcEtw_DXCompilerCreateInstance_Stop(hr)
-#define DxcEtw_DXCompilerCompile_Start()
-#define DxcEtw_DXCompilerCompile_Stop(hr)
-#define DxcEtw_DXCompilerDisassemble_Start()
-#define DxcEtw_DXCompilerDisassemble_Stop(hr)
-#define DxcEtw_DXCompilerPreprocess_Start()
-#define DxcEtw_DXCompilerPreprocess_Stop(hr)
-#define DxcEtw_DxcValidation_Start()
-#define DxcEtw_DxcValidation_Stop(hr)
+// Event Tracing for Windows (ETW) is not available; the DxcEtw_* event
+// macros are routed to the portable tracing in dxc/Support/DxcTrace.h.
 
 #define UInt32Add UIntAdd
 #define Int32ToUInt32 IntToUInt
@@ -221,6 +217,7 @@
 #define E_NOINTERFACE (HRESULT)0x80004002
 #define E_NOTIMPL (HRESULT)0x80004001
 #define E_OUTOFMEMORY (HRESULT)0x8007000E
+#define E_PENDING (HRESULT)0x8000000A
 #define E_POINTER (HRESULT)0x80004003
 #define E_UNEXPECTED (HRESULT)0x8000FFFF
 
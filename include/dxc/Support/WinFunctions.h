@@ -58,6 +58,10 @@ BOOL WriteFile(_In_ HANDLE hFile, _In_ LPCVOID lpBuffer,
 
 BOOL CloseHandle(_In_ HANDLE hObject);
 
+BOOL MoveFileExW(_In_ LPCWSTR lpExistingFileName,
+                 _In_opt_ LPCWSTR lpNewFileName, _In_ DWORD dwFlags);
+BOOL DeleteFileW(_In_ LPCWSTR lpFileName);
+
 // Windows-specific heap functions
 HANDLE HeapCreate(DWORD flOptions, SIZE_T dwInitialSize , SIZE_T dwMaximumSize);
 BOOL HeapDestroy(HANDLE heap);
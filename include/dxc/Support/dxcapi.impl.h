@@ -32,7 +32,8 @@ public:
   }
 };
 
-class DxcOperationResult : public IDxcOperationResult {
+class DxcOperationResult : public IDxcOperationResult,
+                           public IDxcOperationResultMemoryUsage {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
 
@@ -50,9 +51,31 @@ public:
   HRESULT m_status;
   CComPtr<IDxcBlob> m_result;
   CComPtr<IDxcBlobEncoding> m_errors;
+  bool m_hasPeakMemoryUsage = false;
+  UINT64 m_peakMemoryUsage = 0;
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcOperationResult>(this, iid, ppvObject);
+    // Memory usage is only reported by operations that measured it.
+    if (!m_hasPeakMemoryUsage &&
+        IsEqualIID(iid, __uuidof(IDxcOperationResultMemoryUsage))) {
+      *ppvObject = nullptr;
+      return E_NOINTERFACE;
+    }
+    return DoBasicQueryInterface<IDxcOperationResult,
+                                 IDxcOperationResultMemoryUsage>(this, iid,
+                                                                 ppvObject);
+  }
+
+  void SetPeakMemoryUsage(UINT64 peakBytes) {
+    m_hasPeakMemoryUsage = true;
+    m_peakMemoryUsage = peakBytes;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetPeakMemoryUsage(_Out_ UINT64 *pPeakBytes) override {
+    if (pPeakBytes == nullptr)
+      return E_INVALIDARG;
+    *pPeakBytes = m_peakMemoryUsage;
+    return S_OK;
   }
 
   static HRESULT CreateFromResultErrorStatus(_In_opt_ IDxcBlob *pResultBlob,
@@ -128,6 +128,17 @@ public:
     return m_createFn2 != nullptr;
   }
 
+  // Returns an export of the loaded library, or nullptr if it has none.
+  template <typename TProc>
+  TProc GetProcedure(_In_z_ LPCSTR fnName) {
+    if (m_dll == nullptr) return nullptr;
+#ifdef _WIN32
+    return (TProc)GetProcAddress(m_dll, fnName);
+#else
+    return (TProc)::dlsym(m_dll, fnName);
+#endif
+  }
+
   bool IsEnabled() const {
     return m_dll != nullptr;
   }
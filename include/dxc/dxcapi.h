@@ -102,6 +102,48 @@ DXC_API_IMPORT HRESULT __stdcall DxcCreateInstance2(
   _Out_ LPVOID*   ppv
 );
 
+/// <summary>
+/// Receives a begin or end event for a compiler phase, such as compilation,
+/// parsing, an optimization pass, validation or container serialization.
+/// Events of a phase nest within those of the enclosing phase on the same
+/// thread.
+/// </summary>
+/// <param name="pUserData">The value passed to DxcSetTraceCallback.</param>
+/// <param name="pEventName">Name of the phase; valid only during the call.</param>
+/// <param name="isBegin">TRUE when the phase starts, FALSE when it ends.</param>
+/// <param name="status">Result of the phase for end events; S_OK otherwise.</param>
+/// <param name="timestampNs">Monotonic time of the event, in nanoseconds.</param>
+typedef void (__stdcall *DxcTraceCallbackProc)(
+  _In_opt_ void *pUserData,
+  _In_ LPCSTR   pEventName,
+  BOOL          isBegin,
+  HRESULT       status,
+  UINT64        timestampNs
+);
+
+typedef HRESULT(__stdcall *DxcSetTraceCallbackProc)(
+  _In_opt_ DxcTraceCallbackProc pCallback,
+  _In_opt_ void                 *pUserData
+);
+
+/// <summary>
+/// Installs a process-wide callback that receives compiler phase events,
+/// or removes it when pCallback is NULL. The callback may be invoked
+/// concurrently from every thread that uses the compiler.
+/// </summary>
+/// <remarks>
+/// Setting the DXC_TRACE_FILE environment variable before the library is
+/// loaded additionally writes the events to that file as Chrome trace-event
+/// JSON.
+/// </remarks>
+#ifndef _MSC_VER
+extern "C"
+#endif
+DXC_API_IMPORT HRESULT __stdcall DxcSetTraceCallback(
+  _In_opt_ DxcTraceCallbackProc pCallback,
+  _In_opt_ void                 *pUserData
+);
+
 
 // IDxcBlob is an alias of ID3D10Blob and ID3DBlob
 struct __declspec(uuid("8BA5FB08-5195-40e2-AC58-0D989C3A0102"))
@@ -160,6 +202,16 @@ IDxcOperationResult : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcOperationResult)
 };
 
+// Available from the result of IDxcCompiler::Compile.
+struct __declspec(uuid("eed52e50-72f3-4d1f-a425-9271ccc9f1be"))
+IDxcOperationResultMemoryUsage : public IUnknown {
+  // Peak number of bytes the operation had allocated at once through the
+  // compiler's allocator.
+  virtual HRESULT STDMETHODCALLTYPE GetPeakMemoryUsage(_Out_ UINT64 *pPeakBytes) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcOperationResultMemoryUsage)
+};
+
 struct __declspec(uuid("7f61fc7d-950d-467f-b3e3-3c02fb49187c"))
 IDxcIncludeHandler : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE LoadSource(
@@ -233,6 +285,59 @@ IDxcCompiler2 : public IDxcCompiler {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
 };
 
+// Arguments parsed and validated once, to compile many shaders with the same
+// options. Create them with IDxcCompiler3::CreateArgs.
+struct __declspec(uuid("5E0D2A9B-3C47-4F1E-9B6A-7D2C81E4F035"))
+IDxcCompilerArgs : public IUnknown {
+  // Gets whether the arguments are valid. Compiling with invalid arguments
+  // fails with the errors reported when they were parsed.
+  virtual HRESULT STDMETHODCALLTYPE GetStatus(_Out_ HRESULT *pStatus) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetErrors(
+    _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppErrors) = 0;
+
+  // Creates a copy of these arguments with another entry point or target
+  // profile and more defines. Only a new target profile requires the
+  // arguments to be validated again.
+  virtual HRESULT STDMETHODCALLTYPE Clone(
+    _In_opt_ LPCWSTR pEntryPoint,                 // New entry point name, or null to keep it
+    _In_opt_ LPCWSTR pTargetProfile,              // New shader profile, or null to keep it
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines to add
+    _In_ UINT32 defineCount,                      // Number of defines
+    _COM_Outptr_ IDxcCompilerArgs **ppResult      // Arguments with the changes applied
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompilerArgs)
+};
+
+struct __declspec(uuid("B2E5A1C8-6F0D-4A3B-8E79-C4D16F2B9A57"))
+IDxcCompiler3 : public IDxcCompiler2 {
+  // Parse and validate arguments to compile with later.
+  virtual HRESULT STDMETHODCALLTYPE CreateArgs(
+    _In_ LPCWSTR pEntryPoint,                     // Entry point name
+    _In_ LPCWSTR pTargetProfile,                  // Shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _COM_Outptr_ IDxcCompilerArgs **ppArgs        // Parsed arguments
+  ) = 0;
+
+  // Compile with arguments created by this library. The same as
+  // CompileWithDebug with the values the arguments were created with.
+  // Arguments implemented elsewhere fail with E_INVALIDARG.
+  virtual HRESULT STDMETHODCALLTYPE CompileWithArgs(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ IDxcCompilerArgs *pArgs,                 // Parsed arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult,  // Compiler output status, buffer, and errors
+    _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,// Suggested file name for debug blob.
+    _COM_Outptr_opt_ IDxcBlob **ppDebugBlob       // Debug blob
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler3)
+};
+
 struct __declspec(uuid("F1B5BE2A-62DD-4327-A1C2-42AC1E1E78E6"))
 IDxcLinker : public IUnknown {
 public:
@@ -597,6 +597,33 @@ enum DxcCompletionChunkKind
   DxcCompletionChunk_VerticalSpace = 20,
 };
 
+/// <summary>A cursor in an outline from IDxcTranslationUnit2::GetCursorOutline.</summary>
+/// <remarks>Extents are where the cursor appears in the file, after macro expansion.</remarks>
+struct DxcCursorOutlineNode
+{
+  DxcCursorKind Kind;
+  DxcCursorKindFlags KindFlags;
+  unsigned ParentIndex; // The closest enclosing node in the outline, or DxcCursorOutlineNoParent.
+  unsigned NameOffset;  // Offset of the null-terminated spelling in the string table.
+  unsigned StartOffset;
+  unsigned StartLine;
+  unsigned StartColumn;
+  unsigned EndOffset;
+  unsigned EndLine;
+  unsigned EndColumn;
+};
+
+static const unsigned DxcCursorOutlineNoParent = 0xFFFFFFFF;
+
+/// <summary>An outline is this header, followed by NodeCount nodes and then the string table.</summary>
+struct DxcCursorOutline
+{
+  unsigned NodeCount;
+  unsigned StringTableOffset; // From the start of the outline.
+  unsigned StringTableSize;
+  unsigned TotalSize;
+};
+
 struct IDxcCursor;
 struct IDxcDiagnostic;
 struct IDxcFile;
@@ -791,6 +818,22 @@ IDxcTranslationUnit : public IUnknown
       _Outptr_result_nullonfailure_ IDxcCodeCompleteResults **pResult) = 0;
 };
 
+/// <summary>Extends IDxcTranslationUnit; query an IDxcTranslationUnit for it.</summary>
+struct __declspec(uuid("b0071361-0c39-48e9-bda8-910f8f184a79"))
+IDxcTranslationUnit2 : public IDxcTranslationUnit
+{
+  /// <summary>Walks the cursors of a file once and returns them as a flat outline, in document order.</summary>
+  /// <param name="range">If not null, only cursors in the file of the range that overlap it are included; otherwise those in the main file.</param>
+  /// <param name="kinds">If not empty, only cursors of these kinds are included; the children of other cursors are still walked.</param>
+  /// <param name="pResult">The outline, to be freed with CoTaskMemFree.</param>
+  virtual HRESULT STDMETHODCALLTYPE GetCursorOutline(
+      _In_opt_ IDxcSourceRange* range,
+      _In_count_(numKinds) const DxcCursorKind* kinds, unsigned numKinds,
+      _Outptr_result_nullonfailure_ DxcCursorOutline** pResult) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcTranslationUnit2)
+};
+
 struct __declspec(uuid("2ec912fd-b144-4a15-ad0d-1c5439c81e46"))
 IDxcType : public IUnknown
 {
@@ -830,6 +873,81 @@ IDxcCompletionString : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE GetCompletionChunkText(unsigned chunkNumber, _Out_ LPSTR* pResult) = 0;
 };
 
+struct IDxcIntelliSenseOperation;
+
+struct __declspec(uuid("c0c89317-5cbe-4885-8f8c-c5bdaef828d2"))
+IDxcIntelliSenseCallback : public IUnknown
+{
+  /// <summary>Called on a worker thread once the operation has completed, failed or been cancelled.</summary>
+  /// <remarks>Later asynchronous requests to the same object start after this returns; a synchronous request made here never returns while any are queued.</remarks>
+  virtual HRESULT STDMETHODCALLTYPE OnCompleted(_In_ IDxcIntelliSenseOperation* operation) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSenseCallback)
+};
+
+/// <summary>An IntelliSense request running in the background.</summary>
+struct __declspec(uuid("8d3582aa-a808-4607-b38a-8f5ca1b1c6e1"))
+IDxcIntelliSenseOperation : public IUnknown
+{
+  /// <summary>Abandons the operation. A queued operation does not start, and a running one stops at the next top-level declaration.</summary>
+  /// <returns>S_FALSE if the operation had already completed.</returns>
+  virtual HRESULT STDMETHODCALLTYPE Cancel() = 0;
+  /// <summary>Blocks until the operation has completed.</summary>
+  virtual HRESULT STDMETHODCALLTYPE Wait() = 0;
+  virtual HRESULT STDMETHODCALLTYPE IsCompleted(_Out_ BOOL* pResult) = 0;
+  /// <summary>Gets E_PENDING until the operation has completed, then its result; E_ABORT if it was cancelled.</summary>
+  virtual HRESULT STDMETHODCALLTYPE GetStatus(_Out_ HRESULT* pStatus) = 0;
+  /// <summary>Gets the translation unit that was parsed or reparsed, or the code completion results.</summary>
+  /// <remarks>Returns the status of the operation if it has not completed successfully.</remarks>
+  virtual HRESULT STDMETHODCALLTYPE GetResult(_In_ REFIID iid, _COM_Outptr_ void** ppResult) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSenseOperation)
+};
+
+/// <summary>Parses translation units in the background; query an IDxcIndex for it.</summary>
+struct __declspec(uuid("55edb28d-e0a4-4365-876e-2ab530329838"))
+IDxcIndexAsync : public IUnknown
+{
+  /// <summary>Starts parsing a translation unit. The unsaved files are read before this returns.</summary>
+  virtual HRESULT STDMETHODCALLTYPE ParseTranslationUnitAsync(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args,
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files,
+      DxcTranslationUnitFlags options,
+      _In_opt_ IDxcIntelliSenseCallback* callback,
+      _COM_Outptr_ IDxcIntelliSenseOperation** pOperation) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIndexAsync)
+};
+
+/// <summary>Reparses and completes code in the background; query an IDxcTranslationUnit for it.</summary>
+/// <remarks>
+/// All requests to a translation unit, including the synchronous ones, run
+/// one at a time in the order they were made. The asynchronous ones share a
+/// single worker thread per translation unit.
+/// A cancelled reparse may leave the translation unit partially parsed until
+/// it is reparsed again.
+/// </remarks>
+struct __declspec(uuid("5631da38-590b-4353-9a33-8fa8e0167127"))
+IDxcTranslationUnitAsync : public IUnknown
+{
+  virtual HRESULT STDMETHODCALLTYPE ReparseAsync(
+    _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+    unsigned num_unsaved_files,
+    _In_opt_ IDxcIntelliSenseCallback* callback,
+    _COM_Outptr_ IDxcIntelliSenseOperation** pOperation) = 0;
+  virtual HRESULT STDMETHODCALLTYPE CodeCompleteAtAsync(
+      _In_z_ const char *fileName, unsigned line, unsigned column,
+      _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles, unsigned numUnsavedFiles,
+      _In_ DxcCodeCompleteFlags options,
+      _In_opt_ IDxcIntelliSenseCallback* callback,
+      _COM_Outptr_ IDxcIntelliSenseOperation** pOperation) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcTranslationUnitAsync)
+};
+
 // Fun fact: 'extern' is required because const is by default static in C++, so
 // CLSID_DxcIntelliSense is not visible externally (this is OK in C, since const is
 // not by default static in C)
@@ -474,6 +474,22 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+// HLSL Change Starts - pass tracing
+/// Callback invoked before (Begin == true) and after each module or function
+/// pass runs, so that hosts can report pass timing in their own traces.
+typedef void (*PassTraceCallback)(const char *PassName, bool Begin);
+void setPassTraceCallback(PassTraceCallback Callback);
+
+/// Reports the begin and end of a pass run to the pass trace callback.
+class PassTraceRegion {
+  const char *Name;
+
+public:
+  explicit PassTraceRegion(Pass *P);
+  ~PassTraceRegion();
+};
+// HLSL Change Ends
+
 }
 
 #endif
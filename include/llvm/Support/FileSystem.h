@@ -693,6 +693,9 @@ private:
   /// Platform-specific mapping state.
   uint64_t Size;
   void *Mapping;
+#ifndef _WIN32
+  bool FileSystemMapping = false; // HLSL Change - mapped by the MSFileSystem
+#endif
 
   std::error_code init(int FD, uint64_t Offset, mapmode Mode);
 
@@ -16,6 +16,7 @@
 #define LLVM_TRANSFORMS_IPO_PASSMANAGERBUILDER_H
 
 #include <vector>
+#include <climits> // HLSL Change
 
 namespace hlsl {
   class HLSLExtensionsCodegenHelper;
@@ -129,6 +130,17 @@ public:
   bool HLSLHighLevel = false; // HLSL Change
   hlsl::HLSLExtensionsCodegenHelper *HLSLExtensionsCodeGen = nullptr; // HLSL Change
   bool HLSLResMayAlias = false; // HLSL Change
+  bool HLSLFormDotMad = false; // HLSL Change
+  bool HLSLFastTranscendentals = false; // HLSL Change
+  bool HLSLLowerIndexedArrays = false; // HLSL Change
+  bool HLSLIfConversion = false; // HLSL Change
+  bool HLSLWaveAggregateAtomics = false; // HLSL Change
+  bool HLSLRemoveRedundantBarriers = false; // HLSL Change
+  bool HLSLGroupsharedBankReport = false; // HLSL Change
+  bool HLSLPadGroupshared = false; // HLSL Change
+  bool HLSLHotColdSplit = false; // HLSL Change
+  bool HLSLHotColdReport = false; // HLSL Change
+  unsigned HLSLConstArrayBufferSpace = UINT_MAX; // HLSL Change
 
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
@@ -0,0 +1,371 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompileStats.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Machine-readable compile statistics for a DXIL module.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilCompileStats.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/Support/Global.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+void WriteJsonString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned char C : Str) {
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (C < 0x20)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+      break;
+    }
+  }
+  OS << '"';
+}
+
+void WriteJsonCounterMap(raw_ostream &OS, const DxilCompileStatMap &Map,
+                         StringRef Indent) {
+  OS << "{";
+  bool First = true;
+  for (auto &It : Map) {
+    OS << (First ? "\n" : ",\n") << Indent << "  ";
+    WriteJsonString(OS, It.first);
+    OS << ": " << It.second;
+    First = false;
+  }
+  if (!First)
+    OS << "\n" << Indent;
+  OS << "}";
+}
+
+// Number of 32-bit registers needed to hold a value of type Ty. Pointers
+// refer to memory (allocas, groupshared, resources) and are not counted.
+unsigned GetScalarRegCount(Type *Ty) {
+  if (VectorType *VT = dyn_cast<VectorType>(Ty))
+    return VT->getNumElements() * GetScalarRegCount(VT->getElementType());
+  if (ArrayType *AT = dyn_cast<ArrayType>(Ty))
+    return AT->getNumElements() * GetScalarRegCount(AT->getElementType());
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    unsigned Count = 0;
+    for (Type *EltTy : ST->elements())
+      Count += GetScalarRegCount(EltTy);
+    return Count;
+  }
+  if (Ty->isIntegerTy() || Ty->isFloatingPointTy())
+    return Ty->getPrimitiveSizeInBits() > 32 ? 2 : 1;
+  return 0;
+}
+
+bool IsRegisterValue(Value *V) {
+  return (isa<Instruction>(V) || isa<Argument>(V)) &&
+         GetScalarRegCount(V->getType()) != 0;
+}
+
+typedef SmallPtrSet<Value *, 32> LiveSet;
+
+unsigned GetPressure(const LiveSet &Live) {
+  unsigned Pressure = 0;
+  for (Value *V : Live)
+    Pressure += GetScalarRegCount(V->getType());
+  return Pressure;
+}
+
+// Values live out of BB, given the live-in sets of its successors.
+void ComputeLiveOut(BasicBlock *BB, DenseMap<BasicBlock *, LiveSet> &LiveIn,
+                    LiveSet &LiveOut) {
+  for (BasicBlock *Succ : successors(BB)) {
+    // Live-in sets never contain the successor's own phis.
+    for (Value *V : LiveIn[Succ])
+      LiveOut.insert(V);
+    for (Instruction &I : *Succ) {
+      PHINode *Phi = dyn_cast<PHINode>(&I);
+      if (!Phi)
+        break;
+      Value *Incoming = Phi->getIncomingValueForBlock(BB);
+      if (IsRegisterValue(Incoming))
+        LiveOut.insert(Incoming);
+    }
+  }
+}
+
+// Walks BB backwards from its live-out set, returning the largest pressure
+// seen and leaving the live-in set in Live.
+unsigned ScanBlockBackwards(BasicBlock *BB, LiveSet &Live) {
+  unsigned MaxPressure = GetPressure(Live);
+  for (auto It = BB->rbegin(), E = BB->rend(); It != E; ++It) {
+    Instruction &I = *It;
+    Live.erase(&I);
+    if (isa<PHINode>(I) || isa<DbgInfoIntrinsic>(I))
+      continue;
+    for (Value *Op : I.operands()) {
+      if (IsRegisterValue(Op))
+        Live.insert(Op);
+    }
+    MaxPressure = std::max(MaxPressure, GetPressure(Live));
+  }
+  return MaxPressure;
+}
+
+// Estimates register usage as the largest number of live 32-bit scalars at
+// any point in F. This ignores the packing and rematerialization a driver
+// compiler would do, but tracks relative cost between shader variants.
+unsigned EstimateMaxLiveScalars(Function &F) {
+  DenseMap<BasicBlock *, LiveSet> LiveIn;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  std::vector<BasicBlock *> PostOrder(RPOT.begin(), RPOT.end());
+  std::reverse(PostOrder.begin(), PostOrder.end());
+
+  // Live sets only grow, so iterate until no block's live-in size changes.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (BasicBlock *BB : PostOrder) {
+      LiveSet Live;
+      ComputeLiveOut(BB, LiveIn, Live);
+      ScanBlockBackwards(BB, Live);
+      LiveSet &In = LiveIn[BB];
+      if (Live.size() != In.size()) {
+        In = Live;
+        Changed = true;
+      }
+    }
+  }
+
+  unsigned MaxPressure = 0;
+  for (BasicBlock *BB : PostOrder) {
+    LiveSet Live;
+    ComputeLiveOut(BB, LiveIn, Live);
+    MaxPressure = std::max(MaxPressure, ScanBlockBackwards(BB, Live));
+  }
+  return MaxPressure;
+}
+
+struct ResourceUse {
+  const DxilResourceBase *Res;
+  uint64_t OpCalls;
+};
+
+class ResourceUseTracker {
+public:
+  template <typename T>
+  void AddResources(const std::vector<std::unique_ptr<T>> &Resources) {
+    for (auto &Res : Resources) {
+      unsigned Idx = m_Uses.size();
+      m_Uses.push_back({Res.get(), 0});
+      m_ByID[std::make_pair((unsigned)Res->GetClass(), Res->GetID())] = Idx;
+      if (Constant *Symbol = Res->GetGlobalSymbol())
+        m_BySymbol[Symbol] = Idx;
+    }
+  }
+
+  void CountCall(CallInst *CI, Type *HandleTy) {
+    // Count each resource once per call, even if passed more than once.
+    SmallPtrSet<ResourceUse *, 4> Counted;
+    for (Value *Arg : CI->arg_operands()) {
+      if (Arg->getType() != HandleTy)
+        continue;
+      ResourceUse *Use = Resolve(Arg);
+      if (!Use) {
+        ++m_UnresolvedCalls;
+        continue;
+      }
+      if (Counted.insert(Use).second)
+        ++Use->OpCalls;
+    }
+  }
+
+  const std::vector<ResourceUse> &GetUses() const { return m_Uses; }
+  uint64_t GetUnresolvedCalls() const { return m_UnresolvedCalls; }
+
+private:
+  ResourceUse *Resolve(Value *Handle) {
+    CallInst *CI = dyn_cast<CallInst>(Handle);
+    if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+      return nullptr;
+    switch (OP::GetDxilOpFuncCallInst(CI)) {
+    case DXIL::OpCode::CreateHandle: {
+      DxilInst_CreateHandle CH(CI);
+      ConstantInt *Class = dyn_cast<ConstantInt>(CH.get_resourceClass());
+      ConstantInt *RangeID = dyn_cast<ConstantInt>(CH.get_rangeId());
+      if (!Class || !RangeID)
+        return nullptr;
+      auto It = m_ByID.find(std::make_pair((unsigned)Class->getZExtValue(),
+                                           (unsigned)RangeID->getZExtValue()));
+      return It == m_ByID.end() ? nullptr : &m_Uses[It->second];
+    }
+    case DXIL::OpCode::CreateHandleForLib: {
+      DxilInst_CreateHandleForLib CH(CI);
+      LoadInst *LI = dyn_cast<LoadInst>(CH.get_Resource());
+      if (!LI)
+        return nullptr;
+      Value *Ptr = LI->getPointerOperand();
+      while (GEPOperator *GEP = dyn_cast<GEPOperator>(Ptr))
+        Ptr = GEP->getPointerOperand();
+      auto It = m_BySymbol.find(Ptr);
+      return It == m_BySymbol.end() ? nullptr : &m_Uses[It->second];
+    }
+    default:
+      return nullptr;
+    }
+  }
+
+  std::vector<ResourceUse> m_Uses;
+  std::map<std::pair<unsigned, unsigned>, unsigned> m_ByID;
+  DenseMap<Value *, unsigned> m_BySymbol;
+  uint64_t m_UnresolvedCalls = 0;
+};
+
+} // namespace
+
+void hlsl::WriteDxilCompileStatsJson(DxilModule &DM, raw_ostream &OS) {
+  Module &M = *DM.GetModule();
+  const DataLayout &DL = M.getDataLayout();
+  Type *HandleTy = DM.GetOP()->GetHandleType();
+
+  ResourceUseTracker Resources;
+  Resources.AddResources(DM.GetCBuffers());
+  Resources.AddResources(DM.GetSamplers());
+  Resources.AddResources(DM.GetSRVs());
+  Resources.AddResources(DM.GetUAVs());
+
+  DxilCompileStatMap OpClassCounts;
+  DxilCompileStatMap InstOpcodeCounts;
+  uint64_t FunctionCount = 0, InstCount = 0, DxilOpCount = 0;
+  uint64_t BlockCount = 0, LoopCount = 0;
+  uint64_t AllocaCount = 0, AllocaBytes = 0;
+  unsigned MaxLoopDepth = 0, MaxLiveScalars = 0;
+
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    ++FunctionCount;
+    BlockCount += F.size();
+
+    DominatorTree DT;
+    DT.recalculate(F);
+    LoopInfo LI;
+    LI.Analyze(DT);
+    for (BasicBlock &BB : F) {
+      unsigned Depth = LI.getLoopDepth(&BB);
+      MaxLoopDepth = std::max(MaxLoopDepth, Depth);
+      if (LI.isLoopHeader(&BB))
+        ++LoopCount;
+    }
+
+    for (BasicBlock &BB : F) {
+      for (Instruction &I : BB) {
+        if (isa<DbgInfoIntrinsic>(I))
+          continue;
+        ++InstCount;
+        if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+          ++AllocaCount;
+          AllocaBytes += DL.getTypeAllocSize(AI->getAllocatedType());
+        }
+        if (OP::IsDxilOpFuncCallInst(&I)) {
+          CallInst *CI = cast<CallInst>(&I);
+          ++DxilOpCount;
+          ++OpClassCounts[OP::GetOpCodeClassName(OP::GetDxilOpFuncCallInst(CI))];
+          Resources.CountCall(CI, HandleTy);
+        } else {
+          ++InstOpcodeCounts[I.getOpcodeName()];
+        }
+      }
+    }
+
+    MaxLiveScalars = std::max(MaxLiveScalars, EstimateMaxLiveScalars(F));
+  }
+
+  uint64_t TGSMCount = 0, TGSMBytes = 0;
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.getType()->getPointerAddressSpace() != DXIL::kTGSMAddrSpace)
+      continue;
+    ++TGSMCount;
+    TGSMBytes += DL.getTypeAllocSize(GV.getType()->getElementType());
+  }
+
+  const ShaderModel *SM = DM.GetShaderModel();
+  OS << "{\n";
+  OS << "  \"shaderModel\": ";
+  WriteJsonString(OS, SM->GetName());
+  OS << ",\n  \"entryPoint\": ";
+  WriteJsonString(OS, DM.GetEntryFunctionName());
+  OS << ",\n  \"functions\": " << FunctionCount;
+  OS << ",\n  \"instructions\": " << InstCount;
+  OS << ",\n  \"dxilOpCalls\": " << DxilOpCount;
+  OS << ",\n  \"basicBlocks\": " << BlockCount;
+  OS << ",\n  \"loops\": " << LoopCount;
+  OS << ",\n  \"maxLoopDepth\": " << MaxLoopDepth;
+  OS << ",\n  \"estimatedMaxLiveScalars\": " << MaxLiveScalars;
+  OS << ",\n  \"dxilOpClasses\": ";
+  WriteJsonCounterMap(OS, OpClassCounts, "  ");
+  OS << ",\n  \"instructionOpcodes\": ";
+  WriteJsonCounterMap(OS, InstOpcodeCounts, "  ");
+
+  OS << ",\n  \"resources\": [";
+  bool First = true;
+  for (const ResourceUse &Use : Resources.GetUses()) {
+    OS << (First ? "\n" : ",\n") << "    { \"class\": ";
+    WriteJsonString(OS, Use.Res->GetResClassName());
+    OS << ", \"id\": " << Use.Res->GetID() << ", \"name\": ";
+    WriteJsonString(OS, Use.Res->GetGlobalName());
+    OS << ", \"space\": " << Use.Res->GetSpaceID()
+       << ", \"lowerBound\": " << Use.Res->GetLowerBound()
+       << ", \"dxilOpCalls\": " << Use.OpCalls << " }";
+    First = false;
+  }
+  if (!First)
+    OS << "\n  ";
+  OS << "]";
+  OS << ",\n  \"unresolvedHandleCalls\": " << Resources.GetUnresolvedCalls();
+
+  OS << ",\n  \"tempArrays\": { \"allocas\": " << AllocaCount
+     << ", \"allocaBytes\": " << AllocaBytes
+     << ", \"groupsharedVariables\": " << TGSMCount
+     << ", \"groupsharedBytes\": " << TGSMBytes << " }";
+
+  if (!SM->IsLib()) {
+    OS << ",\n  \"signatureRows\": { \"input\": "
+       << DM.GetInputSignature().GetRowCount()
+       << ", \"output\": " << DM.GetOutputSignature().GetRowCount()
+       << ", \"patchConstantOrPrimitive\": "
+       << DM.GetPatchConstOrPrimSignature().GetRowCount() << " }";
+  }
+
+  OS << ",\n  \"counters\": ";
+  WriteJsonCounterMap(OS, DM.GetCompileStats(), "  ");
+  OS << "\n}\n";
+  OS.flush();
+}
@@ -57,11 +57,13 @@ const char DxilMDHelper::kDxilRootSignatureMDName[]                   = "dx.root
 const char DxilMDHelper::kDxilIntermediateOptionsMDName[]             = "dx.intermediateOptions";
 const char DxilMDHelper::kDxilViewIdStateMDName[]                     = "dx.viewIdState";
 const char DxilMDHelper::kDxilSubobjectsMDName[]                      = "dx.subobjects";
+const char DxilMDHelper::kDxilConstantArrayDataMDName[]               = "dx.constArrayData";
 
 const char DxilMDHelper::kDxilSourceContentsMDName[]                  = "dx.source.contents";
 const char DxilMDHelper::kDxilSourceDefinesMDName[]                   = "dx.source.defines";
 const char DxilMDHelper::kDxilSourceMainFileNameMDName[]              = "dx.source.mainFileName";
 const char DxilMDHelper::kDxilSourceArgsMDName[]                      = "dx.source.args";
+const char DxilMDHelper::kDxilSourceStoreMDName[]                     = "dx.source.store";
 
 static std::array<const char *, 7> DxilMDNames = { {
   DxilMDHelper::kDxilVersionMDName,
@@ -417,6 +419,42 @@ void DxilMDHelper::LoadRootSignature(std::vector<uint8_t> &SerializedRootSignatu
          (const uint8_t *)pData->getRawDataValues().begin(), size);
 }
 
+void DxilMDHelper::EmitConstantArrayData(const std::vector<uint8_t> &Data) {
+  if (Data.empty()) {
+    return;
+  }
+
+  Constant *V = llvm::ConstantDataArray::get(
+      m_Ctx, llvm::ArrayRef<uint8_t>(Data.data(), Data.size()));
+
+  NamedMDNode *pDataNamedMD = m_pModule->getNamedMetadata(kDxilConstantArrayDataMDName);
+  IFTBOOL(pDataNamedMD == nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+  pDataNamedMD = m_pModule->getOrInsertNamedMetadata(kDxilConstantArrayDataMDName);
+  pDataNamedMD->addOperand(MDNode::get(m_Ctx, {ConstantAsMetadata::get(V)}));
+}
+
+void DxilMDHelper::LoadConstantArrayData(std::vector<uint8_t> &Data) {
+  NamedMDNode *pDataNamedMD = m_pModule->getNamedMetadata(kDxilConstantArrayDataMDName);
+  if (!pDataNamedMD)
+    return;
+
+  IFTBOOL(pDataNamedMD->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
+
+  MDNode *pNode = pDataNamedMD->getOperand(0);
+  IFTBOOL(pNode->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
+  const ConstantAsMetadata *pMetaData =
+      dyn_cast<ConstantAsMetadata>(pNode->getOperand(0).get());
+  IFTBOOL(pMetaData != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+  const ConstantDataArray *pData =
+      dyn_cast<ConstantDataArray>(pMetaData->getValue());
+  IFTBOOL(pData != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+  IFTBOOL(pData->getElementType() == Type::getInt8Ty(m_Ctx),
+          DXC_E_INCORRECT_DXIL_METADATA);
+
+  StringRef Raw = pData->getRawDataValues();
+  Data.assign((const uint8_t *)Raw.begin(), (const uint8_t *)Raw.end());
+}
+
 static const MDTuple *CastToTupleOrNull(const MDOperand &MDO) {
   if (MDO.get() == nullptr)
     return nullptr;
@@ -1176,6 +1176,32 @@ void DxilModule::ResetSubobjects(DxilSubobjects *subobjects) {
   m_pSubobjects.reset(subobjects);
 }
 
+void DxilModule::AddCompileStat(llvm::StringRef Name, uint64_t Value) {
+  AddDxilCompileStat(m_CompileStats, Name, Value);
+}
+const DxilCompileStatMap &DxilModule::GetCompileStats() const {
+  return m_CompileStats;
+}
+void DxilModule::SetCompileStats(const DxilCompileStatMap &Stats) {
+  m_CompileStats = Stats;
+}
+
+const std::vector<uint8_t> &DxilModule::GetConstantArrayData() const {
+  return m_ConstantArrayData;
+}
+void DxilModule::SetConstantArrayData(std::vector<uint8_t> &&Data) {
+  m_ConstantArrayData = std::move(Data);
+}
+
+bool DxilModule::StripConstantArrayDataFromMetadata() {
+  NamedMDNode *pDataNamedMD = GetModule()->getNamedMetadata(DxilMDHelper::kDxilConstantArrayDataMDName);
+  if (pDataNamedMD) {
+    GetModule()->eraseNamedMetadata(pDataNamedMD);
+    return true;
+  }
+  return false;
+}
+
 bool DxilModule::StripSubobjectsFromMetadata() {
   NamedMDNode *pSubobjectsNamedMD = GetModule()->getNamedMetadata(DxilMDHelper::kDxilSubobjectsMDName);
   if (pSubobjectsNamedMD) {
@@ -1291,6 +1317,7 @@ void DxilModule::ClearDxilMetadata(Module &M) {
       name == DxilMDHelper::kDxilTypeSystemMDName ||
       name == DxilMDHelper::kDxilViewIdStateMDName ||
       name == DxilMDHelper::kDxilSubobjectsMDName ||
+      name == DxilMDHelper::kDxilConstantArrayDataMDName ||
       name.startswith(DxilMDHelper::kDxilTypeSystemHelperVariablePrefix)) {
       nodes.push_back(&b);
     }
@@ -1373,6 +1400,7 @@ void DxilModule::EmitDxilMetadata() {
   if (!m_SerializedRootSignature.empty()) {
     m_pMDHelper->EmitRootSignature(m_SerializedRootSignature);
   }
+  m_pMDHelper->EmitConstantArrayData(m_ConstantArrayData);
 }
 
 bool DxilModule::IsKnownNamedMetaData(llvm::NamedMDNode &Node) {
@@ -1473,6 +1501,7 @@ void DxilModule::LoadDxilMetadata() {
   m_pMDHelper->LoadDxilTypeSystem(*m_pTypeSystem.get());
 
   m_pMDHelper->LoadRootSignature(m_SerializedRootSignature);
+  m_pMDHelper->LoadConstantArrayData(m_ConstantArrayData);
 
   m_pMDHelper->LoadDxilViewIdState(m_SerializedState);
 }
@@ -1641,6 +1670,10 @@ void DxilModule::StripDebugRelatedCode() {
           m_pModule->getNamedMetadata(DxilMDHelper::kDxilSourceArgsMDName)) {
     arguments->eraseFromParent();
   }
+  if (NamedMDNode *store =
+          m_pModule->getNamedMetadata(DxilMDHelper::kDxilSourceStoreMDName)) {
+    store->eraseFromParent();
+  }
 
   if (NamedMDNode *flags = m_pModule->getModuleFlagsMetadata()) {
     SmallVector<llvm::Module::ModuleFlagEntry, 4> flagEntries;
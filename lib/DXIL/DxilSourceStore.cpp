@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSourceStore.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Helpers to keep debug source contents in a shared store.                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilSourceStore.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinFunctions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+
+#ifndef _WIN32
+#include <limits.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+using namespace hlsl;
+
+// The store is outside of the files the compiler is given access to, so it is
+// read and written directly rather than through the LLVM file system.
+static std::wstring GetStorePath(StringRef StoreDir, StringRef Hash) {
+  SmallString<256> Path(StoreDir);
+  sys::path::append(Path, Hash);
+  std::wstring WidePath;
+  IFTBOOL(Unicode::UTF8ToUTF16String(Path.c_str(), &WidePath),
+          E_INVALIDARG);
+  return WidePath;
+}
+
+static bool IsInStore(LPCWSTR pPath) {
+  HANDLE hFile = CreateFileW(pPath, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return false;
+  CloseHandle(hFile);
+  return true;
+}
+
+static SmallString<32> GetContentsHash(StringRef Contents) {
+  MD5 md5;
+  MD5::MD5Result Digest;
+  md5.update(Contents);
+  md5.final(Digest);
+  SmallString<32> Hash;
+  MD5::stringifyResult(Digest, Hash);
+  return Hash;
+}
+
+// The store is named in the debug information, which outlives the working
+// directory of the compile.
+static std::string GetAbsoluteStoreDir(StringRef StoreDir) {
+  if (sys::path::is_absolute(StoreDir))
+    return StoreDir;
+#ifdef _WIN32
+  std::wstring WideDir;
+  IFTBOOL(Unicode::UTF8ToUTF16String(StoreDir.str().c_str(), &WideDir),
+          E_INVALIDARG);
+  DWORD Length = GetFullPathNameW(WideDir.c_str(), 0, nullptr, nullptr);
+  IFTBOOL(Length != 0, HRESULT_FROM_WIN32(GetLastError()));
+  std::wstring WideFullDir(Length, L'\0');
+  Length = GetFullPathNameW(WideDir.c_str(), Length, &WideFullDir[0], nullptr);
+  IFTBOOL(Length != 0 && Length < WideFullDir.size(),
+          HRESULT_FROM_WIN32(GetLastError()));
+  WideFullDir.resize(Length);
+  std::string FullDir;
+  IFTBOOL(Unicode::UTF16ToUTF8String(WideFullDir.c_str(), &FullDir),
+          E_INVALIDARG);
+  return FullDir;
+#else
+  char Cwd[PATH_MAX];
+  IFTBOOL(getcwd(Cwd, sizeof(Cwd)) != nullptr,
+          HRESULT_FROM_WIN32(GetLastError()));
+  SmallString<256> FullDir(Cwd);
+  sys::path::append(FullDir, StoreDir);
+  return FullDir.str();
+#endif
+}
+
+static void WriteToStore(StringRef StoreDir, StringRef Hash,
+                         StringRef Contents) {
+  std::wstring Path = GetStorePath(StoreDir, Hash);
+  if (IsInStore(Path.c_str()))
+    return;
+  // Another compile may add the same source in the meantime. Its contents are
+  // the same, so either copy may win.
+  try {
+    WriteBinaryFileAtomically(Path.c_str(), Contents.data(), Contents.size());
+  } catch (hlsl::Exception &) {
+    if (!IsInStore(Path.c_str()))
+      throw;
+  }
+}
+
+void hlsl::MoveDebugSourcesToStore(Module &M, StringRef StoreDir) {
+  NamedMDNode *pContents =
+      M.getNamedMetadata(DxilMDHelper::kDxilSourceContentsMDName);
+  if (!pContents)
+    return;
+
+  std::string FullStoreDir = GetAbsoluteStoreDir(StoreDir);
+  LLVMContext &Ctx = M.getContext();
+  MDString *pEmpty = MDString::get(Ctx, "");
+  for (unsigned i = 0; i < pContents->getNumOperands(); ++i) {
+    MDNode *pFileInfo = pContents->getOperand(i);
+    if (pFileInfo->getNumOperands() != 2)
+      continue;
+    StringRef Contents = cast<MDString>(pFileInfo->getOperand(1))->getString();
+    SmallString<32> Hash = GetContentsHash(Contents);
+
+    WriteToStore(FullStoreDir, Hash, Contents);
+    pContents->setOperand(
+        i, MDNode::get(Ctx, {pFileInfo->getOperand(0), pEmpty,
+                             MDString::get(Ctx, Hash)}));
+  }
+
+  NamedMDNode *pStore =
+      M.getOrInsertNamedMetadata(DxilMDHelper::kDxilSourceStoreMDName);
+  pStore->dropAllReferences();
+  pStore->addOperand(MDNode::get(Ctx, MDString::get(Ctx, FullStoreDir)));
+}
+
+StringRef hlsl::GetDebugSourceStore(const Module &M) {
+  const NamedMDNode *pStore =
+      M.getNamedMetadata(DxilMDHelper::kDxilSourceStoreMDName);
+  if (!pStore || pStore->getNumOperands() != 1 ||
+      pStore->getOperand(0)->getNumOperands() != 1)
+    return StringRef();
+  MDString *pDir = dyn_cast<MDString>(pStore->getOperand(0)->getOperand(0));
+  return pDir ? pDir->getString() : StringRef();
+}
+
+bool hlsl::LoadDebugSourceFromStore(StringRef StoreDir, StringRef Hash,
+                                    std::string &Contents) {
+  // Hashes come from the module, so keep them from naming other files.
+  if (StoreDir.empty() || Hash.empty() ||
+      Hash.find_first_not_of("0123456789abcdef") != StringRef::npos)
+    return false;
+  std::wstring Path = GetStorePath(StoreDir, Hash);
+  HANDLE hFile = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return false;
+  CHandle h(hFile);
+  LARGE_INTEGER FileSize;
+  if (!GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart > UINT32_MAX)
+    return false;
+  DWORD Size = (DWORD)FileSize.QuadPart;
+  Contents.resize(Size);
+  DWORD BytesRead;
+  if (Size != 0 && (!ReadFile(hFile, &Contents[0], Size, &BytesRead, nullptr) ||
+                    BytesRead != Size))
+    return false;
+  // The store is shared, so do not trust a file to hold what its name says.
+  return GetContentsHash(Contents) == Hash;
+}
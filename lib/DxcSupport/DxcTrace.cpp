@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcTrace.cpp                                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides portable begin/end tracing of compiler phases.                   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/DxcTrace.h"
+#include "llvm/Support/Compiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// The trace state is plain data guarded by a mutex so that recording an event
+// never allocates; events may be reported while a caller-provided IMalloc is
+// installed for the thread, and after it has been released.
+static std::mutex g_TraceMutex;
+static std::atomic<bool> g_TraceEnabled(false);
+static DxcTraceCallbackProc g_pTraceCallback;
+static void *g_pTraceUserData;
+static FILE *g_pTraceFile;
+static unsigned g_TracePid;
+
+// Active phases on this thread, innermost last. Phases nested deeper than
+// the array are counted but not named.
+static const unsigned kMaxTracePhaseDepth = 32;
+static LLVM_THREAD_LOCAL const char *t_TracePhases[kMaxTracePhaseDepth];
+static LLVM_THREAD_LOCAL unsigned t_TracePhaseDepth;
+
+static uint64_t GetTraceTimestampNs() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static unsigned GetTraceTid() {
+#ifdef _WIN32
+  return GetCurrentThreadId();
+#else
+  return (unsigned)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+static void UpdateTraceEnabled() {
+  g_TraceEnabled.store(g_pTraceCallback != nullptr || g_pTraceFile != nullptr,
+                       std::memory_order_release);
+}
+
+// Copies pName into pDest as the body of a JSON string. Characters that would
+// need escaping are replaced, as event names are identifiers.
+static void CopyTraceEventName(char *pDest, size_t DestSize,
+                               const char *pName) {
+  size_t i = 0;
+  for (; pName[i] && i + 1 < DestSize; ++i) {
+    char c = pName[i];
+    pDest[i] = (c == '"' || c == '\\' || (unsigned char)c < 0x20) ? '_' : c;
+  }
+  pDest[i] = '\0';
+}
+
+static void WriteTraceEvent(const char *pName, bool isBegin, HRESULT status,
+                            uint64_t timestampNs) {
+  char name[256];
+  char line[512];
+  CopyTraceEventName(name, sizeof(name), pName);
+  int len;
+  if (isBegin) {
+    len = snprintf(line, sizeof(line),
+                   "{\"name\":\"%s\",\"cat\":\"dxc\",\"ph\":\"B\","
+                   "\"ts\":%.3f,\"pid\":%u,\"tid\":%u},\n",
+                   name, timestampNs / 1000.0, g_TracePid, GetTraceTid());
+  } else {
+    len = snprintf(line, sizeof(line),
+                   "{\"name\":\"%s\",\"cat\":\"dxc\",\"ph\":\"E\","
+                   "\"ts\":%.3f,\"pid\":%u,\"tid\":%u,"
+                   "\"args\":{\"hr\":\"0x%08x\"}},\n",
+                   name, timestampNs / 1000.0, g_TracePid, GetTraceTid(),
+                   (unsigned)status);
+  }
+  if (len <= 0)
+    return;
+  std::lock_guard<std::mutex> lock(g_TraceMutex);
+  if (g_pTraceFile)
+    fwrite(line, 1, std::min((size_t)len, sizeof(line) - 1), g_pTraceFile);
+}
+
+static void ReportTraceEvent(const char *pName, bool isBegin, HRESULT status) {
+  uint64_t timestampNs = GetTraceTimestampNs();
+  DxcTraceCallbackProc pCallback;
+  void *pUserData;
+  bool hasFile;
+  {
+    std::lock_guard<std::mutex> lock(g_TraceMutex);
+    pCallback = g_pTraceCallback;
+    pUserData = g_pTraceUserData;
+    hasFile = g_pTraceFile != nullptr;
+  }
+  // The callback is invoked without the lock held so it may itself
+  // install or clear the callback.
+  if (pCallback)
+    pCallback(pUserData, pName, isBegin ? TRUE : FALSE, status, timestampNs);
+  if (hasFile)
+    WriteTraceEvent(pName, isBegin, status, timestampNs);
+}
+
+void DxcTraceInitialize() throw() {
+  const char *pPath = ::getenv("DXC_TRACE_FILE");
+  if (pPath == nullptr || *pPath == '\0')
+    return;
+  std::lock_guard<std::mutex> lock(g_TraceMutex);
+  if (g_pTraceFile)
+    return;
+#ifdef _WIN32
+  g_TracePid = GetCurrentProcessId();
+#else
+  g_TracePid = (unsigned)getpid();
+#endif
+  g_pTraceFile = fopen(pPath, "w");
+  if (g_pTraceFile) {
+    fputs("[\n", g_pTraceFile);
+    UpdateTraceEnabled();
+  }
+}
+
+void DxcTraceShutdown() throw() {
+  std::lock_guard<std::mutex> lock(g_TraceMutex);
+  if (g_pTraceFile) {
+    // Every event line ends with a comma; close the array with a metadata
+    // event so the file is well-formed JSON.
+    fprintf(g_pTraceFile,
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+            "\"args\":{\"name\":\"dxcompiler\"}}\n]\n",
+            g_TracePid);
+    fclose(g_pTraceFile);
+    g_pTraceFile = nullptr;
+  }
+  g_pTraceCallback = nullptr;
+  g_pTraceUserData = nullptr;
+  UpdateTraceEnabled();
+}
+
+void DxcSetTraceCallbackImpl(DxcTraceCallbackProc pCallback,
+                             void *pUserData) throw() {
+  std::lock_guard<std::mutex> lock(g_TraceMutex);
+  g_pTraceCallback = pCallback;
+  g_pTraceUserData = pCallback ? pUserData : nullptr;
+  UpdateTraceEnabled();
+}
+
+bool DxcIsTraceEnabled() throw() {
+  return g_TraceEnabled.load(std::memory_order_acquire);
+}
+
+void DxcTraceBegin(const char *pName) throw() {
+  if (t_TracePhaseDepth < kMaxTracePhaseDepth)
+    t_TracePhases[t_TracePhaseDepth] = pName;
+  ++t_TracePhaseDepth;
+  if (DxcIsTraceEnabled())
+    ReportTraceEvent(pName, true, S_OK);
+}
+
+void DxcTraceEnd(const char *pName, HRESULT status) throw() {
+  if (t_TracePhaseDepth > 0)
+    --t_TracePhaseDepth;
+  if (DxcIsTraceEnabled())
+    ReportTraceEvent(pName, false, status);
+}
+
+const char *DxcTraceGetCurrentPhase() throw() {
+  unsigned depth = std::min(t_TracePhaseDepth, kMaxTracePhaseDepth);
+  return depth ? t_TracePhases[depth - 1] : nullptr;
+}
@@ -16,9 +16,11 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/WinFunctions.h"
 #include "dxc/dxcapi.h"
+#include "llvm/Support/Process.h"
 
 #include <algorithm>
 #include <memory>
+#include <string>
 
 #ifdef _WIN32
 #include <intsafe.h>
@@ -139,6 +141,40 @@ void WriteBinaryFile(LPCWSTR pFileName, const void *pData, DWORD DataSize) {
   DXASSERT(DataSize == BytesWritten, "WriteFile operation failed");
 }
 
+void WriteBinaryFileAtomically(LPCWSTR pFileName, const void *pData,
+                               DWORD DataSize) {
+  std::wstring TempName;
+  HANDLE hFile = INVALID_HANDLE_VALUE;
+  for (unsigned Attempt = 0; hFile == INVALID_HANDLE_VALUE; ++Attempt) {
+    TempName = pFileName;
+    TempName += L".";
+    TempName += std::to_wstring(llvm::sys::Process::GetRandomNumber());
+    TempName += L".tmp";
+    hFile = CreateFileW(TempName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_NEW,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+      DWORD Error = GetLastError();
+      if (Error != ERROR_FILE_EXISTS || Attempt == 16)
+        IFT(HRESULT_FROM_WIN32(Error));
+    }
+  }
+
+  HRESULT hr = S_OK;
+  DWORD BytesWritten;
+  if (!WriteFile(hFile, pData, DataSize, &BytesWritten, nullptr) ||
+      BytesWritten != DataSize)
+    hr = E_FAIL;
+  if (!CloseHandle(hFile) && SUCCEEDED(hr))
+    hr = HRESULT_FROM_WIN32(GetLastError());
+  if (SUCCEEDED(hr) &&
+      !MoveFileExW(TempName.c_str(), pFileName, MOVEFILE_REPLACE_EXISTING))
+    hr = HRESULT_FROM_WIN32(GetLastError());
+  if (FAILED(hr)) {
+    DeleteFileW(TempName.c_str());
+    IFT(hr);
+  }
+}
+
 _Use_decl_annotations_
 UINT32 DxcCodePageFromBytes(const char *bytes, size_t byteLen) throw() {
   UINT32 codePage;
@@ -128,32 +128,32 @@ void DxcDefines::BuildDefines() {
   }
 }
 
-bool DxcOpts::IsRootSignatureProfile() {
+bool DxcOpts::IsRootSignatureProfile() const {
   return TargetProfile == "rootsig_1_0" ||
       TargetProfile == "rootsig_1_1";
 }
 
-bool DxcOpts::IsLibraryProfile() {
+bool DxcOpts::IsLibraryProfile() const {
   return TargetProfile.startswith("lib_");
 }
 
-bool DxcOpts::IsDebugInfoEnabled() {
+bool DxcOpts::IsDebugInfoEnabled() const {
   return DebugInfo;
 }
 
-bool DxcOpts::EmbedDebugInfo() {
+bool DxcOpts::EmbedDebugInfo() const {
   return EmbedDebug;
 }
 
-bool DxcOpts::EmbedPDBName() {
+bool DxcOpts::EmbedPDBName() const {
   return IsDebugInfoEnabled() || !DebugFile.empty();
 }
 
-bool DxcOpts::DebugFileIsDirectory() {
+bool DxcOpts::DebugFileIsDirectory() const {
   return !DebugFile.empty() && llvm::sys::path::is_separator(DebugFile[DebugFile.size() - 1]);
 }
 
-llvm::StringRef DxcOpts::GetPDBName() {
+llvm::StringRef DxcOpts::GetPDBName() const {
   if (!DebugFileIsDirectory())
     return DebugFile;
   return llvm::StringRef();
@@ -329,6 +329,12 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     return 1;
   }
 
+  // A compile server takes the rest of its options from each request.
+  opts.ServerSocket = Args.getLastArgValue(OPT_server);
+  if (!opts.ServerSocket.empty()) {
+    return 0;
+  }
+
   if (!Args.hasArg(hlsl::options::OPT_Qunused_arguments)) {
     for (const Arg *A : Args.filtered(OPT_UNKNOWN)) {
       errors << "Unknown argument: '" << A->getAsString(Args).c_str() << "'";
@@ -426,6 +432,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.OutputObject = Args.getLastArgValue(OPT_Fo);
   opts.OutputHeader = Args.getLastArgValue(OPT_Fh);
   opts.OutputWarningsFile = Args.getLastArgValue(OPT_Fe);
+  opts.StatsFile = Args.getLastArgValue(OPT_Fstats);
   opts.UseColor = Args.hasFlag(OPT_Cc, OPT_INVALID, false);
   opts.UseInstructionNumbers = Args.hasFlag(OPT_Ni, OPT_INVALID, false);
   opts.UseInstructionByteOffsets = Args.hasFlag(OPT_No, OPT_INVALID, false);
@@ -475,8 +482,44 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     }
   }
 
+  llvm::StringRef const_array_buffer_space = Args.getLastArgValue(OPT_const_array_buffer_space);
+  if (!const_array_buffer_space.empty()) {
+    if (const_array_buffer_space.getAsInteger(10, opts.ConstArrayBufferSpace) ||
+        opts.ConstArrayBufferSpace == UINT_MAX) {
+      errors << "Unsupported value '" << const_array_buffer_space << "' for constant array buffer space.";
+      return 1;
+    }
+  }
+
+  llvm::StringRef memory_limit = Args.getLastArgValue(OPT_memory_limit);
+  if (!memory_limit.empty()) {
+    if (memory_limit.getAsInteger(10, opts.MemoryLimitMB) ||
+        opts.MemoryLimitMB == 0) {
+      errors << "Unsupported value '" << memory_limit
+             << "' for memory limit, expected a positive number of megabytes.";
+      return 1;
+    }
+  }
+
   opts.Exports = Args.getAllArgValues(OPT_exports);
 
+  opts.DedupKnown = Args.getAllArgValues(OPT_fdedup_known);
+  opts.DedupTable = Args.getLastArgValue(OPT_fdedup_table);
+  opts.Dedup = Args.hasFlag(OPT_fdedup, OPT_INVALID, false) ||
+               !opts.DedupKnown.empty();
+  for (const std::string &Known : opts.DedupKnown) {
+    llvm::StringRef Fingerprint, Name;
+    std::tie(Fingerprint, Name) = llvm::StringRef(Known).split('=');
+    if (Fingerprint.size() != 32 ||
+        Fingerprint.find_first_not_of("0123456789abcdefABCDEF") !=
+            llvm::StringRef::npos ||
+        Name.empty()) {
+      errors << "Unsupported value '" << Known
+             << "' for -fdedup-known option, expected <fingerprint>=<name>.";
+      return 1;
+    }
+  }
+
   opts.DefaultLinkage = Args.getLastArgValue(OPT_default_linkage);
   if (!opts.DefaultLinkage.empty()) {
     if (!(opts.DefaultLinkage.equals_lower("internal") ||
@@ -539,6 +582,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.DefaultRowMajor = Args.hasFlag(OPT_Zpr, OPT_INVALID, false);
   opts.DefaultColMajor = Args.hasFlag(OPT_Zpc, OPT_INVALID, false);
   opts.DumpBin = Args.hasFlag(OPT_dumpbin, OPT_INVALID, false);
+  opts.ConnectSocket = Args.getLastArgValue(OPT_connect);
   opts.NotUseLegacyCBufLoad = Args.hasFlag(OPT_not_use_legacy_cbuf_load, OPT_INVALID, false);
   opts.PackPrefixStable = Args.hasFlag(OPT_pack_prefix_stable, OPT_INVALID, false);
   opts.PackOptimized = Args.hasFlag(OPT_pack_optimized, OPT_INVALID, false);
@@ -549,6 +593,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.RecompileFromBinary = Args.hasFlag(OPT_recompile, OPT_INVALID, false);
   opts.StripDebug = Args.hasFlag(OPT_Qstrip_debug, OPT_INVALID, false);
   opts.EmbedDebug = Args.hasFlag(OPT_Qembed_debug, OPT_INVALID, false);
+  opts.SourceStore = Args.getLastArgValue(OPT_Qsource_store);
   opts.StripRootSignature = Args.hasFlag(OPT_Qstrip_rootsignature, OPT_INVALID, false);
   opts.StripPrivate = Args.hasFlag(OPT_Qstrip_priv, OPT_INVALID, false);
   opts.StripReflection = Args.hasFlag(OPT_Qstrip_reflect, OPT_INVALID, false);
@@ -561,6 +606,21 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.LegacyResourceReservation = Args.hasFlag(OPT_flegacy_resource_reservation, OPT_INVALID, false);
   opts.ExportShadersOnly = Args.hasFlag(OPT_export_shaders_only, OPT_INVALID, false);
   opts.ResMayAlias = Args.hasFlag(OPT_res_may_alias, OPT_INVALID, false);
+  opts.FormDotMad = Args.hasFlag(OPT_fform_dot_mad, OPT_INVALID, false);
+  opts.FastTranscendentals = Args.hasFlag(OPT_ffast_transcendentals, OPT_INVALID, false);
+  opts.LowerIndexedArrays = Args.hasFlag(OPT_flower_indexed_arrays, OPT_INVALID, false);
+  opts.IfConversion = Args.hasFlag(OPT_fif_conversion, OPT_INVALID, false);
+  opts.WaveAggregateAtomics = Args.hasFlag(OPT_fwave_aggregate_atomics, OPT_INVALID, false);
+  opts.RemoveRedundantBarriers = Args.hasFlag(OPT_fremove_redundant_barriers, OPT_INVALID, false);
+  opts.GroupsharedBankReport = Args.hasFlag(OPT_fgroupshared_bank_report, OPT_INVALID, false);
+  opts.PadGroupshared = Args.hasFlag(OPT_fpad_groupshared, OPT_INVALID, false);
+  opts.HotColdSplit = Args.hasFlag(OPT_fhot_cold_split, OPT_INVALID, false);
+  opts.HotColdReport = Args.hasFlag(OPT_fhot_cold_report, OPT_INVALID, false);
+  opts.LinkOptimize = Args.hasFlag(OPT_flink_optimize, OPT_INVALID, false);
+  opts.LinkCacheDir = Args.getLastArgValue(OPT_flink_cache_dir);
+  opts.LinkCache = Args.hasFlag(OPT_flink_cache, OPT_INVALID, false) ||
+                   !opts.LinkCacheDir.empty();
+  opts.StatsJson = Args.hasFlag(OPT_fstats_json, OPT_INVALID, false);
 
   if (opts.DefaultColMajor && opts.DefaultRowMajor) {
     errors << "Cannot specify /Zpr and /Zpc together, use /? to get usage information";
@@ -630,6 +690,11 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     return 1;
   }
 
+  if (!opts.SourceStore.empty() && !opts.DebugInfo) {
+    errors << "Must enable debug info with /Zi for /Qsource_store";
+    return 1;
+  }
+
   if (opts.DebugInfo && !opts.DebugNameForBinary && !opts.DebugNameForSource) {
     opts.DebugNameForBinary = true;
   } else if (opts.DebugNameForBinary && opts.DebugNameForSource) {
@@ -15,6 +15,7 @@
 #ifndef _WIN32
 #include <fcntl.h>
 #include <map>
+#include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -181,9 +182,15 @@ HANDLE CreateFileW(_In_ LPCWSTR lpFileName, _In_ DWORD dwDesiredAccess,
       flags |= O_RDWR;
     else
       flags |= O_WRONLY;
+  else if (dwDesiredAccess & FILE_APPEND_DATA)
+    flags |= O_WRONLY;
   else // dwDesiredAccess may be 0, but open() demands something here. This is mostly harmless
     flags |= O_RDONLY;
 
+  // Appending writes land at the end of the file even with other writers.
+  if (dwDesiredAccess & FILE_APPEND_DATA)
+    flags |= O_APPEND;
+
   if (dwCreationDisposition == CREATE_ALWAYS)
     flags |= (O_CREAT | O_TRUNC);
   if (dwCreationDisposition == OPEN_ALWAYS)
@@ -258,6 +265,21 @@ BOOL CloseHandle(_In_ HANDLE hObject) {
   return !close(fd);
 }
 
+BOOL MoveFileExW(_In_ LPCWSTR lpExistingFileName,
+                 _In_opt_ LPCWSTR lpNewFileName, _In_ DWORD dwFlags) {
+  // Implementation limitation: rename() always replaces the target.
+  assert(lpNewFileName && (dwFlags & MOVEFILE_REPLACE_EXISTING) &&
+         "Only replacing moves are supported in MoveFileExW yet.");
+  CW2A pUtf8Existing(lpExistingFileName);
+  CW2A pUtf8New(lpNewFileName);
+  return !rename(pUtf8Existing, pUtf8New);
+}
+
+BOOL DeleteFileW(_In_ LPCWSTR lpFileName) {
+  CW2A pUtf8FileName(lpFileName);
+  return !unlink(pUtf8FileName);
+}
+
 // Half-hearted implementation of a heap structure
 // Enables size queries, maximum allocation limit, and collective free at heap destruction
 // Does not perform any preallocation or allocation organization.
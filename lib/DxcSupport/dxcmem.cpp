@@ -5,7 +5,7 @@
 // This file is distributed under the University of Illinois Open Source     //
 // License. See LICENSE.TXT for details.                                     //
 //                                                                           //
-// Provides support for a thread-local allocator.                            //
+// Provides support for a thread-local allocator and memory accounting.     //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -16,10 +16,19 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/WinFunctions.h"
+#include "dxc/Support/DxcMemoryAccounting.h"
+#include "dxc/Support/DxcTrace.h"
 #include "llvm/Support/ThreadLocal.h"
+#include <algorithm>
+#include <cstring>
 #include <memory>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
 
 static llvm::sys::ThreadLocal<IMalloc> *g_ThreadMallocTls;
+static llvm::sys::ThreadLocal<DxcMemoryAccountingMalloc> *g_ThreadAccountingTls;
 static IMalloc *g_pDefaultMalloc;
 
 HRESULT DxcInitThreadMalloc() throw() {
@@ -37,11 +46,27 @@ HRESULT DxcInitThreadMalloc() throw() {
   }
   g_ThreadMallocTls = new(g_ThreadMallocTls) llvm::sys::ThreadLocal<IMalloc>;
 
+  g_ThreadAccountingTls = (llvm::sys::ThreadLocal<DxcMemoryAccountingMalloc>*)g_pDefaultMalloc->Alloc(sizeof(llvm::sys::ThreadLocal<DxcMemoryAccountingMalloc>));
+  if (g_ThreadAccountingTls == nullptr) {
+    g_ThreadMallocTls->llvm::sys::ThreadLocal<IMalloc>::~ThreadLocal();
+    g_pDefaultMalloc->Free(g_ThreadMallocTls);
+    g_ThreadMallocTls = nullptr;
+    g_pDefaultMalloc->Release();
+    g_pDefaultMalloc = nullptr;
+    return E_OUTOFMEMORY;
+  }
+  g_ThreadAccountingTls = new(g_ThreadAccountingTls) llvm::sys::ThreadLocal<DxcMemoryAccountingMalloc>;
+
   return S_OK;
 }
 
 void DxcCleanupThreadMalloc() throw() {
   if (g_ThreadMallocTls) {
+    // Clear the accounting TLS first, so operator new stops consulting it.
+    llvm::sys::ThreadLocal<DxcMemoryAccountingMalloc> *pAccountingTls = g_ThreadAccountingTls;
+    g_ThreadAccountingTls = nullptr;
+    pAccountingTls->llvm::sys::ThreadLocal<DxcMemoryAccountingMalloc>::~ThreadLocal();
+    g_pDefaultMalloc->Free(pAccountingTls);
     g_ThreadMallocTls->llvm::sys::ThreadLocal<IMalloc>::~ThreadLocal();
     g_pDefaultMalloc->Free(g_ThreadMallocTls);
     g_ThreadMallocTls = nullptr;
@@ -80,6 +105,14 @@ static IMalloc *DxcSwapThreadMalloc(IMalloc *pMalloc, IMalloc **ppPrior) throw()
   return pMalloc;
 }
 
+static DxcMemoryAccountingMalloc *
+DxcSwapThreadAccounting(DxcMemoryAccountingMalloc *pMalloc) throw() {
+  DXASSERT(g_ThreadAccountingTls != nullptr, "else prior to DxcInitThreadMalloc or after DxcCleanupThreadMalloc");
+  DxcMemoryAccountingMalloc *pPrior = g_ThreadAccountingTls->get();
+  g_ThreadAccountingTls->set(pMalloc);
+  return pPrior;
+}
+
 DxcThreadMalloc::DxcThreadMalloc(IMalloc *pMallocOrNull) throw() {
     p = DxcSwapThreadMalloc(pMallocOrNull ? pMallocOrNull : g_pDefaultMalloc, &pPrior);
 }
@@ -87,3 +120,261 @@ DxcThreadMalloc::DxcThreadMalloc(IMalloc *pMallocOrNull) throw() {
 DxcThreadMalloc::~DxcThreadMalloc() {
     DxcSwapThreadMalloc(pPrior, nullptr);
 }
+
+DxcMemoryAccountingScope::DxcMemoryAccountingScope(
+    DxcMemoryAccountingMalloc *pMalloc) throw() {
+  m_pPrior = DxcSwapThreadAccounting(pMalloc);
+}
+
+DxcMemoryAccountingScope::~DxcMemoryAccountingScope() {
+  DxcSwapThreadAccounting(m_pPrior);
+}
+
+static DxcMemoryAccountingMalloc *DxcGetThreadAccountingNoRef() throw() {
+  // operator new runs before DxcInitThreadMalloc and after
+  // DxcCleanupThreadMalloc, when there is nothing to charge.
+  return g_ThreadAccountingTls ? g_ThreadAccountingTls->get() : nullptr;
+}
+
+void *DxcAccountedNew(size_t cb) throw() {
+#ifdef _WIN32
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  void *pv = pMalloc->Alloc(cb);
+#else
+  void *pv = malloc(cb ? cb : 1);
+#endif
+  if (pv == nullptr)
+    return nullptr;
+  DxcMemoryAccountingMalloc *pAccounting = DxcGetThreadAccountingNoRef();
+#ifdef _WIN32
+  // The accounting allocator has already charged what it allocated.
+  if (pAccounting == pMalloc)
+    pAccounting = nullptr;
+#endif
+  if (pAccounting && !pAccounting->ChargeBlock(pv, cb)) {
+#ifdef _WIN32
+    pMalloc->Free(pv);
+#else
+    free(pv);
+#endif
+    return nullptr;
+  }
+  return pv;
+}
+
+void DxcAccountedDelete(void *pv) throw() {
+  if (pv == nullptr)
+    return;
+#ifdef _WIN32
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  DxcMemoryAccountingMalloc *pAccounting = DxcGetThreadAccountingNoRef();
+  if (pAccounting && pAccounting != pMalloc)
+    pAccounting->UnchargeBlock(pv);
+  pMalloc->Free(pv);
+#else
+  if (DxcMemoryAccountingMalloc *pAccounting = DxcGetThreadAccountingNoRef())
+    pAccounting->UnchargeBlock(pv);
+  free(pv);
+#endif
+}
+
+void *DxcAccountedNewAligned(size_t cb, size_t alignment) throw() {
+#ifdef _WIN32
+  void *pv = _aligned_malloc(cb ? cb : 1, alignment);
+#else
+  void *pv = nullptr;
+  if (posix_memalign(&pv, std::max(alignment, sizeof(void *)), cb ? cb : 1))
+    pv = nullptr;
+#endif
+  if (pv == nullptr)
+    return nullptr;
+  DxcMemoryAccountingMalloc *pAccounting = DxcGetThreadAccountingNoRef();
+  if (pAccounting && !pAccounting->ChargeBlock(pv, cb)) {
+    DxcAccountedDeleteAligned(pv);
+    return nullptr;
+  }
+  return pv;
+}
+
+void DxcAccountedDeleteAligned(void *pv) throw() {
+  if (pv == nullptr)
+    return;
+  if (DxcMemoryAccountingMalloc *pAccounting = DxcGetThreadAccountingNoRef())
+    pAccounting->UnchargeBlock(pv);
+#ifdef _WIN32
+  _aligned_free(pv);
+#else
+  free(pv);
+#endif
+}
+
+DxcMemoryAccountingMalloc::~DxcMemoryAccountingMalloc() {
+  if (m_pSizes)
+    m_pMalloc->Free(m_pSizes);
+}
+
+bool DxcMemoryAccountingMalloc::TryReserve(uint64_t cb) {
+  uint64_t limit = m_LimitBytes;
+  uint64_t current = (m_CurrentBytes += cb);
+  if (limit != 0 && current > limit) {
+    m_CurrentBytes -= cb;
+    if (!m_LimitExceeded.exchange(true))
+      m_pLimitPhase = DxcTraceGetCurrentPhase();
+    return false;
+  }
+  uint64_t peak = m_PeakBytes;
+  while (current > peak && !m_PeakBytes.compare_exchange_weak(peak, current)) {
+  }
+  return true;
+}
+
+void DxcMemoryAccountingMalloc::Unreserve(uint64_t cb) {
+  m_CurrentBytes -= cb;
+}
+
+// Marks a size table slot whose block has been freed.
+static void *const kFreedBlock = reinterpret_cast<void *>(~(uintptr_t)0);
+
+// Returns the slot holding pv or, if there is none, the empty slot that ends
+// its probe sequence. The table must have been allocated.
+DxcMemoryAccountingMalloc::SizeEntry *
+DxcMemoryAccountingMalloc::FindSize(void *pv) {
+  uint64_t hash = (uintptr_t)pv;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  size_t mask = m_SizesCapacity - 1;
+  size_t i = (size_t)hash & mask;
+  while (m_pSizes[i].pBlock != pv && m_pSizes[i].pBlock != nullptr)
+    i = (i + 1) & mask;
+  return &m_pSizes[i];
+}
+
+// Rehashes into a table with room for at least as many blocks again.
+bool DxcMemoryAccountingMalloc::GrowSizes() {
+  size_t liveCount = 0;
+  for (size_t i = 0; i < m_SizesCapacity; ++i) {
+    if (m_pSizes[i].pBlock != nullptr && m_pSizes[i].pBlock != kFreedBlock)
+      ++liveCount;
+  }
+  size_t capacity = 256;
+  while (capacity < liveCount * 4)
+    capacity *= 2;
+  SizeEntry *pNew = (SizeEntry *)m_pMalloc->Alloc(capacity * sizeof(SizeEntry));
+  if (pNew == nullptr)
+    return false;
+  memset(pNew, 0, capacity * sizeof(SizeEntry));
+  SizeEntry *pOld = m_pSizes;
+  size_t oldCapacity = m_SizesCapacity;
+  m_pSizes = pNew;
+  m_SizesCapacity = capacity;
+  m_SizesUsed = liveCount;
+  for (size_t i = 0; i < oldCapacity; ++i) {
+    if (pOld[i].pBlock != nullptr && pOld[i].pBlock != kFreedBlock)
+      *FindSize(pOld[i].pBlock) = pOld[i];
+  }
+  if (pOld)
+    m_pMalloc->Free(pOld);
+  return true;
+}
+
+bool DxcMemoryAccountingMalloc::RecordSize(void *pv, uint64_t cb) {
+  std::lock_guard<std::mutex> lock(m_SizesLock);
+  // Keep at least a quarter of the slots empty so probes terminate quickly.
+  if ((m_SizesUsed + 1) * 4 > m_SizesCapacity * 3 && !GrowSizes())
+    return false;
+  SizeEntry *pEntry = FindSize(pv);
+  if (pEntry->pBlock == nullptr)
+    ++m_SizesUsed;
+  pEntry->pBlock = pv;
+  pEntry->Size = cb;
+  return true;
+}
+
+// Removes and returns the recorded size of pv, or zero if it has none.
+uint64_t DxcMemoryAccountingMalloc::TakeSize(void *pv) {
+  std::lock_guard<std::mutex> lock(m_SizesLock);
+  if (m_pSizes == nullptr)
+    return 0;
+  SizeEntry *pEntry = FindSize(pv);
+  if (pEntry->pBlock == nullptr)
+    return 0;
+  pEntry->pBlock = kFreedBlock;
+  return pEntry->Size;
+}
+
+bool DxcMemoryAccountingMalloc::ChargeBlock(void *pv, uint64_t cb) {
+  if (!TryReserve(cb))
+    return false;
+  if (!RecordSize(pv, cb)) {
+    Unreserve(cb);
+    return false;
+  }
+  return true;
+}
+
+void DxcMemoryAccountingMalloc::UnchargeBlock(void *pv) {
+  Unreserve(TakeSize(pv));
+}
+
+void *DxcMemoryAccountingMalloc::Alloc(SIZE_T cb) {
+  if (!TryReserve(cb))
+    return nullptr;
+  void *p = m_pMalloc->Alloc(cb);
+  if (p == nullptr) {
+    Unreserve(cb);
+    return nullptr;
+  }
+  if (!RecordSize(p, cb)) {
+    m_pMalloc->Free(p);
+    Unreserve(cb);
+    return nullptr;
+  }
+  return p;
+}
+
+void *DxcMemoryAccountingMalloc::Realloc(void *pv, SIZE_T cb) {
+  if (pv == nullptr)
+    return Alloc(cb);
+  if (cb == 0) {
+    Free(pv);
+    return nullptr;
+  }
+  // Charge the new size up front, and release the old one once the block has
+  // moved; a block that wasn't charged is taken over at its new size.
+  if (!TryReserve(cb))
+    return nullptr;
+  void *p = m_pMalloc->Realloc(pv, cb);
+  if (p == nullptr) {
+    Unreserve(cb);
+    return nullptr;
+  }
+  Unreserve(TakeSize(pv));
+  if (!RecordSize(p, cb)) {
+    // The block can't be tracked; leave it uncharged rather than fail, as
+    // the original block is gone.
+    Unreserve(cb);
+  }
+  return p;
+}
+
+void DxcMemoryAccountingMalloc::Free(void *pv) {
+  if (pv == nullptr)
+    return;
+  Unreserve(TakeSize(pv));
+  m_pMalloc->Free(pv);
+}
+
+#ifdef _WIN32
+SIZE_T DxcMemoryAccountingMalloc::GetSize(void *pv) {
+  return m_pMalloc->GetSize(pv);
+}
+
+int DxcMemoryAccountingMalloc::DidAlloc(void *pv) {
+  return m_pMalloc->DidAlloc(pv);
+}
+
+void DxcMemoryAccountingMalloc::HeapMinimize(void) {
+  m_pMalloc->HeapMinimize();
+}
+#endif
@@ -15,10 +15,12 @@
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/ADT/STLExtras.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilCompileStats.h"
 #include "dxc/DXIL/DxilShaderModel.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
@@ -31,6 +33,7 @@
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/DxcTrace.h"
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
 #include <algorithm>
@@ -1498,10 +1501,12 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
                                            AbstractMemoryStream *pFinalStream,
                                            llvm::StringRef DebugName,
                                            SerializeDxilFlags Flags,
-                                           DxilShaderHash *pShaderHashOut) {
+                                           DxilShaderHash *pShaderHashOut,
+                                           const DxilShaderFingerprint *pFingerprint) {
   // TODO: add a flag to update the module and remove information that is not part
   // of DXIL proper and is used only to assemble the container.
 
+  DxcTraceScope TraceScope("SerializeDxilContainer");
   DXASSERT_NOMSG(pModule != nullptr);
   DXASSERT_NOMSG(pModuleBitcode != nullptr);
   DXASSERT_NOMSG(pFinalStream != nullptr);
@@ -1516,6 +1521,45 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
 
   DxilContainerWriter_impl writer;
 
+  // Write the compile statistics part. Gather these before any metadata or
+  // debug info is stripped below, and pad the JSON text with trailing spaces
+  // to keep the part dword-aligned.
+  std::string StatsJson;
+  if (Flags & SerializeDxilFlags::IncludeStatisticsPart) {
+    raw_string_ostream OS(StatsJson);
+    WriteDxilCompileStatsJson(*pModule, OS);
+    OS.flush();
+    StatsJson.resize(PSVALIGN4(StatsJson.size()), ' ');
+    writer.AddPart(DFCC_CompileStatistics, StatsJson.size(),
+                   [&](AbstractMemoryStream *pStream) {
+                     ULONG cbWritten;
+                     IFT(pStream->Write(StatsJson.data(), StatsJson.size(),
+                                        &cbWritten));
+                   });
+  }
+
+  if (pFingerprint) {
+    DxilShaderFingerprint FingerprintContent = *pFingerprint;
+    writer.AddPart(DFCC_ShaderFingerprint, sizeof(FingerprintContent),
+      [FingerprintContent]
+      (AbstractMemoryStream *pStream)
+    {
+      IFT(WriteStreamValue(pStream, FingerprintContent));
+    });
+  }
+
+  // Write the data of the buffer generated for constant arrays.
+  const std::vector<uint8_t> &ConstantArrayData =
+      pModule->GetConstantArrayData();
+  if (!ConstantArrayData.empty()) {
+    writer.AddPart(DFCC_ConstantArrayData, ConstantArrayData.size(),
+                   [&](AbstractMemoryStream *pStream) {
+                     ULONG cbWritten;
+                     IFT(pStream->Write(ConstantArrayData.data(),
+                                        ConstantArrayData.size(), &cbWritten));
+                   });
+  }
+
   // Write the feature part.
   DxilFeatureInfoWriter featureInfoWriter(*pModule);
   writer.AddPart(DFCC_FeatureInfo, featureInfoWriter.size(), [&](AbstractMemoryStream *pStream) {
@@ -1590,6 +1634,7 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
         [&](AbstractMemoryStream *pStream) { rootSigWriter.write(pStream); });
       bMetadataStripped |= pModule->StripRootSignatureFromMetadata();
     }
+    bMetadataStripped |= pModule->StripConstantArrayDataFromMetadata();
   }
 
   // If metadata was stripped, re-serialize the input module.
@@ -1657,6 +1702,8 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     llvm::MD5 md5;
     SmallString<32> Hash;
     md5.update(Data);
+    // Constant array data is part of the program but not the DXIL part.
+    md5.update(ArrayRef<uint8_t>(pModule->GetConstantArrayData()));
     md5.final(HashContent.Digest);
 
     if (Flags & SerializeDxilFlags::IncludeDebugNamePart) {
@@ -1731,3 +1778,72 @@ void hlsl::SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRo
   }
   writer.write(pFinalStream);
 }
+
+void hlsl::ComputeDxilModuleFingerprint(const llvm::Module &M,
+                                        DxilShaderFingerprint &Fingerprint) {
+  // Work on a copy; the original keeps its names and debug info for the
+  // disassembly and PDB.
+  std::unique_ptr<Module> pClone(CloneModule(&M));
+  pClone->setModuleIdentifier("");
+  llvm::StripDebugInfo(*pClone);
+
+  const char *SourceMDNames[] = {
+      DxilMDHelper::kDxilSourceContentsMDName,
+      DxilMDHelper::kDxilSourceDefinesMDName,
+      DxilMDHelper::kDxilSourceMainFileNameMDName,
+      DxilMDHelper::kDxilSourceArgsMDName,
+      DxilMDHelper::kDxilSourceStoreMDName};
+  for (const char *Name : SourceMDNames) {
+    if (NamedMDNode *pNamedMD = pClone->getNamedMetadata(Name))
+      pClone->eraseNamedMetadata(pNamedMD);
+  }
+
+  // Symbol names of globals and defined functions don't change the code;
+  // declarations keep theirs, which identify the dx.op and LLVM intrinsics.
+  for (GlobalVariable &GV : pClone->globals())
+    GV.setName("");
+  for (Function &F : *pClone) {
+    if (!F.isDeclaration())
+      F.setName("");
+    for (Argument &Arg : F.args())
+      Arg.setName("");
+    for (BasicBlock &BB : F) {
+      BB.setName("");
+      for (Instruction &I : BB)
+        I.setName("");
+    }
+  }
+
+  SmallVector<char, 4096> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(pClone.get(), OS);
+  }
+
+  llvm::MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)Bitcode.data(), Bitcode.size()));
+  md5.final(Fingerprint.Digest);
+  Fingerprint.Flags = (uint32_t)DxilShaderFingerprintFlags::None;
+}
+
+void hlsl::SerializeDxilContainerForFingerprint(
+    const DxilShaderFingerprint &Fingerprint, llvm::StringRef IdenticalTo,
+    AbstractMemoryStream *pFinalStream) {
+  DXASSERT_NOMSG(pFinalStream != nullptr);
+  DxilContainerWriter_impl writer;
+
+  DxilShaderFingerprint Content = Fingerprint;
+  Content.Flags |= (uint32_t)DxilShaderFingerprintFlags::IdenticalToKnown;
+  const uint32_t NameLen = PSVALIGN4(IdenticalTo.size() + 1); // 1 for null
+  writer.AddPart(DFCC_ShaderFingerprint, sizeof(Content) + NameLen,
+    [Content, IdenticalTo, NameLen]
+    (AbstractMemoryStream *pStream)
+  {
+    IFT(WriteStreamValue(pStream, Content));
+    ULONG cbWritten;
+    IFT(pStream->Write(IdenticalTo.data(), IdenticalTo.size(), &cbWritten));
+    const char Pad[] = { '\0','\0','\0','\0' };
+    IFT(pStream->Write(Pad, NameLen - IdenticalTo.size(), &cbWritten));
+  });
+  writer.write(pFinalStream);
+}
@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderPack.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides support for reading and writing shader packs.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/ErrorCodes.h"
+#include "dxc/DxilContainer/DxilShaderPack.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string.h>
+
+using namespace llvm;
+
+namespace hlsl {
+
+namespace {
+
+std::string GetDigest(StringRef data) {
+  MD5 md5;
+  MD5::MD5Result result;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)data.data(), data.size()));
+  md5.final(result);
+  return std::string((const char *)result, sizeof(result));
+}
+
+uint32_t GetBucket(const uint8_t *pShaderHash, uint32_t bucketCount) {
+  uint32_t value;
+  memcpy(&value, pShaderHash, sizeof(value));
+  return value & (bucketCount - 1);
+}
+
+uint64_t AlignTo(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void WritePadding(raw_ostream &OS, uint64_t &offset, uint64_t alignment) {
+  for (; offset % alignment != 0; ++offset)
+    OS << '\0';
+}
+
+bool IsInBounds(uint64_t offset, uint64_t size, uint64_t length) {
+  return offset <= length && size <= length - offset;
+}
+
+} // namespace
+
+bool DxilShaderPackWriter::AddContainer(const DxilContainerHeader *pHeader,
+                                        size_t length) {
+  IFTBOOL(IsValidDxilContainer(pHeader, length), DXC_E_CONTAINER_INVALID);
+  // Only keep containers laid out the way the pack writes them back out.
+  uint32_t expectedOffset =
+      sizeof(DxilContainerHeader) + GetOffsetTableSize(pHeader->PartCount);
+  const uint32_t *pPartOffsets = (const uint32_t *)(pHeader + 1);
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    IFTBOOL(pPartOffsets[i] == expectedOffset, DXC_E_CONTAINER_INVALID);
+    expectedOffset += sizeof(DxilPartHeader) +
+                      GetDxilContainerPart(pHeader, i)->PartSize;
+  }
+  IFTBOOL(expectedOffset == pHeader->ContainerSizeInBytes,
+          DXC_E_CONTAINER_INVALID);
+
+  DxilShaderPackShader shader;
+  const DxilPartHeader *pHashPart = GetDxilPartByType(pHeader, DFCC_ShaderHash);
+  if (pHashPart && pHashPart->PartSize >= sizeof(DxilShaderHash)) {
+    const DxilShaderHash *pHash =
+        (const DxilShaderHash *)GetDxilPartData(pHashPart);
+    memcpy(shader.ShaderHash, pHash->Digest, sizeof(shader.ShaderHash));
+  } else {
+    std::string digest = GetDigest(
+        StringRef((const char *)pHeader, pHeader->ContainerSizeInBytes));
+    memcpy(shader.ShaderHash, digest.data(), sizeof(shader.ShaderHash));
+  }
+  std::string hashKey((const char *)shader.ShaderHash,
+                      sizeof(shader.ShaderHash));
+  if (m_ShadersByHash.count(hashKey))
+    return false;
+
+  shader.ContainerHash = pHeader->Hash;
+  shader.Version = pHeader->Version;
+  shader.ContainerSizeInBytes = pHeader->ContainerSizeInBytes;
+  shader.FirstPartRef = m_PartRefs.size();
+  shader.PartCount = pHeader->PartCount;
+
+  for (const DxilPartHeader *pPart : pHeader) {
+    StringRef partBytes((const char *)pPart,
+                        sizeof(DxilPartHeader) + pPart->PartSize);
+    std::string digest = GetDigest(partBytes);
+    uint32_t partIndex = m_Parts.size();
+    auto range = m_PartsByDigest.equal_range(digest);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (m_Parts[it->second] == partBytes) {
+        partIndex = it->second;
+        break;
+      }
+    }
+    if (partIndex == m_Parts.size()) {
+      m_Parts.push_back(partBytes.str());
+      m_PartsByDigest.emplace(digest, partIndex);
+    }
+    m_PartRefs.push_back(partIndex);
+  }
+
+  m_ShadersByHash[hashKey] = m_Shaders.size();
+  m_Shaders.push_back(shader);
+  return true;
+}
+
+void DxilShaderPackWriter::Write(raw_ostream &OS) const {
+  uint32_t bucketCount = 1;
+  while (bucketCount <= m_Shaders.size() * 2)
+    bucketCount <<= 1;
+  std::vector<uint32_t> buckets(bucketCount, 0);
+  for (uint32_t i = 0; i < m_Shaders.size(); ++i) {
+    uint32_t bucket = GetBucket(m_Shaders[i].ShaderHash, bucketCount);
+    while (buckets[bucket] != 0)
+      bucket = (bucket + 1) & (bucketCount - 1);
+    buckets[bucket] = i + 1;
+  }
+
+  DxilShaderPackHeader header;
+  memset(&header, 0, sizeof(header));
+  header.Magic = DxilShaderPackMagic;
+  header.Version = DxilShaderPackVersion;
+  header.ShaderCount = m_Shaders.size();
+  header.BucketCount = bucketCount;
+  header.PartRefCount = m_PartRefs.size();
+  header.PartCount = m_Parts.size();
+  uint64_t offset = sizeof(DxilShaderPackHeader);
+  header.ShaderTableOffset = offset;
+  offset += m_Shaders.size() * sizeof(DxilShaderPackShader);
+  header.BucketTableOffset = offset;
+  offset += buckets.size() * sizeof(uint32_t);
+  header.PartRefTableOffset = offset;
+  offset += m_PartRefs.size() * sizeof(uint32_t);
+  offset = AlignTo(offset, 8);
+  header.PartOffsetTableOffset = offset;
+  offset += m_Parts.size() * sizeof(uint64_t);
+  std::vector<uint64_t> partOffsets;
+  partOffsets.reserve(m_Parts.size());
+  for (const std::string &part : m_Parts) {
+    partOffsets.push_back(offset);
+    offset = AlignTo(offset + part.size(), 4);
+  }
+  header.PackSizeInBytes = offset;
+
+  offset = 0;
+  auto WriteBytes = [&](const void *pData, size_t size) {
+    OS.write((const char *)pData, size);
+    offset += size;
+  };
+  WriteBytes(&header, sizeof(header));
+  WriteBytes(m_Shaders.data(), m_Shaders.size() * sizeof(DxilShaderPackShader));
+  WriteBytes(buckets.data(), buckets.size() * sizeof(uint32_t));
+  WriteBytes(m_PartRefs.data(), m_PartRefs.size() * sizeof(uint32_t));
+  WritePadding(OS, offset, 8);
+  WriteBytes(partOffsets.data(), partOffsets.size() * sizeof(uint64_t));
+  for (const std::string &part : m_Parts) {
+    WriteBytes(part.data(), part.size());
+    WritePadding(OS, offset, 4);
+  }
+  DXASSERT_NOMSG(offset == header.PackSizeInBytes);
+}
+
+bool DxilShaderPackReader::Init(const void *pData, size_t length) {
+  m_pData = (const char *)pData;
+  m_pHeader = (const DxilShaderPackHeader *)pData;
+  if (length < sizeof(DxilShaderPackHeader) ||
+      m_pHeader->Magic != DxilShaderPackMagic ||
+      m_pHeader->Version != DxilShaderPackVersion ||
+      m_pHeader->PackSizeInBytes > length)
+    return false;
+  const DxilShaderPackHeader &header = *m_pHeader;
+  uint64_t packSize = header.PackSizeInBytes;
+  if (header.BucketCount <= header.ShaderCount ||
+      (header.BucketCount & (header.BucketCount - 1)) != 0)
+    return false;
+  if ((header.ShaderTableOffset | header.BucketTableOffset |
+       header.PartRefTableOffset) % 4 != 0 ||
+      header.PartOffsetTableOffset % 8 != 0)
+    return false;
+  if (!IsInBounds(header.ShaderTableOffset,
+                  (uint64_t)header.ShaderCount * sizeof(DxilShaderPackShader),
+                  packSize) ||
+      !IsInBounds(header.BucketTableOffset,
+                  (uint64_t)header.BucketCount * sizeof(uint32_t), packSize) ||
+      !IsInBounds(header.PartRefTableOffset,
+                  (uint64_t)header.PartRefCount * sizeof(uint32_t),
+                  packSize) ||
+      !IsInBounds(header.PartOffsetTableOffset,
+                  (uint64_t)header.PartCount * sizeof(uint64_t), packSize))
+    return false;
+  m_pShaders =
+      (const DxilShaderPackShader *)(m_pData + header.ShaderTableOffset);
+  m_pBuckets = (const uint32_t *)(m_pData + header.BucketTableOffset);
+  m_pPartRefs = (const uint32_t *)(m_pData + header.PartRefTableOffset);
+  m_pPartOffsets = (const uint64_t *)(m_pData + header.PartOffsetTableOffset);
+
+  // Check everything the accessors rely on up front, so they need not.
+  for (uint32_t i = 0; i < header.PartCount; ++i) {
+    uint64_t partOffset = m_pPartOffsets[i];
+    if (partOffset % 4 != 0 ||
+        !IsInBounds(partOffset, sizeof(DxilPartHeader), packSize))
+      return false;
+    const DxilPartHeader *pPart =
+        (const DxilPartHeader *)(m_pData + partOffset);
+    if (!IsInBounds(partOffset + sizeof(DxilPartHeader), pPart->PartSize,
+                    packSize))
+      return false;
+  }
+  for (uint32_t i = 0; i < header.PartRefCount; ++i) {
+    if (m_pPartRefs[i] >= header.PartCount)
+      return false;
+  }
+  for (uint32_t i = 0; i < header.ShaderCount; ++i) {
+    const DxilShaderPackShader &shader = m_pShaders[i];
+    if (!IsInBounds(shader.FirstPartRef, shader.PartCount,
+                    header.PartRefCount))
+      return false;
+    uint64_t containerSize =
+        sizeof(DxilContainerHeader) + GetOffsetTableSize(shader.PartCount);
+    for (uint32_t j = 0; j < shader.PartCount; ++j)
+      containerSize += sizeof(DxilPartHeader) + GetPart(i, j)->PartSize;
+    if (containerSize != shader.ContainerSizeInBytes)
+      return false;
+  }
+  for (uint32_t i = 0; i < header.BucketCount; ++i) {
+    if (m_pBuckets[i] > header.ShaderCount)
+      return false;
+  }
+  return true;
+}
+
+bool DxilShaderPackReader::FindShader(const uint8_t *pShaderHash,
+                                      uint32_t *pIndex) const {
+  uint32_t bucketCount = m_pHeader->BucketCount;
+  uint32_t bucket = GetBucket(pShaderHash, bucketCount);
+  for (uint32_t probes = 0; probes < bucketCount; ++probes) {
+    uint32_t entry = m_pBuckets[bucket];
+    if (entry == 0)
+      return false;
+    if (memcmp(m_pShaders[entry - 1].ShaderHash, pShaderHash,
+               DxilContainerHashSize) == 0) {
+      *pIndex = entry - 1;
+      return true;
+    }
+    bucket = (bucket + 1) & (bucketCount - 1);
+  }
+  return false;
+}
+
+const DxilPartHeader *DxilShaderPackReader::GetPart(uint32_t shaderIndex,
+                                                    uint32_t partIndex) const {
+  const DxilShaderPackShader &shader = m_pShaders[shaderIndex];
+  DXASSERT_NOMSG(partIndex < shader.PartCount);
+  uint32_t partRef = m_pPartRefs[shader.FirstPartRef + partIndex];
+  return (const DxilPartHeader *)(m_pData + m_pPartOffsets[partRef]);
+}
+
+const DxilPartHeader *
+DxilShaderPackReader::GetPartByType(uint32_t shaderIndex,
+                                    DxilFourCC fourCC) const {
+  const DxilShaderPackShader &shader = m_pShaders[shaderIndex];
+  for (uint32_t i = 0; i < shader.PartCount; ++i) {
+    const DxilPartHeader *pPart = GetPart(shaderIndex, i);
+    if (pPart->PartFourCC == (uint32_t)fourCC)
+      return pPart;
+  }
+  return nullptr;
+}
+
+void DxilShaderPackReader::WriteContainer(uint32_t shaderIndex,
+                                          raw_ostream &OS) const {
+  const DxilShaderPackShader &shader = m_pShaders[shaderIndex];
+  DxilContainerHeader header;
+  header.HeaderFourCC = DFCC_Container;
+  header.Hash = shader.ContainerHash;
+  header.Version = shader.Version;
+  header.ContainerSizeInBytes = shader.ContainerSizeInBytes;
+  header.PartCount = shader.PartCount;
+  OS.write((const char *)&header, sizeof(header));
+  uint32_t partOffset =
+      sizeof(DxilContainerHeader) + GetOffsetTableSize(shader.PartCount);
+  for (uint32_t i = 0; i < shader.PartCount; ++i) {
+    OS.write((const char *)&partOffset, sizeof(partOffset));
+    partOffset += sizeof(DxilPartHeader) + GetPart(shaderIndex, i)->PartSize;
+  }
+  for (uint32_t i = 0; i < shader.PartCount; ++i) {
+    const DxilPartHeader *pPart = GetPart(shaderIndex, i);
+    OS.write((const char *)pPart, sizeof(DxilPartHeader) + pPart->PartSize);
+  }
+}
+
+} // namespace hlsl
@@ -11,6 +11,7 @@
 
 #include "DxilDiaSession.h"
 
+#include "dxc/DXIL/DxilSourceStore.h"
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 #include "llvm/ADT/STLExtras.h"
@@ -54,6 +55,8 @@ void dxil_dia::Session::Init(
     m_module->getNamedMetadata(hlsl::DxilMDHelper::kDxilSourceContentsMDName);
   if (!m_contents)
     m_contents = m_module->getNamedMetadata("llvm.dbg.contents");
+  m_sourceStore = hlsl::GetDebugSourceStore(*m_module);
+  m_storedSources.clear();
 
   m_defines =
     m_module->getNamedMetadata(hlsl::DxilMDHelper::kDxilSourceDefinesMDName);
@@ -106,6 +109,27 @@ void dxil_dia::Session::Init(
   }
 }
 
+HRESULT dxil_dia::Session::SourceContents(llvm::MDTuple *pNameContent,
+                                         llvm::StringRef *pContents) {
+  if (pNameContent->getNumOperands() < 3) {
+    *pContents =
+      llvm::cast<llvm::MDString>(pNameContent->getOperand(1))->getString();
+    return S_OK;
+  }
+
+  llvm::StringRef hash =
+    llvm::cast<llvm::MDString>(pNameContent->getOperand(2))->getString();
+  auto it = m_storedSources.find(hash);
+  if (it == m_storedSources.end()) {
+    std::string contents;
+    if (!hlsl::LoadDebugSourceFromStore(m_sourceStore, hash, contents))
+      return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    it = m_storedSources.emplace(hash, std::move(contents)).first;
+  }
+  *pContents = it->second;
+  return S_OK;
+}
+
 HRESULT dxil_dia::Session::getSourceFileIdByName(
     llvm::StringRef fileName,
     DWORD *pRetVal) {
@@ -355,12 +379,13 @@ STDMETHODIMP dxil_dia::Session::findInjectedSource(
   if (Contents() != nullptr) {
     CW2A pUtf8FileName(srcFile);
     DxcThreadMalloc TM(m_pMalloc);
-    IDiaTable *pTable;
+    CComPtr<IDiaTable> pTable;
     IFT(Table::Create(this, Table::Kind::InjectedSource, &pTable));
     auto *pInjectedSource =
-      reinterpret_cast<InjectedSourcesTable *>(pTable);
-    pInjectedSource->Init(pUtf8FileName.m_psz);
+      reinterpret_cast<InjectedSourcesTable *>(pTable.p);
+    IFR(pInjectedSource->Init(pUtf8FileName.m_psz));
     *ppResult = pInjectedSource;
+    pTable.Detach();
     return S_OK;
   }
   return S_FALSE;
@@ -15,6 +15,7 @@
 
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -70,6 +71,12 @@ public:
 
   HRESULT getSourceFileIdByName(llvm::StringRef fileName, DWORD *pRetVal);
 
+  // Gets the contents of a source in Contents(), reading it from the source
+  // store when the debug information only refers to it by hash. Fails if the
+  // store does not hold the source.
+  HRESULT SourceContents(llvm::MDTuple *pNameContent,
+                         llvm::StringRef *pContents);
+
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
     return DoBasicQueryInterface<IDiaSession>(this, iid, ppvObject);
   }
@@ -385,6 +392,8 @@ private:
   llvm::NamedMDNode *m_defines;
   llvm::NamedMDNode *m_mainFileName;
   llvm::NamedMDNode *m_arguments;
+  llvm::StringRef m_sourceStore;
+  std::unordered_map<std::string, std::string> m_storedSources;
   RVAMap m_instructions;
   std::vector<const llvm::Instruction *> m_instructionLines; // Instructions with line info.
   std::unordered_map<const llvm::Instruction *, RVA> m_rvaMap; // Map instruction to its RVA.
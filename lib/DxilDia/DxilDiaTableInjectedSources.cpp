@@ -23,12 +23,14 @@ llvm::StringRef dxil_dia::InjectedSource::Name() {
   return llvm::dyn_cast<llvm::MDString>(NameContent()->getOperand(0))->getString();
 }
 
-llvm::StringRef dxil_dia::InjectedSource::Content() {
-  return llvm::dyn_cast<llvm::MDString>(NameContent()->getOperand(1))->getString();
+HRESULT dxil_dia::InjectedSource::Content(llvm::StringRef *pContent) {
+  return m_pSession->SourceContents(NameContent(), pContent);
 }
 
 STDMETHODIMP dxil_dia::InjectedSource::get_length(_Out_ ULONGLONG *pRetVal) {
-  *pRetVal = Content().size();
+  llvm::StringRef content;
+  IFR(Content(&content));
+  *pRetVal = content.size();
   return S_OK;
 }
 
@@ -50,15 +52,17 @@ STDMETHODIMP dxil_dia::InjectedSource::get_source(
   /* [in] */ DWORD cbData,
   /* [out] */ DWORD *pcbData,
   /* [size_is][out] */ BYTE *pbData) {
+  llvm::StringRef content;
+  IFR(Content(&content));
   if (pbData == nullptr) {
     if (pcbData != nullptr) {
-      *pcbData = Content().size();
+      *pcbData = content.size();
     }
     return S_OK;
   }
 
-  cbData = std::min((DWORD)Content().size(), cbData);
-  memcpy(pbData, Content().begin(), cbData);
+  cbData = std::min((DWORD)content.size(), cbData);
+  memcpy(pbData, content.begin(), cbData);
   if (pcbData) {
     *pcbData = cbData;
   }
@@ -89,14 +93,20 @@ HRESULT dxil_dia::InjectedSourcesTable::GetItem(DWORD index, IDiaInjectedSource
   return S_OK;
 }
 
-void dxil_dia::InjectedSourcesTable::Init(llvm::StringRef filename) {
+HRESULT dxil_dia::InjectedSourcesTable::Init(llvm::StringRef filename) {
   for (unsigned i = 0; i < m_pSession->Contents()->getNumOperands(); ++i) {
+    llvm::MDTuple *pNameContent =
+      llvm::cast<llvm::MDTuple>(m_pSession->Contents()->getOperand(i));
     llvm::StringRef fn =
-      llvm::dyn_cast<llvm::MDString>(m_pSession->Contents()->getOperand(i)->getOperand(0))
+      llvm::dyn_cast<llvm::MDString>(pNameContent->getOperand(0))
       ->getString();
     if (fn.equals(filename)) {
+      // Sources that only refer to the store must be found there.
+      llvm::StringRef content;
+      IFR(m_pSession->SourceContents(pNameContent, &content));
       m_indexList.emplace_back(i);
     }
   }
   m_count = m_indexList.size();
+  return S_OK;
 }
\ No newline at end of file
@@ -44,7 +44,7 @@ public:
 
   llvm::MDTuple *NameContent();
   llvm::StringRef Name();
-  llvm::StringRef Content();
+  HRESULT Content(llvm::StringRef *pContent);
 
   STDMETHODIMP get_crc(
     /* [retval][out] */ DWORD *pRetVal) override { return ENotImpl(); }
@@ -73,7 +73,7 @@ public:
 
   HRESULT GetItem(DWORD index, IDiaInjectedSource **ppItem) override;
 
-  void Init(llvm::StringRef filename);
+  HRESULT Init(llvm::StringRef filename);
 
 private:
   std::vector<unsigned> m_indexList;
@@ -30,6 +30,12 @@ class DxilAddPixelHitInstrumentation : public ModulePass {
   int RTWidth = 1024;
   int NumPixels = 128;
   int SVPositionIndex = -1;
+  bool WaveAggregate = false;
+  int TileWidth = 1;
+  int TileHeight = 1;
+
+  void EmitAtomicIncrements(IRBuilder<> &Builder, OP *HlslOP, Value *HandleForUAV,
+                            Value *Index, Value *Increment);
 
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -46,6 +52,81 @@ void DxilAddPixelHitInstrumentation::applyOptions(PassOptions O)
   GetPassOptionInt(O, "rt-width", &RTWidth, 0);
   GetPassOptionInt(O, "num-pixels", &NumPixels, 0);
   GetPassOptionInt(O, "sv-position-index", &SVPositionIndex, 0);
+  GetPassOptionBool(O, "wave-aggregate", &WaveAggregate, false);
+  GetPassOptionInt(O, "tile-width", &TileWidth, 1);
+  GetPassOptionInt(O, "tile-height", &TileHeight, 1);
+  if (TileWidth < 1)
+    TileWidth = 1;
+  if (TileHeight < 1)
+    TileHeight = 1;
+}
+
+// Increments the hit count at Index by Increment and, if requested, the cost
+// at the matching location in the second half of the UAV by the draw-call
+// weight multiplied by Increment.
+void DxilAddPixelHitInstrumentation::EmitAtomicIncrements(
+    IRBuilder<> &Builder, OP *HlslOP, Value *HandleForUAV, Value *Index,
+    Value *Increment) {
+  LLVMContext &Ctx = Builder.getContext();
+  UndefValue* UndefArg = UndefValue::get(Type::getInt32Ty(Ctx));
+  Constant* NumPixelsByteOffsetArg = HlslOP->GetU32Const(NumPixels * 4);
+
+  // Insert the UAV increment instruction:
+  Function* AtomicOpFunc = HlslOP->GetOpFunc(OP::OpCode::AtomicBinOp, Type::getInt32Ty(Ctx));
+  Constant* AtomicBinOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::AtomicBinOp);
+  Constant* AtomicAdd = HlslOP->GetU32Const((unsigned)DXIL::AtomicBinOpCode::Add);
+  {
+    (void)Builder.CreateCall(AtomicOpFunc, {
+      AtomicBinOpcode,// i32, ; opcode
+      HandleForUAV,   // %dx.types.Handle, ; resource handle
+      AtomicAdd,      // i32, ; binary operation code : EXCHANGE, IADD, AND, OR, XOR, IMIN, IMAX, UMIN, UMAX
+      Index,          // i32, ; coordinate c0: byte offset
+      UndefArg,       // i32, ; coordinate c1 (unused)
+      UndefArg,       // i32, ; coordinate c2 (unused)
+      Increment       // i32); increment value
+    }, "UAVIncResult");
+  }
+
+  if (AddPixelCost) {
+    // ------------------------------------------------------------------------------------------------------------
+    // Generate instructions to increment a value corresponding to the current pixel in the second half of the UAV, 
+    // by an amount proportional to the estimated average cost of each pixel in the current draw call.
+    // ------------------------------------------------------------------------------------------------------------
+
+    // Step 1: Retrieve weight value from UAV; it will be placed after the range we're writing to
+    Value * Weight;
+    {
+      Function* LoadWeight = HlslOP->GetOpFunc(OP::OpCode::BufferLoad, Type::getInt32Ty(Ctx));
+      Constant* LoadWeightOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::BufferLoad);
+      Constant* OffsetIntoUAV = HlslOP->GetU32Const(NumPixels * 2 * 4);
+      auto WeightStruct = Builder.CreateCall(LoadWeight, {
+        LoadWeightOpcode, // i32 opcode
+        HandleForUAV,     // %dx.types.Handle, ; resource handle
+        OffsetIntoUAV,    // i32 c0: byte offset
+        UndefArg          // i32 c1: unused
+      }, "WeightStruct");
+      Weight = Builder.CreateExtractValue(WeightStruct, static_cast<uint64_t>(0LL), "Weight");
+    }
+
+    // An aggregated increment stands for several hits, each of which carries the weight
+    if (!isa<ConstantInt>(Increment) || !cast<ConstantInt>(Increment)->isOne()) {
+      Weight = Builder.CreateMul(Weight, Increment, "AggregatedWeight");
+    }
+
+    // Step 2: Update write position ("Index") to second half of the UAV 
+    auto OffsetIndex = Builder.CreateAdd(Index, NumPixelsByteOffsetArg, "OffsetByteIndex");
+
+    // Step 3: Increment UAV value by the weight
+    (void)Builder.CreateCall(AtomicOpFunc,{
+      AtomicBinOpcode,          // i32, ; opcode
+      HandleForUAV,   // %dx.types.Handle, ; resource handle
+      AtomicAdd,      // i32, ; binary operation code : EXCHANGE, IADD, AND, OR, XOR, IMIN, IMAX, UMIN, UMAX
+      OffsetIndex,    // i32, ; coordinate c0: byte offset
+      UndefArg,       // i32, ; coordinate c1 (unused)
+      UndefArg,       // i32, ; coordinate c2 (unused)
+      Weight          // i32); increment value
+    }, "UAVIncResult2");
+  }
 }
 
 bool DxilAddPixelHitInstrumentation::runOnModule(Module &M)
@@ -142,108 +223,180 @@ bool DxilAddPixelHitInstrumentation::runOnModule(Module &M)
   }
   // todo: is it a reasonable assumption that there will be a "Ret" in the entry block, and that these are the only
   // points from which the shader can exit (except for a pixel-kill?)
-  auto & Instructions = EntryBlock.getInstList();
-  auto It = Instructions.begin();
-  while(It != Instructions.end()) {
-    auto ThisInstruction = It++;
-    LlvmInst_Ret Ret(ThisInstruction);
-    if (Ret) {
-      // Check that there is at least one instruction preceding the Ret (no need to instrument it if there isn't)
-      if (ThisInstruction->getPrevNode() != nullptr) {
-
-        // Start adding instructions right before the Ret:
-        IRBuilder<> Builder(ThisInstruction);
-
-        // ------------------------------------------------------------------------------------------------------------
-        // Generate instructions to increment (by one) a UAV value corresponding to the pixel currently being rendered
-        // ------------------------------------------------------------------------------------------------------------
-
-        // Useful constants
-        Constant* Zero32Arg = HlslOP->GetU32Const(0);
-        Constant* Zero8Arg = HlslOP->GetI8Const(0);
-        Constant* One32Arg = HlslOP->GetU32Const(1);
-        Constant* One8Arg = HlslOP->GetI8Const(1);
-        UndefValue* UndefArg = UndefValue::get(Type::getInt32Ty(Ctx));
-        Constant* NumPixelsByteOffsetArg = HlslOP->GetU32Const(NumPixels * 4);
-
-        // Step 1: Convert SV_POSITION to UINT          
-        Value * XAsInt;
-        Value * YAsInt;
-        {
-          auto LoadInputOpFunc = HlslOP->GetOpFunc(DXIL::OpCode::LoadInput, Type::getFloatTy(Ctx));
-          Constant* LoadInputOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::LoadInput);
-          Constant*  SV_Pos_ID = HlslOP->GetU32Const(SV_Position_ID);
-          auto XPos = Builder.CreateCall(LoadInputOpFunc,
-          { LoadInputOpcode, SV_Pos_ID, Zero32Arg /*row*/, Zero8Arg /*column*/, UndefArg }, "XPos");
-          auto YPos = Builder.CreateCall(LoadInputOpFunc,
-          { LoadInputOpcode, SV_Pos_ID, Zero32Arg /*row*/, One8Arg /*column*/, UndefArg }, "YPos");
-
-          XAsInt = Builder.CreateCast(Instruction::CastOps::FPToUI, XPos, Type::getInt32Ty(Ctx), "XIndex");
-          YAsInt = Builder.CreateCast(Instruction::CastOps::FPToUI, YPos, Type::getInt32Ty(Ctx), "YIndex");
-        }
-
-        // Step 2: Calculate pixel index
-        Value * Index;
-        {
-          Constant* RTWidthArg = HlslOP->GetI32Const(RTWidth);
-          auto YOffset = Builder.CreateMul(YAsInt, RTWidthArg, "YOffset");
-          auto Elementoffset = Builder.CreateAdd(XAsInt, YOffset, "ElementOffset");
-          Index = Builder.CreateMul(Elementoffset, HlslOP->GetU32Const(4), "ByteIndex");
-        }
-
-        // Insert the UAV increment instruction:
-        Function* AtomicOpFunc = HlslOP->GetOpFunc(OP::OpCode::AtomicBinOp, Type::getInt32Ty(Ctx));
-        Constant* AtomicBinOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::AtomicBinOp);
-        Constant* AtomicAdd = HlslOP->GetU32Const((unsigned)DXIL::AtomicBinOpCode::Add);
-        {
-          (void)Builder.CreateCall(AtomicOpFunc, {
-            AtomicBinOpcode,// i32, ; opcode
-            HandleForUAV,   // %dx.types.Handle, ; resource handle
-            AtomicAdd,      // i32, ; binary operation code : EXCHANGE, IADD, AND, OR, XOR, IMIN, IMAX, UMIN, UMAX
-            Index,          // i32, ; coordinate c0: byte offset
-            UndefArg,       // i32, ; coordinate c1 (unused)
-            UndefArg,       // i32, ; coordinate c2 (unused)
-            One32Arg        // i32); increment value
-          }, "UAVIncResult");
-        }
-
-        if (AddPixelCost) {
-          // ------------------------------------------------------------------------------------------------------------
-          // Generate instructions to increment a value corresponding to the current pixel in the second half of the UAV, 
-          // by an amount proportional to the estimated average cost of each pixel in the current draw call.
-          // ------------------------------------------------------------------------------------------------------------
-
-          // Step 1: Retrieve weight value from UAV; it will be placed after the range we're writing to
-          Value * Weight;
-          {
-            Function* LoadWeight = HlslOP->GetOpFunc(OP::OpCode::BufferLoad, Type::getInt32Ty(Ctx));
-            Constant* LoadWeightOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::BufferLoad);
-            Constant* OffsetIntoUAV = HlslOP->GetU32Const(NumPixels * 2 * 4);
-            auto WeightStruct = Builder.CreateCall(LoadWeight, {
-              LoadWeightOpcode, // i32 opcode
-              HandleForUAV,     // %dx.types.Handle, ; resource handle
-              OffsetIntoUAV,    // i32 c0: byte offset
-              UndefArg          // i32 c1: unused
-            }, "WeightStruct");
-            Weight = Builder.CreateExtractValue(WeightStruct, static_cast<uint64_t>(0LL), "Weight");
-          }
-
-          // Step 2: Update write position ("Index") to second half of the UAV 
-          auto OffsetIndex = Builder.CreateAdd(Index, NumPixelsByteOffsetArg, "OffsetByteIndex");
-
-          // Step 3: Increment UAV value by the weight
-          (void)Builder.CreateCall(AtomicOpFunc,{
-            AtomicBinOpcode,          // i32, ; opcode
-            HandleForUAV,   // %dx.types.Handle, ; resource handle
-            AtomicAdd,      // i32, ; binary operation code : EXCHANGE, IADD, AND, OR, XOR, IMIN, IMAX, UMIN, UMAX
-            OffsetIndex,    // i32, ; coordinate c0: byte offset
-            UndefArg,       // i32, ; coordinate c1 (unused)
-            UndefArg,       // i32, ; coordinate c2 (unused)
-            Weight          // i32); increment value
-          }, "UAVIncResult2");
-        }
+  // Gather the returns up front: wave aggregation splits the entry block.
+  SmallVector<Instruction *, 2> Returns;
+  for (Instruction &I : EntryBlock) {
+    LlvmInst_Ret Ret(&I);
+    // Check that there is at least one instruction preceding the Ret (no need to instrument it if there isn't)
+    if (Ret && I.getPrevNode() != nullptr)
+      Returns.push_back(&I);
+  }
+
+  // Helper lanes do not take part in wave operations, so a helper lane would never see its own address come up in
+  // the aggregation loop below and would spin forever. They are kept out of the loop by their coverage, which is
+  // zero for helpers. The coverage and inner-coverage inputs can't be used together, so shaders that read inner
+  // coverage fall back to per-lane atomics.
+  bool Aggregate = WaveAggregate && !Returns.empty();
+  if (Aggregate) {
+    Function *InnerCoverageFunc = HlslOP->GetOpFunc(DXIL::OpCode::InnerCoverage, Type::getInt32Ty(Ctx));
+    if (!InnerCoverageFunc->user_empty())
+      Aggregate = false;
+  }
+
+  if (Aggregate) {
+    DM.m_ShaderFlags.SetWaveOps(true);
+  }
+
+  // Lanes that have discarded become helpers too, but keep their coverage; track them with a discard mask that is
+  // updated after every discard in the entry point.
+  AllocaInst *DiscardedMask = nullptr;
+  if (Aggregate) {
+    Function *DiscardFunc = HlslOP->GetOpFunc(DXIL::OpCode::Discard, Type::getVoidTy(Ctx));
+    SmallVector<CallInst *, 4> Discards;
+    for (User *U : DiscardFunc->users()) {
+      CallInst *CI = cast<CallInst>(U);
+      if (CI->getParent()->getParent() == EntryPointFunction)
+        Discards.push_back(CI);
+    }
+    if (!Discards.empty()) {
+      IRBuilder<> AllocaBuilder(EntryPointFunction->getEntryBlock().getFirstInsertionPt());
+      DiscardedMask = AllocaBuilder.CreateAlloca(Type::getInt32Ty(Ctx), nullptr, "PIX_Discarded");
+      IRBuilder<> InitBuilder(dxilutil::FirstNonAllocaInsertionPt(EntryPointFunction));
+      InitBuilder.CreateStore(HlslOP->GetU32Const(0), DiscardedMask);
+      for (CallInst *CI : Discards) {
+        IRBuilder<> DiscardBuilder(CI->getNextNode());
+        Value *Condition = CI->getArgOperand(DXIL::OperandIndex::kUnarySrc0OpIdx);
+        Value *WasDiscarded = DiscardBuilder.CreateLoad(DiscardedMask);
+        Value *Discarded = DiscardBuilder.CreateZExt(Condition, Type::getInt32Ty(Ctx));
+        DiscardBuilder.CreateStore(DiscardBuilder.CreateOr(WasDiscarded, Discarded), DiscardedMask);
+      }
+    }
+  }
+
+  for (Instruction *ThisInstruction : Returns) {
+    // Start adding instructions right before the Ret:
+    IRBuilder<> Builder(ThisInstruction);
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Generate instructions to increment (by one) a UAV value corresponding to the pixel currently being rendered
+    // ------------------------------------------------------------------------------------------------------------
+
+    // Useful constants
+    Constant* Zero32Arg = HlslOP->GetU32Const(0);
+    Constant* Zero8Arg = HlslOP->GetI8Const(0);
+    Constant* One32Arg = HlslOP->GetU32Const(1);
+    Constant* One8Arg = HlslOP->GetI8Const(1);
+    UndefValue* UndefArg = UndefValue::get(Type::getInt32Ty(Ctx));
+
+    // Step 1: Convert SV_POSITION to UINT          
+    Value * XAsInt;
+    Value * YAsInt;
+    {
+      auto LoadInputOpFunc = HlslOP->GetOpFunc(DXIL::OpCode::LoadInput, Type::getFloatTy(Ctx));
+      Constant* LoadInputOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::LoadInput);
+      Constant*  SV_Pos_ID = HlslOP->GetU32Const(SV_Position_ID);
+      auto XPos = Builder.CreateCall(LoadInputOpFunc,
+      { LoadInputOpcode, SV_Pos_ID, Zero32Arg /*row*/, Zero8Arg /*column*/, UndefArg }, "XPos");
+      auto YPos = Builder.CreateCall(LoadInputOpFunc,
+      { LoadInputOpcode, SV_Pos_ID, Zero32Arg /*row*/, One8Arg /*column*/, UndefArg }, "YPos");
+
+      XAsInt = Builder.CreateCast(Instruction::CastOps::FPToUI, XPos, Type::getInt32Ty(Ctx), "XIndex");
+      YAsInt = Builder.CreateCast(Instruction::CastOps::FPToUI, YPos, Type::getInt32Ty(Ctx), "YIndex");
+    }
+
+    // Step 1a: Reduce the pixel coordinates to tile coordinates, if requested
+    int RowWidth = RTWidth;
+    if (TileWidth > 1) {
+      XAsInt = Builder.CreateUDiv(XAsInt, HlslOP->GetU32Const(TileWidth), "XTile");
+      RowWidth = (RTWidth + TileWidth - 1) / TileWidth;
+    }
+    if (TileHeight > 1) {
+      YAsInt = Builder.CreateUDiv(YAsInt, HlslOP->GetU32Const(TileHeight), "YTile");
+    }
+
+    // Step 2: Calculate pixel index
+    Value * Index;
+    {
+      Constant* RTWidthArg = HlslOP->GetI32Const(RowWidth);
+      auto YOffset = Builder.CreateMul(YAsInt, RTWidthArg, "YOffset");
+      auto Elementoffset = Builder.CreateAdd(XAsInt, YOffset, "ElementOffset");
+      Index = Builder.CreateMul(Elementoffset, HlslOP->GetU32Const(4), "ByteIndex");
+    }
+
+    if (!Aggregate) {
+      EmitAtomicIncrements(Builder, HlslOP, HandleForUAV, Index, One32Arg);
+      continue;
+    }
+
+    // Only lanes that are covered and haven't discarded may enter the loop.
+    Value *IsCounted;
+    {
+      Function* CoverageFunc = HlslOP->GetOpFunc(DXIL::OpCode::Coverage, Type::getInt32Ty(Ctx));
+      Constant* CoverageOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::Coverage);
+      auto Coverage = Builder.CreateCall(CoverageFunc, { CoverageOpcode }, "Coverage");
+      IsCounted = Builder.CreateICmpNE(Coverage, Zero32Arg, "IsCovered");
+      if (DiscardedMask) {
+        auto WasDiscarded = Builder.CreateLoad(DiscardedMask, "WasDiscarded");
+        auto IsKept = Builder.CreateICmpEQ(WasDiscarded, Zero32Arg, "IsKept");
+        IsCounted = Builder.CreateAnd(IsCounted, IsKept, "IsCounted");
       }
     }
+
+    // ------------------------------------------------------------------------------------------------------------
+    // Aggregate hits across the wave so that only one atomic is issued per unique address. Each iteration handles
+    // the lanes that share the address of the first active lane; the wave operations have to stay inside the loop
+    // so that they only see those lanes:
+    //
+    //                       if (!IsCounted) goto PIX_AggregateExit
+    //   PIX_AggregateLoop:  FirstIndex = WaveReadLaneFirst(ByteIndex)
+    //                       if (ByteIndex != FirstIndex) goto PIX_AggregateLatch
+    //   PIX_AggregateMatch: HitCount = WaveActiveSum(1)
+    //                       if (!WaveIsFirstLane()) goto PIX_AggregateLatch
+    //   PIX_AggregateWrite: atomic add HitCount at ByteIndex
+    //   PIX_AggregateLatch: if (ByteIndex != FirstIndex) goto PIX_AggregateLoop
+    //   PIX_AggregateExit:  ret
+    // ------------------------------------------------------------------------------------------------------------
+    BasicBlock *PreheaderBB = ThisInstruction->getParent();
+    BasicBlock *ExitBB = PreheaderBB->splitBasicBlock(ThisInstruction, "PIX_AggregateExit");
+    BasicBlock *LoopBB = BasicBlock::Create(Ctx, "PIX_AggregateLoop", EntryPointFunction, ExitBB);
+    BasicBlock *MatchBB = BasicBlock::Create(Ctx, "PIX_AggregateMatch", EntryPointFunction, ExitBB);
+    BasicBlock *WriteBB = BasicBlock::Create(Ctx, "PIX_AggregateWrite", EntryPointFunction, ExitBB);
+    BasicBlock *LatchBB = BasicBlock::Create(Ctx, "PIX_AggregateLatch", EntryPointFunction, ExitBB);
+    PreheaderBB->getTerminator()->eraseFromParent();
+    BranchInst::Create(LoopBB, ExitBB, IsCounted, PreheaderBB);
+
+    Value *IsMatch;
+    {
+      IRBuilder<> LoopBuilder(LoopBB);
+      Function* ReadLaneFirstFunc = HlslOP->GetOpFunc(DXIL::OpCode::WaveReadLaneFirst, Type::getInt32Ty(Ctx));
+      Constant* ReadLaneFirstOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::WaveReadLaneFirst);
+      auto FirstIndex = LoopBuilder.CreateCall(ReadLaneFirstFunc, { ReadLaneFirstOpcode, Index }, "FirstIndex");
+      IsMatch = LoopBuilder.CreateICmpEQ(Index, FirstIndex, "IsMatch");
+      LoopBuilder.CreateCondBr(IsMatch, MatchBB, LatchBB);
+    }
+
+    {
+      IRBuilder<> MatchBuilder(MatchBB);
+      Function* ActiveOpFunc = HlslOP->GetOpFunc(DXIL::OpCode::WaveActiveOp, Type::getInt32Ty(Ctx));
+      Constant* ActiveOpOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::WaveActiveOp);
+      Constant* SumOp = HlslOP->GetI8Const((unsigned)DXIL::WaveOpKind::Sum);
+      Constant* Unsigned = HlslOP->GetI8Const((unsigned)DXIL::SignedOpKind::Unsigned);
+      Value *HitCount = MatchBuilder.CreateCall(ActiveOpFunc, { ActiveOpOpcode, One32Arg, SumOp, Unsigned }, "HitCount");
+      Function* IsFirstLaneFunc = HlslOP->GetOpFunc(DXIL::OpCode::WaveIsFirstLane, Type::getVoidTy(Ctx));
+      Constant* IsFirstLaneOpcode = HlslOP->GetU32Const((unsigned)DXIL::OpCode::WaveIsFirstLane);
+      auto IsFirstLane = MatchBuilder.CreateCall(IsFirstLaneFunc, { IsFirstLaneOpcode }, "IsFirstLane");
+      MatchBuilder.CreateCondBr(IsFirstLane, WriteBB, LatchBB);
+
+      IRBuilder<> WriteBuilder(WriteBB);
+      EmitAtomicIncrements(WriteBuilder, HlslOP, HandleForUAV, Index, HitCount);
+      WriteBuilder.CreateBr(LatchBB);
+    }
+
+    {
+      // Lanes that were handled leave; the rest go around for the next address.
+      IRBuilder<> LatchBuilder(LatchBB);
+      LatchBuilder.CreateCondBr(IsMatch, ExitBB, LoopBB);
+    }
   }
 
   bool Modified = false;
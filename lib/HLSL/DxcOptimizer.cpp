@@ -88,6 +88,7 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDxilCleanupAddrSpaceCastPass(Registry);
     initializeDxilCondenseResourcesPass(Registry);
     initializeDxilConditionalMem2RegPass(Registry);
+    initializeDxilConstArrayToBufferPass(Registry);
     initializeDxilConvergentClearPass(Registry);
     initializeDxilConvergentMarkPass(Registry);
     initializeDxilDeadFunctionEliminationPass(Registry);
@@ -95,20 +96,27 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDxilEmitMetadataPass(Registry);
     initializeDxilExpandTrigIntrinsicsPass(Registry);
     initializeDxilFinalizeModulePass(Registry);
+    initializeDxilFormDotMadPass(Registry);
     initializeDxilFixConstArrayInitializerPass(Registry);
     initializeDxilGenerationPassPass(Registry);
+    initializeDxilGroupsharedBankConflictsPass(Registry);
+    initializeDxilHotColdSplitPass(Registry);
+    initializeDxilIfConversionPass(Registry);
     initializeDxilLegalizeEvalOperationsPass(Registry);
     initializeDxilLegalizeResourcesPass(Registry);
     initializeDxilLegalizeSampleOffsetPassPass(Registry);
     initializeDxilLoadMetadataPass(Registry);
     initializeDxilLoopUnrollPass(Registry);
     initializeDxilLowerCreateHandleForLibPass(Registry);
+    initializeDxilLowerIndexedArraysPass(Registry);
     initializeDxilPrecisePropagatePassPass(Registry);
     initializeDxilPreserveAllOutputsPass(Registry);
     initializeDxilPromoteLocalResourcesPass(Registry);
     initializeDxilPromoteStaticResourcesPass(Registry);
+    initializeDxilRemoveRedundantBarriersPass(Registry);
     initializeDxilSimpleGVNHoistPass(Registry);
     initializeDxilTranslateRawBufferPass(Registry);
+    initializeDxilWaveAggregateAtomicsPass(Registry);
     initializeDynamicIndexingVectorToArrayPass(Registry);
     initializeEarlyCSELegacyPassPass(Registry);
     initializeEliminateAvailableExternallyPass(Registry);
@@ -190,10 +198,16 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   static const LPCSTR AlwaysInlinerArgs[] = { "InsertLifetime", "InlineThreshold" };
   static const LPCSTR ArgPromotionArgs[] = { "maxElements" };
   static const LPCSTR CFGSimplifyPassArgs[] = { "Threshold", "Ftor", "bonus-inst-threshold" };
-  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "force-early-z", "add-pixel-cost", "rt-width", "sv-position-index", "num-pixels" };
+  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "force-early-z", "add-pixel-cost", "rt-width", "sv-position-index", "num-pixels", "wave-aggregate", "tile-width", "tile-height" };
   static const LPCSTR DxilConditionalMem2RegArgs[] = { "NoOpt" };
+  static const LPCSTR DxilConstArrayToBufferArgs[] = { "space", "min-bytes" };
   static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2" };
+  static const LPCSTR DxilExpandTrigIntrinsicsArgs[] = { "fast-transcendentals" };
   static const LPCSTR DxilGenerationPassArgs[] = { "NotOptimized" };
+  static const LPCSTR DxilGroupsharedBankConflictsArgs[] = { "report", "pad" };
+  static const LPCSTR DxilHotColdSplitArgs[] = { "split", "cold-percent" };
+  static const LPCSTR DxilIfConversionArgs[] = { "uniform-threshold", "divergent-threshold" };
+  static const LPCSTR DxilLowerIndexedArraysArgs[] = { "indexed-access-cost" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "mod-mode", "constant-red", "constant-green", "constant-blue", "constant-alpha" };
   static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing" };
   static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "ReplaceAllVectors" };
@@ -226,8 +240,14 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   if (strcmp(passName, "simplifycfg") == 0) return ArrayRef<LPCSTR>(CFGSimplifyPassArgs, _countof(CFGSimplifyPassArgs));
   if (strcmp(passName, "hlsl-dxil-add-pixel-hit-instrmentation") == 0) return ArrayRef<LPCSTR>(DxilAddPixelHitInstrumentationArgs, _countof(DxilAddPixelHitInstrumentationArgs));
   if (strcmp(passName, "dxil-cond-mem2reg") == 0) return ArrayRef<LPCSTR>(DxilConditionalMem2RegArgs, _countof(DxilConditionalMem2RegArgs));
+  if (strcmp(passName, "dxil-const-array-to-buffer") == 0) return ArrayRef<LPCSTR>(DxilConstArrayToBufferArgs, _countof(DxilConstArrayToBufferArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-expand-trig-intrinsics") == 0) return ArrayRef<LPCSTR>(DxilExpandTrigIntrinsicsArgs, _countof(DxilExpandTrigIntrinsicsArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
+  if (strcmp(passName, "dxil-groupshared-bank-conflicts") == 0) return ArrayRef<LPCSTR>(DxilGroupsharedBankConflictsArgs, _countof(DxilGroupsharedBankConflictsArgs));
+  if (strcmp(passName, "dxil-hot-cold-split") == 0) return ArrayRef<LPCSTR>(DxilHotColdSplitArgs, _countof(DxilHotColdSplitArgs));
+  if (strcmp(passName, "dxil-if-conversion") == 0) return ArrayRef<LPCSTR>(DxilIfConversionArgs, _countof(DxilIfConversionArgs));
+  if (strcmp(passName, "dxil-lower-indexed-arrays") == 0) return ArrayRef<LPCSTR>(DxilLowerIndexedArraysArgs, _countof(DxilLowerIndexedArraysArgs));
   if (strcmp(passName, "hlsl-dxil-constantColor") == 0) return ArrayRef<LPCSTR>(DxilOutputColorBecomesConstantArgs, _countof(DxilOutputColorBecomesConstantArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
@@ -265,10 +285,16 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   static const LPCSTR AlwaysInlinerArgs[] = { "Insert @llvm.lifetime intrinsics", "Insert @llvm.lifetime intrinsics" };
   static const LPCSTR ArgPromotionArgs[] = { "None" };
   static const LPCSTR CFGSimplifyPassArgs[] = { "None", "None", "Control the number of bonus instructions (default = 1)" };
-  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "None", "None", "None", "None", "None" };
+  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "None", "None", "None", "None", "None", "None", "None", "None" };
   static const LPCSTR DxilConditionalMem2RegArgs[] = { "None" };
+  static const LPCSTR DxilConstArrayToBufferArgs[] = { "Register space of the generated buffer", "Minimum size of the arrays to move" };
   static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None" };
+  static const LPCSTR DxilExpandTrigIntrinsicsArgs[] = { "Lower non-precise operations to faster approximations" };
   static const LPCSTR DxilGenerationPassArgs[] = { "None" };
+  static const LPCSTR DxilGroupsharedBankConflictsArgs[] = { "Warn about accesses with bank conflicts", "Pad the innermost dimension of arrays to avoid bank conflicts" };
+  static const LPCSTR DxilHotColdSplitArgs[] = { "Move cold regions out of the hot path", "Largest profiled edge probability, in percent, considered cold" };
+  static const LPCSTR DxilIfConversionArgs[] = { "Maximum cost of flattening a branch on a wave-uniform condition", "Maximum cost of flattening a branch on a divergent condition" };
+  static const LPCSTR DxilLowerIndexedArraysArgs[] = { "Estimated cost of a dynamically indexed access to an indexable register" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "None", "None", "None", "None", "None" };
   static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None" };
   static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "None" };
@@ -301,8 +327,14 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   if (strcmp(passName, "simplifycfg") == 0) return ArrayRef<LPCSTR>(CFGSimplifyPassArgs, _countof(CFGSimplifyPassArgs));
   if (strcmp(passName, "hlsl-dxil-add-pixel-hit-instrmentation") == 0) return ArrayRef<LPCSTR>(DxilAddPixelHitInstrumentationArgs, _countof(DxilAddPixelHitInstrumentationArgs));
   if (strcmp(passName, "dxil-cond-mem2reg") == 0) return ArrayRef<LPCSTR>(DxilConditionalMem2RegArgs, _countof(DxilConditionalMem2RegArgs));
+  if (strcmp(passName, "dxil-const-array-to-buffer") == 0) return ArrayRef<LPCSTR>(DxilConstArrayToBufferArgs, _countof(DxilConstArrayToBufferArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-expand-trig-intrinsics") == 0) return ArrayRef<LPCSTR>(DxilExpandTrigIntrinsicsArgs, _countof(DxilExpandTrigIntrinsicsArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
+  if (strcmp(passName, "dxil-groupshared-bank-conflicts") == 0) return ArrayRef<LPCSTR>(DxilGroupsharedBankConflictsArgs, _countof(DxilGroupsharedBankConflictsArgs));
+  if (strcmp(passName, "dxil-hot-cold-split") == 0) return ArrayRef<LPCSTR>(DxilHotColdSplitArgs, _countof(DxilHotColdSplitArgs));
+  if (strcmp(passName, "dxil-if-conversion") == 0) return ArrayRef<LPCSTR>(DxilIfConversionArgs, _countof(DxilIfConversionArgs));
+  if (strcmp(passName, "dxil-lower-indexed-arrays") == 0) return ArrayRef<LPCSTR>(DxilLowerIndexedArraysArgs, _countof(DxilLowerIndexedArraysArgs));
   if (strcmp(passName, "hlsl-dxil-constantColor") == 0) return ArrayRef<LPCSTR>(DxilOutputColorBecomesConstantArgs, _countof(DxilOutputColorBecomesConstantArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
@@ -361,19 +393,23 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("add-pixel-cost")
     ||  S.equals("bonus-inst-threshold")
     ||  S.equals("checkForDynamicIndexing")
+    ||  S.equals("cold-percent")
     ||  S.equals("config")
     ||  S.equals("constant-alpha")
     ||  S.equals("constant-blue")
     ||  S.equals("constant-green")
     ||  S.equals("constant-red")
     ||  S.equals("disable-licm-promotion")
+    ||  S.equals("divergent-threshold")
     ||  S.equals("enable-load-pre")
     ||  S.equals("enable-pre")
     ||  S.equals("enable-scoped-noalias")
     ||  S.equals("enable-tbaa")
+    ||  S.equals("fast-transcendentals")
     ||  S.equals("float2int-max-integer-bw")
     ||  S.equals("force-early-z")
     ||  S.equals("force-ssa-updater")
+    ||  S.equals("indexed-access-cost")
     ||  S.equals("jump-threading-threshold")
     ||  S.equals("likely-branch-weight")
     ||  S.equals("loop-distribute-non-if-convertible")
@@ -384,23 +420,31 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("max-reroll-increment")
     ||  S.equals("maxElements")
     ||  S.equals("mergefunc-sanity")
+    ||  S.equals("min-bytes")
     ||  S.equals("mod-mode")
     ||  S.equals("no-discriminators")
     ||  S.equals("noloads")
     ||  S.equals("num-pixels")
+    ||  S.equals("pad")
     ||  S.equals("parameter0")
     ||  S.equals("parameter1")
     ||  S.equals("parameter2")
     ||  S.equals("pragma-unroll-threshold")
+    ||  S.equals("report")
     ||  S.equals("reroll-num-tolerated-failed-matches")
     ||  S.equals("rewrite-map-file")
     ||  S.equals("rotation-max-header-size")
     ||  S.equals("rt-width")
     ||  S.equals("sample-profile-file")
     ||  S.equals("sample-profile-max-propagate-iterations")
+    ||  S.equals("space")
+    ||  S.equals("split")
     ||  S.equals("sroa-random-shuffle-slices")
     ||  S.equals("sroa-strict-inbounds")
     ||  S.equals("sv-position-index")
+    ||  S.equals("tile-height")
+    ||  S.equals("tile-width")
+    ||  S.equals("uniform-threshold")
     ||  S.equals("unlikely-branch-weight")
     ||  S.equals("unroll-allow-partial")
     ||  S.equals("unroll-count")
@@ -410,7 +454,8 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("unroll-runtime")
     ||  S.equals("unroll-threshold")
     ||  S.equals("vector-library")
-    ||  S.equals("verify-debug-info");
+    ||  S.equals("verify-debug-info")
+    ||  S.equals("wave-aggregate");
   // ISPASSOPTIONNAME:END
 }
 
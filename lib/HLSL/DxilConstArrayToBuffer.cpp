@@ -0,0 +1,353 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilConstArrayToBuffer.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Moves large constant arrays into a generated raw buffer resource.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilResource.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilRootSignature/DxilRootSignature.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Constant array to buffer.
+//
+// Constant arrays that are indexed dynamically stay in the shader as global
+// constants, which drivers usually place in an immediate constant buffer or
+// indexable temporary registers. Lookup tables of several kilobytes cost
+// registers and occupancy that way.
+//
+// This pass moves each such array of 32-bit scalars of at least min-bytes
+// into one read-only ByteAddressBuffer bound at t0 in the given register
+// space, and turns the indexed loads into bufferLoads:
+//
+//   @A = internal constant [512 x float] [...]
+//   %p = getelementptr [512 x float], [512 x float]* @A, i32 0, i32 %i
+//   %v = load float, float* %p
+// =>
+//   %h = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, ...)
+//   %o = shl i32 %i, 2
+//   %r = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %h, %o, undef)
+//   %v = extractvalue %dx.types.ResRet.f32 %r, 0
+//
+// The buffer appears in reflection and the PSV part like any other SRV. Its
+// contents are written to the CADT container part (see
+// DxilConstantArrayDataHeader) so the runtime can create and upload it once.
+// Until then they are kept in the dx.constArrayData metadata, which the
+// shader fingerprint covers and the shader hash folds in. An explicit root
+// signature must bind the buffer. Libraries are skipped as their resources
+// are only bound at link time.
+
+namespace {
+
+const char kConstArrayBufferName[] = "dx.const.arrays";
+
+class DxilConstArrayToBuffer : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilConstArrayToBuffer(unsigned Space = UINT_MAX)
+      : ModulePass(ID), m_Space(Space), m_MinBytes(1024) {}
+
+  const char *getPassName() const override {
+    return "DXIL constant array to buffer";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUInt32(O, "space", &m_Space, m_Space);
+    GetPassOptionUInt32(O, "min-bytes", &m_MinBytes, m_MinBytes);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  unsigned m_Space;
+  unsigned m_MinBytes;
+
+  bool IsCandidate(GlobalVariable &GV, const DataLayout &DL);
+  bool RootSignatureBindsBuffer(DxilModule &DM);
+  void AppendData(Constant *Init, std::vector<uint8_t> &Data);
+  unsigned AddBufferResource(DxilModule &DM);
+  void ReplaceLoads(GlobalVariable &GV, unsigned BaseOffset, unsigned ID,
+                    DxilModule &DM,
+                    DenseMap<Function *, Value *> &HandleMap);
+};
+
+char DxilConstArrayToBuffer::ID = 0;
+
+// Returns true if every use of GV is a load of an element through a
+// getelementptr (0, index), the only form the pass knows how to rewrite.
+static bool HasOnlyElementLoads(GlobalVariable &GV) {
+  for (User *U : GV.users()) {
+    GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+    if (!GEP || GEP->getNumIndices() != 2)
+      return false;
+    ConstantInt *Zero = dyn_cast<ConstantInt>(GEP->getOperand(1));
+    if (!Zero || !Zero->isZero())
+      return false;
+    for (User *GEPUser : GEP->users()) {
+      if (!isa<LoadInst>(GEPUser))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool DxilConstArrayToBuffer::IsCandidate(GlobalVariable &GV,
+                                         const DataLayout &DL) {
+  if (!GV.isConstant() || !GV.hasInitializer() || !GV.hasLocalLinkage() ||
+      GV.getType()->getPointerAddressSpace() != DXIL::kDefaultAddrSpace)
+    return false;
+  ArrayType *AT = dyn_cast<ArrayType>(GV.getType()->getElementType());
+  if (!AT)
+    return false;
+  Type *EltTy = AT->getElementType();
+  if (!EltTy->isFloatTy() && !EltTy->isIntegerTy(32))
+    return false;
+  if (DL.getTypeAllocSize(AT) < m_MinBytes)
+    return false;
+  return HasOnlyElementLoads(GV);
+}
+
+static DxilShaderVisibility GetShaderVisibility(DXIL::ShaderKind Kind) {
+  switch (Kind) {
+  case DXIL::ShaderKind::Vertex:        return DxilShaderVisibility::Vertex;
+  case DXIL::ShaderKind::Hull:          return DxilShaderVisibility::Hull;
+  case DXIL::ShaderKind::Domain:        return DxilShaderVisibility::Domain;
+  case DXIL::ShaderKind::Geometry:      return DxilShaderVisibility::Geometry;
+  case DXIL::ShaderKind::Pixel:         return DxilShaderVisibility::Pixel;
+  case DXIL::ShaderKind::Amplification: return DxilShaderVisibility::Amplification;
+  case DXIL::ShaderKind::Mesh:          return DxilShaderVisibility::Mesh;
+  default:                              return DxilShaderVisibility::All;
+  }
+}
+
+// Returns true if Param binds an SRV at t0 in Space for shaders of the given
+// visibility.
+template <typename RootParameter>
+static bool RootParameterBindsT0(const RootParameter &Param, unsigned Space,
+                                 DxilShaderVisibility Visibility) {
+  if (Param.ShaderVisibility != DxilShaderVisibility::All &&
+      Param.ShaderVisibility != Visibility)
+    return false;
+  switch (Param.ParameterType) {
+  case DxilRootParameterType::SRV:
+    return Param.Descriptor.ShaderRegister == 0 &&
+           Param.Descriptor.RegisterSpace == Space;
+  case DxilRootParameterType::DescriptorTable:
+    for (unsigned i = 0; i < Param.DescriptorTable.NumDescriptorRanges; ++i) {
+      const auto &Range = Param.DescriptorTable.pDescriptorRanges[i];
+      if (Range.RangeType == DxilDescriptorRangeType::SRV &&
+          Range.BaseShaderRegister == 0 && Range.NumDescriptors != 0 &&
+          Range.RegisterSpace == Space)
+        return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+bool DxilConstArrayToBuffer::RootSignatureBindsBuffer(DxilModule &DM) {
+  const std::vector<uint8_t> &SerializedRootSig =
+      DM.GetSerializedRootSignature();
+  if (SerializedRootSig.empty())
+    return true;
+
+  const DxilVersionedRootSignatureDesc *pDesc = nullptr;
+  try {
+    DeserializeRootSignature(SerializedRootSig.data(),
+                             SerializedRootSig.size(), &pDesc);
+  } catch (...) {
+    // The validator reports a malformed root signature.
+    return true;
+  }
+  if (!pDesc)
+    return true;
+
+  DxilShaderVisibility Visibility =
+      GetShaderVisibility(DM.GetShaderModel()->GetKind());
+  bool Binds = false;
+  if (pDesc->Version == DxilRootSignatureVersion::Version_1_0) {
+    const DxilRootSignatureDesc &Desc = pDesc->Desc_1_0;
+    for (unsigned i = 0; i < Desc.NumParameters && !Binds; ++i)
+      Binds = RootParameterBindsT0(Desc.pParameters[i], m_Space, Visibility);
+  } else {
+    const DxilRootSignatureDesc1 &Desc = pDesc->Desc_1_1;
+    for (unsigned i = 0; i < Desc.NumParameters && !Binds; ++i)
+      Binds = RootParameterBindsT0(Desc.pParameters[i], m_Space, Visibility);
+  }
+  DeleteRootSignature(pDesc);
+  return Binds;
+}
+
+// Appends the little-endian bits of each element of Init. Undef elements
+// are written as zero.
+void DxilConstArrayToBuffer::AppendData(Constant *Init,
+                                        std::vector<uint8_t> &Data) {
+  ArrayType *AT = cast<ArrayType>(Init->getType());
+  for (unsigned i = 0, e = AT->getNumElements(); i < e; ++i) {
+    Constant *Elt = Init->getAggregateElement(i);
+    uint32_t Bits = 0;
+    if (ConstantFP *FP = dyn_cast_or_null<ConstantFP>(Elt))
+      Bits = (uint32_t)FP->getValueAPF().bitcastToAPInt().getZExtValue();
+    else if (ConstantInt *CI = dyn_cast_or_null<ConstantInt>(Elt))
+      Bits = (uint32_t)CI->getZExtValue();
+    for (unsigned b = 0; b < 4; ++b)
+      Data.push_back((uint8_t)(Bits >> (b * 8)));
+  }
+}
+
+unsigned DxilConstArrayToBuffer::AddBufferResource(DxilModule &DM) {
+  LLVMContext &Ctx = DM.GetCtx();
+  StructType *BufTy = DM.GetModule()->getTypeByName("struct.ByteAddressBuffer");
+  if (!BufTy)
+    BufTy = StructType::create({Type::getInt32Ty(Ctx)},
+                               "struct.ByteAddressBuffer");
+
+  std::unique_ptr<DxilResource> pSRV = llvm::make_unique<DxilResource>();
+  pSRV->SetGlobalName(kConstArrayBufferName);
+  pSRV->SetGlobalSymbol(UndefValue::get(BufTy->getPointerTo()));
+  pSRV->SetID(DM.GetSRVs().size());
+  pSRV->SetSpaceID(m_Space);
+  pSRV->SetLowerBound(0);
+  pSRV->SetRangeSize(1);
+  pSRV->SetSampleCount(0);
+  pSRV->SetCompType(CompType::getInvalid());
+  pSRV->SetKind(DXIL::ResourceKind::RawBuffer);
+  pSRV->SetRW(false);
+  return DM.AddSRV(std::move(pSRV));
+}
+
+void DxilConstArrayToBuffer::ReplaceLoads(
+    GlobalVariable &GV, unsigned BaseOffset, unsigned ID, DxilModule &DM,
+    DenseMap<Function *, Value *> &HandleMap) {
+  OP *hlslOP = DM.GetOP();
+  Type *EltTy = GV.getType()->getElementType()->getArrayElementType();
+  Function *CreateHandle =
+      hlslOP->GetOpFunc(DXIL::OpCode::CreateHandle, Type::getVoidTy(DM.GetCtx()));
+  Function *BufferLoad = hlslOP->GetOpFunc(DXIL::OpCode::BufferLoad, EltTy);
+  Value *Undef = UndefValue::get(Type::getInt32Ty(DM.GetCtx()));
+
+  std::vector<User *> GEPs(GV.user_begin(), GV.user_end());
+  for (User *U : GEPs) {
+    GEPOperator *GEP = cast<GEPOperator>(U);
+    std::vector<User *> Loads(GEP->user_begin(), GEP->user_end());
+    for (User *LU : Loads) {
+      LoadInst *LI = cast<LoadInst>(LU);
+      Function *F = LI->getParent()->getParent();
+      Value *&Handle = HandleMap[F];
+      if (!Handle) {
+        IRBuilder<> Builder(dxilutil::FirstNonAllocaInsertionPt(F));
+        Handle = Builder.CreateCall(
+            CreateHandle,
+            {hlslOP->GetU32Const((unsigned)DXIL::OpCode::CreateHandle),
+             hlslOP->GetI8Const((unsigned)DXIL::ResourceClass::SRV),
+             hlslOP->GetU32Const(ID), hlslOP->GetU32Const(0),
+             hlslOP->GetI1Const(0)},
+            kConstArrayBufferName);
+      }
+
+      IRBuilder<> Builder(LI);
+      Value *Index = Builder.CreateZExtOrTrunc(GEP->getOperand(2),
+                                               Builder.getInt32Ty());
+      Value *Offset = Builder.CreateShl(Index, 2);
+      if (BaseOffset)
+        Offset = Builder.CreateAdd(Offset, hlslOP->GetU32Const(BaseOffset));
+      Value *Ret = Builder.CreateCall(
+          BufferLoad, {hlslOP->GetU32Const((unsigned)DXIL::OpCode::BufferLoad),
+                       Handle, Offset, Undef});
+      Value *V = Builder.CreateExtractValue(Ret, 0);
+      LI->replaceAllUsesWith(V);
+      LI->eraseFromParent();
+    }
+    if (Instruction *I = dyn_cast<Instruction>(GEP))
+      I->eraseFromParent();
+  }
+}
+
+bool DxilConstArrayToBuffer::runOnModule(Module &M) {
+  if (m_Space == UINT_MAX || !M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  if (DM.GetShaderModel()->IsLib())
+    return false;
+
+  const DataLayout &DL = M.getDataLayout();
+  std::vector<GlobalVariable *> Arrays;
+  for (GlobalVariable &GV : M.globals()) {
+    if (IsCandidate(GV, DL))
+      Arrays.push_back(&GV);
+  }
+  if (Arrays.empty())
+    return false;
+
+  for (auto &SRV : DM.GetSRVs()) {
+    if (SRV->GetSpaceID() == m_Space && SRV->GetLowerBound() == 0) {
+      M.getContext().emitError(
+          Twine("resource ") + SRV->GetGlobalName() +
+          " at register 0, space " + Twine(m_Space) +
+          " overlaps with the buffer reserved for constant arrays");
+      return false;
+    }
+  }
+
+  if (!RootSignatureBindsBuffer(DM)) {
+    M.getContext().emitError(
+        Twine("root signature does not bind t0, space ") + Twine(m_Space) +
+        " for the buffer reserved for constant arrays");
+    return false;
+  }
+
+  unsigned ID = AddBufferResource(DM);
+  std::vector<uint8_t> Data;
+  DenseMap<Function *, Value *> HandleMap;
+  for (GlobalVariable *GV : Arrays) {
+    unsigned BaseOffset = Data.size();
+    AppendData(GV->getInitializer(), Data);
+    ReplaceLoads(*GV, BaseOffset, ID, DM, HandleMap);
+    GV->removeDeadConstantUsers();
+    GV->eraseFromParent();
+  }
+
+  DxilConstantArrayDataHeader Header = {};
+  Header.Space = m_Space;
+  Header.LowerBound = 0;
+  Header.DataSize = Data.size();
+  std::vector<uint8_t> Part(sizeof(Header));
+  memcpy(Part.data(), &Header, sizeof(Header));
+  Part.insert(Part.end(), Data.begin(), Data.end());
+  DM.SetConstantArrayData(std::move(Part));
+
+  DM.AddCompileStat("DxilConstArrayToBuffer.Arrays", Arrays.size());
+  DM.AddCompileStat("DxilConstArrayToBuffer.Bytes", Data.size());
+  DM.ReEmitDxilResources();
+  return true;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilConstArrayToBufferPass(unsigned Space) {
+  return new DxilConstArrayToBuffer(Space);
+}
+
+INITIALIZE_PASS(DxilConstArrayToBuffer, "dxil-const-array-to-buffer",
+                "DXIL constant array to buffer", false, false)
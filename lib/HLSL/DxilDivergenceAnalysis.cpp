@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDivergenceAnalysis.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Finds the values of a DXIL function that may differ between threads.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilDivergenceAnalysis.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Divergence starts at values that are not computed from inputs shared by
+// the scope, such as arguments, memory loads and most dx.op calls, and
+// propagates forward through data flow. Branches are not tracked
+// individually: once any branch is divergent, every phi and every value
+// defined in a loop is treated as divergent too, since threads may reach
+// them through different paths or on different iterations.
+DxilDivergenceAnalysis::DxilDivergenceAnalysis(Function &F, LoopInfo &LI,
+                                               Scope S)
+    : m_Scope(S) {
+  std::vector<Value *> Worklist;
+  for (Argument &Arg : F.args())
+    MarkDivergent(&Arg, Worklist);
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      m_Analyzed.insert(&I);
+      if (!IsUniformSource(&I) && !PropagatesUniformity(&I))
+        MarkDivergent(&I, Worklist);
+    }
+  }
+
+  bool bDivergentBranch = false;
+  while (!Worklist.empty()) {
+    Value *V = Worklist.back();
+    Worklist.pop_back();
+    for (User *U : V->users()) {
+      Instruction *I = dyn_cast<Instruction>(U);
+      if (!I)
+        continue;
+      if (TerminatorInst *TI = dyn_cast<TerminatorInst>(I)) {
+        m_Divergent.insert(TI);
+        if (TI->getNumSuccessors() > 1 && !bDivergentBranch) {
+          bDivergentBranch = true;
+          MarkPathDependentValues(F, LI, Worklist);
+        }
+        continue;
+      }
+      if (PropagatesUniformity(I))
+        MarkDivergent(I, Worklist);
+    }
+  }
+}
+
+bool DxilDivergenceAnalysis::IsUniform(Value *V) const {
+  if (isa<Constant>(V))
+    return true;
+  return m_Analyzed.count(V) && !m_Divergent.count(V);
+}
+
+void DxilDivergenceAnalysis::MarkDivergent(Value *V,
+                                           std::vector<Value *> &Worklist) {
+  if (m_Divergent.insert(V).second)
+    Worklist.push_back(V);
+}
+
+void DxilDivergenceAnalysis::MarkPathDependentValues(
+    Function &F, LoopInfo &LI, std::vector<Value *> &Worklist) {
+  for (BasicBlock &BB : F) {
+    bool bInLoop = LI.getLoopFor(&BB) != nullptr;
+    for (Instruction &I : BB) {
+      if (isa<PHINode>(I) || (bInLoop && !I.getType()->isVoidTy()))
+        MarkDivergent(&I, Worklist);
+    }
+  }
+}
+
+// Returns true if I is uniform whenever its operands are.
+bool DxilDivergenceAnalysis::PropagatesUniformity(Instruction *I) const {
+  if (isa<BinaryOperator>(I) || isa<CastInst>(I) || isa<CmpInst>(I) ||
+      isa<SelectInst>(I) || isa<PHINode>(I) || isa<ExtractValueInst>(I) ||
+      isa<ExtractElementInst>(I) || isa<InsertElementInst>(I) ||
+      isa<InsertValueInst>(I) || isa<TerminatorInst>(I))
+    return true;
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::CreateHandle:
+  case DXIL::OpCode::CreateHandleForLib:
+  case DXIL::OpCode::CBufferLoad:
+  case DXIL::OpCode::CBufferLoadLegacy:
+  case DXIL::OpCode::GroupId:
+    // Constant buffers cannot change during a draw or dispatch, and neither
+    // a wave nor a thread group spans thread groups.
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Returns true if I is uniform whatever its operands are.
+bool DxilDivergenceAnalysis::IsUniformSource(Instruction *I) const {
+  // Resource globals in libraries are bound once for the whole dispatch.
+  if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    return isa<GlobalVariable>(LI->getPointerOperand()) &&
+           dxilutil::IsHLSLResourceType(LI->getType());
+  }
+  if (m_Scope != Scope::Wave)
+    return false;
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::WaveReadLaneFirst:
+  case DXIL::OpCode::WaveActiveOp:
+  case DXIL::OpCode::WaveActiveBit:
+  case DXIL::OpCode::WaveActiveAllEqual:
+  case DXIL::OpCode::WaveActiveBallot:
+  case DXIL::OpCode::WaveAnyTrue:
+  case DXIL::OpCode::WaveAllTrue:
+  case DXIL::OpCode::WaveAllBitCount:
+  case DXIL::OpCode::WaveGetLaneCount:
+    // Wave reductions are the same in every lane of one wave, though not
+    // across the waves of a group.
+    return true;
+  default:
+    return false;
+  }
+}
@@ -38,6 +38,28 @@
 // The approximation functions mostly come from [ADC]. The approximations
 // are also referenced in [HMF], but they give original credit to [ADC].
 // 
+// Fast transcendentals
+// ---------------------------------------------------------------------------
+// With the fast-transcendentals option the pass instead targets speed on
+// hardware that does have the native operations. Only calls that are not
+// precise are rewritten; precise calls keep the native operation, which is
+// more accurate than any expansion here.
+//
+//   acos, asin  shorter psi*(x) polynomial, see emitSqrt1mXtimesPsiX
+//   atan        shorter odd polynomial, see expandATan (atan2 is lowered to
+//               atan and benefits too)
+//   hcos, hsin  one Exp, using e^-x = 1 / e^x
+//   htan        one Exp, using tanh(x) = 1 - 2 / (e^2x + 1)
+//   pow         Exp(Log(x) * 0.5) becomes Sqrt(x), and with -0.5 Rsqrt(x)
+//   normalize   x / Sqrt(y) becomes x * Rsqrt(y)
+//
+// Exp and Log are native dxil operations and have no cheaper expansion.
+// The error of each approximation is given with its expansion, as a maximum
+// absolute error and the matching maximum error in float ulps, measured
+// against the libm result with utils/hct/hcttrigaccuracy.py. Near zero the
+// ulp error of odd functions is dominated by the relative error of the
+// leading coefficient.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/DxilGenerationPass.h"
@@ -52,6 +74,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/Transforms/Utils/Local.h"
 
 #include <cmath>
 #include <utility>
@@ -62,23 +85,31 @@ using namespace hlsl;
 namespace {
 class DxilExpandTrigIntrinsics : public FunctionPass {
 private:
+  bool m_FastTranscendentals;
 
 public:
   static char ID; // Pass identification, replacement for typeid
-  explicit DxilExpandTrigIntrinsics() : FunctionPass(ID) {}
+  explicit DxilExpandTrigIntrinsics(bool FastTranscendentals = false)
+      : FunctionPass(ID), m_FastTranscendentals(FastTranscendentals) {}
 
   const char *getPassName() const override {
     return "DXIL expand trig intrinsics";
   }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "fast-transcendentals", &m_FastTranscendentals,
+                      false);
+  }
   
   bool runOnFunction(Function &F) override;
   
 
 private:
   typedef std::vector<CallInst *> IntrinsicList;
-  IntrinsicList findTrigFunctionsToExpand(Function &F);
+  IntrinsicList findTrigFunctionsToExpand(Function &F, DxilModule &DM);
   CallInst *isExpandableTrigIntrinsicCall(Instruction *I);
   bool expandTrigIntrinsics(DxilModule &DM, const IntrinsicList &worklist);
+  bool simplifyFastPowAndRsqrt(Function &F, DxilModule &DM);
   FastMathFlags getFastMathFlagsForIntrinsic(CallInst *intrinsic);
   void prepareBuilderToExpandIntrinsic(IRBuilder<> &builder, CallInst *intrinsic);
 
@@ -106,8 +137,10 @@ namespace math {
 
 bool DxilExpandTrigIntrinsics::runOnFunction(Function &F) {
   DxilModule &DM = F.getParent()->GetOrCreateDxilModule(); 
-  IntrinsicList intrinsics = findTrigFunctionsToExpand(F);
-  const bool changed = expandTrigIntrinsics(DM, intrinsics);
+  IntrinsicList intrinsics = findTrigFunctionsToExpand(F, DM);
+  bool changed = expandTrigIntrinsics(DM, intrinsics);
+  if (m_FastTranscendentals)
+    changed |= simplifyFastPowAndRsqrt(F, DM);
   return changed;
 }
 
@@ -128,11 +161,16 @@ CallInst *DxilExpandTrigIntrinsics::isExpandableTrigIntrinsicCall(Instruction *I
     return nullptr;
 }
 
-DxilExpandTrigIntrinsics::IntrinsicList DxilExpandTrigIntrinsics::findTrigFunctionsToExpand(Function &F) {
+DxilExpandTrigIntrinsics::IntrinsicList DxilExpandTrigIntrinsics::findTrigFunctionsToExpand(Function &F, DxilModule &DM) {
   IntrinsicList worklist;
   for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
     if (CallInst *call = isExpandableTrigIntrinsicCall(&*I))
-      worklist.push_back(call);
+      // In fast mode precise calls keep the native operation, as does tan,
+      // which has no cheaper expansion.
+      if (!m_FastTranscendentals ||
+          (!DM.IsPrecise(call) &&
+           OP::GetDxilOpFuncCallInst(call) != OP::OpCode::Tan))
+        worklist.push_back(call);
 
   return worklist;
 }
@@ -220,25 +258,43 @@ static Value *emitSqrt(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name)
 //         = a0 + x(a1 + a2x + a3x^2)
 //         = a0 + x(a1 + x(a2 + a3x))
 //
-static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name) {
+// The fast approximation drops the cubic term and refits the remaining
+// coefficients as a minimax approximation with a0 fixed to pi/2, so that
+// asin(0) is exactly 0.
+//
+//   psi*(X) = pi/2 + b1x + b2x^2
+//     b1 = -0.2074471
+//     b2 =  0.0534494
+//
+static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name, bool fast) {
   Value *One = ConstantFP::get(X->getType(), 1.0);
-  Value *a0 = ConstantFP::get(X->getType(),  1.5707288);
-  Value *a1 = ConstantFP::get(X->getType(), -0.2121144);
-  Value *a2 = ConstantFP::get(X->getType(),  0.0742610);
-  Value *a3 = ConstantFP::get(X->getType(), -0.0187293);
-
 
   // sqrt(1-x)
   Value *r1 = builder.CreateFSub(One, X, name);
   Value *r2 = emitSqrt(builder, r1, dxOp, name);
 
   // psi*(x)
-  Value *r3 = builder.CreateFMul(X,  a3, name);
-         r3 = builder.CreateFAdd(r3, a2, name);
-         r3 = builder.CreateFMul(X,  r3, name);
-         r3 = builder.CreateFAdd(r3, a1, name);
-         r3 = builder.CreateFMul(X,  r3, name);
-         r3 = builder.CreateFAdd(r3, a0, name);
+  Value *r3;
+  if (fast) {
+    Value *b0 = ConstantFP::get(X->getType(), math::PI_2);
+    Value *b1 = ConstantFP::get(X->getType(), -0.2074471);
+    Value *b2 = ConstantFP::get(X->getType(),  0.0534494);
+    r3 = builder.CreateFMul(X,  b2, name);
+    r3 = builder.CreateFAdd(r3, b1, name);
+    r3 = builder.CreateFMul(X,  r3, name);
+    r3 = builder.CreateFAdd(r3, b0, name);
+  } else {
+    Value *a0 = ConstantFP::get(X->getType(),  1.5707288);
+    Value *a1 = ConstantFP::get(X->getType(), -0.2121144);
+    Value *a2 = ConstantFP::get(X->getType(),  0.0742610);
+    Value *a3 = ConstantFP::get(X->getType(), -0.0187293);
+    r3 = builder.CreateFMul(X,  a3, name);
+    r3 = builder.CreateFAdd(r3, a2, name);
+    r3 = builder.CreateFMul(X,  r3, name);
+    r3 = builder.CreateFAdd(r3, a1, name);
+    r3 = builder.CreateFMul(X,  r3, name);
+    r3 = builder.CreateFAdd(r3, a0, name);
+  }
 
   // sqrt(1-x) * psi*(x)
   Value *r4 = builder.CreateFMul(r2, r3,  name);
@@ -254,12 +310,18 @@ static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, Str
 //
 //  e^x = 2^{x * log_2(e)}
 //
-static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name) {
+// The fast version computes e^-x as 1 / e^x, trading the second Exp for a
+// reciprocal.
+//
+static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name, bool fast) {
   Value *Zero  = ConstantFP::get(X->getType(), 0.0);
+  Value *One   = ConstantFP::get(X->getType(), 1.0);
   Value *Log2e = ConstantFP::get(X->getType(), math::LOG2E);
 
   Value *r0 = builder.CreateFMul(X, Log2e, name);
   Value *r1 = emitUnaryFloat(builder, r0, dxOp, OP::OpCode::Exp, name);
+  if (fast)
+    return std::make_pair(r1, builder.CreateFDiv(One, r1, name));
   Value *r2 = builder.CreateFSub(Zero, r0, name);
   Value *r3 = emitUnaryFloat(builder, r2, dxOp, OP::OpCode::Exp, name);
 
@@ -294,6 +356,9 @@ static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP
 //
 // In [HMF] the authors claim an error, e, of |e| <= 5e-5, but the error graph
 // in [ADC] looks like the error can be larger that that for some inputs.
+//
+// The fast approximation has a maximum error of 4.0e-4 over [-1, 1], or
+// 1.2e5 ulps, the largest near zero.
 // 
 Value *DxilExpandTrigIntrinsics::expandASin(IRBuilder<> &builder, DxilInst_Asin asin, DxilModule &DM) {
   assert(asin);
@@ -306,7 +371,8 @@ Value *DxilExpandTrigIntrinsics::expandASin(IRBuilder<> &builder, DxilInst_Asin
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
 
   // Approximation
-  Value *psiX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name);
+  Value *psiX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name,
+                                     m_FastTranscendentals);
   Value *asinX = builder.CreateFSub(PI_2, psiX, name);
   Value *asinmX = builder.CreateFSub(Zero, asinX, name);
 
@@ -339,6 +405,9 @@ Value *DxilExpandTrigIntrinsics::expandASin(IRBuilder<> &builder, DxilInst_Asin
 // We take the absolute value of x, compute acos(x) using the approximation
 // and then subtract from pi if x < 0.
 //
+// The fast approximation has a maximum error of 4.0e-4 over [-1, 1], or
+// 3.0e4 ulps.
+//
 Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos acos, DxilModule &DM) {
   assert(acos);
   StringRef name = "acos.x";
@@ -350,7 +419,8 @@ Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
 
   // Approximation
-  Value *acosX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name);
+  Value *acosX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name,
+                                      m_FastTranscendentals);
   Value *acosmX = builder.CreateFSub(PI, acosX, name);
 
   // Range expansion to [-1, 1]
@@ -400,6 +470,16 @@ Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos
 // To expand the range we check if x > 1 then subtracted the computed value from
 // pi/2 and if x is negative then negate the final value.
 //
+// The fast approximation drops the two highest terms and refits the rest as
+// a minimax approximation on [0, 1]
+//
+//    arctan*(x) = d1x + d3x^3 + d5x^5
+//      d1 =  0.9953620
+//      d3 = -0.2887134
+//      d5 =  0.0793630
+//
+// with a maximum error of 6.1e-4, or 7.7e4 ulps, the largest near zero.
+//
 Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan atan, DxilModule &DM) {
   assert(atan);
   StringRef name  = "atan.x";
@@ -423,15 +503,26 @@ Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan
 
   // Approximate
   Value *r3 = builder.CreateFMul(r2, r2, name);
-  Value *r4 = builder.CreateFMul(r3, c9, name);
-         r4 = builder.CreateFAdd(r4, c7, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c5, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c3, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c1, name);
-         r4 = builder.CreateFMul(r2, r4, name);
+  Value *r4;
+  if (m_FastTranscendentals) {
+    Value *d1 = ConstantFP::get(X->getType(),  0.9953620);
+    Value *d3 = ConstantFP::get(X->getType(), -0.2887134);
+    Value *d5 = ConstantFP::get(X->getType(),  0.0793630);
+    r4 = builder.CreateFMul(r3, d5, name);
+    r4 = builder.CreateFAdd(r4, d3, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, d1, name);
+  } else {
+    r4 = builder.CreateFMul(r3, c9, name);
+    r4 = builder.CreateFAdd(r4, c7, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, c5, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, c3, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, c1, name);
+  }
+  r4 = builder.CreateFMul(r2, r4, name);
 
   // Range Expansion to [0, inf]
   Value *r5 = builder.CreateFSub(PI_2, r4, name);
@@ -453,6 +544,9 @@ Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan
 // 
 // No range reduction is needed.
 //
+// The fast expansion computes e^-x as 1 / e^x. As with the full expansion
+// the error, up to 16 ulps, comes from rounding x * log_2(e).
+//
 Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos hcos, DxilModule &DM) {
   assert(hcos);
   StringRef name = "hcos.x";
@@ -460,7 +554,8 @@ Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos
   Value *X = hcos.get_value();
   Value *Two = ConstantFP::get(X->getType(), 2.0);
 
-  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
+  std::tie(eX, emX) =
+      emitExEmx(builder, X, DM.GetOP(), name, m_FastTranscendentals);
   Value *r4 = builder.CreateFAdd(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, Two, name);
 
@@ -475,6 +570,10 @@ Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos
 //
 // No range reduction is needed.
 //
+// The fast expansion computes e^-x as 1 / e^x. Like the full expansion it
+// loses precision to cancellation near zero, with a maximum absolute error
+// of 2.4e-7.
+//
 Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin hsin, DxilModule &DM) {
   assert(hsin);
   StringRef name = "hsin.x";
@@ -482,7 +581,8 @@ Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin
   Value *X = hsin.get_value();
   Value *Two = ConstantFP::get(X->getType(), 2.0);
 
-  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
+  std::tie(eX, emX) =
+      emitExEmx(builder, X, DM.GetOP(), name, m_FastTranscendentals);
   Value *r4 = builder.CreateFSub(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, Two, name);
 
@@ -497,13 +597,33 @@ Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin
 //
 // No range reduction is needed.
 //
+// The fast expansion uses the identity
+//
+//    tanh(x) = 1 - 2 / (e^2x + 1)
+//
+// which needs a single Exp and saturates to +-1 instead of dividing infinity
+// by infinity for large |x|. It has a maximum absolute error of 1.8e-7; the
+// relative error grows near zero due to cancellation.
+//
 Value *DxilExpandTrigIntrinsics::expandHTan(IRBuilder<> &builder, DxilInst_Htan htan, DxilModule &DM) {
   assert(htan);
   StringRef name = "htan.x";
   Value *eX, *emX;
   Value *X = htan.get_value();
 
-  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
+  if (m_FastTranscendentals) {
+    Value *One = ConstantFP::get(X->getType(), 1.0);
+    Value *Two = ConstantFP::get(X->getType(), 2.0);
+    Value *TwoLog2e = ConstantFP::get(X->getType(), 2.0 * math::LOG2E);
+    Value *r0 = builder.CreateFMul(X, TwoLog2e, name);
+    Value *r1 = emitUnaryFloat(builder, r0, DM.GetOP(), OP::OpCode::Exp, name);
+    Value *r2 = builder.CreateFAdd(r1, One, name);
+    Value *r3 = builder.CreateFDiv(Two, r2, name);
+    return builder.CreateFSub(One, r3, name);
+  }
+
+  std::tie(eX, emX) =
+      emitExEmx(builder, X, DM.GetOP(), name, m_FastTranscendentals);
   Value *r4 = builder.CreateFSub(eX, emX, name);
   Value *r5 = builder.CreateFAdd(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, r5, name);
@@ -532,10 +652,94 @@ Value *DxilExpandTrigIntrinsics::expandTan(IRBuilder<> &builder,
   return r;
 }
 
+// Pow and normalize
+// ----------------------------------------------------------------------------
+// Fast mode only. pow(x, y) is lowered to Exp(Log(x) * y). When y is a
+// constant +-0.5 the same result comes from a single native operation:
+//
+//    Exp(Log(x) *  0.5) = Sqrt(x)
+//    Exp(Log(x) * -0.5) = Rsqrt(x)
+//
+// Both forms return NaN for x < 0 and 0 or +inf for x = 0, and differ only
+// in rounding.
+//
+// Normalization and other divisions by a square root become a multiply by
+// the reciprocal square root:
+//
+//    x / Sqrt(y) = x * Rsqrt(y)
+//
+// The result is within the precision dxil requires of Rsqrt.
+//
+static Value *getSqrtPowBase(Value *V, DxilModule &DM, bool &reciprocal) {
+  BinaryOperator *Mul = dyn_cast<BinaryOperator>(V);
+  if (!Mul || Mul->getOpcode() != Instruction::FMul || DM.IsPrecise(Mul))
+    return nullptr;
+  for (unsigned i = 0; i < 2; ++i) {
+    CallInst *Log = dyn_cast<CallInst>(Mul->getOperand(i));
+    ConstantFP *Y = dyn_cast<ConstantFP>(Mul->getOperand(1 - i));
+    if (!Y || !Log || !OP::IsDxilOpFuncCallInst(Log, OP::OpCode::Log) ||
+        DM.IsPrecise(Log))
+      continue;
+    double y = Y->getValueAPF().convertToDouble();
+    if (y != 0.5 && y != -0.5)
+      continue;
+    reciprocal = y < 0;
+    return DxilInst_Log(Log).get_value();
+  }
+  return nullptr;
+}
+
+bool DxilExpandTrigIntrinsics::simplifyFastPowAndRsqrt(Function &F, DxilModule &DM) {
+  std::vector<Instruction *> candidates;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    if (OP::IsDxilOpFuncCallInst(&*I, OP::OpCode::Exp) ||
+        I->getOpcode() == Instruction::FDiv)
+      if (!DM.IsPrecise(&*I))
+        candidates.push_back(&*I);
+  }
+
+  IRBuilder<> builder(DM.GetCtx());
+  setPreciseBuilder(builder, false);
+  OP *dxOp = DM.GetOP();
+  bool changed = false;
+  for (Instruction *I : candidates) {
+    builder.SetInsertPoint(I);
+    Value *replacement = nullptr;
+    if (CallInst *exp = dyn_cast<CallInst>(I)) {
+      bool reciprocal = false;
+      if (Value *X = getSqrtPowBase(DxilInst_Exp(exp).get_value(), DM,
+                                    reciprocal))
+        replacement = emitUnaryFloat(
+            builder, X, dxOp,
+            reciprocal ? OP::OpCode::Rsqrt : OP::OpCode::Sqrt, "pow.x");
+    } else {
+      Value *Num = I->getOperand(0);
+      CallInst *Den = dyn_cast<CallInst>(I->getOperand(1));
+      if (!Den || !Den->hasOneUse() ||
+          !OP::IsDxilOpFuncCallInst(Den, OP::OpCode::Sqrt) ||
+          DM.IsPrecise(Den))
+        continue;
+      Value *rsqrt = emitUnaryFloat(
+          builder, DxilInst_Sqrt(Den).get_value(), dxOp,
+          OP::OpCode::Rsqrt, "rsqrt.x");
+      ConstantFP *NumC = dyn_cast<ConstantFP>(Num);
+      replacement = NumC && NumC->isExactlyValue(1.0)
+                        ? rsqrt
+                        : builder.CreateFMul(Num, rsqrt, "rsqrt.x");
+    }
+    if (!replacement)
+      continue;
+    I->replaceAllUsesWith(replacement);
+    RecursivelyDeleteTriviallyDeadInstructions(I);
+    changed = true;
+  }
+  return changed;
+}
+
 char DxilExpandTrigIntrinsics::ID = 0;
 
-FunctionPass *llvm::createDxilExpandTrigIntrinsicsPass() {
-  return new DxilExpandTrigIntrinsics();
+FunctionPass *llvm::createDxilExpandTrigIntrinsicsPass(bool FastTranscendentals) {
+  return new DxilExpandTrigIntrinsics(FastTranscendentals);
 }
 
 INITIALIZE_PASS(DxilExpandTrigIntrinsics,
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilFormDotMad.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Forms dot and mad operations from scalar multiply and add chains.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Dot and mad formation.
+//
+// Vector math written out by hand, or split apart by scalarization and matrix
+// lowering, reaches DXIL as chains of scalar multiplies and adds:
+//
+//   a.x * b.x + a.y * b.y + a.z * b.z  =>  dx.op.dot3(a.x, a.y, a.z, ...)
+//   a * b + c                          =>  dx.op.fmad / imad / umad
+//
+// Floating point chains are only rewritten when every instruction involved
+// allows unsafe algebra and none is precise, as the result may round
+// differently. Integer chains wrap the same either way and are always
+// rewritten.
+
+namespace {
+
+class DxilFormDotMad : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilFormDotMad() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL form dot and mad";
+  }
+
+  bool runOnFunction(Function &F) override {
+    Module *M = F.getParent();
+    if (!M->HasDxilModule())
+      return false;
+    DxilModule &DM = M->GetDxilModule();
+    m_pDM = &DM;
+    m_pOP = DM.GetOP();
+    m_DotCount = m_MadCount = 0;
+
+    bool bChanged = false;
+    for (BasicBlock &BB : F)
+      bChanged |= FormDots(BB);
+    for (BasicBlock &BB : F)
+      bChanged |= FormMads(BB);
+
+    if (m_DotCount)
+      DM.AddCompileStat("DxilFormDotMad.Dot", m_DotCount);
+    if (m_MadCount)
+      DM.AddCompileStat("DxilFormDotMad.Mad", m_MadCount);
+    return bChanged;
+  }
+
+private:
+  DxilModule *m_pDM;
+  OP *m_pOP;
+  unsigned m_DotCount;
+  unsigned m_MadCount;
+
+  bool IsFastBinOp(Value *V, Instruction::BinaryOps Opcode) {
+    BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+    if (!BO || BO->getOpcode() != Opcode || m_pDM->IsPrecise(BO))
+      return false;
+    return !isa<FPMathOperator>(BO) || BO->hasUnsafeAlgebra();
+  }
+
+  bool CollectDotProducts(Value *V, Instruction *Root,
+                          SmallVectorImpl<BinaryOperator *> &Products);
+  bool FormDots(BasicBlock &BB);
+  bool FormMads(BasicBlock &BB);
+};
+
+char DxilFormDotMad::ID = 0;
+
+// Gathers the multiplies summed by the fadd tree rooted at V. Returns false if
+// the tree has any other kind of leaf or more than four products.
+bool DxilFormDotMad::CollectDotProducts(
+    Value *V, Instruction *Root, SmallVectorImpl<BinaryOperator *> &Products) {
+  // Inner nodes must feed only the tree so that the whole tree can go away.
+  if (V != Root && !V->hasOneUse())
+    return false;
+  if (IsFastBinOp(V, Instruction::FAdd)) {
+    BinaryOperator *Add = cast<BinaryOperator>(V);
+    return CollectDotProducts(Add->getOperand(0), Root, Products) &&
+           CollectDotProducts(Add->getOperand(1), Root, Products);
+  }
+  if (V != Root && IsFastBinOp(V, Instruction::FMul) && Products.size() < 4) {
+    Products.push_back(cast<BinaryOperator>(V));
+    return true;
+  }
+  return false;
+}
+
+bool DxilFormDotMad::FormDots(BasicBlock &BB) {
+  SmallVector<WeakVH, 16> Adds;
+  for (Instruction &I : BB) {
+    Type *Ty = I.getType();
+    if ((Ty->isFloatTy() || Ty->isHalfTy()) &&
+        IsFastBinOp(&I, Instruction::FAdd))
+      Adds.emplace_back(&I);
+  }
+
+  // Visit outer adds before the adds they consume, so the largest tree is
+  // formed first; the inner adds of a formed tree are deleted with it.
+  bool bChanged = false;
+  for (auto It = Adds.rbegin(), E = Adds.rend(); It != E; ++It) {
+    Instruction *I = cast_or_null<Instruction>((Value *)*It);
+    if (!I)
+      continue;
+    SmallVector<BinaryOperator *, 4> Products;
+    if (!CollectDotProducts(I, I, Products) || Products.size() < 2)
+      continue;
+
+    DXIL::OpCode Opcode = Products.size() == 2   ? DXIL::OpCode::Dot2
+                          : Products.size() == 3 ? DXIL::OpCode::Dot3
+                                                 : DXIL::OpCode::Dot4;
+    SmallVector<Value *, 9> Args;
+    Args.emplace_back(m_pOP->GetU32Const((unsigned)Opcode));
+    for (BinaryOperator *Mul : Products)
+      Args.emplace_back(Mul->getOperand(0));
+    for (BinaryOperator *Mul : Products)
+      Args.emplace_back(Mul->getOperand(1));
+
+    IRBuilder<> Builder(I);
+    Value *Dot =
+        Builder.CreateCall(m_pOP->GetOpFunc(Opcode, I->getType()), Args);
+    I->replaceAllUsesWith(Dot);
+    RecursivelyDeleteTriviallyDeadInstructions(I);
+    ++m_DotCount;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+bool DxilFormDotMad::FormMads(BasicBlock &BB) {
+  bool bChanged = false;
+  for (auto It = BB.begin(); It != BB.end();) {
+    Instruction *I = &*(It++);
+    Type *Ty = I->getType();
+    bool bFloat = Ty->isHalfTy() || Ty->isFloatTy() || Ty->isDoubleTy();
+    bool bInt = Ty->isIntegerTy(16) || Ty->isIntegerTy(32) ||
+                Ty->isIntegerTy(64);
+    Instruction::BinaryOps AddOp =
+        bFloat ? Instruction::FAdd : Instruction::Add;
+    Instruction::BinaryOps MulOp =
+        bFloat ? Instruction::FMul : Instruction::Mul;
+    if (!(bFloat || bInt) || !IsFastBinOp(I, AddOp))
+      continue;
+
+    BinaryOperator *Mul = nullptr;
+    Value *Addend = nullptr;
+    for (unsigned i = 0; i < 2 && !Mul; ++i) {
+      Value *Op = I->getOperand(i);
+      if (Op->hasOneUse() && IsFastBinOp(Op, MulOp)) {
+        Mul = cast<BinaryOperator>(Op);
+        Addend = I->getOperand(1 - i);
+      }
+    }
+    if (!Mul)
+      continue;
+
+    DXIL::OpCode Opcode = bFloat ? DXIL::OpCode::FMad
+                          : Mul->hasNoSignedWrap() ? DXIL::OpCode::IMad
+                                                   : DXIL::OpCode::UMad;
+    IRBuilder<> Builder(I);
+    Value *Mad = Builder.CreateCall(
+        m_pOP->GetOpFunc(Opcode, Ty),
+        {m_pOP->GetU32Const((unsigned)Opcode), Mul->getOperand(0),
+         Mul->getOperand(1), Addend});
+    I->replaceAllUsesWith(Mad);
+    I->eraseFromParent();
+    Mul->eraseFromParent();
+    ++m_MadCount;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+} // namespace
+
+FunctionPass *llvm::createDxilFormDotMadPass() {
+  return new DxilFormDotMad();
+}
+
+INITIALIZE_PASS(DxilFormDotMad, "dxil-form-dot-mad", "DXIL form dot and mad",
+                false, false)
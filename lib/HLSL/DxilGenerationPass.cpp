@@ -177,6 +177,7 @@ void InitDxilModuleFromHLModule(HLModule &H, DxilModule &M, bool HasDebugInfo) {
   M.SetAllResourcesBound(H.GetHLOptions().bAllResourcesBound);
 
   M.SetAutoBindingSpace(H.GetAutoBindingSpace());
+  M.SetCompileStats(H.GetCompileStats());
 
   // Update Validator Version
   M.UpgradeToMinValidatorVersion();
@@ -0,0 +1,535 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilGroupsharedBankConflicts.cpp                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Reports and pads groupshared arrays accessed with bank conflicts.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilDivergenceAnalysis.h"
+#include "dxc/HLSL/HLModule.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Groupshared bank conflicts.
+//
+// Groupshared memory is split into 32 banks of 4-byte words, word w being in
+// bank w % 32. When the lanes of a wave access distinct words of one bank in
+// the same instruction, the accesses are serialized. The classic case is a
+// column access to a square array:
+//
+//   groupshared float data[32][32];
+//   ... data[GTid.x][i] ...    // lanes are 32 words apart: 32-way conflict
+//
+// For every access to a groupshared array, the pass expresses each index as
+// an affine function of the thread IDs, ignoring terms that are uniform over
+// the wave, and evaluates the resulting addresses for the lanes of the first
+// wave of the group. The degree of conflict is the largest number of distinct
+// words any bank is asked for. Accesses whose indices are not affine in the
+// thread IDs are counted as unknown.
+//
+// With reporting enabled, a warning is emitted for each conflicting access;
+// reporting alone does not change the module.
+// With padding enabled, the innermost dimension of a multi-dimensional array
+// is padded with the few elements that minimize the total degree of
+// conflict, provided every access to the array is a full-depth
+// getelementptr with affine indices, so that rewriting the global type and
+// the getelementptrs keeps every element where it is addressed. The pass
+// must run before multi-dimensional arrays are flattened.
+
+namespace {
+
+// Number of groupshared memory banks, and the wave size assumed for them.
+const unsigned kNumBanks = 32;
+const unsigned kBankWordBytes = 4;
+// Largest padding tried, in elements.
+const unsigned kMaxPadElements = 8;
+
+// Thread ID components an index may depend on.
+enum ThreadVar { TidX, TidY, TidZ, TidFlat, NumThreadVars };
+
+// Coefficients of an index over the thread IDs. Constant and wave-uniform
+// terms shift every lane by the same amount and do not affect conflicts.
+struct LaneAffine {
+  int64_t Coeff[NumThreadVars] = {};
+};
+
+struct GroupsharedAccess {
+  Instruction *I = nullptr;
+  // Per-dimension coefficients; empty if an index is not affine.
+  std::vector<LaneAffine> Indices;
+};
+
+struct GroupsharedArray {
+  GlobalVariable *GV = nullptr;
+  std::vector<uint64_t> Dims;
+  uint64_t EltBytes = 0;
+  std::vector<GroupsharedAccess> Accesses;
+  // True if every user is a full-depth getelementptr used only to access
+  // an element.
+  bool bFullDepthOnly = true;
+};
+
+class DxilGroupsharedBankConflicts : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilGroupsharedBankConflicts(bool Report = false, bool Pad = false)
+      : ModulePass(ID), m_bReport(Report), m_bPad(Pad) {}
+
+  const char *getPassName() const override {
+    return "DXIL groupshared bank conflicts";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "report", &m_bReport, m_bReport);
+    GetPassOptionBool(O, "pad", &m_bPad, m_bPad);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool m_bReport;
+  bool m_bPad;
+  unsigned m_NumThreads[3];
+  std::unordered_map<Function *, std::unique_ptr<DxilDivergenceAnalysis>>
+      m_Divergence;
+
+  const DxilDivergenceAnalysis &GetDivergence(Function *F);
+  bool Decompose(Value *V, LaneAffine &Result, unsigned Depth);
+  bool CollectArray(GlobalVariable *GV, GroupsharedArray &Arr);
+  void CollectAccesses(Value *Ptr, SmallVectorImpl<Value *> &Indices,
+                       GroupsharedArray &Arr);
+  unsigned GetConflictDegree(const GroupsharedArray &Arr,
+                             const GroupsharedAccess &Access,
+                             unsigned PadElements, int64_t *LaneStride);
+  static void PadArray(GroupsharedArray &Arr, unsigned PadElements,
+                       DebugInfoFinder *Finder);
+};
+
+char DxilGroupsharedBankConflicts::ID = 0;
+
+const DxilDivergenceAnalysis &
+DxilGroupsharedBankConflicts::GetDivergence(Function *F) {
+  std::unique_ptr<DxilDivergenceAnalysis> &DA = m_Divergence[F];
+  if (!DA) {
+    DominatorTree DT;
+    DT.recalculate(*F);
+    LoopInfo LI;
+    LI.Analyze(DT);
+    DA = llvm::make_unique<DxilDivergenceAnalysis>(
+        *F, LI, DxilDivergenceAnalysis::Scope::Wave);
+  }
+  return *DA;
+}
+
+// Expresses V as coefficients over the thread IDs. Returns false if V is
+// not affine in the thread IDs and wave-uniform values.
+bool DxilGroupsharedBankConflicts::Decompose(Value *V, LaneAffine &Result,
+                                             unsigned Depth) {
+  Result = LaneAffine();
+  if (isa<Constant>(V))
+    return isa<ConstantInt>(V);
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I || Depth > 8)
+    return false;
+  if (GetDivergence(I->getParent()->getParent()).IsUniform(I))
+    return true;
+
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (!OP::IsDxilOpFuncCallInst(CI))
+      return false;
+    switch (OP::GetDxilOpFuncCallInst(CI)) {
+    case DXIL::OpCode::FlattenedThreadIdInGroup:
+      Result.Coeff[TidFlat] = 1;
+      return true;
+    case DXIL::OpCode::ThreadIdInGroup:
+    case DXIL::OpCode::ThreadId: {
+      // The dispatch thread ID differs from the group thread ID by a
+      // multiple of the group size that is the same for the whole group.
+      ConstantInt *Comp = dyn_cast<ConstantInt>(CI->getArgOperand(1));
+      if (!Comp || Comp->getZExtValue() > 2)
+        return false;
+      Result.Coeff[TidX + Comp->getZExtValue()] = 1;
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+
+  switch (I->getOpcode()) {
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::Trunc:
+    return Decompose(I->getOperand(0), Result, Depth + 1);
+  case Instruction::Add:
+  case Instruction::Sub: {
+    LaneAffine RHS;
+    if (!Decompose(I->getOperand(0), Result, Depth + 1) ||
+        !Decompose(I->getOperand(1), RHS, Depth + 1))
+      return false;
+    int64_t Sign = I->getOpcode() == Instruction::Add ? 1 : -1;
+    for (unsigned v = 0; v < NumThreadVars; ++v)
+      Result.Coeff[v] += Sign * RHS.Coeff[v];
+    return true;
+  }
+  case Instruction::Mul:
+  case Instruction::Shl: {
+    Value *Var = I->getOperand(0);
+    ConstantInt *C = dyn_cast<ConstantInt>(I->getOperand(1));
+    if (!C && I->getOpcode() == Instruction::Mul) {
+      Var = I->getOperand(1);
+      C = dyn_cast<ConstantInt>(I->getOperand(0));
+    }
+    if (!C || C->getBitWidth() > 64)
+      return false;
+    int64_t Scale = C->getSExtValue();
+    if (I->getOpcode() == Instruction::Shl) {
+      if (Scale < 0 || Scale > 31)
+        return false;
+      Scale = (int64_t)1 << Scale;
+    }
+    if (!Decompose(Var, Result, Depth + 1))
+      return false;
+    for (unsigned v = 0; v < NumThreadVars; ++v)
+      Result.Coeff[v] *= Scale;
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+// Returns true if Ptr is only used as the address of element accesses.
+static bool IsOnlyAccessed(Value *Ptr) {
+  for (User *U : Ptr->users()) {
+    if (isa<LoadInst>(U)) {
+      continue;
+    } else if (StoreInst *SI = dyn_cast<StoreInst>(U)) {
+      if (SI->getPointerOperand() != Ptr)
+        return false;
+    } else if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(U)) {
+      if (RMW->getPointerOperand() != Ptr)
+        return false;
+    } else if (AtomicCmpXchgInst *CAS = dyn_cast<AtomicCmpXchgInst>(U)) {
+      if (CAS->getPointerOperand() != Ptr)
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Fills in Arr for GV if it is an array of scalars, with the accesses made
+// through full-depth getelementptrs.
+bool DxilGroupsharedBankConflicts::CollectArray(GlobalVariable *GV,
+                                                GroupsharedArray &Arr) {
+  Type *Ty = GV->getType()->getElementType();
+  if (!Ty->isArrayTy())
+    return false;
+  while (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+    Arr.Dims.push_back(AT->getNumElements());
+    Ty = AT->getElementType();
+  }
+  if (!Ty->isIntegerTy() && !Ty->isFloatingPointTy())
+    return false;
+  Arr.GV = GV;
+  Arr.EltBytes = GV->getParent()->getDataLayout().getTypeAllocSize(Ty);
+
+  // Padding rewrites each access through a single getelementptr of the
+  // global, so it first merges chains of them. Reporting alone leaves the
+  // module untouched and follows the chains instead.
+  if (m_bPad) {
+    GV->removeDeadConstantUsers();
+    HLModule::MergeGepUse(GV);
+  }
+  SmallVector<Value *, 4> Indices;
+  CollectAccesses(GV, Indices, Arr);
+  return true;
+}
+
+// Adds the accesses made through the getelementptrs based on Ptr, which is
+// GV indexed by Indices in its outer dimensions.
+void DxilGroupsharedBankConflicts::CollectAccesses(
+    Value *Ptr, SmallVectorImpl<Value *> &Indices, GroupsharedArray &Arr) {
+  for (User *U : Ptr->users()) {
+    GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+    if (!GEP || !isa<ConstantInt>(GEP->getOperand(1)) ||
+        !cast<ConstantInt>(GEP->getOperand(1))->isZero()) {
+      Arr.bFullDepthOnly = false;
+      continue;
+    }
+    unsigned NumOuter = Indices.size();
+    Indices.append(GEP->op_begin() + 2, GEP->op_end());
+    if (Ptr != Arr.GV || Indices.size() != Arr.Dims.size())
+      Arr.bFullDepthOnly = false;
+    if (Indices.size() < Arr.Dims.size()) {
+      CollectAccesses(GEP, Indices, Arr);
+    } else if (Indices.size() == Arr.Dims.size() && IsOnlyAccessed(GEP)) {
+      for (User *AccessU : GEP->users()) {
+        GroupsharedAccess Access;
+        Access.I = cast<Instruction>(AccessU);
+        for (Value *IndexV : Indices) {
+          LaneAffine Index;
+          if (!Decompose(IndexV, Index, 0)) {
+            Access.Indices.clear();
+            break;
+          }
+          Access.Indices.push_back(Index);
+        }
+        Arr.Accesses.push_back(Access);
+      }
+    } else {
+      Arr.bFullDepthOnly = false;
+    }
+    Indices.resize(NumOuter);
+  }
+}
+
+// Returns the largest number of distinct words requested from one bank by
+// the lanes of the first wave, with the innermost dimension padded by
+// PadElements. Sets LaneStride to the distance in words between the first
+// two lanes.
+unsigned DxilGroupsharedBankConflicts::GetConflictDegree(
+    const GroupsharedArray &Arr, const GroupsharedAccess &Access,
+    unsigned PadElements, int64_t *LaneStride) {
+  unsigned NumDims = Arr.Dims.size();
+  std::vector<int64_t> Strides(NumDims);
+  int64_t Stride = Arr.EltBytes;
+  for (unsigned d = NumDims; d-- > 0;) {
+    Strides[d] = Stride;
+    Stride *= Arr.Dims[d] + (d == NumDims - 1 ? PadElements : 0);
+  }
+  int64_t AddrCoeff[NumThreadVars] = {};
+  for (unsigned d = 0; d < NumDims; ++d) {
+    for (unsigned v = 0; v < NumThreadVars; ++v)
+      AddrCoeff[v] += Access.Indices[d].Coeff[v] * Strides[d];
+  }
+
+  unsigned NumLanes = std::min<unsigned>(
+      kNumBanks, m_NumThreads[0] * m_NumThreads[1] * m_NumThreads[2]);
+  std::set<int64_t> BankWords[kNumBanks];
+  int64_t FirstWords[2] = {0, 0};
+  for (unsigned Lane = 0; Lane < NumLanes; ++Lane) {
+    int64_t Tid[NumThreadVars] = {
+        Lane % m_NumThreads[0], (Lane / m_NumThreads[0]) % m_NumThreads[1],
+        Lane / (m_NumThreads[0] * m_NumThreads[1]), Lane};
+    int64_t Addr = 0;
+    for (unsigned v = 0; v < NumThreadVars; ++v)
+      Addr += AddrCoeff[v] * Tid[v];
+    // Rebase so that word arithmetic is on non-negative values.
+    Addr += (int64_t)1 << 40;
+    int64_t First = Addr / kBankWordBytes;
+    int64_t Last = (Addr + Arr.EltBytes - 1) / kBankWordBytes;
+    if (Lane < 2)
+      FirstWords[Lane] = First;
+    for (int64_t W = First; W <= Last; ++W)
+      BankWords[W % kNumBanks].insert(W);
+  }
+  if (LaneStride)
+    *LaneStride = NumLanes > 1 ? FirstWords[1] - FirstWords[0] : 0;
+  unsigned Degree = 1;
+  for (const std::set<int64_t> &Words : BankWords)
+    Degree = std::max<unsigned>(Degree, Words.size());
+  return Degree;
+}
+
+// Rewrites Arr with its innermost dimension padded by PadElements. The
+// indices of every getelementptr are unchanged.
+void DxilGroupsharedBankConflicts::PadArray(GroupsharedArray &Arr,
+                                            unsigned PadElements,
+                                            DebugInfoFinder *Finder) {
+  GlobalVariable *GV = Arr.GV;
+  std::vector<Type *> Types;
+  for (Type *Ty = GV->getType()->getElementType(); Ty->isArrayTy();
+       Ty = Ty->getArrayElementType())
+    Types.push_back(Ty);
+  Type *NewTy = ArrayType::get(Types.back()->getArrayElementType(),
+                               Arr.Dims.back() + PadElements);
+  for (unsigned d = Types.size() - 1; d-- > 0;)
+    NewTy = ArrayType::get(NewTy, Arr.Dims[d]);
+
+  Module &M = *GV->getParent();
+  GlobalVariable *NewGV = new GlobalVariable(
+      M, NewTy, GV->isConstant(), GV->getLinkage(), UndefValue::get(NewTy),
+      "", GV, GV->getThreadLocalMode(), DXIL::kTGSMAddrSpace);
+  NewGV->takeName(GV);
+  NewGV->setAlignment(GV->getAlignment());
+  if (Finder)
+    HLModule::UpdateGlobalVariableDebugInfo(GV, *Finder, NewGV);
+
+  for (auto It = GV->user_begin(); It != GV->user_end();) {
+    GEPOperator *GEP = cast<GEPOperator>(*(It++));
+    SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+    if (GetElementPtrInst *GEPInst = dyn_cast<GetElementPtrInst>(GEP)) {
+      IRBuilder<> Builder(GEPInst);
+      Value *NewGEP = GEP->isInBounds()
+                          ? Builder.CreateInBoundsGEP(NewGV, Indices)
+                          : Builder.CreateGEP(NewGV, Indices);
+      NewGEP->takeName(GEPInst);
+      GEPInst->replaceAllUsesWith(NewGEP);
+      GEPInst->eraseFromParent();
+    } else {
+      SmallVector<Constant *, 4> ConstIndices;
+      for (Value *Index : Indices)
+        ConstIndices.push_back(cast<Constant>(Index));
+      Constant *NewGEP = ConstantExpr::getGetElementPtr(
+          NewTy, NewGV, ConstIndices, GEP->isInBounds());
+      GEP->replaceAllUsesWith(NewGEP);
+      cast<Constant>(GEP)->destroyConstant();
+    }
+  }
+  GV->eraseFromParent();
+  Arr.GV = NewGV;
+  Arr.Dims.back() += PadElements;
+}
+
+bool DxilGroupsharedBankConflicts::runOnModule(Module &M) {
+  if (!M.HasDxilModule() || (!m_bReport && !m_bPad))
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  const ShaderModel *SM = DM.GetShaderModel();
+  if (SM->IsCS() || SM->IsMS() || SM->IsAS()) {
+    for (unsigned i = 0; i < 3; ++i)
+      m_NumThreads[i] = std::max(1U, DM.GetNumThreads(i));
+  } else {
+    // Without a thread group shape, assume the lanes of a wave only differ
+    // in the X component.
+    m_NumThreads[0] = kNumBanks;
+    m_NumThreads[1] = m_NumThreads[2] = 1;
+  }
+  m_Divergence.clear();
+
+  const DataLayout &DL = M.getDataLayout();
+  uint64_t GroupSharedBytes = 0;
+  std::vector<GlobalVariable *> GVs;
+  for (GlobalVariable &GV : M.globals()) {
+    if (!dxilutil::IsSharedMemoryGlobal(&GV))
+      continue;
+    GroupSharedBytes += DL.getTypeAllocSize(GV.getType()->getElementType());
+    GVs.push_back(&GV);
+  }
+
+  bool HasDbgInfo = getDebugMetadataVersionFromModule(M) != 0;
+  std::unique_ptr<DebugInfoFinder> Finder;
+  if (HasDbgInfo && m_bPad) {
+    Finder = llvm::make_unique<DebugInfoFinder>();
+    Finder->processModule(M);
+  }
+
+  unsigned ConflictCount = 0, UnknownCount = 0, PaddedCount = 0;
+  bool bChanged = false;
+  for (GlobalVariable *GV : GVs) {
+    GroupsharedArray Arr;
+    if (!CollectArray(GV, Arr))
+      continue;
+
+    bool bAllAffine = Arr.bFullDepthOnly;
+    unsigned TotalDegree = 0;
+    std::set<std::string> Reported;
+    for (GroupsharedAccess &Access : Arr.Accesses) {
+      if (Access.Indices.empty()) {
+        ++UnknownCount;
+        bAllAffine = false;
+        continue;
+      }
+      int64_t LaneStride = 0;
+      unsigned Degree = GetConflictDegree(Arr, Access, 0, &LaneStride);
+      TotalDegree += Degree;
+      if (Degree <= 1)
+        continue;
+      ++ConflictCount;
+      if (!m_bReport)
+        continue;
+      std::string Message;
+      raw_string_ostream OS(Message);
+      OS << Degree << "-way bank conflict accessing groupshared '"
+         << GV->getName() << "'; lanes are " << LaneStride << " words apart.";
+      OS.flush();
+      const DebugLoc &Loc = Access.I->getDebugLoc();
+      std::string Warning =
+          Loc ? dxilutil::FormatMessageAtLocation(Loc, Message)
+              : dxilutil::FormatMessageWithoutLocation(Message).str();
+      // Scalarized vector accesses share a location; report them once.
+      if (Reported.insert(Warning).second)
+        M.getContext().emitWarning(Warning);
+    }
+
+    if (!m_bPad || !bAllAffine || Arr.Dims.size() < 2 ||
+        TotalDegree <= Arr.Accesses.size() ||
+        !isa<UndefValue>(GV->getInitializer()))
+      continue;
+
+    // Pick the smallest padding with the least total conflict that fits.
+    uint64_t RowElements = 1;
+    for (unsigned d = 0; d + 1 < Arr.Dims.size(); ++d)
+      RowElements *= Arr.Dims[d];
+    unsigned BestPad = 0;
+    unsigned BestDegree = TotalDegree;
+    for (unsigned Pad = 1; Pad <= kMaxPadElements; ++Pad) {
+      if (GroupSharedBytes + RowElements * Pad * Arr.EltBytes >
+          DXIL::kMaxTGSMSize)
+        break;
+      unsigned PaddedDegree = 0;
+      for (GroupsharedAccess &Access : Arr.Accesses)
+        PaddedDegree += GetConflictDegree(Arr, Access, Pad, nullptr);
+      if (PaddedDegree < BestDegree) {
+        BestPad = Pad;
+        BestDegree = PaddedDegree;
+      }
+    }
+    if (!BestPad)
+      continue;
+    GroupSharedBytes += RowElements * BestPad * Arr.EltBytes;
+    PadArray(Arr, BestPad, Finder.get());
+    ++PaddedCount;
+    bChanged = true;
+  }
+  m_Divergence.clear();
+
+  if (ConflictCount)
+    DM.AddCompileStat("DxilGroupsharedBankConflicts.Conflicts", ConflictCount);
+  if (UnknownCount)
+    DM.AddCompileStat("DxilGroupsharedBankConflicts.Unknown", UnknownCount);
+  if (PaddedCount)
+    DM.AddCompileStat("DxilGroupsharedBankConflicts.Padded", PaddedCount);
+  return bChanged;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilGroupsharedBankConflictsPass(bool Report,
+                                                         bool Pad) {
+  return new DxilGroupsharedBankConflicts(Report, Pad);
+}
+
+INITIALIZE_PASS(DxilGroupsharedBankConflicts,
+                "dxil-groupshared-bank-conflicts",
+                "DXIL groupshared bank conflicts", false, false)
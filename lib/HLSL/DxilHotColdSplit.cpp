@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilHotColdSplit.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Finds rarely executed regions, reports their size and moves them out of   //
+// the hot path.                                                             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilDivergenceAnalysis.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Hot/cold splitting.
+//
+// A region is the set of blocks dominated by one successor of a conditional
+// branch, entered only through that branch. It is cold when:
+//
+//  - the branch has branch_weights profile metadata that gives the edge into
+//    it a probability below cold-percent, or
+//  - the branch is a [branch] if-then on a wave-uniform condition, the usual
+//    form of a feature switch such as a debug view, and the region is the
+//    'then' side, or
+//  - the region ends in unreachable.
+//
+// With reporting enabled, the size of every cold region, in instructions, is
+// recorded in the compile statistics under the source line and column of the
+// region when debug information is available, along with the total size of
+// hot and cold code.
+//
+// With splitting enabled, cold regions are moved to the end of their
+// function, so the hot path is laid out contiguously. In library targets
+// without debug information, a cold region that only takes scalar inputs,
+// produces no values used outside of it and only uses operations valid in
+// every shader stage is outlined into an internal function. Linking the
+// library into a shader inlines it back; libraries consumed as state objects
+// keep it out of line.
+
+namespace {
+
+struct ColdRegion {
+  BasicBlock *Header = nullptr;
+  SmallVector<BasicBlock *, 8> Blocks;
+  unsigned Size = 0;
+};
+
+class DxilHotColdSplit : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilHotColdSplit(bool Split = false)
+      : ModulePass(ID), m_bSplit(Split), m_ColdPercent(10) {}
+
+  const char *getPassName() const override { return "DXIL hot/cold split"; }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "split", &m_bSplit, m_bSplit);
+    GetPassOptionUInt32(O, "cold-percent", &m_ColdPercent, m_ColdPercent);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool m_bSplit;
+  unsigned m_ColdPercent;
+
+  BasicBlock *GetColdSuccessor(BranchInst *BI,
+                               const DxilDivergenceAnalysis &DA) const;
+  void FindColdRegions(Function &F, DominatorTree &DT,
+                       std::vector<ColdRegion> &Regions);
+  static bool CanOutline(const ColdRegion &Region, DominatorTree &DT);
+};
+
+char DxilHotColdSplit::ID = 0;
+
+unsigned GetInstructionCount(BasicBlock &BB) {
+  unsigned Count = 0;
+  for (Instruction &I : BB) {
+    if (!isa<DbgInfoIntrinsic>(I))
+      ++Count;
+  }
+  return Count;
+}
+
+// Returns the successor of BI that heads a cold region, or null.
+BasicBlock *
+DxilHotColdSplit::GetColdSuccessor(BranchInst *BI,
+                                   const DxilDivergenceAnalysis &DA) const {
+  if (!BI->isConditional())
+    return nullptr;
+  BasicBlock *BB = BI->getParent();
+  BasicBlock *Succ[2] = {BI->getSuccessor(0), BI->getSuccessor(1)};
+  if (Succ[0] == Succ[1])
+    return nullptr;
+  bool bSinglePred[2] = {Succ[0]->getSinglePredecessor() == BB,
+                         Succ[1]->getSinglePredecessor() == BB};
+
+  if (MDNode *Prof = BI->getMetadata(LLVMContext::MD_prof)) {
+    MDString *Kind = dyn_cast<MDString>(Prof->getOperand(0));
+    if (Kind && Kind->getString() == "branch_weights" &&
+        Prof->getNumOperands() == 3) {
+      uint64_t Weights[2];
+      for (unsigned i = 0; i < 2; ++i) {
+        ConstantInt *W =
+            mdconst::dyn_extract<ConstantInt>(Prof->getOperand(i + 1));
+        if (!W)
+          return nullptr;
+        Weights[i] = W->getZExtValue();
+      }
+      uint64_t Total = Weights[0] + Weights[1];
+      for (unsigned i = 0; i < 2; ++i) {
+        if (bSinglePred[i] && Weights[i] * 100 < Total * m_ColdPercent)
+          return Succ[i];
+      }
+      return nullptr;
+    }
+  }
+
+  for (unsigned i = 0; i < 2; ++i) {
+    if (bSinglePred[i] && isa<UnreachableInst>(Succ[i]->getTerminator()))
+      return Succ[i];
+  }
+
+  if ((DxilMDHelper::GetControlFlowHintMask(BI) &
+       (1 << (unsigned)DXIL::ControlFlowHint::Branch)) &&
+      bSinglePred[0] != bSinglePred[1] && DA.IsUniform(BI->getCondition()))
+    return bSinglePred[0] ? Succ[0] : Succ[1];
+  return nullptr;
+}
+
+void DxilHotColdSplit::FindColdRegions(Function &F, DominatorTree &DT,
+                                       std::vector<ColdRegion> &Regions) {
+  LoopInfo LI;
+  LI.Analyze(DT);
+  DxilDivergenceAnalysis DA(F, LI, DxilDivergenceAnalysis::Scope::Wave);
+
+  std::vector<ColdRegion> Found;
+  for (BasicBlock &BB : F) {
+    BranchInst *BI = dyn_cast<BranchInst>(BB.getTerminator());
+    if (!BI)
+      continue;
+    BasicBlock *Header = GetColdSuccessor(BI, DA);
+    if (!Header)
+      continue;
+    ColdRegion Region;
+    Region.Header = Header;
+    DT.getDescendants(Header, Region.Blocks);
+    for (BasicBlock *Block : Region.Blocks)
+      Region.Size += GetInstructionCount(*Block);
+    Found.push_back(std::move(Region));
+  }
+
+  // Keep only the outermost of nested regions.
+  for (ColdRegion &Region : Found) {
+    bool bNested = false;
+    for (ColdRegion &Other : Found) {
+      if (&Other != &Region && Other.Header != Region.Header &&
+          DT.dominates(Other.Header, Region.Header))
+        bNested = true;
+    }
+    if (!bNested)
+      Regions.push_back(std::move(Region));
+  }
+}
+
+bool DxilHotColdSplit::CanOutline(const ColdRegion &Region,
+                                  DominatorTree &DT) {
+  const unsigned AllStages =
+      ((unsigned)1 << (unsigned)DXIL::ShaderKind::Invalid) - 1;
+  for (BasicBlock *BB : Region.Blocks) {
+    if (isa<ReturnInst>(BB->getTerminator()))
+      return false;
+    for (Instruction &I : *BB) {
+      if (!OP::IsDxilOpFuncCallInst(&I))
+        continue;
+      unsigned Major, Minor, Mask;
+      OP::GetMinShaderModelAndMask(cast<CallInst>(&I), /*bWithTranslation*/ true,
+                                   Major, Minor, Mask);
+      if ((Mask & AllStages) != AllStages)
+        return false;
+    }
+  }
+
+  CodeExtractor CE(Region.Blocks, &DT);
+  if (!CE.isEligible())
+    return false;
+  SetVector<Value *> Inputs, Outputs;
+  CE.findInputsOutputs(Inputs, Outputs);
+  if (!Outputs.empty())
+    return false;
+  for (Value *V : Inputs) {
+    Type *Ty = V->getType();
+    if (!Ty->isIntegerTy() && !Ty->isFloatingPointTy())
+      return false;
+  }
+  return true;
+}
+
+bool DxilHotColdSplit::runOnModule(Module &M) {
+  if (!M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  bool bCanOutline = DM.GetShaderModel()->IsLib() &&
+                     getDebugMetadataVersionFromModule(M) == 0;
+
+  uint64_t HotSize = 0, ColdSize = 0;
+  unsigned RegionCount = 0, OutlinedCount = 0;
+  bool bChanged = false;
+  std::vector<Function *> Functions;
+  for (Function &F : M) {
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+  }
+  for (Function *F : Functions) {
+    uint64_t FunctionSize = 0;
+    for (BasicBlock &BB : *F)
+      FunctionSize += GetInstructionCount(BB);
+
+    DominatorTree DT;
+    DT.recalculate(*F);
+    std::vector<ColdRegion> Regions;
+    FindColdRegions(*F, DT, Regions);
+
+    std::string FunctionName = dxilutil::DemangleFunctionName(F->getName());
+    for (ColdRegion &Region : Regions) {
+      ColdSize += Region.Size;
+      FunctionSize -= Region.Size;
+      ++RegionCount;
+      std::string Key;
+      raw_string_ostream OS(Key);
+      OS << "DxilHotColdSplit.Region.";
+      DebugLoc Loc;
+      for (Instruction &I : *Region.Header) {
+        if ((Loc = I.getDebugLoc()))
+          break;
+      }
+      if (Loc) {
+        OS << Loc->getFilename() << ":" << Loc.getLine() << ":"
+           << Loc.getCol();
+      } else {
+        OS << FunctionName << "." << RegionCount;
+      }
+      OS.flush();
+      DM.AddCompileStat(Key, Region.Size);
+    }
+    HotSize += FunctionSize;
+    if (!m_bSplit || Regions.empty())
+      continue;
+
+    for (ColdRegion &Region : Regions) {
+      if (bCanOutline && CanOutline(Region, DT)) {
+        CodeExtractor CE(Region.Blocks, &DT);
+        if (Function *Outlined = CE.extractCodeRegion()) {
+          Outlined->setName(F->getName() + ".cold");
+          Outlined->setLinkage(GlobalValue::LinkageTypes::InternalLinkage);
+          DM.GetTypeSystem().AddFunctionAnnotation(Outlined);
+          DT.recalculate(*F);
+          ++OutlinedCount;
+          bChanged = true;
+          continue;
+        }
+      }
+      // Move the region after the hot code, keeping its block order.
+      SmallPtrSet<BasicBlock *, 8> InRegion(Region.Blocks.begin(),
+                                            Region.Blocks.end());
+      std::vector<BasicBlock *> Ordered;
+      for (BasicBlock &BB : *F) {
+        if (InRegion.count(&BB))
+          Ordered.push_back(&BB);
+      }
+      for (BasicBlock *BB : Ordered) {
+        if (BB != &F->back()) {
+          BB->moveAfter(&F->back());
+          bChanged = true;
+        }
+      }
+    }
+  }
+
+  if (RegionCount) {
+    DM.AddCompileStat("DxilHotColdSplit.ColdRegions", RegionCount);
+    DM.AddCompileStat("DxilHotColdSplit.ColdInstructions", ColdSize);
+  }
+  DM.AddCompileStat("DxilHotColdSplit.HotInstructions", HotSize);
+  if (OutlinedCount)
+    DM.AddCompileStat("DxilHotColdSplit.Outlined", OutlinedCount);
+  return bChanged;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilHotColdSplitPass(bool Split) {
+  return new DxilHotColdSplit(Split);
+}
+
+INITIALIZE_PASS(DxilHotColdSplit, "dxil-hot-cold-split",
+                "DXIL hot/cold split", false, false)
@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilIfConversion.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Flattens small branches into selects using a GPU cost model.              //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilDivergenceAnalysis.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// If-conversion.
+//
+// SimplifyCFG only speculates a few cheap instructions, a threshold tuned for
+// CPUs. On a GPU the lanes of a wave that disagree on a branch condition run
+// both sides anyway, so a small divergent branch costs more as a branch than
+// flattened into selects. A uniform branch is never taken both ways by one
+// wave, so flattening it only pays when the skipped side is very cheap.
+//
+// The pass flattens if-then and if-then-else regions whose side blocks can
+// be executed unconditionally:
+//
+//   br i1 %c, label %then, label %else      %a = ...
+// then:                                     %b = ...
+//   %a = ...                          =>    %r = select i1 %c, %a, %b
+// else:
+//   %b = ...
+// join:
+//   %r = phi [ %a, %then ], [ %b, %else ]
+//
+// The cost of the flattened code, from per-instruction and per-dx.op class
+// estimates plus one select per phi, is compared with a threshold for
+// divergent and a lower one for uniform conditions. [branch] and [flatten]
+// hints override the cost model. Each decision is recorded in the compile
+// statistics.
+
+namespace {
+
+const unsigned kNotSpeculatable = UINT_MAX;
+
+// Returns the estimated cost of a dx.op call, in simple ALU instructions, or
+// kNotSpeculatable if it may not be executed unconditionally.
+unsigned GetDxilOpCost(CallInst *CI) {
+  DXIL::OpCode Opcode = OP::GetDxilOpFuncCallInst(CI);
+  // Wave and gradient operations depend on the set of active lanes.
+  if (OP::IsDxilOpWave(Opcode) || OP::IsDxilOpGradient(Opcode))
+    return kNotSpeculatable;
+  switch (Opcode) {
+  case DXIL::OpCode::CBufferLoad:
+  case DXIL::OpCode::CBufferLoadLegacy:
+    return 4;
+  default:
+    break;
+  }
+  if (OP::GetMemAccessAttr(Opcode) != Attribute::ReadNone)
+    return kNotSpeculatable;
+
+  switch (OP::GetOpCodeClass(Opcode)) {
+  case DXIL::OpCodeClass::Unary:
+    switch (Opcode) {
+    case DXIL::OpCode::Cos:
+    case DXIL::OpCode::Sin:
+    case DXIL::OpCode::Tan:
+    case DXIL::OpCode::Acos:
+    case DXIL::OpCode::Asin:
+    case DXIL::OpCode::Atan:
+    case DXIL::OpCode::Hcos:
+    case DXIL::OpCode::Hsin:
+    case DXIL::OpCode::Htan:
+      return 8;
+    case DXIL::OpCode::Exp:
+    case DXIL::OpCode::Log:
+    case DXIL::OpCode::Sqrt:
+    case DXIL::OpCode::Rsqrt:
+      return 4;
+    default:
+      return 1;
+    }
+  case DXIL::OpCodeClass::UnaryBits:
+  case DXIL::OpCodeClass::Binary:
+  case DXIL::OpCodeClass::Tertiary:
+  case DXIL::OpCodeClass::IsSpecialFloat:
+    return 1;
+  case DXIL::OpCodeClass::Dot2:
+    return 2;
+  case DXIL::OpCodeClass::Dot3:
+    return 3;
+  case DXIL::OpCodeClass::Dot4:
+    return 4;
+  default:
+    return 4;
+  }
+}
+
+// Returns the estimated cost of I, or kNotSpeculatable if it may not be
+// executed unconditionally.
+unsigned GetInstructionCost(Instruction *I) {
+  if (isa<DbgInfoIntrinsic>(I))
+    return 0;
+  if (CallInst *CI = dyn_cast<CallInst>(I))
+    return OP::IsDxilOpFuncCallInst(CI) ? GetDxilOpCost(CI) : kNotSpeculatable;
+  if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    // Groupshared memory may be written by other threads of the group.
+    if (LI->getPointerAddressSpace() == DXIL::kTGSMAddrSpace)
+      return kNotSpeculatable;
+  }
+  if (!isSafeToSpeculativelyExecute(I))
+    return kNotSpeculatable;
+
+  switch (I->getOpcode()) {
+  case Instruction::GetElementPtr:
+  case Instruction::BitCast:
+  case Instruction::ExtractValue:
+  case Instruction::InsertValue:
+    return 0;
+  case Instruction::Load:
+  case Instruction::FDiv:
+  case Instruction::FRem:
+    return 4;
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+    return 16;
+  default:
+    return 1;
+  }
+}
+
+enum class Decision {
+  NotCandidate,
+  FlattenedUniform,
+  FlattenedDivergent,
+  FlattenedByHint,
+  KeptUniform,
+  KeptDivergent,
+  KeptByHint,
+};
+
+class DxilIfConversion : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilIfConversion()
+      : FunctionPass(ID), m_UniformThreshold(4), m_DivergentThreshold(24) {}
+
+  const char *getPassName() const override { return "DXIL if-conversion"; }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUInt32(O, "uniform-threshold", &m_UniformThreshold,
+                        m_UniformThreshold);
+    GetPassOptionUInt32(O, "divergent-threshold", &m_DivergentThreshold,
+                        m_DivergentThreshold);
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  unsigned m_UniformThreshold;
+  unsigned m_DivergentThreshold;
+
+  Decision TryConvert(BranchInst *BI, const DxilDivergenceAnalysis &DA,
+                      SmallPtrSetImpl<BasicBlock *> &Erased,
+                      SmallPtrSetImpl<Value *> &NewValues);
+};
+
+char DxilIfConversion::ID = 0;
+
+// Returns the successor of S if S is a side block of a region branching
+// from BB: reached only from BB and ending in an unconditional branch.
+BasicBlock *GetSideBlockSuccessor(BasicBlock *S, BasicBlock *BB) {
+  if (S->getSinglePredecessor() != BB || isa<PHINode>(S->begin()))
+    return nullptr;
+  BranchInst *BI = dyn_cast<BranchInst>(S->getTerminator());
+  if (!BI || BI->isConditional())
+    return nullptr;
+  return BI->getSuccessor(0);
+}
+
+// Flattens the region branching at BI if the cost model allows it. Blocks
+// deleted by flattening are added to Erased, and the selects created, which
+// DA knows nothing about, to NewValues.
+Decision DxilIfConversion::TryConvert(BranchInst *BI,
+                                      const DxilDivergenceAnalysis &DA,
+                                      SmallPtrSetImpl<BasicBlock *> &Erased,
+                                      SmallPtrSetImpl<Value *> &NewValues) {
+  if (!BI->isConditional() || isa<Constant>(BI->getCondition()))
+    return Decision::NotCandidate;
+  BasicBlock *BB = BI->getParent();
+  BasicBlock *Succ[2] = {BI->getSuccessor(0), BI->getSuccessor(1)};
+  if (Succ[0] == Succ[1])
+    return Decision::NotCandidate;
+
+  // Side[k] is the block executed when the condition selects successor k,
+  // or null if that successor is the join block itself.
+  BasicBlock *Side[2] = {nullptr, nullptr};
+  BasicBlock *Join = nullptr;
+  BasicBlock *SideSucc[2] = {GetSideBlockSuccessor(Succ[0], BB),
+                             GetSideBlockSuccessor(Succ[1], BB)};
+  if (SideSucc[0] && SideSucc[0] == SideSucc[1]) {
+    Side[0] = Succ[0];
+    Side[1] = Succ[1];
+    Join = SideSucc[0];
+  } else if (SideSucc[0] == Succ[1]) {
+    Side[0] = Succ[0];
+    Join = Succ[1];
+  } else if (SideSucc[1] == Succ[0]) {
+    Side[1] = Succ[1];
+    Join = Succ[0];
+  } else {
+    return Decision::NotCandidate;
+  }
+  if (Join == BB)
+    return Decision::NotCandidate;
+
+  unsigned Cost = 0;
+  for (BasicBlock *S : Side) {
+    if (!S)
+      continue;
+    for (Instruction &I : *S) {
+      if (&I == S->getTerminator())
+        break;
+      unsigned InstCost = GetInstructionCost(&I);
+      if (InstCost == kNotSpeculatable)
+        return Decision::NotCandidate;
+      Cost += InstCost;
+    }
+  }
+  BasicBlock *Pred[2] = {Side[0] ? Side[0] : BB, Side[1] ? Side[1] : BB};
+  for (auto It = Join->begin(); PHINode *Phi = dyn_cast<PHINode>(It); ++It) {
+    if (Phi->getIncomingValueForBlock(Pred[0]) !=
+        Phi->getIncomingValueForBlock(Pred[1]))
+      ++Cost;
+  }
+
+  bool bUniform = DA.IsUniform(BI->getCondition());
+  Decision Result;
+  if (DxilMDHelper::HasControlFlowHintToPreventFlatten(BI)) {
+    return Decision::KeptByHint;
+  } else if (DxilMDHelper::GetControlFlowHintMask(BI) &
+             (1 << (unsigned)DXIL::ControlFlowHint::Flatten)) {
+    Result = Decision::FlattenedByHint;
+  } else if (bUniform) {
+    if (Cost > m_UniformThreshold)
+      return Decision::KeptUniform;
+    Result = Decision::FlattenedUniform;
+  } else {
+    if (Cost > m_DivergentThreshold)
+      return Decision::KeptDivergent;
+    Result = Decision::FlattenedDivergent;
+  }
+
+  // Hoist the side blocks and replace the phis with selects.
+  Value *Cond = BI->getCondition();
+  for (BasicBlock *S : Side) {
+    if (!S)
+      continue;
+    while (&S->front() != S->getTerminator())
+      S->front().moveBefore(BI);
+  }
+  IRBuilder<> Builder(BI);
+  for (auto It = Join->begin(); PHINode *Phi = dyn_cast<PHINode>(It); ++It) {
+    Value *TrueVal = Phi->getIncomingValueForBlock(Pred[0]);
+    Value *FalseVal = Phi->getIncomingValueForBlock(Pred[1]);
+    Value *V = TrueVal;
+    if (TrueVal != FalseVal) {
+      V = Builder.CreateSelect(Cond, TrueVal, FalseVal);
+      NewValues.insert(V);
+    }
+    for (BasicBlock *S : Side) {
+      if (S)
+        Phi->removeIncomingValue(S, /*DeletePHIIfEmpty*/ false);
+    }
+    int Idx = Phi->getBasicBlockIndex(BB);
+    if (Idx >= 0)
+      Phi->setIncomingValue(Idx, V);
+    else
+      Phi->addIncoming(V, BB);
+  }
+  BranchInst::Create(Join, BI);
+  BI->eraseFromParent();
+  for (BasicBlock *S : Side) {
+    if (S) {
+      Erased.insert(S);
+      S->eraseFromParent();
+    }
+  }
+  if (MergeBlockIntoPredecessor(Join))
+    Erased.insert(Join);
+  return Result;
+}
+
+bool DxilIfConversion::runOnFunction(Function &F) {
+  Module *M = F.getParent();
+  if (!M->HasDxilModule())
+    return false;
+  DxilModule &DM = M->GetDxilModule();
+
+  // Flattening a region makes the region around it a candidate. Blocks are
+  // visited in post-order, so inner regions are flattened before the regions
+  // around them within one sweep, and the analyses are only computed once per
+  // sweep. A branch on a select created during the sweep, and anything the
+  // sweep changed, are looked at again in the next one.
+  unsigned Counts[(unsigned)Decision::KeptByHint + 1] = {};
+  DenseMap<BranchInst *, Decision> Kept;
+  bool bChanged = false;
+  for (bool bRetry = true; bRetry;) {
+    bRetry = false;
+    DominatorTree DT;
+    DT.recalculate(F);
+    LoopInfo LI;
+    LI.Analyze(DT);
+    DxilDivergenceAnalysis DA(F, LI, DxilDivergenceAnalysis::Scope::Wave);
+    std::vector<BasicBlock *> Blocks(po_begin(&F.getEntryBlock()),
+                                     po_end(&F.getEntryBlock()));
+    SmallPtrSet<BasicBlock *, 16> Erased;
+    SmallPtrSet<Value *, 16> NewValues;
+    for (BasicBlock *BB : Blocks) {
+      if (Erased.count(BB))
+        continue;
+      BranchInst *BI = dyn_cast<BranchInst>(BB->getTerminator());
+      if (!BI)
+        continue;
+      if (BI->isConditional() && NewValues.count(BI->getCondition())) {
+        bRetry = true;
+        continue;
+      }
+      Decision D = TryConvert(BI, DA, Erased, NewValues);
+      switch (D) {
+      case Decision::NotCandidate:
+        break;
+      case Decision::KeptUniform:
+      case Decision::KeptDivergent:
+      case Decision::KeptByHint:
+        Kept[BI] = D;
+        break;
+      default:
+        Kept.erase(BI);
+        ++Counts[(unsigned)D];
+        bChanged = bRetry = true;
+        break;
+      }
+    }
+  }
+  for (auto &It : Kept)
+    ++Counts[(unsigned)It.second];
+
+  static const char *const kStatNames[] = {
+      nullptr,
+      "DxilIfConversion.FlattenedUniform",
+      "DxilIfConversion.FlattenedDivergent",
+      "DxilIfConversion.FlattenedByHint",
+      "DxilIfConversion.KeptUniform",
+      "DxilIfConversion.KeptDivergent",
+      "DxilIfConversion.KeptByHint",
+  };
+  static_assert(_countof(kStatNames) == _countof(Counts),
+                "kStatNames must name every decision");
+  for (unsigned i = 1; i < _countof(Counts); ++i) {
+    if (Counts[i])
+      DM.AddCompileStat(kStatNames[i], Counts[i]);
+  }
+  return bChanged;
+}
+
+} // namespace
+
+FunctionPass *llvm::createDxilIfConversionPass() {
+  return new DxilIfConversion();
+}
+
+INITIALIZE_PASS(DxilIfConversion, "dxil-if-conversion", "DXIL if-conversion",
+                false, false)
@@ -153,7 +153,8 @@ public:
   void DetachAll() override;
 
   std::unique_ptr<llvm::Module>
-  Link(StringRef entry, StringRef profile, dxilutil::ExportMap &exportMap) override;
+  Link(StringRef entry, StringRef profile, dxilutil::ExportMap &exportMap,
+       bool bOptimize = false) override;
 
 private:
   bool AttachLib(DxilLib *lib);
@@ -338,10 +339,10 @@ struct DxilLinkJob {
         m_valMinor(valMinor) {}
   std::unique_ptr<llvm::Module>
   Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
-       const ShaderModel *pSM);
+       const ShaderModel *pSM, bool bOptimize);
   std::unique_ptr<llvm::Module> LinkToLib(const ShaderModel *pSM);
   void StripDeadDebugInfo(llvm::Module &M);
-  void RunPreparePass(llvm::Module &M);
+  void RunPreparePass(llvm::Module &M, bool bOptimize = false);
   void AddFunction(std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair);
   void AddFunction(llvm::Function *F);
 
@@ -691,7 +692,7 @@ void DxilLinkJob::AddFunctions(DxilModule &DM, ValueToValueMapTy &vmap) {
 
 std::unique_ptr<Module>
 DxilLinkJob::Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
-                  const ShaderModel *pSM) {
+                  const ShaderModel *pSM, bool bOptimize) {
   Function *entryFunc = entryLinkPair.first->func;
   DxilModule &entryDM = entryLinkPair.second->GetDxilModule();
   if (!entryDM.HasDxilFunctionProps(entryFunc)) {
@@ -788,7 +789,7 @@ DxilLinkJob::Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
   // Link metadata like debug info.
   LinkNamedMDNodes(pM.get(), vmap);
 
-  RunPreparePass(*pM);
+  RunPreparePass(*pM, bOptimize);
 
   return pM;
 }
@@ -1014,9 +1015,25 @@ void DxilLinkJob::StripDeadDebugInfo(Module &M) {
   }
 }
 
-void DxilLinkJob::RunPreparePass(Module &M) {
+void DxilLinkJob::RunPreparePass(Module &M, bool bOptimize) {
   StripDeadDebugInfo(M);
   legacy::PassManager PM;
+
+  if (bOptimize) {
+    // Only the entry points of a linked shader are visible outside of it,
+    // so library helpers can be specialized to the arguments they get.
+    DxilModule &DM = M.GetDxilModule();
+    for (Function &F : M) {
+      if (!F.isDeclaration() && &F != DM.GetEntryFunction() &&
+          &F != DM.GetPatchConstantFunction())
+        F.setLinkage(GlobalValue::LinkageTypes::InternalLinkage);
+    }
+    // Propagate constants from call sites and drop the arguments this
+    // leaves unused before helpers are inlined.
+    PM.add(createIPSCCPPass());
+    PM.add(createDeadArgEliminationPass());
+  }
+
   PM.add(createAlwaysInlinerPass(/*InsertLifeTime*/ false));
 
   // Remove unused functions.
@@ -1038,6 +1055,16 @@ void DxilLinkJob::RunPreparePass(Module &M) {
   PM.add(createScalarizerPass());
   PM.add(createPromoteMemoryToRegisterPass());
 
+  if (bOptimize) {
+    // Clean up code that was generic across library boundaries, as the
+    // compiler would for a shader compiled from a single source.
+    PM.add(createInstructionCombiningPass());
+    PM.add(createSCCPPass());
+    PM.add(createGVNPass());
+    PM.add(createCFGSimplificationPass());
+    PM.add(createInstructionCombiningPass());
+  }
+
   PM.add(createSimplifyInstPass());
   PM.add(createCFGSimplificationPass());
 
@@ -1214,7 +1241,8 @@ bool DxilLinkerImpl::AddFunctions(SmallVector<StringRef, 4> &workList,
 }
 
 std::unique_ptr<llvm::Module>
-DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &exportMap) {
+DxilLinkerImpl::Link(StringRef entry, StringRef profile,
+                     dxilutil::ExportMap &exportMap, bool bOptimize) {
   const ShaderModel *pSM = ShaderModel::GetByName(profile.data());
   DXIL::ShaderKind kind = pSM->GetKind();
   if (kind == DXIL::ShaderKind::Invalid ||
@@ -1327,7 +1355,7 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
     std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair =
         m_functionNameMap[entry];
 
-    return linkJob.Link(entryLinkPair, pSM);
+    return linkJob.Link(entryLinkPair, pSM, bOptimize);
   } else {
     return linkJob.LinkToLib(pSM);
   }
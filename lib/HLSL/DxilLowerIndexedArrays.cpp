@@ -0,0 +1,497 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilLowerIndexedArrays.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Chooses how to lower dynamically indexed local arrays.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilDivergenceAnalysis.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Dynamically indexed local array lowering.
+//
+// A local array indexed with a value that is not a constant survives
+// scalarization as an alloca, which drivers turn into indexable temporary
+// registers. These are often slow and may spill to scratch memory. For each
+// such array of 16 or 32-bit scalars the pass estimates the cost of three
+// alternatives and keeps the cheapest:
+//
+//  - Select: the array is split into one value per element. A dynamic load
+//    becomes a chain of compares and selects over the elements, a dynamic
+//    store a compare and select for each element. Cost grows with the number
+//    of elements, so this suits small arrays.
+//  - Groupshared: in compute, mesh and amplification shaders, an array whose
+//    dynamic indices are uniform over the thread group is moved to
+//    groupshared memory with one column per thread, laid out as
+//    [index * threads + thread]. The lanes of a wave access consecutive words
+//    and so never conflict on a bank. Dynamic indices are clamped to the
+//    array, so even an out-of-bounds access stays in the thread's own column;
+//    no thread reads another's column so no barrier is needed. Staging is limited to half of the groupshared
+//    memory, including what the shader already declares, to bound the effect
+//    on occupancy.
+//  - Memory: the array stays an alloca. Arrays left in memory that have the
+//    same length and element type and are indexed by the same values are
+//    interleaved into one array, as the components of one indexable register,
+//    so the driver allocates and addresses a single temporary for up to four
+//    of them.
+//
+// Each decision is recorded in the compile statistics.
+
+namespace {
+
+enum class ArrayLowering { Select, GroupShared, Memory };
+
+// Estimated cost of one access to groupshared memory, in ALU instructions.
+const unsigned kGroupSharedAccessCost = 8;
+// Estimated cost of clamping a dynamic groupshared index to the array.
+const unsigned kGroupSharedClampCost = 2;
+// Estimated cost of a constant-index access to an indexable register.
+const unsigned kConstantIndexedTempAccessCost = 1;
+// Number of arrays that fit in the components of one indexable register.
+const unsigned kMaxPackedArrays = 4;
+
+struct IndexedArray {
+  AllocaInst *AI = nullptr;
+  unsigned NumElements = 0;
+  std::vector<GetElementPtrInst *> GEPs;
+  // Distinct non-constant indices used to access the array.
+  SmallVector<Value *, 4> DynamicIndices;
+  unsigned DynamicLoads = 0;
+  unsigned DynamicStores = 0;
+  unsigned ConstantAccesses = 0;
+  ArrayLowering Lowering = ArrayLowering::Memory;
+  bool bPacked = false;
+};
+
+class DxilLowerIndexedArrays : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilLowerIndexedArrays()
+      : ModulePass(ID), m_IndexedAccessCost(16) {}
+
+  const char *getPassName() const override {
+    return "DXIL lower indexed arrays";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUInt32(O, "indexed-access-cost", &m_IndexedAccessCost,
+                        m_IndexedAccessCost);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  unsigned m_IndexedAccessCost;
+  unsigned m_ThreadsPerGroup;
+  uint64_t m_GroupSharedBytes;
+  unsigned m_SelectCount;
+  unsigned m_GroupSharedCount;
+  unsigned m_PackedCount;
+  unsigned m_MemoryCount;
+
+  bool runOnFunction(Function &F, DxilModule &DM, bool bEntry);
+  static bool CollectArray(AllocaInst *AI, IndexedArray &Arr);
+  void ChooseLowering(IndexedArray &Arr, const DataLayout &DL,
+                      const DxilDivergenceAnalysis *Divergence);
+  static void PackArrays(std::vector<IndexedArray> &Arrays);
+  static void LowerToSelects(IndexedArray &Arr,
+                             std::vector<AllocaInst *> &ElementAllocas);
+  void LowerToGroupShared(IndexedArray &Arr, Value *ThreadIndex);
+  static void LowerPacked(ArrayRef<IndexedArray *> Group);
+};
+
+char DxilLowerIndexedArrays::ID = 0;
+
+// Fills in Arr for AI if it is an array of scalars only accessed by loads
+// and stores through getelementptr (0, index), with at least one index that
+// is not a constant.
+bool DxilLowerIndexedArrays::CollectArray(AllocaInst *AI, IndexedArray &Arr) {
+  ArrayType *AT = dyn_cast<ArrayType>(AI->getAllocatedType());
+  if (!AT || AI->isArrayAllocation())
+    return false;
+  Type *EltTy = AT->getElementType();
+  if (!EltTy->isHalfTy() && !EltTy->isFloatTy() && !EltTy->isIntegerTy(16) &&
+      !EltTy->isIntegerTy(32))
+    return false;
+
+  Arr.AI = AI;
+  Arr.NumElements = AT->getNumElements();
+  if (Arr.NumElements == 0)
+    return false;
+  for (User *U : AI->users()) {
+    GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(U);
+    if (!GEP || GEP->getNumIndices() != 2)
+      return false;
+    ConstantInt *Zero = dyn_cast<ConstantInt>(GEP->getOperand(1));
+    if (!Zero || !Zero->isZero())
+      return false;
+    Value *Index = GEP->getOperand(2);
+    ConstantInt *ConstIndex = dyn_cast<ConstantInt>(Index);
+    if (ConstIndex && ConstIndex->getZExtValue() >= Arr.NumElements)
+      return false;
+
+    for (User *GEPUser : GEP->users()) {
+      if (LoadInst *LI = dyn_cast<LoadInst>(GEPUser)) {
+        if (LI->isVolatile())
+          return false;
+        if (ConstIndex)
+          ++Arr.ConstantAccesses;
+        else
+          ++Arr.DynamicLoads;
+      } else if (StoreInst *SI = dyn_cast<StoreInst>(GEPUser)) {
+        if (SI->isVolatile() || SI->getPointerOperand() != GEP)
+          return false;
+        if (ConstIndex)
+          ++Arr.ConstantAccesses;
+        else
+          ++Arr.DynamicStores;
+      } else {
+        return false;
+      }
+    }
+    Arr.GEPs.emplace_back(GEP);
+    if (!ConstIndex &&
+        std::find(Arr.DynamicIndices.begin(), Arr.DynamicIndices.end(),
+                  Index) == Arr.DynamicIndices.end())
+      Arr.DynamicIndices.emplace_back(Index);
+  }
+  return !Arr.DynamicIndices.empty();
+}
+
+void DxilLowerIndexedArrays::ChooseLowering(
+    IndexedArray &Arr, const DataLayout &DL,
+    const DxilDivergenceAnalysis *Divergence) {
+  unsigned N = Arr.NumElements;
+  unsigned DynamicAccesses = Arr.DynamicLoads + Arr.DynamicStores;
+  uint64_t SelectCost = (uint64_t)Arr.DynamicLoads * 2 * (N - 1) +
+                        (uint64_t)Arr.DynamicStores * 2 * N;
+  uint64_t MemoryCost =
+      (uint64_t)DynamicAccesses * m_IndexedAccessCost +
+      (uint64_t)Arr.ConstantAccesses * kConstantIndexedTempAccessCost;
+  uint64_t GroupSharedCost = UINT64_MAX;
+  uint64_t GroupSharedBytes =
+      DL.getTypeAllocSize(Arr.AI->getAllocatedType()) * m_ThreadsPerGroup;
+  if (Divergence && m_GroupSharedBytes + GroupSharedBytes <=
+                        DXIL::kMaxTGSMSize / 2) {
+    bool bUniform = true;
+    for (Value *Index : Arr.DynamicIndices)
+      bUniform &= Divergence->IsUniform(Index);
+    if (bUniform)
+      GroupSharedCost = (uint64_t)(DynamicAccesses + Arr.ConstantAccesses) *
+                            kGroupSharedAccessCost +
+                        (uint64_t)DynamicAccesses * kGroupSharedClampCost;
+  }
+
+  if (SelectCost <= GroupSharedCost && SelectCost <= MemoryCost) {
+    Arr.Lowering = ArrayLowering::Select;
+  } else if (GroupSharedCost <= MemoryCost) {
+    Arr.Lowering = ArrayLowering::GroupShared;
+    m_GroupSharedBytes += GroupSharedBytes;
+  } else {
+    Arr.Lowering = ArrayLowering::Memory;
+  }
+}
+
+// Marks groups of arrays left in memory that can share one indexable
+// register: same length and element type, and the same dynamic indices.
+void DxilLowerIndexedArrays::PackArrays(std::vector<IndexedArray> &Arrays) {
+  for (unsigned i = 0; i < Arrays.size(); ++i) {
+    IndexedArray &First = Arrays[i];
+    if (First.Lowering != ArrayLowering::Memory || First.bPacked)
+      continue;
+    SmallVector<IndexedArray *, kMaxPackedArrays> Group;
+    Group.emplace_back(&First);
+    for (unsigned j = i + 1; j < Arrays.size() && Group.size() < kMaxPackedArrays;
+         ++j) {
+      IndexedArray &Other = Arrays[j];
+      if (Other.Lowering != ArrayLowering::Memory || Other.bPacked ||
+          Other.AI->getAllocatedType() != First.AI->getAllocatedType() ||
+          Other.DynamicIndices.size() != First.DynamicIndices.size())
+        continue;
+      bool bSameIndices = true;
+      for (Value *Index : Other.DynamicIndices)
+        bSameIndices &= std::find(First.DynamicIndices.begin(),
+                                  First.DynamicIndices.end(),
+                                  Index) != First.DynamicIndices.end();
+      if (bSameIndices)
+        Group.emplace_back(&Other);
+    }
+    if (Group.size() < 2)
+      continue;
+    for (IndexedArray *Arr : Group)
+      Arr->bPacked = true;
+    LowerPacked(Group);
+  }
+}
+
+void DxilLowerIndexedArrays::LowerToSelects(
+    IndexedArray &Arr, std::vector<AllocaInst *> &ElementAllocas) {
+  AllocaInst *AI = Arr.AI;
+  Type *EltTy = AI->getAllocatedType()->getArrayElementType();
+  IRBuilder<> AllocaBuilder(AI);
+  SmallVector<AllocaInst *, 16> Elts;
+  for (unsigned i = 0; i < Arr.NumElements; ++i) {
+    Elts.emplace_back(
+        AllocaBuilder.CreateAlloca(EltTy, nullptr, AI->getName() + "." + Twine(i)));
+    ElementAllocas.emplace_back(Elts.back());
+  }
+
+  for (GetElementPtrInst *GEP : Arr.GEPs) {
+    Value *Index = GEP->getOperand(2);
+    if (ConstantInt *ConstIndex = dyn_cast<ConstantInt>(Index)) {
+      GEP->replaceAllUsesWith(Elts[ConstIndex->getZExtValue()]);
+      GEP->eraseFromParent();
+      continue;
+    }
+    std::vector<User *> Users(GEP->user_begin(), GEP->user_end());
+    for (User *U : Users) {
+      Instruction *I = cast<Instruction>(U);
+      IRBuilder<> Builder(I);
+      if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+        Value *V = Builder.CreateLoad(Elts[0]);
+        for (unsigned i = 1; i < Arr.NumElements; ++i) {
+          Value *Cmp =
+              Builder.CreateICmpEQ(Index, ConstantInt::get(Index->getType(), i));
+          V = Builder.CreateSelect(Cmp, Builder.CreateLoad(Elts[i]), V);
+        }
+        LI->replaceAllUsesWith(V);
+      } else {
+        Value *Val = cast<StoreInst>(I)->getValueOperand();
+        for (unsigned i = 0; i < Arr.NumElements; ++i) {
+          Value *Cmp =
+              Builder.CreateICmpEQ(Index, ConstantInt::get(Index->getType(), i));
+          Value *Old = Builder.CreateLoad(Elts[i]);
+          Builder.CreateStore(Builder.CreateSelect(Cmp, Val, Old), Elts[i]);
+        }
+      }
+      I->eraseFromParent();
+    }
+    GEP->eraseFromParent();
+  }
+  AI->eraseFromParent();
+}
+
+void DxilLowerIndexedArrays::LowerToGroupShared(IndexedArray &Arr,
+                                                Value *ThreadIndex) {
+  AllocaInst *AI = Arr.AI;
+  Type *EltTy = AI->getAllocatedType()->getArrayElementType();
+  Module &M = *AI->getModule();
+  ArrayType *GSTy =
+      ArrayType::get(EltTy, (uint64_t)Arr.NumElements * m_ThreadsPerGroup);
+  GlobalVariable *GV = new GlobalVariable(
+      M, GSTy, /*isConstant*/ false, GlobalValue::ExternalLinkage,
+      UndefValue::get(GSTy), "dx.indexed.array", /*InsertBefore*/ nullptr,
+      GlobalVariable::NotThreadLocal, DXIL::kTGSMAddrSpace);
+  GV->setAlignment(AI->getAlignment());
+
+  for (GetElementPtrInst *GEP : Arr.GEPs) {
+    IRBuilder<> Builder(GEP);
+    Value *Index =
+        Builder.CreateZExtOrTrunc(GEP->getOperand(2), Builder.getInt32Ty());
+    if (!isa<ConstantInt>(Index)) {
+      unsigned Last = Arr.NumElements - 1;
+      if (isPowerOf2_32(Arr.NumElements)) {
+        Index = Builder.CreateAnd(Index, Last);
+      } else {
+        Index = Builder.CreateSelect(
+            Builder.CreateICmpULT(Index, Builder.getInt32(Last)), Index,
+            Builder.getInt32(Last));
+      }
+    }
+    Value *Offset = Builder.CreateAdd(
+        Builder.CreateMul(Index, Builder.getInt32(m_ThreadsPerGroup)),
+        ThreadIndex);
+    Value *Ptr =
+        Builder.CreateInBoundsGEP(GV, {Builder.getInt32(0), Offset});
+    std::vector<User *> Users(GEP->user_begin(), GEP->user_end());
+    for (User *U : Users) {
+      Builder.SetInsertPoint(cast<Instruction>(U));
+      if (LoadInst *LI = dyn_cast<LoadInst>(U)) {
+        LoadInst *NewLI = Builder.CreateLoad(Ptr);
+        NewLI->setAlignment(LI->getAlignment());
+        LI->replaceAllUsesWith(NewLI);
+        LI->eraseFromParent();
+      } else {
+        StoreInst *SI = cast<StoreInst>(U);
+        StoreInst *NewSI = Builder.CreateStore(SI->getValueOperand(), Ptr);
+        NewSI->setAlignment(SI->getAlignment());
+        SI->eraseFromParent();
+      }
+    }
+    GEP->eraseFromParent();
+  }
+  AI->eraseFromParent();
+}
+
+// Interleaves the arrays of Group into one array with element i of array c
+// at i * Group.size() + c.
+void DxilLowerIndexedArrays::LowerPacked(ArrayRef<IndexedArray *> Group) {
+  AllocaInst *First = Group[0]->AI;
+  Type *EltTy = First->getAllocatedType()->getArrayElementType();
+  unsigned Stride = Group.size();
+  ArrayType *PackedTy =
+      ArrayType::get(EltTy, (uint64_t)Group[0]->NumElements * Stride);
+  IRBuilder<> AllocaBuilder(First);
+  AllocaInst *Packed =
+      AllocaBuilder.CreateAlloca(PackedTy, nullptr, First->getName() + ".packed");
+  Packed->setAlignment(First->getAlignment());
+
+  for (unsigned c = 0; c < Stride; ++c) {
+    IndexedArray *Arr = Group[c];
+    for (GetElementPtrInst *GEP : Arr->GEPs) {
+      IRBuilder<> Builder(GEP);
+      Value *Index =
+          Builder.CreateZExtOrTrunc(GEP->getOperand(2), Builder.getInt32Ty());
+      Value *Offset = Builder.CreateMul(Index, Builder.getInt32(Stride));
+      if (c)
+        Offset = Builder.CreateAdd(Offset, Builder.getInt32(c));
+      Value *Ptr =
+          Builder.CreateInBoundsGEP(Packed, {Builder.getInt32(0), Offset});
+      GEP->replaceAllUsesWith(Ptr);
+      GEP->eraseFromParent();
+    }
+    Arr->AI->eraseFromParent();
+  }
+}
+
+bool DxilLowerIndexedArrays::runOnFunction(Function &F, DxilModule &DM,
+                                           bool bEntry) {
+  std::vector<IndexedArray> Arrays;
+  for (Instruction &I : F.getEntryBlock()) {
+    AllocaInst *AI = dyn_cast<AllocaInst>(&I);
+    if (!AI)
+      continue;
+    IndexedArray Arr;
+    if (CollectArray(AI, Arr))
+      Arrays.emplace_back(std::move(Arr));
+  }
+  if (Arrays.empty())
+    return false;
+
+  DominatorTree DT;
+  DT.recalculate(F);
+  LoopInfo LI;
+  LI.Analyze(DT);
+  std::unique_ptr<DxilDivergenceAnalysis> Divergence;
+  if (bEntry && m_ThreadsPerGroup)
+    Divergence = llvm::make_unique<DxilDivergenceAnalysis>(
+        F, LI, DxilDivergenceAnalysis::Scope::ThreadGroup);
+
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  for (IndexedArray &Arr : Arrays)
+    ChooseLowering(Arr, DL, Divergence.get());
+
+  bool bChanged = false;
+  std::vector<AllocaInst *> ElementAllocas;
+  Value *ThreadIndex = nullptr;
+  for (IndexedArray &Arr : Arrays) {
+    switch (Arr.Lowering) {
+    case ArrayLowering::Select:
+      LowerToSelects(Arr, ElementAllocas);
+      ++m_SelectCount;
+      break;
+    case ArrayLowering::GroupShared:
+      if (!ThreadIndex) {
+        OP *hlslOP = DM.GetOP();
+        IRBuilder<> Builder(dxilutil::FirstNonAllocaInsertionPt(&F));
+        ThreadIndex = Builder.CreateCall(
+            hlslOP->GetOpFunc(DXIL::OpCode::FlattenedThreadIdInGroup,
+                              Builder.getInt32Ty()),
+            {hlslOP->GetU32Const(
+                (unsigned)DXIL::OpCode::FlattenedThreadIdInGroup)});
+      }
+      LowerToGroupShared(Arr, ThreadIndex);
+      ++m_GroupSharedCount;
+      break;
+    case ArrayLowering::Memory:
+      continue;
+    }
+    bChanged = true;
+  }
+
+  // Packing erases allocas, so it runs after the other lowerings are done
+  // with the array list.
+  PackArrays(Arrays);
+  for (IndexedArray &Arr : Arrays) {
+    if (Arr.Lowering != ArrayLowering::Memory)
+      continue;
+    if (Arr.bPacked) {
+      ++m_PackedCount;
+      bChanged = true;
+    } else {
+      ++m_MemoryCount;
+    }
+  }
+
+  if (!ElementAllocas.empty())
+    PromoteMemToReg(ElementAllocas, DT);
+  return bChanged;
+}
+
+bool DxilLowerIndexedArrays::runOnModule(Module &M) {
+  if (!M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  const ShaderModel *SM = DM.GetShaderModel();
+  m_ThreadsPerGroup = 0;
+  m_GroupSharedBytes = 0;
+  if (SM->IsCS() || SM->IsMS() || SM->IsAS()) {
+    m_ThreadsPerGroup =
+        DM.GetNumThreads(0) * DM.GetNumThreads(1) * DM.GetNumThreads(2);
+    const DataLayout &DL = M.getDataLayout();
+    for (GlobalVariable &GV : M.globals()) {
+      if (GV.getType()->getPointerAddressSpace() == DXIL::kTGSMAddrSpace)
+        m_GroupSharedBytes +=
+            DL.getTypeAllocSize(GV.getType()->getElementType());
+    }
+  }
+  m_SelectCount = m_GroupSharedCount = m_PackedCount = m_MemoryCount = 0;
+
+  bool bChanged = false;
+  Function *Entry = SM->IsLib() ? nullptr : DM.GetEntryFunction();
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    bChanged |= runOnFunction(F, DM, &F == Entry);
+  }
+
+  if (m_SelectCount)
+    DM.AddCompileStat("DxilLowerIndexedArrays.Select", m_SelectCount);
+  if (m_GroupSharedCount)
+    DM.AddCompileStat("DxilLowerIndexedArrays.Groupshared", m_GroupSharedCount);
+  if (m_PackedCount)
+    DM.AddCompileStat("DxilLowerIndexedArrays.Packed", m_PackedCount);
+  if (m_MemoryCount)
+    DM.AddCompileStat("DxilLowerIndexedArrays.Memory", m_MemoryCount);
+  return bChanged;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilLowerIndexedArraysPass() {
+  return new DxilLowerIndexedArrays();
+}
+
+INITIALIZE_PASS(DxilLowerIndexedArrays, "dxil-lower-indexed-arrays",
+                "DXIL lower indexed arrays", false, false)
@@ -0,0 +1,364 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRemoveRedundantBarriers.cpp                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Removes and weakens barriers that order no memory accesses.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilUtil.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Redundant barrier elimination.
+//
+// A barrier orders the memory accesses that precede it against those that
+// follow it. Each fence it carries is only needed when accesses of that kind
+// can happen both before and after the barrier:
+//
+//  - Two barriers with no access between them are merged into one.
+//  - A fence is dropped when no access of its kind can reach the barrier or
+//    be reached from it, as for a barrier ending the shader.
+//  - A barrier left with no fence is removed when it has no sync, or when
+//    no shared memory is accessed on one side of it, so no thread can
+//    observe where the others are. Otherwise the sync is kept with the
+//    narrowest fence the barrier had, as sync alone is not valid DXIL.
+//
+// Barriers are only removed or weakened, never moved, so the convergence
+// requirements on their placement still hold. Libraries are skipped as the
+// accesses around an exported function are not known until link time.
+//
+// Each removed or merged barrier is recorded as a compile stat named after
+// its source location, or after its position in the function when there is
+// no debug info, so -fstats-json lists them for the shader.
+
+namespace {
+
+enum MemoryKind : unsigned {
+  MemNone = 0,
+  MemTGSM = 1 << 0,
+  MemUAV = 1 << 1,
+  MemAll = MemTGSM | MemUAV,
+};
+
+const unsigned kUAVFences =
+    (unsigned)DXIL::BarrierMode::UAVFenceGlobal |
+    (unsigned)DXIL::BarrierMode::UAVFenceThreadGroup;
+const unsigned kTGSMFences = (unsigned)DXIL::BarrierMode::TGSMFence;
+const unsigned kSync = (unsigned)DXIL::BarrierMode::SyncThreadGroup;
+
+unsigned GetPointerMemoryKind(Value *Ptr) {
+  switch (Ptr->getType()->getPointerAddressSpace()) {
+  case DXIL::kTGSMAddrSpace:
+    return MemTGSM;
+  case DXIL::kDeviceMemoryAddrSpace:
+    return MemUAV;
+  default:
+    return MemNone;
+  }
+}
+
+bool IsUAVHandle(Value *V) {
+  CallInst *CI = dyn_cast<CallInst>(V);
+  if (!CI)
+    return true;
+  DxilInst_CreateHandle createHandle(CI);
+  if (!createHandle)
+    return true;
+  ConstantInt *Class = dyn_cast<ConstantInt>(createHandle.get_resourceClass());
+  return !Class ||
+         Class->getZExtValue() == (unsigned)DXIL::ResourceClass::UAV;
+}
+
+// Returns the kinds of memory shared between threads that I may access.
+// Thread-local memory (allocas and static globals) is not considered.
+unsigned GetMemoryKind(Instruction *I, Type *HandleTy) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(I))
+    return GetPointerMemoryKind(LI->getPointerOperand());
+  if (StoreInst *SI = dyn_cast<StoreInst>(I))
+    return GetPointerMemoryKind(SI->getPointerOperand());
+  if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(I))
+    return GetPointerMemoryKind(RMW->getPointerOperand());
+  if (AtomicCmpXchgInst *CmpXchg = dyn_cast<AtomicCmpXchgInst>(I))
+    return GetPointerMemoryKind(CmpXchg->getPointerOperand());
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI)
+    return MemNone;
+  Function *F = CI->getCalledFunction();
+  if (!F || !OP::IsDxilOpFunc(F))
+    return (F && F->doesNotAccessMemory()) ? MemNone : MemAll;
+
+  DXIL::OpCode Opcode = OP::GetDxilOpFuncCallInst(CI);
+  if (Opcode == DXIL::OpCode::Barrier)
+    return MemNone;
+  switch (OP::GetMemAccessAttr(Opcode)) {
+  case Attribute::ReadNone:
+    return MemNone;
+  case Attribute::ReadOnly:
+    // Reads of SRVs and constant buffers cannot race with other threads.
+    for (Value *Arg : CI->arg_operands()) {
+      if (Arg->getType() == HandleTy && IsUAVHandle(Arg))
+        return MemUAV;
+    }
+    return MemNone;
+  default:
+    return MemUAV;
+  }
+}
+
+// A global UAV fence subsumes the thread group one, and validation rejects
+// both together.
+unsigned NormalizeBarrierMode(unsigned Mode) {
+  if (Mode & (unsigned)DXIL::BarrierMode::UAVFenceGlobal)
+    Mode &= ~(unsigned)DXIL::BarrierMode::UAVFenceThreadGroup;
+  return Mode;
+}
+
+class DxilRemoveRedundantBarriers : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRemoveRedundantBarriers() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL remove redundant barriers";
+  }
+
+  bool runOnModule(Module &M) override {
+    if (!M.HasDxilModule())
+      return false;
+    DxilModule &DM = M.GetDxilModule();
+    if (DM.GetShaderModel()->IsLib())
+      return false;
+    m_pDM = &DM;
+    m_HandleTy = DM.GetOP()->GetHandleType();
+    m_Removed = m_Merged = m_Weakened = 0;
+
+    bool bChanged = false;
+    for (Function &F : M) {
+      if (F.isDeclaration())
+        continue;
+      bChanged |= runOnFunction(F);
+    }
+
+    if (m_Removed)
+      DM.AddCompileStat("DxilRemoveRedundantBarriers.Removed", m_Removed);
+    if (m_Merged)
+      DM.AddCompileStat("DxilRemoveRedundantBarriers.Merged", m_Merged);
+    if (m_Weakened)
+      DM.AddCompileStat("DxilRemoveRedundantBarriers.Weakened", m_Weakened);
+    return bChanged;
+  }
+
+private:
+  DxilModule *m_pDM;
+  Type *m_HandleTy;
+  unsigned m_Removed;
+  unsigned m_Merged;
+  unsigned m_Weakened;
+  // Memory kinds accessed anywhere in each block.
+  DenseMap<BasicBlock *, unsigned> m_BlockKinds;
+  // One-based position of each barrier in its function, for the report.
+  DenseMap<CallInst *, unsigned> m_BarrierIndex;
+
+  bool runOnFunction(Function &F);
+  bool MergeAdjacentBarriers(BasicBlock &BB);
+  unsigned GetKindsBefore(CallInst *Barrier);
+  unsigned GetKindsAfter(CallInst *Barrier);
+  bool SetBarrierMode(CallInst *Barrier, unsigned Mode);
+  void ReportRemoved(CallInst *Barrier, StringRef Kind);
+};
+
+char DxilRemoveRedundantBarriers::ID = 0;
+
+bool DxilRemoveRedundantBarriers::runOnFunction(Function &F) {
+  bool bChanged = false;
+  m_BlockKinds.clear();
+  m_BarrierIndex.clear();
+  unsigned Index = 0;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::Barrier))
+        m_BarrierIndex[cast<CallInst>(&I)] = ++Index;
+    }
+  }
+  for (BasicBlock &BB : F) {
+    unsigned Kinds = MemNone;
+    for (Instruction &I : BB)
+      Kinds |= GetMemoryKind(&I, m_HandleTy);
+    m_BlockKinds[&BB] = Kinds;
+    bChanged |= MergeAdjacentBarriers(BB);
+  }
+
+  std::vector<CallInst *> Barriers;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::Barrier))
+        Barriers.push_back(cast<CallInst>(&I));
+    }
+  }
+
+  for (CallInst *Barrier : Barriers) {
+    DxilInst_Barrier BarrierInst(Barrier);
+    ConstantInt *ModeConst =
+        dyn_cast<ConstantInt>(BarrierInst.get_barrierMode());
+    if (!ModeConst)
+      continue;
+    unsigned OrigMode = ModeConst->getZExtValue();
+    unsigned Before = GetKindsBefore(Barrier);
+    unsigned After = GetKindsAfter(Barrier);
+    unsigned Ordered = Before & After;
+    unsigned Mode = OrigMode;
+    if (!(Ordered & MemTGSM))
+      Mode &= ~kTGSMFences;
+    if (!(Ordered & MemUAV))
+      Mode &= ~kUAVFences;
+    // The sync still holds threads back while any of them may access shared
+    // memory on both sides of the barrier.
+    if ((Mode & kSync) && !(Mode & (kUAVFences | kTGSMFences)) &&
+        Before != MemNone && After != MemNone) {
+      Mode |= (OrigMode & kTGSMFences)
+                  ? kTGSMFences
+                  : (unsigned)DXIL::BarrierMode::UAVFenceThreadGroup;
+    }
+    bChanged |= SetBarrierMode(Barrier, Mode);
+  }
+  return bChanged;
+}
+
+// Folds each barrier into the previous one when no memory is accessed
+// between them, as the combined barrier orders the same accesses.
+bool DxilRemoveRedundantBarriers::MergeAdjacentBarriers(BasicBlock &BB) {
+  bool bChanged = false;
+  CallInst *Prev = nullptr;
+  for (auto It = BB.begin(); It != BB.end();) {
+    Instruction *I = &*(It++);
+    if (!OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::Barrier)) {
+      if (GetMemoryKind(I, m_HandleTy) != MemNone)
+        Prev = nullptr;
+      continue;
+    }
+    CallInst *Barrier = cast<CallInst>(I);
+    ConstantInt *Mode =
+        dyn_cast<ConstantInt>(DxilInst_Barrier(Barrier).get_barrierMode());
+    if (!Mode) {
+      Prev = nullptr;
+      continue;
+    }
+    if (Prev) {
+      DxilInst_Barrier PrevInst(Prev);
+      PrevInst.set_barrierMode_val(NormalizeBarrierMode(
+          PrevInst.get_barrierMode_val() | Mode->getZExtValue()));
+      ReportRemoved(Barrier, "Merged");
+      Barrier->eraseFromParent();
+      ++m_Merged;
+      bChanged = true;
+      continue;
+    }
+    Prev = Barrier;
+  }
+  return bChanged;
+}
+
+unsigned DxilRemoveRedundantBarriers::GetKindsBefore(CallInst *Barrier) {
+  BasicBlock *BB = Barrier->getParent();
+  unsigned Kinds = MemNone;
+  for (Instruction &I : *BB) {
+    if (&I == Barrier)
+      break;
+    Kinds |= GetMemoryKind(&I, m_HandleTy);
+  }
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  SmallVector<BasicBlock *, 16> Worklist(pred_begin(BB), pred_end(BB));
+  while (!Worklist.empty() && Kinds != MemAll) {
+    BasicBlock *Pred = Worklist.pop_back_val();
+    if (!Visited.insert(Pred).second)
+      continue;
+    Kinds |= m_BlockKinds[Pred];
+    Worklist.append(pred_begin(Pred), pred_end(Pred));
+  }
+  return Kinds;
+}
+
+unsigned DxilRemoveRedundantBarriers::GetKindsAfter(CallInst *Barrier) {
+  BasicBlock *BB = Barrier->getParent();
+  unsigned Kinds = MemNone;
+  for (auto It = ++BasicBlock::iterator(Barrier); It != BB->end(); ++It)
+    Kinds |= GetMemoryKind(&*It, m_HandleTy);
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  SmallVector<BasicBlock *, 16> Worklist(succ_begin(BB), succ_end(BB));
+  while (!Worklist.empty() && Kinds != MemAll) {
+    BasicBlock *Succ = Worklist.pop_back_val();
+    if (!Visited.insert(Succ).second)
+      continue;
+    Kinds |= m_BlockKinds[Succ];
+    Worklist.append(succ_begin(Succ), succ_end(Succ));
+  }
+  return Kinds;
+}
+
+// Updates the barrier to Mode, removing it if no fence remains; the caller
+// only drops every fence of a sync when the sync is not needed either.
+// Returns true if the barrier changed.
+bool DxilRemoveRedundantBarriers::SetBarrierMode(CallInst *Barrier,
+                                                 unsigned Mode) {
+  Mode = NormalizeBarrierMode(Mode);
+  if (!(Mode & (kUAVFences | kTGSMFences))) {
+    ReportRemoved(Barrier, "Removed");
+    Barrier->eraseFromParent();
+    ++m_Removed;
+    return true;
+  }
+  DxilInst_Barrier BarrierInst(Barrier);
+  if ((unsigned)BarrierInst.get_barrierMode_val() == Mode)
+    return false;
+  BarrierInst.set_barrierMode_val(Mode);
+  ++m_Weakened;
+  return true;
+}
+
+// Records Barrier as removed for the stats of this shader. Repeated barriers
+// at one location add up.
+void DxilRemoveRedundantBarriers::ReportRemoved(CallInst *Barrier,
+                                                StringRef Kind) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  OS << "DxilRemoveRedundantBarriers." << Kind << ".";
+  const DebugLoc &Loc = Barrier->getDebugLoc();
+  if (Loc) {
+    OS << Loc->getFilename() << ":" << Loc.getLine() << ":" << Loc.getCol();
+  } else {
+    OS << dxilutil::DemangleFunctionName(
+              Barrier->getParent()->getParent()->getName())
+       << "." << m_BarrierIndex[Barrier];
+  }
+  OS.flush();
+  m_pDM->AddCompileStat(Key, 1);
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilRemoveRedundantBarriersPass() {
+  return new DxilRemoveRedundantBarriers();
+}
+
+INITIALIZE_PASS(DxilRemoveRedundantBarriers, "dxil-remove-redundant-barriers",
+                "DXIL remove redundant barriers", false, false)
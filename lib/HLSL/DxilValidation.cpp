@@ -52,6 +52,7 @@
 #include "dxc/HLSL/DxilSignatureAllocator.h"
 #include "dxc/HLSL/DxilPackSignatureElement.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
+#include "dxc/Support/DxcTrace.h"
 #include <algorithm>
 #include <deque>
 
@@ -5630,6 +5631,7 @@ void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor) {
 
 _Use_decl_annotations_ HRESULT
 ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
+  DxcTraceScope TraceScope("Validation.Module");
   std::string diagStr;
   raw_string_ostream diagStream(diagStr);
   DiagnosticPrinterRawOStream DiagPrinter(diagStream);
@@ -5856,6 +5858,7 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
                                    const DxilContainerHeader *pContainer,
                                    uint32_t ContainerSize) {
 
+  DxcTraceScope TraceScope("Validation.ContainerParts");
   DXASSERT_NOMSG(pModule);
   if (!pContainer || !IsValidDxilContainer(pContainer, ContainerSize)) {
     return DXC_E_CONTAINER_INVALID;
@@ -5940,6 +5943,9 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     // Skip these
     case DFCC_ResourceDef:
     case DFCC_ShaderStatistics:
+    case DFCC_CompileStatistics:
+    case DFCC_ShaderFingerprint:
+    case DFCC_ConstantArrayData:
     case DFCC_PrivateData:
     case DFCC_DXIL:
     case DFCC_ShaderDebugInfoDXIL:
@@ -6057,6 +6063,7 @@ HRESULT ValidateLoadModule(const char *pIL,
                            llvm::raw_ostream &DiagStream,
                            unsigned bLazyLoad) {
 
+  DxcTraceScope TraceScope("Validation.LoadModule");
   llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(Ctx, &DiagContext);
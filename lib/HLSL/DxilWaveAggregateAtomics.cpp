@@ -0,0 +1,396 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilWaveAggregateAtomics.cpp                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Combines UAV atomics on wave-uniform addresses into one atomic per wave.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Wave-aggregate atomics.
+//
+// When every active lane performs
+//   InterlockedAdd(counter[0], v)
+// the hardware serializes one atomic per lane on the same address. If the
+// address is the same for all lanes and the operation is associative, the
+// values can be combined with a wave reduction and applied by a single lane:
+//
+//   agg = WaveActiveSum(v)
+//   if (WaveIsFirstLane()) orig = atomicBinOp(counter, 0, agg)
+//   result = WaveReadLaneFirst(orig) + WavePrefixSum(v)
+//
+// The per-lane result is only reconstructed for add, as SM 6.0 has no prefix
+// forms of the bitwise and min/max reductions; those are rewritten only when
+// their result is unused.
+//
+// Wave intrinsics are only defined over the lanes that reach them, so the
+// rewrite is valid at any point in the control flow provided the address is
+// the same for every lane that performs the atomic.
+
+namespace {
+
+class WaveUniformity {
+public:
+  explicit WaveUniformity(LoopInfo &LI) : m_LI(LI), m_UseBB(nullptr) {}
+
+  // Sets the block whose active lanes later queries refer to.
+  void SetUseBlock(BasicBlock *BB) {
+    if (BB != m_UseBB) {
+      m_UseBB = BB;
+      m_Cache.clear();
+    }
+  }
+
+  // Returns true if V has the same value in every active lane executing the
+  // use block.
+  bool IsUniform(Value *V) {
+    auto it = m_Cache.find(V);
+    if (it != m_Cache.end())
+      return it->second;
+    // Guard against cycles through instructions that are not phis, which
+    // cannot occur in valid SSA but would otherwise recurse forever.
+    m_Cache[V] = false;
+    bool bUniform = Compute(V);
+    m_Cache[V] = bUniform;
+    return bUniform;
+  }
+
+private:
+  LoopInfo &m_LI;
+  BasicBlock *m_UseBB;
+  DenseMap<Value *, bool> m_Cache;
+
+  bool AllOperandsUniform(User *U) {
+    for (Value *Op : U->operands()) {
+      if (!IsUniform(Op))
+        return false;
+    }
+    return true;
+  }
+
+  // A wave intrinsic is only uniform over the lanes active at one dynamic
+  // instance. Lanes leaving a loop on different iterations would observe
+  // different instances, so the result is only trusted when every loop
+  // containing the wave op also contains the use.
+  bool IsSameLoopInstance(Instruction *I) {
+    Loop *L = m_LI.getLoopFor(I->getParent());
+    return L == nullptr || L->contains(m_UseBB);
+  }
+
+  bool ComputeDxilOp(CallInst *CI) {
+    switch (OP::GetDxilOpFuncCallInst(CI)) {
+    case DXIL::OpCode::CreateHandle: {
+      DxilInst_CreateHandle createHandle(CI);
+      return IsUniform(createHandle.get_rangeId()) &&
+             IsUniform(createHandle.get_index());
+    }
+    case DXIL::OpCode::CBufferLoad:
+    case DXIL::OpCode::CBufferLoadLegacy:
+      // Constant buffers cannot change during the dispatch.
+      return AllOperandsUniform(CI);
+    case DXIL::OpCode::GroupId:
+      // A wave never spans thread groups.
+      return AllOperandsUniform(CI);
+    case DXIL::OpCode::WaveReadLaneFirst:
+    case DXIL::OpCode::WaveActiveOp:
+    case DXIL::OpCode::WaveActiveBit:
+    case DXIL::OpCode::WaveActiveAllEqual:
+    case DXIL::OpCode::WaveAnyTrue:
+    case DXIL::OpCode::WaveAllTrue:
+    case DXIL::OpCode::WaveAllBitCount:
+    case DXIL::OpCode::WaveGetLaneCount:
+      return IsSameLoopInstance(CI);
+    default:
+      return false;
+    }
+  }
+
+  bool Compute(Value *V) {
+    if (isa<Constant>(V))
+      return true;
+    Instruction *I = dyn_cast<Instruction>(V);
+    if (!I)
+      return false;
+    if (isa<BinaryOperator>(I) || isa<CastInst>(I) || isa<CmpInst>(I) ||
+        isa<SelectInst>(I) || isa<ExtractValueInst>(I) ||
+        isa<ExtractElementInst>(I) || isa<InsertElementInst>(I) ||
+        isa<InsertValueInst>(I))
+      return AllOperandsUniform(I);
+    if (PHINode *Phi = dyn_cast<PHINode>(I)) {
+      // Lanes may arrive through different edges; only a phi that merges a
+      // single value is known to be uniform.
+      Value *Common = nullptr;
+      for (Value *Incoming : Phi->incoming_values()) {
+        if (Incoming == Phi || isa<UndefValue>(Incoming))
+          continue;
+        if (Common && Common != Incoming)
+          return false;
+        Common = Incoming;
+      }
+      return Common == nullptr || IsUniform(Common);
+    }
+    if (CallInst *CI = dyn_cast<CallInst>(I)) {
+      if (OP::IsDxilOpFuncCallInst(CI))
+        return ComputeDxilOp(CI);
+    }
+    return false;
+  }
+};
+
+class DxilWaveAggregateAtomics : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilWaveAggregateAtomics() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL wave-aggregate atomics";
+  }
+
+  bool runOnModule(Module &M) override {
+    if (!M.HasDxilModule())
+      return false;
+    DxilModule &DM = M.GetDxilModule();
+    const ShaderModel *SM = DM.GetShaderModel();
+    // Pixel shaders are left alone because of helper lanes, and libraries
+    // because they may be linked into any stage.
+    if (!SM->IsSM60Plus() || !(SM->IsCS() || SM->IsMS() || SM->IsAS()))
+      return false;
+
+    bool bChanged = false;
+    for (Function &F : M) {
+      if (F.isDeclaration())
+        continue;
+      bChanged |= runOnFunction(F, *DM.GetOP());
+    }
+    return bChanged;
+  }
+
+private:
+  struct Candidate {
+    CallInst *Atomic;
+    DXIL::AtomicBinOpCode Op;
+  };
+
+  bool runOnFunction(Function &F, OP &hlslOP);
+  static bool IsGuardedByFirstLane(CallInst *Atomic);
+  static void Aggregate(const Candidate &C, OP &hlslOP);
+};
+
+char DxilWaveAggregateAtomics::ID = 0;
+
+bool DxilWaveAggregateAtomics::runOnFunction(Function &F, OP &hlslOP) {
+  std::vector<Candidate> Candidates;
+  DominatorTree DT;
+  DT.recalculate(F);
+  LoopInfo LI;
+  LI.Analyze(DT);
+  WaveUniformity Uniformity(LI);
+
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      DxilInst_AtomicBinOp Atomic(&I);
+      if (!Atomic)
+        continue;
+      ConstantInt *OpConst = dyn_cast<ConstantInt>(Atomic.get_atomicOp());
+      if (!OpConst)
+        continue;
+      DXIL::AtomicBinOpCode Op = (DXIL::AtomicBinOpCode)OpConst->getZExtValue();
+      switch (Op) {
+      case DXIL::AtomicBinOpCode::Add:
+        break;
+      case DXIL::AtomicBinOpCode::And:
+      case DXIL::AtomicBinOpCode::Or:
+      case DXIL::AtomicBinOpCode::Xor:
+      case DXIL::AtomicBinOpCode::IMin:
+      case DXIL::AtomicBinOpCode::IMax:
+      case DXIL::AtomicBinOpCode::UMin:
+      case DXIL::AtomicBinOpCode::UMax:
+        if (!I.use_empty())
+          continue;
+        break;
+      default:
+        continue;
+      }
+      if (!Atomic.get_newValue()->getType()->isIntegerTy(32))
+        continue;
+      if (IsGuardedByFirstLane(cast<CallInst>(&I)))
+        continue;
+      Uniformity.SetUseBlock(&BB);
+      if (!Uniformity.IsUniform(Atomic.get_handle()) ||
+          !Uniformity.IsUniform(Atomic.get_offset0()) ||
+          !Uniformity.IsUniform(Atomic.get_offset1()) ||
+          !Uniformity.IsUniform(Atomic.get_offset2()))
+        continue;
+      Candidates.push_back({cast<CallInst>(&I), Op});
+    }
+  }
+
+  for (const Candidate &C : Candidates)
+    Aggregate(C, hlslOP);
+  return !Candidates.empty();
+}
+
+// Skips atomics the source already issues from a single lane.
+bool DxilWaveAggregateAtomics::IsGuardedByFirstLane(CallInst *Atomic) {
+  BasicBlock *Pred = Atomic->getParent()->getSinglePredecessor();
+  if (!Pred)
+    return false;
+  BranchInst *Br = dyn_cast<BranchInst>(Pred->getTerminator());
+  if (!Br || !Br->isConditional() ||
+      Br->getSuccessor(0) != Atomic->getParent())
+    return false;
+  Instruction *Cond = dyn_cast<Instruction>(Br->getCondition());
+  return Cond &&
+         OP::IsDxilOpFuncCallInst(Cond, DXIL::OpCode::WaveIsFirstLane);
+}
+
+void DxilWaveAggregateAtomics::Aggregate(const Candidate &C, OP &hlslOP) {
+  CallInst *Atomic = C.Atomic;
+  DxilInst_AtomicBinOp AtomicInst(Atomic);
+  Value *Val = AtomicInst.get_newValue();
+  Type *Ty = Val->getType();
+  LLVMContext &Ctx = Atomic->getContext();
+  Type *VoidTy = Type::getVoidTy(Ctx);
+  IRBuilder<> Builder(Atomic);
+
+  // A constant addend only depends on the number of active lanes, which a
+  // ballot count provides more cheaply than a reduction.
+  ConstantInt *ConstVal = dyn_cast<ConstantInt>(Val);
+  bool bCountLanes = C.Op == DXIL::AtomicBinOpCode::Add && ConstVal;
+
+  Value *Agg = nullptr;
+  if (bCountLanes) {
+    Function *CountFn = hlslOP.GetOpFunc(DXIL::OpCode::WaveAllBitCount, VoidTy);
+    Value *Count = Builder.CreateCall(
+        CountFn, {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WaveAllBitCount),
+                  hlslOP.GetI1Const(true)});
+    Agg = ConstVal->isOne() ? Count : Builder.CreateMul(Count, ConstVal);
+  } else {
+    bool bBitOp = false;
+    unsigned Kind = 0;
+    DXIL::SignedOpKind Sign = DXIL::SignedOpKind::Unsigned;
+    switch (C.Op) {
+    case DXIL::AtomicBinOpCode::Add:
+      Kind = (unsigned)DXIL::WaveOpKind::Sum;
+      break;
+    case DXIL::AtomicBinOpCode::IMin:
+      Sign = DXIL::SignedOpKind::Signed;
+      // fallthrough
+    case DXIL::AtomicBinOpCode::UMin:
+      Kind = (unsigned)DXIL::WaveOpKind::Min;
+      break;
+    case DXIL::AtomicBinOpCode::IMax:
+      Sign = DXIL::SignedOpKind::Signed;
+      // fallthrough
+    case DXIL::AtomicBinOpCode::UMax:
+      Kind = (unsigned)DXIL::WaveOpKind::Max;
+      break;
+    case DXIL::AtomicBinOpCode::And:
+      bBitOp = true;
+      Kind = (unsigned)DXIL::WaveBitOpKind::And;
+      break;
+    case DXIL::AtomicBinOpCode::Or:
+      bBitOp = true;
+      Kind = (unsigned)DXIL::WaveBitOpKind::Or;
+      break;
+    default:
+      DXASSERT(C.Op == DXIL::AtomicBinOpCode::Xor, "otherwise, unexpected op");
+      bBitOp = true;
+      Kind = (unsigned)DXIL::WaveBitOpKind::Xor;
+      break;
+    }
+    if (bBitOp) {
+      Function *BitFn = hlslOP.GetOpFunc(DXIL::OpCode::WaveActiveBit, Ty);
+      Agg = Builder.CreateCall(
+          BitFn, {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WaveActiveBit),
+                  Val, hlslOP.GetI8Const(Kind)});
+    } else {
+      Function *OpFn = hlslOP.GetOpFunc(DXIL::OpCode::WaveActiveOp, Ty);
+      Agg = Builder.CreateCall(
+          OpFn, {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WaveActiveOp), Val,
+                 hlslOP.GetI8Const(Kind), hlslOP.GetI8Const((unsigned)Sign)});
+    }
+  }
+
+  Function *FirstLaneFn =
+      hlslOP.GetOpFunc(DXIL::OpCode::WaveIsFirstLane, VoidTy);
+  Value *IsFirst = Builder.CreateCall(
+      FirstLaneFn, {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WaveIsFirstLane)});
+
+  BasicBlock *HeadBB = Atomic->getParent();
+  TerminatorInst *ThenTerm =
+      SplitBlockAndInsertIfThen(IsFirst, Atomic, /*Unreachable*/ false);
+  BasicBlock *ThenBB = ThenTerm->getParent();
+  BasicBlock *TailBB = ThenTerm->getSuccessor(0);
+  Atomic->moveBefore(ThenTerm);
+  AtomicInst.set_newValue(Agg);
+
+  if (Atomic->use_empty())
+    return;
+
+  // Every lane observes the value the first lane received, advanced by the
+  // contributions of the lanes before it.
+  Builder.SetInsertPoint(TailBB->getFirstInsertionPt());
+  PHINode *Orig = Builder.CreatePHI(Ty, 2, "atomic.orig");
+  Orig->addIncoming(Atomic, ThenBB);
+  Orig->addIncoming(UndefValue::get(Ty), HeadBB);
+  Function *ReadFirstFn =
+      hlslOP.GetOpFunc(DXIL::OpCode::WaveReadLaneFirst, Ty);
+  Value *Base = Builder.CreateCall(
+      ReadFirstFn,
+      {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WaveReadLaneFirst), Orig});
+
+  Value *Prefix = nullptr;
+  if (bCountLanes) {
+    Function *PrefixCountFn =
+        hlslOP.GetOpFunc(DXIL::OpCode::WavePrefixBitCount, VoidTy);
+    Value *Count = Builder.CreateCall(
+        PrefixCountFn,
+        {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WavePrefixBitCount),
+         hlslOP.GetI1Const(true)});
+    Prefix = ConstVal->isOne() ? Count : Builder.CreateMul(Count, ConstVal);
+  } else {
+    Function *PrefixFn = hlslOP.GetOpFunc(DXIL::OpCode::WavePrefixOp, Ty);
+    Prefix = Builder.CreateCall(
+        PrefixFn, {hlslOP.GetU32Const((unsigned)DXIL::OpCode::WavePrefixOp),
+                   Val, hlslOP.GetI8Const((unsigned)DXIL::WaveOpKind::Sum),
+                   hlslOP.GetI8Const((unsigned)DXIL::SignedOpKind::Unsigned)});
+  }
+  Value *Result = Builder.CreateAdd(Base, Prefix);
+
+  Atomic->replaceAllUsesWith(Result);
+  // The phi was built before the replacement; point it back at the atomic.
+  Orig->setIncomingValue(0, Atomic);
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilWaveAggregateAtomicsPass() {
+  return new DxilWaveAggregateAtomics();
+}
+
+INITIALIZE_PASS(DxilWaveAggregateAtomics, "dxil-wave-aggregate-atomics",
+                "DXIL wave-aggregate atomics", false, false)
@@ -1294,6 +1294,13 @@ void HLModule::ResetSubobjects(DxilSubobjects *subobjects) {
   m_pSubobjects.reset(subobjects);
 }
 
+void HLModule::AddCompileStat(llvm::StringRef Name, uint64_t Value) {
+  AddDxilCompileStat(m_CompileStats, Name, Value);
+}
+const DxilCompileStatMap &HLModule::GetCompileStats() const {
+  return m_CompileStats;
+}
+
 //------------------------------------------------------------------------------
 //
 // Signature methods.
@@ -1544,6 +1544,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassTraceRegion PassTrace(FP); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1620,6 +1621,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassTraceRegion PassTrace(MP); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1795,6 +1797,25 @@ Timer *llvm::getPassTimer(Pass *P) {
   return nullptr;
 }
 
+// HLSL Change Starts - pass tracing
+static PassTraceCallback ThePassTraceCallback = nullptr;
+
+void llvm::setPassTraceCallback(PassTraceCallback Callback) {
+  ThePassTraceCallback = Callback;
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P)
+    : Name(ThePassTraceCallback ? P->getPassName() : nullptr) {
+  if (Name)
+    ThePassTraceCallback(Name, true);
+}
+
+PassTraceRegion::~PassTraceRegion() {
+  if (Name && ThePassTraceCallback)
+    ThePassTraceCallback(Name, false);
+}
+// HLSL Change Ends
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -349,7 +349,8 @@ HANDLE MSFileSystemForDisk::CreateFileMappingW(HANDLE hFile, DWORD flProtect, DW
   #ifdef _WIN32
   return ::CreateFileMappingW(hFile, nullptr, flProtect, dwMaximumSizeHigh, dwMaximumSizeLow, nullptr);
   #else
-  assert(false && "Not implemented for Unix");
+  // Files on disk are mapped with mmap directly.
+  SetLastError(ERROR_NOT_CAPABLE);
   return nullptr;
   #endif
 }
@@ -447,8 +448,7 @@ intptr_t MSFileSystemForDisk::get_osfhandle(int fd) throw()
   #ifdef _WIN32
   return ::_get_osfhandle(fd);
   #else
-  assert(false && "Not implemented for Unix");
-  return 0;
+  return fd;
   #endif
 }
 
@@ -619,10 +619,29 @@ void PassManagerBuilder::populateModulePassManager(
                                               // annotations before CreateHandleForLib
                                               // so no unused resources get re-added to
                                               // DxilModule.
+    if (HLSLGroupsharedBankReport || HLSLPadGroupshared)
+      MPM.add(createDxilGroupsharedBankConflictsPass(HLSLGroupsharedBankReport,
+                                                     HLSLPadGroupshared));
     MPM.add(createMultiDimArrayToOneDimArrayPass());
     MPM.add(createDxilLowerCreateHandleForLibPass());
     MPM.add(createDxilTranslateRawBuffer());
     MPM.add(createDeadCodeEliminationPass());
+    if (HLSLLowerIndexedArrays)
+      MPM.add(createDxilLowerIndexedArraysPass());
+    if (HLSLConstArrayBufferSpace != UINT_MAX)
+      MPM.add(createDxilConstArrayToBufferPass(HLSLConstArrayBufferSpace));
+    if (HLSLWaveAggregateAtomics)
+      MPM.add(createDxilWaveAggregateAtomicsPass());
+    if (HLSLRemoveRedundantBarriers)
+      MPM.add(createDxilRemoveRedundantBarriersPass());
+    if (HLSLIfConversion)
+      MPM.add(createDxilIfConversionPass());
+    if (HLSLFastTranscendentals)
+      MPM.add(createDxilExpandTrigIntrinsicsPass(/*FastTranscendentals*/ true));
+    if (HLSLFormDotMad)
+      MPM.add(createDxilFormDotMadPass());
+    if (HLSLHotColdSplit || HLSLHotColdReport)
+      MPM.add(createDxilHotColdSplitPass(HLSLHotColdSplit));
     // Always try to legalize sample offsets as loop unrolling
     // is not guaranteed for higher opt levels.
     MPM.add(createDxilLegalizeSampleOffsetPass());
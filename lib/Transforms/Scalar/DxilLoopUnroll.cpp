@@ -1077,6 +1077,12 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
       FailLoopUnroll(false, F->getContext(), LoopLoc, "Could not unroll loop due to out of bound array access.");
     }
 
+    if (F->getParent()->HasHLModule()) {
+      HLModule &HM = F->getParent()->GetHLModule();
+      HM.AddCompileStat("DxilLoopUnroll.UnrolledLoops", 1);
+      HM.AddCompileStat("DxilLoopUnroll.UnrolledIterations", Iterations.size());
+    }
+
     return true;
   }
 
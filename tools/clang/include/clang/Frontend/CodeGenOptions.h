@@ -205,6 +205,9 @@ public:
   hlsl::DXIL::Float32DenormMode HLSLFloat32DenormMode;
   /// HLSLDefaultSpace also enables automatic binding for libraries if set. UINT_MAX == unset
   unsigned HLSLDefaultSpace = UINT_MAX;
+  /// Register space of the buffer large constant arrays are moved into.
+  /// UINT_MAX == unset
+  unsigned HLSLConstArrayBufferSpace = UINT_MAX;
   /// HLSLLibraryExports specifies desired exports, with optional renaming
   std::vector<std::string> HLSLLibraryExports;
   /// ExportShadersOnly limits library export functions to shaders
@@ -214,6 +217,26 @@ public:
   hlsl::DXIL::DefaultLinkage DefaultLinkage = hlsl::DXIL::DefaultLinkage::Default;
   /// Assume UAVs/SRVs may alias.
   bool HLSLResMayAlias = false;
+  /// Form dot and mad operations from scalar multiply and add chains.
+  bool HLSLFormDotMad = false;
+  /// Lower non-precise transcendental operations to faster approximations.
+  bool HLSLFastTranscendentals = false;
+  /// Lower dynamically indexed local arrays by estimated cost.
+  bool HLSLLowerIndexedArrays = false;
+  /// Flatten small branches by estimated cost.
+  bool HLSLIfConversion = false;
+  /// Combine atomics on wave-uniform addresses using wave operations.
+  bool HLSLWaveAggregateAtomics = false;
+  /// Remove barriers that order no memory accesses.
+  bool HLSLRemoveRedundantBarriers = false;
+  /// Warn about groupshared accesses with bank conflicts.
+  bool HLSLGroupsharedBankReport = false;
+  /// Pad groupshared arrays to avoid bank conflicts.
+  bool HLSLPadGroupshared = false;
+  /// Move cold regions out of the hot path.
+  bool HLSLHotColdSplit = false;
+  /// Record the size of cold regions in the compile statistics.
+  bool HLSLHotColdReport = false;
   // HLSL Change Ends
 
   // SPIRV Change Starts
@@ -15,6 +15,7 @@
 #define LLVM_CLANG_PARSE_PARSEAST_H
 
 #include "clang/Basic/LangOptions.h"
+#include <atomic> // HLSL Change
 
 namespace clang {
   class Preprocessor;
@@ -43,6 +44,22 @@ namespace clang {
   /// abstract syntax tree.
   void ParseAST(Sema &S, bool PrintStats = false,
                 bool SkipFunctionBodies = false);
+
+  // HLSL Change Starts
+  /// \brief While in scope, makes ParseAST on the current thread stop at the
+  /// next top-level declaration once *Cancelled is set, so that work that is
+  /// no longer wanted can be abandoned. Preambles are always parsed in full,
+  /// since they are reused.
+  class ParseCancellationScope {
+    const std::atomic<bool> *Previous;
+  public:
+    explicit ParseCancellationScope(const std::atomic<bool> *Cancelled);
+    ~ParseCancellationScope();
+
+    /// \brief Gets the flag in effect on the current thread, if any.
+    static const std::atomic<bool> *getCurrent();
+  };
+  // HLSL Change Ends
   
 }  // end namespace clang
 
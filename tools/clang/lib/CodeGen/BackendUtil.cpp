@@ -43,6 +43,7 @@
 #include <memory>
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h"  // HLSL Change
+#include "dxc/Support/DxcTrace.h"        // HLSL Change
 
 using namespace clang;
 using namespace llvm;
@@ -325,6 +326,17 @@ void EmitAssemblyHelper::CreatePasses() {
   PMBuilder.HLSLHighLevel = CodeGenOpts.HLSLHighLevel; // HLSL Change
   PMBuilder.HLSLExtensionsCodeGen = CodeGenOpts.HLSLExtensionsCodegen.get(); // HLSL Change
   PMBuilder.HLSLResMayAlias = CodeGenOpts.HLSLResMayAlias; // HLSL Change
+  PMBuilder.HLSLFormDotMad = CodeGenOpts.HLSLFormDotMad; // HLSL Change
+  PMBuilder.HLSLFastTranscendentals = CodeGenOpts.HLSLFastTranscendentals; // HLSL Change
+  PMBuilder.HLSLLowerIndexedArrays = CodeGenOpts.HLSLLowerIndexedArrays; // HLSL Change
+  PMBuilder.HLSLIfConversion = CodeGenOpts.HLSLIfConversion; // HLSL Change
+  PMBuilder.HLSLWaveAggregateAtomics = CodeGenOpts.HLSLWaveAggregateAtomics; // HLSL Change
+  PMBuilder.HLSLRemoveRedundantBarriers = CodeGenOpts.HLSLRemoveRedundantBarriers; // HLSL Change
+  PMBuilder.HLSLGroupsharedBankReport = CodeGenOpts.HLSLGroupsharedBankReport; // HLSL Change
+  PMBuilder.HLSLPadGroupshared = CodeGenOpts.HLSLPadGroupshared; // HLSL Change
+  PMBuilder.HLSLHotColdSplit = CodeGenOpts.HLSLHotColdSplit; // HLSL Change
+  PMBuilder.HLSLHotColdReport = CodeGenOpts.HLSLHotColdReport; // HLSL Change
+  PMBuilder.HLSLConstArrayBufferSpace = CodeGenOpts.HLSLConstArrayBufferSpace; // HLSL Change
 
   PMBuilder.DisableUnitAtATime = !CodeGenOpts.UnitAtATime;
   PMBuilder.DisableUnrollLoops = !CodeGenOpts.UnrollLoops;
@@ -709,6 +721,7 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   if (PerFunctionPasses) {
     PrettyStackTraceString CrashInfo("Per-function optimization");
+    DxcTraceScope TraceScope("Backend.PerFunctionPasses"); // HLSL Change
 
     PerFunctionPasses->doInitialization();
     for (Function &F : *TheModule)
@@ -719,11 +732,13 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   if (PerModulePasses) {
     PrettyStackTraceString CrashInfo("Per-module optimization passes");
+    DxcTraceScope TraceScope("Backend.PerModulePasses"); // HLSL Change
     PerModulePasses->run(*TheModule);
   }
 
   if (CodeGenPasses) {
     PrettyStackTraceString CrashInfo("Code generation");
+    DxcTraceScope TraceScope("Backend.CodeGenPasses"); // HLSL Change
     CodeGenPasses->run(*TheModule);
   }
 }
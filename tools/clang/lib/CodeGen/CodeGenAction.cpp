@@ -35,6 +35,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/Timer.h"
 #include <memory>
+#include "dxc/Support/DxcTrace.h" // HLSL Change
 using namespace clang;
 using namespace llvm;
 
@@ -140,6 +141,7 @@ namespace clang {
     void HandleTranslationUnit(ASTContext &C) override {
       {
         PrettyStackTraceString CrashInfo("Per-file LLVM IR generation");
+        DxcTraceScope TraceScope("Frontend.IRGeneration"); // HLSL Change
         if (llvm::TimePassesIsEnabled)
           LLVMIRGeneration.startTimer();
 
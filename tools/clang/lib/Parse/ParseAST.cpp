@@ -23,6 +23,8 @@
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "clang/Sema/SemaHLSL.h" // HLSL Change
+#include "dxc/Support/DxcTrace.h" // HLSL Change
+#include "llvm/Support/Compiler.h" // HLSL Change
 #include "llvm/Support/CrashRecoveryContext.h"
 #include <cstdio>
 #include <memory>
@@ -78,6 +80,25 @@ void PrettyStackTraceParserEntry::print(raw_ostream &OS) const {
 // Public interface to the file
 //===----------------------------------------------------------------------===//
 
+// HLSL Change Starts
+static LLVM_THREAD_LOCAL const std::atomic<bool> *CurrentCancellation =
+    nullptr;
+
+ParseCancellationScope::ParseCancellationScope(
+    const std::atomic<bool> *Cancelled)
+    : Previous(CurrentCancellation) {
+  CurrentCancellation = Cancelled;
+}
+
+ParseCancellationScope::~ParseCancellationScope() {
+  CurrentCancellation = Previous;
+}
+
+const std::atomic<bool> *ParseCancellationScope::getCurrent() {
+  return CurrentCancellation;
+}
+// HLSL Change Ends
+
 /// ParseAST - Parse the entire file specified, notifying the ASTConsumer as
 /// the file is parsed.  This inserts the parsed decls into the translation unit
 /// held by Ctx.
@@ -132,6 +153,8 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   if (External)
     External->StartTranslationUnit(Consumer);
 
+  llvm::Optional<DxcTraceScope> ParseTrace; // HLSL Change
+  ParseTrace.emplace("Frontend.Parse");      // HLSL Change
   if (!S.getDiagnostics().hasUnrecoverableErrorOccurred()) {  // HLSL Change: Skip if fatal error already occurred
     if (P.ParseTopLevelDecl(ADecl)) {
       if (!External && !S.getLangOpts().CPlusPlus)
@@ -143,6 +166,11 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
         // skipping something.
         if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
           return;
+        // HLSL Change Starts - stop if the parse has been cancelled.
+        if (S.TUKind != TU_Prefix && CurrentCancellation &&
+            CurrentCancellation->load(std::memory_order_relaxed))
+          return;
+        // HLSL Change Ends
       } while (!P.ParseTopLevelDecl(ADecl));
     }
   } // HLSL Change: Skip if fatal error already occurred
@@ -156,6 +184,7 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   // errors in the front-end, without relying on code generation being
   // available.
   hlsl::DiagnoseTranslationUnit(&S);
+  ParseTrace.reset();
   // HLSL Change Ends
   Consumer->HandleTranslationUnit(S.getASTContext());
 
@@ -66,6 +66,36 @@ void AlignmentSizeCalculator::alignUsingHLSLRelaxedLayout(
 std::pair<uint32_t, uint32_t> AlignmentSizeCalculator::getAlignmentAndSize(
     QualType type, SpirvLayoutRule rule, llvm::Optional<bool> isRowMajor,
     uint32_t *stride) {
+  const uint32_t majorness = isRowMajor.hasValue() ? (*isRowMajor ? 2 : 1) : 0;
+  const auto key = std::make_pair(type.getAsOpaquePtr(),
+                                  static_cast<uint32_t>(rule) << 2 | majorness);
+  auto found = layoutCache.find(key);
+  if (found != layoutCache.end()) {
+    if (found->second.stride.hasValue())
+      *stride = *found->second.stride;
+    return {found->second.alignment, found->second.size};
+  }
+
+  // Not every type writes a stride, so watch for the sentinel to change.
+  const uint32_t kNoStride = ~0u;
+  uint32_t computedStride = kNoStride;
+  const auto result =
+      computeAlignmentAndSize(type, rule, isRowMajor, &computedStride);
+  Layout layout = {result.first, result.second, llvm::None};
+  if (computedStride != kNoStride) {
+    layout.stride = computedStride;
+    *stride = computedStride;
+  }
+  // Stop remembering once an error was reported, so that errors in type
+  // layouts are reported at each use.
+  if (!astContext.getDiagnostics().hasErrorOccurred())
+    layoutCache[key] = layout;
+  return result;
+}
+
+std::pair<uint32_t, uint32_t> AlignmentSizeCalculator::computeAlignmentAndSize(
+    QualType type, SpirvLayoutRule rule, llvm::Optional<bool> isRowMajor,
+    uint32_t *stride) {
   // std140 layout rules:
 
   // 1. If the member is a scalar consuming N basic machine units, the base
@@ -12,6 +12,7 @@
 
 #include "dxc/Support/SPIRVOptions.h"
 #include "clang/AST/ASTContext.h"
+#include "llvm/ADT/DenseMap.h"
 
 namespace clang {
 namespace spirv {
@@ -49,6 +50,12 @@ public:
                                    uint32_t *currentOffset);
 
 private:
+  /// Computes the alignment, size and stride for getAlignmentAndSize, which
+  /// memoizes the results.
+  std::pair<uint32_t, uint32_t>
+  computeAlignmentAndSize(QualType type, SpirvLayoutRule rule,
+                          llvm::Optional<bool> isRowMajor, uint32_t *stride);
+
   /// Emits error to the diagnostic engine associated with this visitor.
   template <unsigned N>
   DiagnosticBuilder emitError(const char (&message)[N],
@@ -61,6 +68,18 @@ private:
 private:
   ASTContext &astContext;                /// AST context
   const SpirvCodeGenOptions &spvOptions; /// SPIR-V options
+
+  /// A previously computed layout. The stride is only set if the computation
+  /// wrote one.
+  struct Layout {
+    uint32_t alignment;
+    uint32_t size;
+    llvm::Optional<uint32_t> stride;
+  };
+  /// Layouts computed so far, keyed on the type and a packed layout rule and
+  /// majorness. Nested struct and array types are laid out many times when
+  /// used in different resources, so this avoids recursing into them again.
+  llvm::DenseMap<std::pair<void *, uint32_t>, Layout> layoutCache;
 };
 
 } // end namespace spirv
@@ -141,6 +141,22 @@ bool LowerTypeVisitor::visitInstruction(SpirvInstruction *instr) {
 const SpirvType *LowerTypeVisitor::lowerType(const SpirvType *type,
                                              SpirvLayoutRule rule,
                                              SourceLocation loc) {
+  const auto key = std::make_pair(type, static_cast<uint32_t>(rule));
+  auto found = hybridTypeCache.find(key);
+  if (found != hybridTypeCache.end())
+    return found->second;
+
+  const SpirvType *loweredType = lowerTypeImpl(type, rule, loc);
+  // Stop remembering once an error was reported, so that errors are
+  // reported at each use.
+  if (!astContext.getDiagnostics().hasErrorOccurred())
+    hybridTypeCache[key] = loweredType;
+  return loweredType;
+}
+
+const SpirvType *LowerTypeVisitor::lowerTypeImpl(const SpirvType *type,
+                                                 SpirvLayoutRule rule,
+                                                 SourceLocation loc) {
   if (const auto *hybridPointer = dyn_cast<HybridPointerType>(type)) {
     const QualType pointeeType = hybridPointer->getPointeeType();
     const SpirvType *pointeeSpirvType =
@@ -240,6 +256,25 @@ const SpirvType *LowerTypeVisitor::lowerType(QualType type,
                                              SpirvLayoutRule rule,
                                              llvm::Optional<bool> isRowMajor,
                                              SourceLocation srcLoc) {
+  const uint32_t majorness = isRowMajor.hasValue() ? (*isRowMajor ? 2 : 1) : 0;
+  const auto key = std::make_pair(type.getAsOpaquePtr(),
+                                  static_cast<uint32_t>(rule) << 2 | majorness);
+  auto found = astTypeCache.find(key);
+  if (found != astTypeCache.end())
+    return found->second;
+
+  const SpirvType *loweredType = lowerTypeImpl(type, rule, isRowMajor, srcLoc);
+  // Stop remembering once an error was reported, so that errors are
+  // reported at each use.
+  if (!astContext.getDiagnostics().hasErrorOccurred())
+    astTypeCache[key] = loweredType;
+  return loweredType;
+}
+
+const SpirvType *LowerTypeVisitor::lowerTypeImpl(QualType type,
+                                                 SpirvLayoutRule rule,
+                                                 llvm::Optional<bool> isRowMajor,
+                                                 SourceLocation srcLoc) {
   const auto desugaredType = desugarType(type, &isRowMajor);
 
   if (desugaredType != type) {
@@ -14,6 +14,7 @@
 #include "clang/AST/ASTContext.h"
 #include "clang/SPIRV/SpirvContext.h"
 #include "clang/SPIRV/SpirvVisitor.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 
 namespace clang {
@@ -55,12 +56,21 @@ private:
   /// on will be created in SpirvContext.
   const SpirvType *lowerType(QualType type, SpirvLayoutRule,
                              llvm::Optional<bool> isRowMajor, SourceLocation);
+  /// Does the actual lowering for the above lowerType method, which memoizes
+  /// the results.
+  const SpirvType *lowerTypeImpl(QualType type, SpirvLayoutRule,
+                                 llvm::Optional<bool> isRowMajor,
+                                 SourceLocation);
   /// Lowers the given Hybrid type into a SPIR-V type.
   ///
   /// Uses the above lowerType method to lower the QualType components of hybrid
   /// types.
   const SpirvType *lowerType(const SpirvType *, SpirvLayoutRule,
                              SourceLocation);
+  /// Does the actual lowering for the above lowerType method, which memoizes
+  /// the results.
+  const SpirvType *lowerTypeImpl(const SpirvType *, SpirvLayoutRule,
+                                 SourceLocation);
 
   /// Lowers the given HLSL resource type into its SPIR-V type.
   const SpirvType *lowerResourceType(QualType type, SpirvLayoutRule rule,
@@ -84,6 +94,15 @@ private:
   ASTContext &astContext;                /// AST context
   SpirvContext &spvContext;              /// SPIR-V context
   AlignmentSizeCalculator alignmentCalc; /// alignment calculator
+
+  /// Lowered AST types, keyed on the type and a packed layout rule and
+  /// majorness. Every instruction carries its result type, so the same types
+  /// are lowered over and over again.
+  llvm::DenseMap<std::pair<void *, uint32_t>, const SpirvType *>
+      astTypeCache;
+  /// Lowered hybrid types, keyed on the type and layout rule.
+  llvm::DenseMap<std::pair<const SpirvType *, uint32_t>, const SpirvType *>
+      hybridTypeCache;
 };
 
 } // end namespace spirv
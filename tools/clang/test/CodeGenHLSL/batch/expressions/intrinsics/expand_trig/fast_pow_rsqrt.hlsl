@@ -0,0 +1,28 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-expand-trig-intrinsics,fast-transcendentals=1 | %FileCheck %s
+
+// CHECK-DAG: [[X:%.*]] = call float @dx.op.loadInput.f32(i32 4, i32 0
+// CHECK-DAG: [[Y:%.*]] = call float @dx.op.loadInput.f32(i32 4, i32 1
+// CHECK-DAG: [[Z:%.*]] = call float @dx.op.loadInput.f32(i32 4, i32 2
+// CHECK-DAG: [[W:%.*]] = call float @dx.op.loadInput.f32(i32 4, i32 3
+
+// pow(x, 0.5) becomes sqrt(x).
+// CHECK-DAG: call float @dx.op.unary.f32(i32 24, float [[X]])
+
+// pow(y, -0.5) becomes rsqrt(y).
+// CHECK-DAG: call float @dx.op.unary.f32(i32 25, float [[Y]])
+
+// z / sqrt(w) becomes z * rsqrt(w).
+// CHECK-DAG: [[R:%.*]] = call float @dx.op.unary.f32(i32 25, float [[W]])
+// CHECK-DAG: fmul fast float [[Z]], [[R]]
+
+// pow with any other exponent is kept.
+// CHECK-DAG: call float @dx.op.unary.f32(i32 23
+// CHECK-DAG: call float @dx.op.unary.f32(i32 21
+
+// CHECK-NOT: fdiv
+// CHECK: ret void
+
+[RootSignature("")]
+float main(float x : A, float y : B, float z : C, float w : D, float v : E) : SV_Target {
+    return pow(x, 0.5) + pow(y, -0.5) + z / sqrt(w) + pow(v, 0.25);
+}
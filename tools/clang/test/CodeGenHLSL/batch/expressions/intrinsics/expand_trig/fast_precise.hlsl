@@ -0,0 +1,21 @@
+// RUN: %dxc -Emain -Tps_6_0 -ffast-transcendentals %s | %FileCheck %s
+
+// Make sure that with -ffast-transcendentals only calls that are not precise
+// are expanded; precise calls keep the native operation.
+
+// CHECK: [[X:%.*]] = call float @dx.op.loadInput.f32(i32 4, i32 0
+// CHECK: call float @dx.op.unary.f32(i32 15, float [[X]]), !dx.precise
+
+// CHECK: [[Y:%.*]] = call float @dx.op.loadInput.f32(i32 4, i32 1
+// CHECK: [[r0:%.*]] = call float @dx.op.unary.f32(i32 6, float [[Y]])
+// CHECK: fmul fast float [[r0]], 0x3FAB5DB840000000
+// CHECK: fadd fast float {{.*}}, 0xBFCA8DA060000000
+
+// CHECK-NOT: call float @dx.op.unary.f32(i32 15
+
+[RootSignature("")]
+float main(float x : A, float y : B) : SV_Target {
+    precise float a = acos(x);
+            float b = acos(y);
+    return a + b;
+}
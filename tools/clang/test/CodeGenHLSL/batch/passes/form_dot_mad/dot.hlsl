@@ -0,0 +1,11 @@
+// RUN: %dxc -E main -T ps_6_0 -fform-dot-mad %s | FileCheck %s
+
+// A sum of products written out by hand becomes a dot operation.
+
+// CHECK: call float @dx.op.dot3.f32(i32 55,
+// CHECK-NOT: fmul
+// CHECK-NOT: fadd
+
+float main(float3 a : A, float3 b : B) : SV_Target {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 -fform-dot-mad %s | FileCheck %s
+
+// Multiply-add pairs become mad operations.
+
+// CHECK: call float @dx.op.tertiary.f32(i32 46,
+// CHECK: call i32 @dx.op.tertiary.i32(i32 {{48|49}},
+
+struct Output {
+  float f : SV_Target0;
+  uint u : SV_Target1;
+};
+
+Output main(float a : A, float b : B, float c : C,
+            uint x : X, uint y : Y, uint z : Z) {
+  Output o;
+  o.f = a * b + c;
+  o.u = x * y + z;
+  return o;
+}
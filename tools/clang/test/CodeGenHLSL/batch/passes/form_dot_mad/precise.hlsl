@@ -0,0 +1,13 @@
+// RUN: %dxc -E main -T ps_6_0 -fform-dot-mad %s | FileCheck %s
+
+// Precise math is left as written.
+
+// CHECK-NOT: dx.op.tertiary.f32
+// CHECK-NOT: dx.op.dot
+// CHECK: fmul float
+// CHECK: fadd float
+
+float main(float2 a : A, float2 b : B, float c : C) : SV_Target {
+  precise float r = a.x * b.x + a.y * b.y + c;
+  return r;
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T cs_6_0 -fpad-groupshared -fstats-json %s | FileCheck %s
+
+// An index that is not affine in the thread IDs cannot be analyzed, so the
+// array keeps its layout even though other accesses conflict.
+
+// CHECK: "DxilGroupsharedBankConflicts.Conflicts": 1
+// CHECK: "DxilGroupsharedBankConflicts.Unknown": 1
+// CHECK-NOT: DxilGroupsharedBankConflicts.Padded
+// CHECK: addrspace(3) global [1024 x float]
+
+groupshared float data[32][32];
+RWStructuredBuffer<float> buf;
+
+[numthreads(32, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID) {
+  data[tid.x][0] = buf[tid.x];
+  GroupMemoryBarrierWithGroupSync();
+  buf[tid.x] = data[(tid.x * tid.x) % 32][1];
+}
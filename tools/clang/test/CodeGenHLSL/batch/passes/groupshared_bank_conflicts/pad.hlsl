@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T cs_6_0 -fpad-groupshared -fstats-json %s | FileCheck %s
+
+// Padding each row of a 32x32 array with one element puts the lanes of a
+// column access 33 words apart, each in a different bank. Row accesses are
+// unaffected.
+
+// CHECK: "DxilGroupsharedBankConflicts.Conflicts": 2
+// CHECK: "DxilGroupsharedBankConflicts.Padded": 1
+// CHECK: addrspace(3) global [1056 x float]
+// CHECK: define void @main()
+// CHECK: mul i32 %{{.*}}, 33
+
+groupshared float data[32][32];
+RWStructuredBuffer<float> buf;
+
+[numthreads(32, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID) {
+  data[tid.x][1] = buf[tid.x];
+  GroupMemoryBarrierWithGroupSync();
+  buf[tid.x] = data[tid.x][0] + data[1][tid.x];
+}
@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T cs_6_0 -fgroupshared-bank-report -fstats-json %s | FileCheck %s
+
+// Reading a column of a 32x32 array puts the lanes of a wave 32 words apart,
+// all in the same bank. Reading a row does not conflict.
+
+// CHECK: warning: 32-way bank conflict accessing groupshared
+// CHECK-SAME: lanes are 32 words apart
+// CHECK-NOT: warning: {{.*}}bank conflict
+// CHECK: "DxilGroupsharedBankConflicts.Conflicts": 1
+// CHECK: addrspace(3) global [1024 x float]
+
+groupshared float data[32][32];
+RWStructuredBuffer<float> buf;
+
+[numthreads(32, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID) {
+  data[0][tid.x] = buf[tid.x];
+  GroupMemoryBarrierWithGroupSync();
+  buf[tid.x] = data[tid.x][0];
+}
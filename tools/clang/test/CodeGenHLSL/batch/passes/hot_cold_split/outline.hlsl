@@ -0,0 +1,22 @@
+// RUN: %dxc -T lib_6_3 -fhot-cold-split -fstats-json %s | FileCheck %s
+
+// In a library, a cold region that only takes scalars and produces nothing
+// used after it is outlined into an internal function.
+
+// CHECK: "DxilHotColdSplit.Outlined": 1
+// CHECK: define void @"\01?shade@@YAXM@Z"(float
+// CHECK: call void @"\01?shade@@YAXM@Z.cold"(float
+// CHECK: define internal void @"\01?shade@@YAXM@Z.cold"(float
+// CHECK: call float @dx.op.unary.f32(i32 13
+
+cbuffer C {
+  uint debugView;
+};
+
+RWByteAddressBuffer debugOut;
+
+export void shade(float x) {
+  [branch]
+  if (debugView != 0)
+    debugOut.Store(0, asuint(sin(x)));
+}
@@ -0,0 +1,23 @@
+// RUN: %dxc -E main -T ps_6_0 -fhot-cold-report -fstats-json %s | FileCheck %s
+
+// A [branch] if-then on a constant buffer switch is reported as a cold region
+// with its size. Without -fhot-cold-split the code is not moved.
+
+// CHECK: "DxilHotColdSplit.ColdInstructions": {{[1-9][0-9]*}}
+// CHECK: "DxilHotColdSplit.ColdRegions": 1
+// CHECK: "DxilHotColdSplit.HotInstructions": {{[1-9][0-9]*}}
+// CHECK: "DxilHotColdSplit.Region.main.1": {{[1-9][0-9]*}}
+// CHECK: define void @main()
+// CHECK: call float @dx.op.unary.f32(i32 13
+// CHECK: ret void
+
+cbuffer C {
+  uint debugView;
+};
+
+float4 main(float4 color : COLOR, float3 n : NORMAL) : SV_Target {
+  [branch]
+  if (debugView != 0)
+    color = float4(sin(n * 8) * 0.5 + 0.5, 1);
+  return color;
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 -Zi -fhot-cold-report -fstats-json %s | FileCheck %s
+
+// With debug information, each cold region is reported under the line and
+// column where it starts, so two regions on one line are told apart.
+
+// CHECK: "DxilHotColdSplit.ColdRegions": 2
+// CHECK: "DxilHotColdSplit.Region.{{.*}}report_location.hlsl:17:{{[0-9]+}}": {{[1-9][0-9]*}}
+// CHECK: "DxilHotColdSplit.Region.{{.*}}report_location.hlsl:17:{{[0-9]+}}": {{[1-9][0-9]*}}
+
+cbuffer C {
+  uint debugView;
+  uint debugMask;
+};
+
+float4 main(float4 color : COLOR, float3 n : NORMAL) : SV_Target {
+  // The regions start at the sin and cos calls.
+  [branch] if (debugView != 0) { color.rgb = sin(n * 8); } [branch] if (debugMask != 0) { color.a = cos(n.x * 4); }
+  return color;
+}
@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T ps_6_0 -fhot-cold-split %s | FileCheck %s
+
+// The cold region is moved after the hot path, which ends in the return.
+
+// CHECK: define void @main()
+// CHECK: br i1
+// CHECK: call void @dx.op.storeOutput.f32(i32 5
+// CHECK: ret void
+// CHECK: call float @dx.op.unary.f32(i32 13
+// CHECK: br label
+
+cbuffer C {
+  uint debugView;
+};
+
+float4 main(float4 color : COLOR, float3 n : NORMAL) : SV_Target {
+  [branch]
+  if (debugView != 0)
+    color = float4(sin(n * 8) * 0.5 + 0.5, 1);
+  return color;
+}
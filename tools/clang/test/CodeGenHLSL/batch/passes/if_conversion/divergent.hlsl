@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 -fif-conversion -fstats-json %s | FileCheck %s
+
+// A short branch on a per-pixel condition is cheaper to execute on both sides
+// than to run divergently, so it is flattened into a select.
+
+// CHECK: "DxilIfConversion.FlattenedDivergent": 1
+// CHECK: define void @main()
+// CHECK-NOT: br i1
+// CHECK: call float @dx.op.unary.f32(i32 13
+// CHECK: call float @dx.op.unary.f32(i32 12
+// CHECK: select i1
+// CHECK: ret void
+
+float main(float a : A, float b : B) : SV_Target {
+  float r = a;
+  if (b > 0)
+    r = sin(a) * b + cos(a);
+  return r;
+}
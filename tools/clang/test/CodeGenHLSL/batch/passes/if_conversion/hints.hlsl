@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T ps_6_0 -fif-conversion -fstats-json %s | FileCheck %s
+
+// [branch] keeps a region the cost model would flatten, and [flatten]
+// flattens one it would keep.
+
+// CHECK: "DxilIfConversion.FlattenedByHint": 1
+// CHECK: "DxilIfConversion.KeptByHint": 1
+// CHECK: define void @main()
+// CHECK: br i1
+// CHECK-NOT: br i1
+// CHECK: ret void
+
+cbuffer C {
+  float k;
+};
+
+float main(float a : A, float b : B) : SV_Target {
+  float r = a;
+  [branch]
+  if (b > 0)
+    r = sin(a) * b;
+  [flatten]
+  if (k > 0)
+    r = cos(r) * b + sin(r);
+  return r;
+}
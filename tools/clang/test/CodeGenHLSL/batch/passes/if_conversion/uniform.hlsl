@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T ps_6_0 -fif-conversion -fstats-json %s | FileCheck %s
+
+// A branch on a constant buffer value is taken the same way by every lane of
+// a wave, so the same region is only worth flattening if it is very cheap.
+
+// CHECK: "DxilIfConversion.KeptUniform": 1
+// CHECK: define void @main()
+// CHECK: br i1
+// CHECK: call float @dx.op.unary.f32(i32 13
+// CHECK: phi float
+// CHECK: ret void
+
+cbuffer C {
+  float k;
+};
+
+float main(float a : A, float b : B) : SV_Target {
+  float r = a;
+  if (k > 0)
+    r = sin(a) * b + cos(a);
+  return r;
+}
@@ -0,0 +1,32 @@
+// RUN: %dxc -E main -T cs_6_0 -flower-indexed-arrays -fstats-json %s | FileCheck %s
+
+// The array is indexed by a loop counter with a constant trip count and by a
+// constant buffer value, both uniform over the group, so it is staged in
+// groupshared memory with one column per thread. Dynamic indices are masked
+// to the array so that no access can reach another thread's column.
+
+// CHECK: "DxilLowerIndexedArrays.Groupshared": 1
+// CHECK: @dx.indexed.array = addrspace(3) global [2048 x float] undef
+// CHECK: define void @main()
+// CHECK-NOT: alloca
+// CHECK: %[[tid:[0-9]+]] = call i32 @dx.op.flattenedThreadIdInGroup.i32(i32 96)
+// CHECK: mul i32 %{{.+}}, 64
+// CHECK: add i32 %{{.+}}, %[[tid]]
+// CHECK: store float %{{.+}}, float addrspace(3)*
+// CHECK: and i32 %{{.+}}, 31
+// CHECK: load float, float addrspace(3)*
+
+cbuffer C {
+  uint index;
+};
+
+RWStructuredBuffer<float> output;
+
+[numthreads(64, 1, 1)]
+void main(uint3 tid : SV_DispatchThreadID) {
+  float a[32];
+  [loop]
+  for (uint i = 0; i < 32; ++i)
+    a[i] = tid.x * i;
+  output[tid.x] = a[index];
+}
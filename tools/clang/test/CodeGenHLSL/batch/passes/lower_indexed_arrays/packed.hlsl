@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T ps_6_0 -flower-indexed-arrays -fstats-json %s | FileCheck %s
+
+// Two arrays too large for selects are accessed with the same indices, so
+// they stay in memory interleaved in one array.
+
+// CHECK: "DxilLowerIndexedArrays.Packed": 2
+// CHECK: define void @main()
+// CHECK: alloca [32 x float]
+// CHECK-NOT: alloca [16 x float]
+// CHECK: %[[off:[0-9]+]] = mul i32 %{{.+}}, 2
+// CHECK: add i32 %[[off]], 1
+
+float main(float4 v : A, uint i : B) : SV_Target {
+  float a[16];
+  float b[16];
+  [loop]
+  for (uint j = 0; j < 16; ++j) {
+    a[j] = v.x * j;
+    b[j] = v.y + j;
+  }
+  return a[i] * b[i];
+}
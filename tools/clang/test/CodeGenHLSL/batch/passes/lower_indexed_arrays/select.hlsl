@@ -0,0 +1,15 @@
+// RUN: %dxc -E main -T ps_6_0 -flower-indexed-arrays -fstats-json %s | FileCheck %s
+
+// A small array read with a dynamic index becomes a chain of selects.
+
+// CHECK: "DxilLowerIndexedArrays.Select": 1
+// CHECK: define void @main()
+// CHECK-NOT: alloca
+// CHECK: icmp eq i32
+// CHECK: select i1
+// CHECK: ret void
+
+float main(float4 v : A, uint i : B) : SV_Target {
+  float a[4] = { v.x, v.y, v.z, v.w };
+  return a[i];
+}
@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T cs_6_0 -fremove-redundant-barriers -fstats-json %s | FileCheck %s
+
+// Back-to-back barriers merge into one, and a barrier with no memory access
+// after it is removed. Each removed barrier is reported by its position.
+
+// CHECK: "DxilRemoveRedundantBarriers.Merged.main.2": 1
+// CHECK: "DxilRemoveRedundantBarriers.Removed.main.3": 1
+// CHECK: store i32
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+// CHECK-NOT: call void @dx.op.barrier
+// CHECK: load i32
+// CHECK: call void @dx.op.bufferStore.i32
+// CHECK-NOT: call void @dx.op.barrier
+// CHECK: ret void
+
+groupshared uint data[64];
+RWStructuredBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint index : SV_GroupIndex) {
+  data[index] = index;
+  GroupMemoryBarrierWithGroupSync();
+  GroupMemoryBarrierWithGroupSync();
+  output[index] = data[63 - index];
+  GroupMemoryBarrierWithGroupSync();
+}
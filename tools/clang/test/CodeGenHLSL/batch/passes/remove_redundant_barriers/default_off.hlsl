@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// Barriers are left alone without -fremove-redundant-barriers.
+
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+
+groupshared uint data[64];
+RWStructuredBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint index : SV_GroupIndex) {
+  data[index] = index;
+  GroupMemoryBarrierWithGroupSync();
+  GroupMemoryBarrierWithGroupSync();
+  output[index] = data[63 - index];
+  GroupMemoryBarrierWithGroupSync();
+}
@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T cs_6_0 -fremove-redundant-barriers %s | FileCheck %s
+
+// Groupshared memory is only accessed before the barrier and a UAV only
+// after it, so neither fence orders anything. The group sync is still kept,
+// with the groupshared fence DXIL requires alongside it.
+
+// CHECK: load i32, i32 addrspace(3)*
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+// CHECK: call void @dx.op.bufferStore.i32
+
+groupshared uint data[64];
+RWStructuredBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint index : SV_GroupIndex) {
+  data[index] = index;
+  uint value = data[63 - index];
+  GroupMemoryBarrierWithGroupSync();
+  output[index] = value;
+}
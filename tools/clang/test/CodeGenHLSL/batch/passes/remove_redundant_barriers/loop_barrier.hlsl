@@ -0,0 +1,23 @@
+// RUN: %dxc -E main -T cs_6_0 -fremove-redundant-barriers %s | FileCheck %s
+
+// Barriers in a loop order the accesses of one iteration against the next
+// and are kept.
+
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+
+groupshared uint data[64];
+RWStructuredBuffer<uint> output;
+uint count;
+
+[numthreads(64, 1, 1)]
+void main(uint index : SV_GroupIndex) {
+  data[index] = index;
+  [loop]
+  for (uint i = 0; i < count; ++i) {
+    GroupMemoryBarrierWithGroupSync();
+    data[index] += data[(index + 1) % 64];
+  }
+  GroupMemoryBarrierWithGroupSync();
+  output[index] = data[0];
+}
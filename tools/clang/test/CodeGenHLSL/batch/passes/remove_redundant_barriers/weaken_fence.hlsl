@@ -0,0 +1,16 @@
+// RUN: %dxc -E main -T cs_6_0 -fremove-redundant-barriers %s | FileCheck %s
+
+// No UAV is accessed before the barrier, so only the groupshared fence and
+// the sync are kept.
+
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+
+groupshared float data[64];
+RWBuffer<float> output;
+
+[numthreads(64, 1, 1)]
+void main(uint index : SV_GroupIndex) {
+  data[index] = index;
+  AllMemoryBarrierWithGroupSync();
+  output[index] = data[63 - index];
+}
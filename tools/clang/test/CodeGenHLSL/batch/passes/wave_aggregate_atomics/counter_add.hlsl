@@ -0,0 +1,25 @@
+// RUN: %dxc -E main -T cs_6_0 -fwave-aggregate-atomics %s | FileCheck %s
+
+// An increment of a single counter from every lane becomes one atomic add of
+// the active lane count, and each lane's original value is rebuilt from the
+// lanes before it.
+
+// CHECK: [[COUNT:%[^ ]+]] = call i32 @dx.op.waveAllOp(i32 135, i1 true)
+// CHECK: [[FIRST:%[^ ]+]] = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: br i1 [[FIRST]]
+// CHECK: [[ORIG:%[^ ]+]] = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %{{[^ ]+}}, i32 0, {{.*}}, i32 [[COUNT]])
+// CHECK: [[PHI:%[^ ]+]] = phi i32 [ [[ORIG]], %{{[^ ]+}} ], [ undef, %{{[^ ]+}} ]
+// CHECK: [[BASE:%[^ ]+]] = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 [[PHI]])
+// CHECK: [[PREFIX:%[^ ]+]] = call i32 @dx.op.wavePrefixOp(i32 136, i1 true)
+// CHECK: add i32 [[BASE]], [[PREFIX]]
+// CHECK-NOT: call i32 @dx.op.atomicBinOp
+
+RWStructuredBuffer<uint> counter;
+RWStructuredBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_DispatchThreadID) {
+  uint slot;
+  InterlockedAdd(counter[0], 1, slot);
+  output[slot] = tid;
+}
@@ -0,0 +1,18 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// Wave operations are an optional feature, so without
+// -fwave-aggregate-atomics each lane keeps its own atomic.
+
+// CHECK-NOT: @dx.op.waveIsFirstLane
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %{{[^ ]+}}, i32 0, {{.*}}, i32 1)
+// CHECK-NOT: @dx.op.waveIsFirstLane
+
+RWStructuredBuffer<uint> counter;
+RWStructuredBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_DispatchThreadID) {
+  uint slot;
+  InterlockedAdd(counter[0], 1, slot);
+  output[slot] = tid;
+}
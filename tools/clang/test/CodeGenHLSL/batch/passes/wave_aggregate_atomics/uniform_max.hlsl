@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T cs_6_0 -fwave-aggregate-atomics %s | FileCheck %s
+
+// A max on an address taken from a constant buffer is reduced across the
+// wave; with the result unused no per-lane value is rebuilt.
+
+// CHECK: [[MAX:%[^ ]+]] = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %{{[^ ]+}}, i8 3, i8 1)
+// CHECK: [[FIRST:%[^ ]+]] = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: br i1 [[FIRST]]
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %{{[^ ]+}}, i32 7, {{.*}}, i32 [[MAX]])
+// CHECK-NOT: @dx.op.waveReadLaneFirst
+
+RWByteAddressBuffer buf;
+
+cbuffer Params {
+  uint slot;
+};
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_DispatchThreadID) {
+  buf.InterlockedMax(slot * 4, tid);
+}
@@ -0,0 +1,14 @@
+// RUN: %dxc -E main -T cs_6_0 -fwave-aggregate-atomics %s | FileCheck %s
+
+// Atomics on addresses that vary across lanes are left alone.
+
+// CHECK-NOT: @dx.op.waveIsFirstLane
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %{{[^ ]+}}, i32 0,
+// CHECK-NOT: @dx.op.waveIsFirstLane
+
+RWByteAddressBuffer buf;
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_DispatchThreadID) {
+  buf.InterlockedAdd(tid * 4, 1);
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-add-pixel-hit-instrmentation,rt-width=16,num-pixels=16,tile-width=4,tile-height=8 | %FileCheck %s
+
+// The cast-to-int:
+// CHECK: %XIndex = fptoui float %XPos to i32
+// CHECK: %YIndex = fptoui float %YPos to i32
+
+// Reduction to tile coordinates:
+// CHECK: %XTile = udiv i32 %XIndex, 4
+// CHECK: %YTile = udiv i32 %YIndex, 8
+
+// Calculation of offset uses the width in tiles:
+// CHECK: %YOffset = mul i32 %YTile, 4
+// CHECK: %ElementOffset = add i32 %XTile, %YOffset
+
+// CHECK: %UAVIncResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 0, i32 %ByteIndex, i32 undef, i32 undef, i32 1)
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+  return pos;
+}
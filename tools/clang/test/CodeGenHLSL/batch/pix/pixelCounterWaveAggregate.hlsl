@@ -0,0 +1,43 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-add-pixel-hit-instrmentation,rt-width=16,num-pixels=64,add-pixel-cost=1,wave-aggregate=1 | %FileCheck %s
+
+// Check that the pixel index is computed as usual:
+// CHECK: %ByteIndex = mul i32 %ElementOffset, 4
+
+// Helper lanes don't take part in wave operations, so they are kept out of the
+// loop by their coverage:
+// CHECK: %Coverage = call i32 @dx.op.coverage.i32(i32 91)
+// CHECK: %IsCovered = icmp ne i32 %Coverage, 0
+// CHECK: br i1 %IsCovered, label %PIX_AggregateLoop, label %PIX_AggregateExit
+
+// Each iteration handles the lanes that share the address of the first
+// active lane:
+// CHECK: PIX_AggregateLoop:
+// CHECK: %FirstIndex = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %ByteIndex)
+// CHECK: %IsMatch = icmp eq i32 %ByteIndex, %FirstIndex
+// CHECK: br i1 %IsMatch, label %PIX_AggregateMatch, label %PIX_AggregateLatch
+
+// Hits to that address are summed inside the loop, so the sum only sees the
+// matching lanes, and only the first of them writes:
+// CHECK: PIX_AggregateMatch:
+// CHECK: %HitCount = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 1, i8 0, i8 1)
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: br i1 %IsFirstLane, label %PIX_AggregateWrite, label %PIX_AggregateLatch
+
+// CHECK: PIX_AggregateWrite:
+// CHECK: %UAVIncResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 0, i32 %ByteIndex, i32 undef, i32 undef, i32 %HitCount)
+// CHECK: %Weight = extractvalue %dx.types.ResRet.i32 %WeightStruct, 0
+// CHECK: %AggregatedWeight = mul i32 %Weight, %HitCount
+// CHECK: %OffsetByteIndex = add i32 %ByteIndex, 256
+// CHECK: %UAVIncResult2 = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 0, i32 %OffsetByteIndex, i32 undef, i32 undef, i32 %AggregatedWeight)
+// CHECK: br label %PIX_AggregateLatch
+
+// Handled lanes leave the loop; the others go around for the next address:
+// CHECK: PIX_AggregateLatch:
+// CHECK-NEXT: br i1 %IsMatch, label %PIX_AggregateExit, label %PIX_AggregateLoop
+
+// CHECK: PIX_AggregateExit:
+// CHECK-NEXT: ret void
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+  return pos;
+}
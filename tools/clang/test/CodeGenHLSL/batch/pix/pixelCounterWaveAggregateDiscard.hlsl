@@ -0,0 +1,23 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-add-pixel-hit-instrmentation,rt-width=16,num-pixels=64,wave-aggregate=1 | %FileCheck %s
+
+// Lanes that discard become helpers, so the discard condition is recorded:
+// CHECK: %PIX_Discarded = alloca i32
+// CHECK: store i32 0, i32* %PIX_Discarded
+// CHECK: call void @dx.op.discard(i32 82, i1 [[COND:%.*]])
+// CHECK: [[PREV:%.*]] = load i32, i32* %PIX_Discarded
+// CHECK: [[DISCARDED:%.*]] = zext i1 [[COND]] to i32
+// CHECK: [[MASK:%.*]] = or i32 [[PREV]], [[DISCARDED]]
+// CHECK: store i32 [[MASK]], i32* %PIX_Discarded
+
+// and only covered lanes that haven't discarded enter the aggregation loop:
+// CHECK: %Coverage = call i32 @dx.op.coverage.i32(i32 91)
+// CHECK: %IsCovered = icmp ne i32 %Coverage, 0
+// CHECK: %WasDiscarded = load i32, i32* %PIX_Discarded
+// CHECK: %IsKept = icmp eq i32 %WasDiscarded, 0
+// CHECK: %IsCounted = and i1 %IsCovered, %IsKept
+// CHECK: br i1 %IsCounted, label %PIX_AggregateLoop, label %PIX_AggregateExit
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+  clip(pos.x - 8);
+  return pos;
+}
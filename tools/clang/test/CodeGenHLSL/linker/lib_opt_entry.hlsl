@@ -0,0 +1,11 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// CHECK: call float @"\01?shade@@YAMM@Z"(float
+// CHECK: call float @"\01?shade@@YAMM@Z"(float
+
+float shade(float x);
+
+[shader("pixel")]
+float ps_main(float x : X) : SV_Target {
+  return shade(x) + shade(x);
+}
@@ -0,0 +1,7 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// CHECK: define float @"\01?shade@@YAMM@Z"(float
+
+export float shade(float x) {
+  return sin(x) * x;
+}
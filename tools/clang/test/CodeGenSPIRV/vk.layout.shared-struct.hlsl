@@ -0,0 +1,39 @@
+// Run: %dxc -T ps_6_0 -E main -fvk-use-gl-layout
+
+// The same struct is laid out under std140 in the cbuffer and under std430
+// in the structured buffer, and holds arrays of the same matrix type with
+// both majornesses. Each combination needs its own layout.
+
+struct S {                      // std140                 std430
+                 float    a[2]; // 0   + 2 * 16 = 32      0   + 2 * 4  = 8
+    row_major    float2x3 m[2]; // 32  + 2 * 32 = 96      16  + 2 * 32 = 80
+    column_major float2x3 n[2]; // 96  + 2 * 48 = 192     80  + 2 * 24 = 128
+};                              // 192                    128
+
+cbuffer MyCBuffer {
+    S s;
+};
+
+StructuredBuffer<S> MySBuffer;
+
+// CHECK-DAG: OpDecorate %_arr_float_uint_2{{(_0)?}} ArrayStride 16
+// CHECK-DAG: OpDecorate %_arr_float_uint_2{{(_0)?}} ArrayStride 4
+// CHECK-DAG: OpDecorate %_arr_mat2v3float_uint_2{{(_[0-9]+)?}} ArrayStride 32
+// CHECK-DAG: OpDecorate %_arr_mat2v3float_uint_2{{(_[0-9]+)?}} ArrayStride 48
+// CHECK-DAG: OpDecorate %_arr_mat2v3float_uint_2{{(_[0-9]+)?}} ArrayStride 24
+
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 1 Offset 32
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 2 Offset 96
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 2 MatrixStride 16
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 1 Offset 16
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 2 Offset 80
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 2 MatrixStride 8
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 1 ColMajor
+// CHECK-DAG: OpMemberDecorate %S{{(_0)?}} 2 RowMajor
+
+// CHECK-DAG: OpDecorate %_runtimearr_S{{(_0)?}} ArrayStride 128
+
+float main() : SV_Target {
+    return s.a[1] + s.m[1][0][2] + s.n[1][1][2] +
+           MySBuffer[0].a[1] + MySBuffer[0].m[1][0][2] + MySBuffer[0].n[1][1][2];
+}
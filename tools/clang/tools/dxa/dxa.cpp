@@ -10,6 +10,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/Support/Global.h"
+#include "dxc/Support/ErrorCodes.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/WinIncludes.h"
 
@@ -17,8 +18,10 @@
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilShaderPack.h"
 
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
 #include <dia2.h>
 #include <intsafe.h>
 
@@ -48,6 +51,16 @@ static cl::opt<bool> ListFiles("listfiles",
 static cl::opt<std::string>
     ExtractFile("extractfile", cl::desc("Extract file from debug information (use '*' for all files)"));
 
+static cl::list<std::string> PackInputFilenames(cl::Positional, cl::ZeroOrMore,
+                                                cl::desc("<more containers to pack>"));
+static cl::opt<bool> Pack("pack",
+                          cl::desc("Pack input containers into a shader pack"),
+                          cl::init(false));
+static cl::opt<bool> ListPack("listpack",
+                              cl::desc("List shaders in input shader pack"),
+                              cl::init(false));
+static cl::opt<std::string>
+    Unpack("unpack", cl::desc("Extract the container with the given shader hash from input shader pack"));
 
 class DxaContext {
 
@@ -63,6 +76,9 @@ public:
   bool ExtractPart(const char *pName);
   void ListFiles();
   void ListParts();
+  void PackContainers();
+  void ListPackedShaders();
+  bool UnpackContainer(const char *pHash);
 };
 
 void DxaContext::Assemble() {
@@ -332,6 +348,96 @@ void DxaContext::ListParts() {
   }
 }
 
+static void WriteStringToFile(DxcDllSupport &dxcSupport, const std::string &data,
+                              StringRef fileName) {
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pBlob;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy(data.data(), data.size(),
+                                                 CP_ACP, &pBlob));
+  WriteBlobToFile(pBlob, StringRefUtf16(fileName));
+}
+
+void DxaContext::PackContainers() {
+  IFTARG(!OutputFilename.empty());
+  std::vector<std::string> inputs(1, InputFilename.getValue());
+  inputs.insert(inputs.end(), PackInputFilenames.begin(),
+                PackInputFilenames.end());
+
+  hlsl::DxilShaderPackWriter writer;
+  for (const std::string &input : inputs) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(input), &pSource);
+    if (!writer.AddContainer(
+            (const hlsl::DxilContainerHeader *)pSource->GetBufferPointer(),
+            pSource->GetBufferSize())) {
+      printf("Skipping %s - shader already packed.\n", input.c_str());
+    }
+  }
+
+  std::string pack;
+  raw_string_ostream OS(pack);
+  writer.Write(OS);
+  OS.flush();
+  WriteStringToFile(m_dxcSupport, pack, OutputFilename);
+  printf("Packed %u shaders, %u of %u parts distinct, %u bytes written to %s\n",
+         writer.GetShaderCount(), writer.GetDistinctPartCount(),
+         writer.GetPartRefCount(), (unsigned)pack.size(),
+         OutputFilename.c_str());
+}
+
+void DxaContext::ListPackedShaders() {
+  CComPtr<IDxcBlobEncoding> pSource;
+  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputFilename), &pSource);
+  hlsl::DxilShaderPackReader reader;
+  IFTBOOL(reader.Init(pSource->GetBufferPointer(), pSource->GetBufferSize()),
+          DXC_E_CONTAINER_INVALID);
+
+  printf("Shader count: %u\n", reader.GetShaderCount());
+  for (uint32_t i = 0; i < reader.GetShaderCount(); ++i) {
+    const hlsl::DxilShaderPackShader &shader = reader.GetShader(i);
+    printf("#%u - ", i);
+    for (uint8_t byte : shader.ShaderHash)
+      printf("%02x", byte);
+    printf(" (%u bytes, %u parts)\n", shader.ContainerSizeInBytes,
+           shader.PartCount);
+  }
+}
+
+bool DxaContext::UnpackContainer(const char *pHash) {
+  uint8_t hash[hlsl::DxilContainerHashSize];
+  IFTARG(strlen(pHash) == 2 * sizeof(hash));
+  for (unsigned i = 0; i < sizeof(hash); ++i) {
+    unsigned byte;
+    IFTARG(sscanf(pHash + 2 * i, "%2x", &byte) == 1);
+    hash[i] = (uint8_t)byte;
+  }
+
+  CComPtr<IDxcBlobEncoding> pSource;
+  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputFilename), &pSource);
+  hlsl::DxilShaderPackReader reader;
+  IFTBOOL(reader.Init(pSource->GetBufferPointer(), pSource->GetBufferSize()),
+          DXC_E_CONTAINER_INVALID);
+  uint32_t index;
+  if (!reader.FindShader(hash, &index)) {
+    printf("Shader %s not found in %s\n", pHash, InputFilename.c_str());
+    return false;
+  }
+
+  if (OutputFilename.empty()) {
+    OutputFilename = pHash;
+    OutputFilename += ".dxbc";
+  }
+  std::string container;
+  raw_string_ostream OS(container);
+  reader.WriteContainer(index, OS);
+  OS.flush();
+  WriteStringToFile(m_dxcSupport, container, OutputFilename);
+  printf("%u bytes written to %s\n", (unsigned)container.size(),
+         OutputFilename.c_str());
+  return true;
+}
+
 using namespace hlsl::options;
 
 int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
@@ -361,6 +467,20 @@ int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
         return 1;
       }
     }
+    else if (Pack) {
+      pStage = "Packing";
+      context.PackContainers();
+    }
+    else if (ListPack) {
+      pStage = "Listing shaders";
+      context.ListPackedShaders();
+    }
+    else if (!Unpack.empty()) {
+      pStage = "Unpacking";
+      if (!context.UnpackContainer(Unpack.c_str())) {
+        return 1;
+      }
+    }
     else if (!ExtractFile.empty()) {
       pStage = "Extracting files";
       if (!context.ExtractFile(ExtractFile.c_str())) {
@@ -42,6 +42,7 @@
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/WinFunctions.h"
 #include "dxc.h"
+#include "dxcserver.h"
 #include <vector>
 #include <string>
 
@@ -120,6 +121,7 @@ class DxcContext {
 private:
   DxcOpts &m_Opts;
   DxcDllSupport &m_dxcSupport;
+  bool m_DedupTableNeedsNewline = false; // /fdedup-table lacks a final newline.
 
   int ActOnBlob(IDxcBlob *pBlob);
   int ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugBlobName);
@@ -128,6 +130,9 @@ private:
   void WriteHeader(IDxcBlobEncoding *pDisassembly, IDxcBlob *pCode,
                    llvm::Twine &pVariableName, LPCWSTR pPath);
   HRESULT ReadFileIntoPartContent(hlsl::DxilFourCC fourCC, LPCWSTR fileName, IDxcBlob **ppResult);
+  void AddKnownFingerprints(std::vector<std::wstring> &argStrings);
+  void AppendFingerprintToTable(IDxcBlob *pBlob);
+  void CopyIdenticalOutput(llvm::StringRef IdenticalTo);
 
 // Dia is only supported on Windows.
 #ifdef _WIN32
@@ -157,6 +162,7 @@ public:
   int DumpBinary();
   void Preprocess();
   void GetCompilerVersionInfo(llvm::raw_string_ostream &OS);
+  void WarmUp();
 };
 
 static void WriteBlobToFile(_In_opt_ IDxcBlob *pBlob, llvm::StringRef FName) {
@@ -191,6 +197,34 @@ static void WritePartToFile(IDxcBlob *pBlob, hlsl::DxilFourCC CC,
   }
 }
 
+// Returns the fingerprint part of a compiled blob, or nullptr if there is none.
+static const hlsl::DxilShaderFingerprint *
+GetFingerprintPart(IDxcBlob *pBlob, const char **ppIdenticalTo) {
+  *ppIdenticalTo = nullptr;
+  const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+      pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  if (!pContainer)
+    return nullptr;
+  hlsl::DxilPartIterator it =
+      std::find_if(hlsl::begin(pContainer), hlsl::end(pContainer),
+                   hlsl::DxilPartIsType(hlsl::DFCC_ShaderFingerprint));
+  const hlsl::DxilShaderFingerprint *pFingerprint;
+  if (it == hlsl::end(pContainer) ||
+      !hlsl::GetDxilShaderFingerprint(*it, &pFingerprint, ppIdenticalTo))
+    return nullptr;
+  return pFingerprint;
+}
+
+static std::string FingerprintToHex(const hlsl::DxilShaderFingerprint &Fingerprint) {
+  static const char Digits[] = "0123456789abcdef";
+  std::string Hex;
+  for (uint8_t Byte : Fingerprint.Digest) {
+    Hex += Digits[Byte >> 4];
+    Hex += Digits[Byte & 0xf];
+  }
+  return Hex;
+}
+
 // This function is called either after the compilation is done or /dumpbin option is provided
 // Performing options that are used to process dxil container.
 int DxcContext::ActOnBlob(IDxcBlob *pBlob) {
@@ -205,6 +239,21 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugB
     return retVal;
   }
 
+  // A shader identical to a known fingerprint has no outputs of its own.
+  if (m_Opts.Dedup) {
+    const char *pIdenticalTo;
+    if (GetFingerprintPart(pBlob, &pIdenticalTo) && pIdenticalTo) {
+      std::string Message = m_Opts.InputFile.str() + " is identical to " +
+                            pIdenticalTo + "\n";
+      WriteUtf8ToConsoleSizeT(Message.data(), Message.size());
+      // The /Fo output is still written, as a copy of the identical shader.
+      if (!m_Opts.OutputObject.empty() &&
+          m_Opts.OutputObject != llvm::StringRef(pIdenticalTo))
+        CopyIdenticalOutput(pIdenticalTo);
+      return retVal;
+    }
+  }
+
   // Write the output blob.
   if (!m_Opts.OutputObject.empty()) {
     // For backward compatability: fxc requires /Fo for /extractrootsignature
@@ -212,6 +261,8 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugB
       CComPtr<IDxcBlob> pResult;
       UpdatePart(pBlob, &pResult);
       WriteBlobToFile(pResult, m_Opts.OutputObject);
+      if (!m_Opts.DedupTable.empty())
+        AppendFingerprintToTable(pBlob);
     }
   }
 
@@ -248,11 +299,16 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugB
     WritePartToFile(pBlob, hlsl::DFCC_PrivateData, m_Opts.ExtractPrivateFile);
   }
 
+  // Extract and write compile statistics.
+  if (!m_Opts.StatsFile.empty()) {
+    WritePartToFile(pBlob, hlsl::DFCC_CompileStatistics, m_Opts.StatsFile);
+  }
+
   // OutputObject suppresses console dump.
   bool needDisassembly =
       !m_Opts.OutputHeader.empty() || !m_Opts.AssemblyCode.empty() ||
       (m_Opts.OutputObject.empty() && m_Opts.DebugFile.empty() &&
-       m_Opts.ExtractPrivateFile.empty() &&
+       m_Opts.ExtractPrivateFile.empty() && m_Opts.StatsFile.empty() &&
        m_Opts.VerifyRootSignatureSource.empty() && !m_Opts.ExtractRootSignature);
 
   if (!needDisassembly)
@@ -332,6 +388,10 @@ void DxcContext::UpdatePart(IDxcBlob *pSource, IDxcBlob **ppResult) {
   if (m_Opts.StripRootSignature) {
     IFT(pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_RootSignature));
   }
+  if (!m_Opts.StatsFile.empty() && !m_Opts.StatsJson) {
+    // Statistics were only requested for /Fstats; keep them out of /Fo.
+    IFT(pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_CompileStatistics));
+  }
   if (!m_Opts.PrivateSource.empty()) {
     CComPtr<IDxcBlob> privateBlob;
     IFT(ReadFileIntoPartContent(hlsl::DxilFourCC::DFCC_PrivateData,
@@ -376,10 +436,81 @@ void DxcContext::UpdatePart(IDxcBlob *pSource, IDxcBlob **ppResult) {
   IFT(pBuilderResult->GetResult(ppResult));
 }
 
+// Reads the /fdedup-table file and passes each '<fingerprint> <name>' entry to
+// the compiler as a known fingerprint. A missing table is treated as empty.
+void DxcContext::AddKnownFingerprints(std::vector<std::wstring> &argStrings) {
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pTable;
+  IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  if (FAILED(pLibrary->CreateBlobFromFile(StringRefUtf16(m_Opts.DedupTable),
+                                          nullptr, &pTable)))
+    return;
+  llvm::StringRef TableText((const char *)pTable->GetBufferPointer(),
+                            pTable->GetBufferSize());
+  m_DedupTableNeedsNewline = !TableText.empty() && TableText.back() != '\n';
+
+  llvm::SmallVector<llvm::StringRef, 64> Lines;
+  TableText.split(Lines, "\n", -1, false);
+  for (llvm::StringRef Line : Lines) {
+    llvm::StringRef Fingerprint, Name;
+    std::tie(Fingerprint, Name) = Line.trim().split(' ');
+    Name = Name.trim();
+    if (Fingerprint.empty() || Fingerprint[0] == '#' || Name.empty())
+      continue;
+    argStrings.emplace_back(L"-fdedup-known");
+    argStrings.emplace_back(Unicode::UTF8ToUTF16StringOrThrow(
+        (Fingerprint + "=" + Name).str().c_str()));
+  }
+}
+
+// Records the fingerprint of a newly written /Fo output in the /fdedup-table
+// file so later permutations that optimize to the same module are skipped.
+// The entry is appended with a single write to a file opened for appending,
+// so concurrent builds sharing the table each add their line without
+// rewriting (and losing) the others'.
+void DxcContext::AppendFingerprintToTable(IDxcBlob *pBlob) {
+  const char *pIdenticalTo;
+  const hlsl::DxilShaderFingerprint *pFingerprint =
+      GetFingerprintPart(pBlob, &pIdenticalTo);
+  if (!pFingerprint)
+    return;
+  std::string Entry;
+  if (m_DedupTableNeedsNewline)
+    Entry += '\n';
+  Entry += FingerprintToHex(*pFingerprint) + " " + m_Opts.OutputObject.str() +
+           "\n";
+
+  StringRefUtf16 WideName(m_Opts.DedupTable);
+  CHandle file(CreateFileW(WideName, FILE_APPEND_DATA,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+  if (file == INVALID_HANDLE_VALUE) {
+    IFT_Data(HRESULT_FROM_WIN32(GetLastError()), WideName);
+  }
+  DWORD written;
+  if (FALSE == WriteFile(file, Entry.data(), Entry.size(), &written, nullptr)) {
+    IFT_Data(HRESULT_FROM_WIN32(GetLastError()), WideName);
+  }
+  m_DedupTableNeedsNewline = false;
+}
+
+// Writes the /Fo output of a shader found identical to a known one by copying
+// the known shader's output.
+void DxcContext::CopyIdenticalOutput(llvm::StringRef IdenticalTo) {
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pIdentical;
+  StringRefUtf16 WideName(IdenticalTo);
+  IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  IFT_Data(pLibrary->CreateBlobFromFile(WideName, nullptr, &pIdentical),
+           WideName);
+  WriteBlobToFile(pIdentical, m_Opts.OutputObject);
+}
+
 bool DxcContext::UpdatePartRequired() {
   return m_Opts.StripDebug || m_Opts.StripPrivate ||
     m_Opts.StripRootSignature || !m_Opts.PrivateSource.empty() ||
-    !m_Opts.RootSignatureSource.empty();
+    !m_Opts.RootSignatureSource.empty() ||
+    (!m_Opts.StatsFile.empty() && !m_Opts.StatsJson);
 }
 
 // This function reads the file from input file and constructs a blob with fourCC parts
@@ -734,6 +865,11 @@ int DxcContext::Compile() {
 
     std::vector<std::wstring> argStrings;
     CopyArgsToWStrings(m_Opts.Args, CoreOption, argStrings);
+    if (!m_Opts.DedupTable.empty()) {
+      m_Opts.Dedup = true;
+      argStrings.emplace_back(L"-fdedup");
+      AddKnownFingerprints(argStrings);
+    }
 
     std::vector<LPCWSTR> args;
     args.reserve(argStrings.size());
@@ -743,6 +879,10 @@ int DxcContext::Compile() {
     if (m_Opts.AstDump)
       args.push_back(L"-ast-dump");
 
+    // /Fstats is a driver option; ask the compiler for the statistics part.
+    if (!m_Opts.StatsFile.empty() && !m_Opts.StatsJson)
+      args.push_back(L"-fstats-json");
+
     CComPtr<IDxcLibrary> pLibrary;
     IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
     IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
@@ -1111,18 +1251,35 @@ void DxcContext::GetCompilerVersionInfo(llvm::raw_string_ostream &OS) {
   }
 }
 
+// Compiles a small shader, so that the compiler and validator are loaded and
+// initialized before a server starts taking requests.
+void DxcContext::WarmUp() {
+  static const char WarmUpSource[] = "float4 main() : SV_Target { return 0; }";
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  IFT(m_dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  IFT(pLibrary->CreateBlobWithEncodingFromPinned(
+      WarmUpSource, sizeof(WarmUpSource) - 1, CP_UTF8, &pSource));
+  IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(pCompiler->Compile(pSource, L"warmup.hlsl", L"main", L"ps_6_0", nullptr,
+                         0, nullptr, 0, nullptr, &pResult));
+}
+
+// Runs one command line. bServerRequest is set when a compile server runs it
+// on behalf of a client.
 #ifdef _WIN32
-int dxc::main(int argc, const wchar_t **argv_) {
+static int RunCommand(int argc, const wchar_t **argv_, bool bServerRequest) {
 #else
-int dxc::main(int argc, const char **argv_) {
+static int RunCommand(int argc, const char **argv_, bool bServerRequest) {
 #endif // _WIN32
   const char *pStage = "Operation";
   int retVal = 0;
-  if (FAILED(DxcInitThreadMalloc())) return 1;
-  DxcSetThreadMallocToDefault();
   try {
     pStage = "Argument processing";
-    if (initHlslOptTable()) throw std::bad_alloc();
+    if (getHlslOptTable() == nullptr && initHlslOptTable())
+      throw std::bad_alloc();
 
     // Parse command line options.
     const OptTable *optionTable = getHlslOptTable();
@@ -1145,6 +1302,28 @@ int dxc::main(int argc, const char **argv_) {
       }
     }
 
+    if (bServerRequest && !dxcOpts.ServerSocket.empty()) {
+      fprintf(stderr, "dxc failed : A compile server cannot be started by a "
+                      "request to another.\n");
+      return 1;
+    }
+
+#ifndef _WIN32
+    // Hand the command line to a compile server if one is listening. The
+    // options have been checked already, so errors in them are reported
+    // without a round trip.
+    if (!bServerRequest && dxcOpts.ServerSocket.empty()) {
+      llvm::StringRef socketPath = dxcOpts.ConnectSocket;
+      const char *pEnvSocket = getenv("DXC_SERVER");
+      if (socketPath.empty() && pEnvSocket != nullptr)
+        socketPath = pEnvSocket;
+      int exitCode;
+      if (!socketPath.empty() &&
+          RunClient(socketPath, argc, argv_, &exitCode))
+        return exitCode;
+    }
+#endif // _WIN32
+
     // Apply defaults.
     if (dxcOpts.EntryPoint.empty() && !dxcOpts.RecompileFromBinary) {
       dxcOpts.EntryPoint = "main";
@@ -1180,6 +1359,21 @@ int dxc::main(int argc, const char **argv_) {
       return 0;
     }
 
+    if (!dxcOpts.ServerSocket.empty()) {
+#ifdef _WIN32
+      fprintf(stderr, "dxc failed : -server is not supported on this "
+                      "platform.\n");
+      return 1;
+#else
+      pStage = "Server startup";
+      context.WarmUp();
+      pStage = "Server";
+      return RunServer(dxcOpts.ServerSocket, [](int argc, const char **argv) {
+        return RunCommand(argc, argv, /*bServerRequest*/ true);
+      });
+#endif // _WIN32
+    }
+
     // TODO: implement all other actions.
     if (!dxcOpts.Preprocess.empty()) {
       pStage = "Preprocessing";
@@ -1246,3 +1440,13 @@ int dxc::main(int argc, const char **argv_) {
 
   return retVal;
 }
+
+#ifdef _WIN32
+int dxc::main(int argc, const wchar_t **argv_) {
+#else
+int dxc::main(int argc, const char **argv_) {
+#endif // _WIN32
+  if (FAILED(DxcInitThreadMalloc())) return 1;
+  DxcSetThreadMallocToDefault();
+  return RunCommand(argc, argv_, /*bServerRequest*/ false);
+}
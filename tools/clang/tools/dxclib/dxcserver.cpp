@@ -0,0 +1,420 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcserver.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the compile server and client modes of the dxc console program.//
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+#include "dxcserver.h"
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+// Protocol. A client connects and sends a single request:
+//
+//   uint32 magic, uint32 version, uint32 string count
+//   for each string: uint32 length, then that many bytes of UTF-8
+//
+// The first string is the working directory of the client and the rest are
+// its command line, starting with the program name. The standard output and
+// error descriptors of the client are passed along with the header as
+// SCM_RIGHTS ancillary data, so the request streams its messages and
+// disassembly straight to the console of the client while it runs. When it
+// is done, the server sends back the exit code as a uint32 and closes the
+// connection. Both ends are on one machine, so integers are in host order.
+//
+// Requests name their input and output files as they would on the command
+// line; the server reads and writes them directly, from the working
+// directory of the client. It does so with its own rights, so the socket is
+// only accessible to its owner and connections from other users are
+// rejected.
+
+namespace {
+
+const uint32_t kRequestMagic = 0x53435844; // 'DXCS'
+const uint32_t kProtocolVersion = 1;
+const uint32_t kMaxStringCount = 4 * 1024;
+const uint32_t kMaxStringLength = 64 * 1024;
+const uint32_t kMaxRequestLength = 1024 * 1024;
+
+// Requests reaped by OnChildExit that the server loop has not counted yet.
+// Only changed by the loop while SIGCHLD is blocked.
+volatile sig_atomic_t g_ReapedCount = 0;
+
+void OnChildExit(int) {
+  int savedErrno = errno;
+  while (waitpid(-1, nullptr, WNOHANG) > 0)
+    g_ReapedCount = g_ReapedCount + 1;
+  errno = savedErrno;
+}
+
+struct RequestHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t StringCount;
+};
+
+bool ReadAll(int fd, void *pData, size_t size) {
+  char *pBytes = (char *)pData;
+  while (size > 0) {
+    ssize_t count = read(fd, pBytes, size);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    pBytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+bool WriteAll(int fd, const void *pData, size_t size) {
+  const char *pBytes = (const char *)pData;
+  while (size > 0) {
+    ssize_t count = write(fd, pBytes, size);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    pBytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+bool InitSocketAddress(StringRef socketPath, sockaddr_un &addr) {
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(addr.sun_path))
+    return false;
+  memcpy(addr.sun_path, socketPath.data(), socketPath.size());
+  return true;
+}
+
+// Returns true if the process on the other end of the connection runs as
+// the same user as this one.
+bool IsPeerSameUser(int fd) {
+#ifdef __linux__
+  ucred cred;
+  socklen_t length = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) != 0 ||
+      length != sizeof(cred))
+    return false;
+  return cred.uid == geteuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  if (getpeereid(fd, &uid, &gid) != 0)
+    return false;
+  return uid == geteuid();
+#endif
+}
+
+union OutputFdsControl {
+  cmsghdr Align;
+  char Buffer[CMSG_SPACE(sizeof(int) * 2)];
+};
+
+// Receives the request header along with the output descriptors of the
+// client.
+bool ReceiveHeader(int fd, RequestHeader &header, int (&outputFds)[2]) {
+  iovec iov = {&header, sizeof(header)};
+  OutputFdsControl control;
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.Buffer;
+  msg.msg_controllen = sizeof(control.Buffer);
+  ssize_t count;
+  do {
+    count = recvmsg(fd, &msg, 0);
+  } while (count < 0 && errno == EINTR);
+  if (count <= 0)
+    return false;
+
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 2))
+    return false;
+  memcpy(outputFds, CMSG_DATA(cmsg), sizeof(int) * 2);
+
+  // The rest of the header may arrive separately.
+  return ReadAll(fd, (char *)&header + count, sizeof(header) - count);
+}
+
+// Sends the request header along with the output descriptors of this
+// process.
+bool SendHeader(int fd, const RequestHeader &header) {
+  int outputFds[2] = {STDOUT_FILENO, STDERR_FILENO};
+  iovec iov = {const_cast<RequestHeader *>(&header), sizeof(header)};
+  OutputFdsControl control;
+  memset(&control, 0, sizeof(control));
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.Buffer;
+  msg.msg_controllen = sizeof(control.Buffer);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(outputFds));
+  memcpy(CMSG_DATA(cmsg), outputFds, sizeof(outputFds));
+  ssize_t count;
+  do {
+    count = sendmsg(fd, &msg, 0);
+  } while (count < 0 && errno == EINTR);
+  if (count <= 0)
+    return false;
+  return WriteAll(fd, (const char *)&header + count, sizeof(header) - count);
+}
+
+void AppendString(std::string &payload, StringRef value) {
+  uint32_t length = value.size();
+  payload.append((const char *)&length, sizeof(length));
+  payload.append(value.data(), value.size());
+}
+
+// Runs one request in a forked process. Any failure to read the request
+// simply closes the connection, which the client reports.
+void ServeRequest(int connFd, const dxc::ServerCommandFn &runCommand) {
+  RequestHeader header;
+  int outputFds[2];
+  if (!ReceiveHeader(connFd, header, outputFds))
+    return;
+  if (header.Magic != kRequestMagic || header.Version != kProtocolVersion ||
+      header.StringCount < 2 || header.StringCount > kMaxStringCount)
+    return;
+  std::vector<std::string> strings(header.StringCount);
+  uint32_t requestLength = 0;
+  for (std::string &value : strings) {
+    uint32_t length;
+    if (!ReadAll(connFd, &length, sizeof(length)) ||
+        length > kMaxStringLength ||
+        length > kMaxRequestLength - requestLength)
+      return;
+    requestLength += length;
+    value.resize(length);
+    if (length > 0 && !ReadAll(connFd, &value[0], length))
+      return;
+  }
+
+  int exitCode = 1;
+  if (dup2(outputFds[0], STDOUT_FILENO) < 0 ||
+      dup2(outputFds[1], STDERR_FILENO) < 0)
+    return;
+  close(outputFds[0]);
+  close(outputFds[1]);
+  if (chdir(strings[0].c_str()) != 0) {
+    fprintf(stderr, "dxc failed : cannot change to directory '%s'.\n",
+            strings[0].c_str());
+  } else {
+    std::vector<const char *> argv;
+    for (size_t i = 1; i < strings.size(); ++i)
+      argv.push_back(strings[i].c_str());
+    exitCode = runCommand((int)argv.size(), argv.data());
+  }
+  fflush(stdout);
+  fflush(stderr);
+
+  uint32_t result = (uint32_t)exitCode;
+  WriteAll(connFd, &result, sizeof(result));
+}
+
+} // namespace
+
+int dxc::RunServer(StringRef socketPath, const ServerCommandFn &runCommand) {
+  sockaddr_un addr;
+  if (!InitSocketAddress(socketPath, addr)) {
+    fprintf(stderr, "dxc failed : socket path '%s' is too long.\n",
+            socketPath.str().c_str());
+    return 1;
+  }
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    fprintf(stderr, "dxc failed : cannot create socket: %s.\n",
+            strerror(errno));
+    return 1;
+  }
+  // Take over the socket left behind by a server that did not shut down,
+  // but nothing else that may be at that path. Nobody listens on a stale
+  // socket, so connecting to it is refused.
+  struct stat existing;
+  if (lstat(addr.sun_path, &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      fprintf(stderr, "dxc failed : '%s' exists and is not a socket.\n",
+              addr.sun_path);
+      close(listenFd);
+      return 1;
+    }
+    int probeFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int probeResult =
+        probeFd < 0 ? -1 : connect(probeFd, (sockaddr *)&addr, sizeof(addr));
+    int probeErrno = errno;
+    if (probeFd >= 0)
+      close(probeFd);
+    if (probeResult == 0) {
+      fprintf(stderr, "dxc failed : a server is already listening on '%s'.\n",
+              addr.sun_path);
+      close(listenFd);
+      return 1;
+    }
+    if (probeErrno != ECONNREFUSED) {
+      fprintf(stderr, "dxc failed : cannot check the socket at '%s': %s.\n",
+              addr.sun_path, strerror(probeErrno));
+      close(listenFd);
+      return 1;
+    }
+    unlink(addr.sun_path);
+  }
+  // Requests run with the rights of this process, so only its owner may
+  // connect. The umask covers the window between bind and chmod.
+  mode_t priorMask = umask(S_IRWXG | S_IRWXO);
+  int bindResult = bind(listenFd, (sockaddr *)&addr, sizeof(addr));
+  umask(priorMask);
+  if (bindResult != 0 || chmod(addr.sun_path, S_IRUSR | S_IWUSR) != 0 ||
+      listen(listenFd, SOMAXCONN) != 0) {
+    fprintf(stderr, "dxc failed : cannot listen on '%s': %s.\n",
+            addr.sun_path, strerror(errno));
+    close(listenFd);
+    return 1;
+  }
+  // A client that goes away must not take the server down with it.
+  signal(SIGPIPE, SIG_IGN);
+
+  // Finished requests are reaped as soon as they exit, even while the server
+  // waits for a connection. SIGCHLD is blocked except while waiting, so the
+  // count of running requests is only updated here.
+  sigset_t childMask, waitMask;
+  sigemptyset(&childMask);
+  sigaddset(&childMask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &childMask, &waitMask);
+  sigdelset(&waitMask, SIGCHLD);
+  struct sigaction childAction;
+  memset(&childAction, 0, sizeof(childAction));
+  childAction.sa_handler = OnChildExit;
+  sigemptyset(&childAction.sa_mask);
+  childAction.sa_flags = SA_NOCLDSTOP;
+  sigaction(SIGCHLD, &childAction, nullptr);
+
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned maxRunning = processors > 0 ? (unsigned)processors : 1;
+  unsigned running = 0;
+  for (;;) {
+    // Count finished requests, waiting for one while all slots are busy.
+    OnChildExit(SIGCHLD);
+    for (;;) {
+      running -= std::min<unsigned>(running, g_ReapedCount);
+      g_ReapedCount = 0;
+      if (running < maxRunning)
+        break;
+      sigsuspend(&waitMask);
+    }
+
+    sigprocmask(SIG_SETMASK, &waitMask, nullptr);
+    int connFd = accept(listenFd, nullptr, nullptr);
+    int acceptErrno = errno;
+    sigprocmask(SIG_BLOCK, &childMask, nullptr);
+    if (connFd < 0) {
+      errno = acceptErrno;
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      fprintf(stderr, "dxc failed : cannot accept a connection: %s.\n",
+              strerror(errno));
+      close(listenFd);
+      return 1;
+    }
+    if (!IsPeerSameUser(connFd)) {
+      close(connFd);
+      continue;
+    }
+
+    // Do not let the request inherit output buffered in this process.
+    fflush(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(listenFd);
+      signal(SIGCHLD, SIG_DFL);
+      sigprocmask(SIG_SETMASK, &waitMask, nullptr);
+      ServeRequest(connFd, runCommand);
+      _exit(0);
+    }
+    // If the fork failed, closing the connection tells the client.
+    if (pid > 0)
+      ++running;
+    close(connFd);
+  }
+}
+
+bool dxc::RunClient(StringRef socketPath, int argc, const char **argv,
+                    int *pExitCode) {
+  sockaddr_un addr;
+  if (!InitSocketAddress(socketPath, addr))
+    return false;
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, sizeof(cwd)) == nullptr)
+    return false;
+
+  // Leave command lines the server would refuse to this process.
+  if ((uint32_t)argc + 1 > kMaxStringCount)
+    return false;
+  std::string payload;
+  AppendString(payload, cwd);
+  uint32_t requestLength = strlen(cwd);
+  for (int i = 0; i < argc; ++i) {
+    uint32_t length = strlen(argv[i]);
+    if (length > kMaxStringLength || length > kMaxRequestLength - requestLength)
+      return false;
+    requestLength += length;
+    AppendString(payload, argv[i]);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return false;
+  }
+
+  // Once the request is sent, it may run, so from here on errors are
+  // reported rather than falling back to compiling in this process.
+  signal(SIGPIPE, SIG_IGN);
+  RequestHeader header = {kRequestMagic, kProtocolVersion,
+                          (uint32_t)argc + 1};
+  uint32_t result;
+  if (!SendHeader(fd, header) ||
+      !WriteAll(fd, payload.data(), payload.size()) ||
+      !ReadAll(fd, &result, sizeof(result))) {
+    fprintf(stderr, "dxc failed : lost the connection to the compile "
+                    "server at '%s'.\n",
+            addr.sun_path);
+    result = 1;
+  }
+  close(fd);
+  *pExitCode = (int)result;
+  return true;
+}
+
+#endif // _WIN32
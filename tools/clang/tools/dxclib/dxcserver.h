@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcserver.h                                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the compile server and client modes of the dxc console program.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef __DXC_DXCSERVER__
+#define __DXC_DXCSERVER__
+
+#include "llvm/ADT/StringRef.h"
+#include <functional>
+
+namespace dxc {
+
+#ifndef _WIN32
+/// Runs a command line on behalf of a client, with the client's working
+/// directory and standard output and error already in place.
+typedef std::function<int(int argc, const char **argv)> ServerCommandFn;
+
+/// Listens on the Unix domain socket at socketPath and runs each request in
+/// a process forked from this one, so requests start with the compiler
+/// already loaded and initialized. At most one request per processor runs at
+/// a time. The socket is only accessible to the user running the server, and
+/// connections from other users are dropped. A socket left behind at
+/// socketPath is replaced, unless a server still listens on it. Only returns
+/// if the socket cannot be set up.
+int RunServer(llvm::StringRef socketPath, const ServerCommandFn &runCommand);
+
+/// Sends the command line to the server listening at socketPath and waits
+/// for it to run. Returns false without side effects if no server accepts
+/// the connection or the command line is too large for a request, so the
+/// caller can run the command itself.
+bool RunClient(llvm::StringRef socketPath, int argc, const char **argv,
+               int *pExitCode);
+#endif // _WIN32
+
+} // namespace dxc
+
+#endif // __DXC_DXCSERVER__
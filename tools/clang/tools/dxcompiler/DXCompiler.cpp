@@ -11,12 +11,15 @@
 
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/IR/LegacyPassManagers.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/HLSLOptions.h"
 #ifdef LLVM_ON_WIN32
 #include "dxcetw.h"
 #endif
+#include "dxc/Support/DxcTrace.h"
+#include "dxc/Support/DxcMemoryAccounting.h"
 #include "dxillib.h"
 
 namespace hlsl {
@@ -28,24 +31,135 @@ HRESULT SetupRegistryPassForPIX();
 #pragma warning( disable : 4290 )
 
 #ifdef LLVM_ON_WIN32
-// operator new and friends.
-void *  __CRTDECL operator new(std::size_t size) throw(std::bad_alloc) {
-  void * ptr = DxcGetThreadMallocNoRef()->Alloc(size);
+#define DXC_NEW_DECL __CRTDECL
+#else
+#define DXC_NEW_DECL
+#endif
+
+// operator new and friends, in every form, allocate through the thread
+// allocator on Windows and with malloc elsewhere (as memory crosses the
+// library boundary), and are charged to the thread's
+// DxcMemoryAccountingScope.
+static void *DxcNewOrThrow(std::size_t size) {
+  void *ptr = DxcAccountedNew(size);
   if (ptr == nullptr)
     throw std::bad_alloc();
   return ptr;
 }
-void * __CRTDECL operator new(std::size_t size,
-  const std::nothrow_t &nothrow_value) throw() {
-  return DxcGetThreadMallocNoRef()->Alloc(size);
+void *DXC_NEW_DECL operator new(std::size_t size) {
+  return DxcNewOrThrow(size);
 }
-void  __CRTDECL operator delete (void* ptr) throw() {
-  DxcGetThreadMallocNoRef()->Free(ptr);
+void *DXC_NEW_DECL operator new[](std::size_t size) {
+  return DxcNewOrThrow(size);
 }
-void  __CRTDECL operator delete (void* ptr, const std::nothrow_t& nothrow_constant) throw() {
-  DxcGetThreadMallocNoRef()->Free(ptr);
+void *DXC_NEW_DECL operator new(std::size_t size,
+                                const std::nothrow_t &nothrow_value) throw() {
+  return DxcAccountedNew(size);
+}
+void *DXC_NEW_DECL operator new[](std::size_t size,
+                                  const std::nothrow_t &nothrow_value) throw() {
+  return DxcAccountedNew(size);
+}
+void DXC_NEW_DECL operator delete(void *ptr) throw() {
+  DxcAccountedDelete(ptr);
+}
+void DXC_NEW_DECL operator delete[](void *ptr) throw() {
+  DxcAccountedDelete(ptr);
+}
+void DXC_NEW_DECL operator delete(void *ptr,
+                                  const std::nothrow_t &nothrow_constant) throw() {
+  DxcAccountedDelete(ptr);
+}
+void DXC_NEW_DECL operator delete[](void *ptr,
+                                    const std::nothrow_t &nothrow_constant) throw() {
+  DxcAccountedDelete(ptr);
+}
+void DXC_NEW_DECL operator delete(void *ptr, std::size_t size) throw() {
+  DxcAccountedDelete(ptr);
+}
+void DXC_NEW_DECL operator delete[](void *ptr, std::size_t size) throw() {
+  DxcAccountedDelete(ptr);
+}
+
+#ifdef __cpp_aligned_new
+static void *DxcNewAlignedOrThrow(std::size_t size, std::align_val_t align) {
+  void *ptr = DxcAccountedNewAligned(size, (std::size_t)align);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void *DXC_NEW_DECL operator new(std::size_t size, std::align_val_t align) {
+  return DxcNewAlignedOrThrow(size, align);
+}
+void *DXC_NEW_DECL operator new[](std::size_t size, std::align_val_t align) {
+  return DxcNewAlignedOrThrow(size, align);
+}
+void *DXC_NEW_DECL operator new(std::size_t size, std::align_val_t align,
+                                const std::nothrow_t &nothrow_value) noexcept {
+  return DxcAccountedNewAligned(size, (std::size_t)align);
+}
+void *DXC_NEW_DECL operator new[](std::size_t size, std::align_val_t align,
+                                  const std::nothrow_t &nothrow_value) noexcept {
+  return DxcAccountedNewAligned(size, (std::size_t)align);
+}
+void DXC_NEW_DECL operator delete(void *ptr, std::align_val_t align) noexcept {
+  DxcAccountedDeleteAligned(ptr);
+}
+void DXC_NEW_DECL operator delete[](void *ptr, std::align_val_t align) noexcept {
+  DxcAccountedDeleteAligned(ptr);
+}
+void DXC_NEW_DECL operator delete(void *ptr, std::align_val_t align,
+                                  const std::nothrow_t &nothrow_constant) noexcept {
+  DxcAccountedDeleteAligned(ptr);
+}
+void DXC_NEW_DECL operator delete[](void *ptr, std::align_val_t align,
+                                    const std::nothrow_t &nothrow_constant) noexcept {
+  DxcAccountedDeleteAligned(ptr);
+}
+void DXC_NEW_DECL operator delete(void *ptr, std::size_t size,
+                                  std::align_val_t align) noexcept {
+  DxcAccountedDeleteAligned(ptr);
+}
+void DXC_NEW_DECL operator delete[](void *ptr, std::size_t size,
+                                    std::align_val_t align) noexcept {
+  DxcAccountedDeleteAligned(ptr);
+}
+#endif // __cpp_aligned_new
+
+// Reports each optimization pass run as a trace event.
+static void TracePassRun(const char *PassName, bool Begin) {
+  if (Begin)
+    DxcTraceBegin(PassName);
+  else
+    DxcTraceEnd(PassName);
+}
+
+// Registers the passes and builds the option table. Only compiling,
+// preprocessing, optimizing, linking and rewriting need these, so they are
+// set up on first use rather than when the library is loaded, which keeps
+// short-lived processes and users of the other APIs from paying for them.
+static HRESULT InitCompilerComponents() throw() {
+  // Reported separately from DXCompilerInitialization, so the cost moved out
+  // of library load can still be measured.
+  DxcTraceScope TraceScope("DXCompilerComponentsInitialization");
+  // These live until the library is unloaded, so allocate them from the
+  // default allocator rather than the caller's.
+  DxcThreadMalloc TM(nullptr);
+  HRESULT hr;
+  IFC(hlsl::SetupRegistryPassForHLSL());
+  IFC(hlsl::SetupRegistryPassForPIX());
+  IFCBOOL(!hlsl::options::initHlslOptTable(), E_FAIL);
+  ::llvm::setPassTraceCallback(TracePassRun);
+Cleanup:
+  TraceScope.SetStatus(hr);
+  return hr;
+}
+
+HRESULT DxcInitializeCompilerComponents() throw() {
+  // Initialization of function-local statics is thread-safe.
+  static const HRESULT hr = InitCompilerComponents();
+  return hr;
 }
-#endif
 
 static HRESULT InitMaybeFail() throw() {
   HRESULT hr;
@@ -58,13 +172,7 @@ static HRESULT InitMaybeFail() throw() {
     goto Cleanup;
   }
   fsSetup = true;
-  IFC(hlsl::SetupRegistryPassForHLSL());
-  IFC(hlsl::SetupRegistryPassForPIX());
   IFC(DxilLibInitialize());
-  if (hlsl::options::initHlslOptTable()) {
-    hr = E_FAIL;
-    goto Cleanup;
-  }
 Cleanup:
   if (FAILED(hr)) {
     if (fsSetup) {
@@ -82,22 +190,30 @@ Cleanup:
 }
 #if defined(LLVM_ON_UNIX)
 HRESULT __attribute__ ((constructor)) DllMain() {
-  return InitMaybeFail();
+  DxcTraceInitialize();
+  DxcEtw_DXCompilerInitialization_Start();
+  HRESULT hr = InitMaybeFail();
+  DxcEtw_DXCompilerInitialization_Stop(hr);
+  return hr;
 }
 
 void __attribute__ ((destructor)) DllShutdown() {
+  DxcEtw_DXCompilerShutdown_Start();
   DxcSetThreadMallocToDefault();
   ::hlsl::options::cleanupHlslOptTable();
   ::llvm::sys::fs::CleanupPerThreadFileSystem();
   ::llvm::llvm_shutdown();
   DxcClearThreadMalloc();
   DxcCleanupThreadMalloc();
+  DxcEtw_DXCompilerShutdown_Stop(S_OK);
+  DxcTraceShutdown();
 }
 #else // LLVM_ON_UNIX
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD Reason, LPVOID reserved) {
   BOOL result = TRUE;
   if (Reason == DLL_PROCESS_ATTACH) {
     EventRegisterMicrosoft_Windows_DXCompiler_API();
+    DxcTraceInitialize();
     DxcEtw_DXCompilerInitialization_Start();
     DisableThreadLibraryCalls(hinstDLL);
     HRESULT hr = InitMaybeFail();
@@ -118,6 +234,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD Reason, LPVOID reserved) {
     DxcClearThreadMalloc();
     DxcCleanupThreadMalloc();
     DxcEtw_DXCompilerShutdown_Stop(S_OK);
+    DxcTraceShutdown();
     EventUnregisterMicrosoft_Windows_DXCompiler_API();
   }
 
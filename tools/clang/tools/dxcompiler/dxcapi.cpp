@@ -23,6 +23,7 @@
 #ifdef _WIN32
 #include "dxcetw.h"
 #endif
+#include "dxc/Support/DxcTrace.h"
 #include "dxillib.h"
 #include <memory>
 
@@ -30,11 +31,14 @@
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLibrary)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBlobEncoding)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOperationResult)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOperationResultMemoryUsage)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcAssembler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBlob)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler3)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompilerArgs)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcValidator)
@@ -44,6 +48,11 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSense)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSenseCallback)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSenseOperation)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIndexAsync)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcTranslationUnit2)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcTranslationUnitAsync)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLinker)
 
 HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -56,6 +65,7 @@ HRESULT CreateDxcAssembler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT DxcInitializeCompilerComponents() throw();
 
 namespace hlsl {
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
@@ -96,7 +106,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
     hr = CreateDxcAssembler(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcOptimizer)) {
-    hr = CreateDxcOptimizer(riid, ppv);
+    hr = DxcInitializeCompilerComponents();
+    if (SUCCEEDED(hr))
+      hr = CreateDxcOptimizer(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcIntelliSense)) {
     hr = CreateDxcIntelliSense(riid, ppv);
@@ -104,7 +116,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
 // Note: The following targets are not yet enabled for non-Windows platforms.
 #ifdef _WIN32
   else if (IsEqualCLSID(rclsid, CLSID_DxcRewriter)) {
-    hr = CreateDxcRewriter(riid, ppv);
+    hr = DxcInitializeCompilerComponents();
+    if (SUCCEEDED(hr))
+      hr = CreateDxcRewriter(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcDiaDataSource)) {
     hr = CreateDxcDiaDataSource(riid, ppv);
@@ -113,7 +127,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
     hr = CreateDxcContainerReflection(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcLinker)) {
-    hr = CreateDxcLinker(riid, ppv);
+    hr = DxcInitializeCompilerComponents();
+    if (SUCCEEDED(hr))
+      hr = CreateDxcLinker(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder)) {
     hr = CreateDxcContainerBuilder(riid, ppv);
@@ -159,3 +175,11 @@ DxcCreateInstance2(
   DxcEtw_DXCompilerCreateInstance_Stop(hr);
   return hr;
 }
+
+DXC_API_IMPORT HRESULT __stdcall
+DxcSetTraceCallback(
+  _In_opt_ DxcTraceCallbackProc pCallback,
+  _In_opt_ void                 *pUserData) {
+  DxcSetTraceCallbackImpl(pCallback, pUserData);
+  return S_OK;
+}
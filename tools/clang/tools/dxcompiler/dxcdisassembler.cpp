@@ -1613,6 +1613,18 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       Stream << "\n";
     }
 
+    it = std::find_if(begin(pContainer), end(pContainer),
+                      DxilPartIsType(DFCC_CompileStatistics));
+    if (it != end(pContainer)) {
+      StringRef Stats(GetDxilPartData(*it), (*it)->PartSize);
+      Stream << "; Compile statistics:\n";
+      SmallVector<StringRef, 64> Lines;
+      Stats.rtrim().split(Lines, "\n");
+      for (StringRef Line : Lines)
+        Stream << "; " << Line << "\n";
+      Stream << ";\n";
+    }
+
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_DXIL));
     if (it == end(pContainer)) {
@@ -72,7 +72,8 @@ enum class HandleKind {
   Special = 0,
   File = 1,
   FileDir = 2,
-  SearchDir = 3
+  SearchDir = 3,
+  FileMapping = 4
 };
 enum class SpecialValue {
   Unknown = 0,
@@ -123,8 +124,9 @@ struct DxcArgsHandle {
            (GetSpecialValue() == SpecialValue::StdErr ||
             GetSpecialValue() == SpecialValue::StdOut);
   }
+  bool IsFileMappingKind() const { return GetKind() == HandleKind::FileMapping; }
   unsigned GetFileIndex() const {
-    DXASSERT_NOMSG(IsFileKind());
+    DXASSERT_NOMSG(IsFileKind() || IsFileMappingKind());
     return Bits.Offset;
   }
   SpecialValue GetSpecialValue() const {
@@ -232,12 +234,27 @@ private:
 
   // Some constraints of the current design: opening the same file twice
   // will return the same handle/structure, and thus the same file pointer.
+  //
+  // A blob that ends in a null terminator is exposed without it. Clang needs
+  // a null after the contents of a file to use its memory in place, so only
+  // those blobs can be mapped; the others are read into a copy.
   struct IncludedFile {
     CComPtr<IDxcBlob> Blob;
     CComPtr<IStream> BlobStream;
     std::wstring Name;
+    size_t Size;
+    bool NullTerminated;
     IncludedFile(std::wstring &&name, IDxcBlob *pBlob, IStream *pStream)
-      : Blob(pBlob), BlobStream(pStream), Name(name) { }
+      : Blob(pBlob), BlobStream(pStream), Name(name) {
+      Size = pBlob->GetBufferSize();
+      NullTerminated =
+          Size > 0 && ((const char *)pBlob->GetBufferPointer())[Size - 1] == '\0';
+      if (NullTerminated)
+        --Size;
+    }
+    const char *GetData() const {
+      return (const char *)Blob->GetBufferPointer();
+    }
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
 
@@ -327,6 +344,9 @@ private:
   bool IsKnownHandle(HANDLE h) const {
     return !DxcArgsHandle(h).IsSpecialUnknown();
   }
+  static HANDLE IncludedFileIndexToMappingHandle(size_t index) {
+    return DxcArgsHandle(HandleKind::FileMapping, index, 0).Handle;
+  }
   IncludedFile &HandleToIncludedFile(HANDLE handle) {
     DxcArgsHandle argsHandle(handle);
     DXASSERT_NOMSG(argsHandle.GetFileIndex() < m_includedFiles.size());
@@ -481,7 +501,7 @@ public:
     if (argsHandle.IsFileKind()) {
       IncludedFile &file = HandleToIncludedFile(hFile);
       lpFileInformation->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
-      lpFileInformation->nFileSizeLow = file.Blob->GetBufferSize();
+      lpFileInformation->nFileSizeLow = file.Size;
       return TRUE;
     }
     if (argsHandle == OutputHandle) {
@@ -615,8 +635,19 @@ public:
     _In_      DWORD flProtect,
     _In_      DWORD dwMaximumSizeHigh,
     _In_      DWORD dwMaximumSizeLow) throw() override {
-    SetLastError(ERROR_NOT_CAPABLE);
-    return INVALID_HANDLE_VALUE;
+    // Included files can be mapped read-only, as views of their blobs.
+    DxcArgsHandle argsHandle(hFile);
+    uint64_t maximumSize = ((uint64_t)dwMaximumSizeHigh << 32) | dwMaximumSizeLow;
+    if (!argsHandle.IsFileKind() || flProtect != PAGE_READONLY) {
+      SetLastError(ERROR_NOT_CAPABLE);
+      return nullptr;
+    }
+    IncludedFile &file = HandleToIncludedFile(hFile);
+    if (!file.NullTerminated || maximumSize > file.Size) {
+      SetLastError(ERROR_NOT_CAPABLE);
+      return nullptr;
+    }
+    return IncludedFileIndexToMappingHandle(argsHandle.GetFileIndex());
   }
   LPVOID MapViewOfFile(
     _In_  HANDLE hFileMappingObject,
@@ -624,11 +655,29 @@ public:
     _In_  DWORD dwFileOffsetHigh,
     _In_  DWORD dwFileOffsetLow,
     _In_  SIZE_T dwNumberOfBytesToMap) throw() override {
-    SetLastError(ERROR_NOT_CAPABLE);
-    return nullptr;
+    DxcArgsHandle argsHandle(hFileMappingObject);
+    if (!argsHandle.IsFileMappingKind() || dwDesiredAccess != FILE_MAP_READ) {
+      SetLastError(ERROR_NOT_CAPABLE);
+      return nullptr;
+    }
+    IncludedFile &file = HandleToIncludedFile(hFileMappingObject);
+    uint64_t offset = ((uint64_t)dwFileOffsetHigh << 32) | dwFileOffsetLow;
+    if (dwNumberOfBytesToMap == 0 || offset > file.Size ||
+        dwNumberOfBytesToMap > file.Size - offset) {
+      SetLastError(ERROR_INVALID_PARAMETER);
+      return nullptr;
+    }
+    // The blob stays alive with the file system, so views need no tracking.
+    return const_cast<char *>(file.GetData()) + offset;
   }
   BOOL UnmapViewOfFile(_In_ LPCVOID lpBaseAddress) throw() override {
-    SetLastError(ERROR_NOT_CAPABLE);
+    for (const IncludedFile &file : m_includedFiles) {
+      if (lpBaseAddress >= file.GetData() &&
+          lpBaseAddress < file.GetData() + file.Size) {
+        return TRUE;
+      }
+    }
+    SetLastError(ERROR_INVALID_PARAMETER);
     return FALSE;
   }
 
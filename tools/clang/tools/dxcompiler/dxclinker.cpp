@@ -19,7 +19,9 @@
 #include "dxc/dxcapi.h"
 #include "dxillib.h"
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include <algorithm>
 
 #include "dxc/HLSL/DxilLinker.h"
@@ -29,10 +31,13 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxcutil.h"
 #include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/Version.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "dxc/Support/HLSLOptions.h"
@@ -92,9 +97,8 @@ public:
   }
 
   void Initialize() {
-    UINT32 valMajor, valMinor;
-    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
-    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, valMajor, valMinor));
+    dxcutil::GetValidatorVersion(&m_valMajor, &m_valMinor);
+    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, m_valMajor, m_valMinor));
   }
 
   ~DxcLinker() {
@@ -108,8 +112,145 @@ private:
   std::unique_ptr<DxilLinker> m_pLinker;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
   std::vector<CComPtr<IDxcBlob>> m_blobs; // Keep blobs live for lazy load.
+  UINT32 m_valMajor = 0, m_valMinor = 0;
+
+  // Link cache. Outputs are kept as they were before the container events
+  // handler saw them, keyed by an MD5 of everything that affects them.
+  static const size_t kLinkCacheMaxSize = 64 * 1024 * 1024;
+  llvm::StringMap<std::string> m_libHashes; // MD5 of each registered library.
+  llvm::StringMap<CComPtr<IDxcBlob>> m_linkCache;
+  size_t m_linkCacheSize = 0;
+
+  bool GetLinkCacheKey(const hlsl::options::DxcOpts &opts,
+                       const LPCWSTR *pLibNames, UINT32 libCount,
+                       SmallVectorImpl<char> &key);
+  bool LookupLinkCache(StringRef key, StringRef dir, CComPtr<IDxcBlob> &pBlob);
+  void AddToLinkCache(StringRef key, StringRef dir, IDxcBlob *pBlob);
+  void ApplyContainerEventsHandler(CComPtr<IDxcBlob> &pBlob);
 };
 
+static void HashLinkCacheField(MD5 &md5, StringRef value) {
+  // Prefix each field with its size so that fields cannot run together.
+  uint32_t size = value.size();
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)&size, sizeof(size)));
+  md5.update(value);
+}
+
+static const std::string &GetLinkCacheCompilerVersion() {
+  static const std::string version = []() {
+    std::string result = clang::getClangFullVersion();
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    result += " ";
+    result += clang::getGitCommitHash();
+    result += " ";
+    result += std::to_string(clang::getGitCommitCount());
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    result += " dxil " + std::to_string(DXIL::kDxilMajor) + "." +
+              std::to_string(DXIL::kDxilMinor);
+    return result;
+  }();
+  return version;
+}
+
+static std::wstring GetLinkCachePath(StringRef dir, StringRef key) {
+  SmallString<256> path(dir);
+  sys::path::append(path, key + ".dxil");
+  std::wstring widePath;
+  IFTBOOL(Unicode::UTF8ToUTF16String(path.c_str(), &widePath), E_INVALIDARG);
+  return widePath;
+}
+
+// Returns false if a library is not registered, in which case the link fails
+// and there is nothing to cache.
+bool DxcLinker::GetLinkCacheKey(const hlsl::options::DxcOpts &opts,
+                                const LPCWSTR *pLibNames, UINT32 libCount,
+                                SmallVectorImpl<char> &key) {
+  MD5 md5;
+  // The directory may be shared with other builds of the compiler.
+  HashLinkCacheField(md5, GetLinkCacheCompilerVersion());
+  HashLinkCacheField(md5, opts.EntryPoint);
+  HashLinkCacheField(md5, opts.TargetProfile);
+  uint32_t values[] = {(uint32_t)opts.Exports.size(), m_valMajor, m_valMinor,
+                       opts.LinkOptimize, opts.StripDebug,
+                       opts.DebugNameForSource};
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)values, sizeof(values)));
+  for (const std::string &exportName : opts.Exports)
+    HashLinkCacheField(md5, exportName);
+  for (unsigned i = 0; i < libCount; i++) {
+    CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
+    auto it = m_libHashes.find(pUtf8LibName.m_psz);
+    if (it == m_libHashes.end())
+      return false;
+    HashLinkCacheField(md5, it->second);
+  }
+  MD5::MD5Result digest;
+  md5.final(digest);
+  SmallString<32> hash;
+  MD5::stringifyResult(digest, hash);
+  key.clear();
+  key.append(hash.begin(), hash.end());
+  return true;
+}
+
+bool DxcLinker::LookupLinkCache(StringRef key, StringRef dir,
+                                CComPtr<IDxcBlob> &pBlob) {
+  auto it = m_linkCache.find(key);
+  if (it != m_linkCache.end()) {
+    pBlob = it->second;
+    return true;
+  }
+  if (dir.empty())
+    return false;
+
+  CComPtr<IDxcBlobEncoding> pFileBlob;
+  std::wstring path = GetLinkCachePath(dir, key);
+  if (FAILED(DxcCreateBlobFromFile(m_pMalloc, path.c_str(), nullptr,
+                                   &pFileBlob)))
+    return false;
+  // Files are moved into place once written, so this only rejects files
+  // that were damaged or are not link outputs.
+  if (!IsValidDxilContainer(
+          (const DxilContainerHeader *)pFileBlob->GetBufferPointer(),
+          pFileBlob->GetBufferSize()))
+    return false;
+  pBlob = pFileBlob;
+  AddToLinkCache(key, StringRef(), pBlob);
+  return true;
+}
+
+void DxcLinker::AddToLinkCache(StringRef key, StringRef dir, IDxcBlob *pBlob) {
+  size_t size = pBlob->GetBufferSize();
+  if (size > kLinkCacheMaxSize)
+    return;
+  if (m_linkCacheSize + size > kLinkCacheMaxSize) {
+    m_linkCache.clear();
+    m_linkCacheSize = 0;
+  }
+  m_linkCache[key] = pBlob;
+  m_linkCacheSize += size;
+
+  if (dir.empty())
+    return;
+  // The directory is only an optimization, so failing to write to it is not
+  // an error for the link.
+  try {
+    std::wstring path = GetLinkCachePath(dir, key);
+    WriteBinaryFileAtomically(path.c_str(), pBlob->GetBufferPointer(), size);
+  } catch (hlsl::Exception &) {
+  }
+}
+
+// Lets the registered handler replace a linked container.
+void DxcLinker::ApplyContainerEventsHandler(CComPtr<IDxcBlob> &pBlob) {
+  if (m_pDxcContainerEventsHandler == nullptr)
+    return;
+  CComPtr<IDxcBlob> pTargetBlob;
+  HRESULT hr =
+      m_pDxcContainerEventsHandler->OnDxilContainerBuilt(pBlob, &pTargetBlob);
+  if (SUCCEEDED(hr) && pTargetBlob != nullptr)
+    std::swap(pBlob, pTargetBlob);
+}
+
 HRESULT
 DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
                            _In_ IDxcBlob *pBlob       // Library to add.
@@ -140,6 +281,14 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
     if (m_pLinker->RegisterLib(pUtf8LibName.m_psz, std::move(pModule),
                                std::move(pDebugModule))) {
       m_blobs.emplace_back(pBlob);
+      MD5 md5;
+      MD5::MD5Result digest;
+      md5.update(ArrayRef<uint8_t>((const uint8_t *)pBlob->GetBufferPointer(),
+                                   pBlob->GetBufferSize()));
+      md5.final(digest);
+      SmallString<32> hash;
+      MD5::stringifyResult(digest, hash);
+      m_libHashes[pUtf8LibName.m_psz] = hash.str();
       return S_OK;
     } else {
       return E_INVALIDARG;
@@ -203,6 +352,18 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     std::string warnings;
     //llvm::raw_string_ostream w(warnings);
     IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+
+    SmallString<32> cacheKey;
+    if (opts.LinkCache &&
+        GetLinkCacheKey(opts, pLibNames, libCount, cacheKey) &&
+        LookupLinkCache(cacheKey, opts.LinkCacheDir, pOutputBlob)) {
+      ApplyContainerEventsHandler(pOutputBlob);
+      CComPtr<IStream> pStream = pDiagStream;
+      dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pStream, warnings,
+                                                false, ppResult);
+      return S_OK;
+    }
+
     raw_stream_ostream DiagStream(pDiagStream);
     llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
     PrintDiagnosticContext DiagContext(DiagPrinter);
@@ -220,9 +381,11 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     bSuccess = exportMap.ParseExports(opts.Exports, DiagStream);
 
     bool hasErrorOccurred = !bSuccess;
+    CComPtr<IDxcBlob> pLinkedBlob;
     if (bSuccess) {
-      std::unique_ptr<Module> pM = m_pLinker->Link(
-          opts.EntryPoint, pUtf8TargetProfile.m_psz, exportMap);
+      std::unique_ptr<Module> pM =
+          m_pLinker->Link(opts.EntryPoint, pUtf8TargetProfile.m_psz,
+                          exportMap, opts.LinkOptimize);
       if (pM) {
         const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
             new clang::DiagnosticIDs);
@@ -263,14 +426,8 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         }
         // Callback after valid DXIL is produced
         if (SUCCEEDED(valHR)) {
-          CComPtr<IDxcBlob> pTargetBlob;
-          if (m_pDxcContainerEventsHandler != nullptr) {
-            HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
-                pOutputBlob, &pTargetBlob);
-            if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
-              std::swap(pOutputBlob, pTargetBlob);
-            }
-          }
+          pLinkedBlob = pOutputBlob;
+          ApplyContainerEventsHandler(pOutputBlob);
           // TODO: DFCC_ShaderDebugName
         }
 
@@ -281,6 +438,10 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
       }
     }
     DiagStream.flush();
+    // Only cache clean links, since a cache hit reports no diagnostics.
+    if (!cacheKey.empty() && pLinkedBlob && !hasErrorOccurred &&
+        pDiagStream->GetPtrSize() == 0)
+      AddToLinkCache(cacheKey, opts.LinkCacheDir, pLinkedBlob);
     CComPtr<IStream> pStream = pDiagStream;
     dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pStream, warnings,
                                               hasErrorOccurred, ppResult);
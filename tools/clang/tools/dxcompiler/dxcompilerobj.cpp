@@ -24,6 +24,7 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/MD5.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
@@ -33,6 +34,7 @@
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
 #include "dxc/dxcapi.internal.h"
 #include "dxc/DXIL/DxilPDB.h"
+#include "dxc/DXIL/DxilSourceStore.h"
 
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/Global.h"
@@ -41,13 +43,17 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include "dxc/Support/DxcMemoryAccounting.h"
 #include "dxc/Support/HLSLOptions.h"
 #ifdef _WIN32
 #include "dxcetw.h"
 #endif
+#include "dxc/Support/DxcTrace.h"
 #include "dxillib.h"
 #include <algorithm>
 #include <cfloat>
+#include <map>
+#include <mutex>
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -70,6 +76,8 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLangExtensions)
 
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
+// Registers the passes and builds the option table on first use.
+HRESULT DxcInitializeCompilerComponents() throw();
 
 // This internal call allows the validator to avoid having to re-deserialize
 // the module. It trusts that the caller didn't make any changes and is
@@ -102,6 +110,31 @@ static void CreateOperationResultFromOutputs(
                                    ppResult);
 }
 
+// Creates the result of a compilation that exceeded its memory limit.
+static HRESULT CreateMemoryLimitResult(DxcMemoryAccountingMalloc *pMalloc,
+                                       uint64_t limitBytes,
+                                       _COM_Outptr_ IDxcOperationResult **ppResult) {
+  try {
+    std::string msg;
+    raw_string_ostream OS(msg);
+    OS << "error: compilation exceeded the memory limit of "
+       << (limitBytes >> 20) << " MB";
+    if (const char *pPhase = pMalloc->GetLimitPhase())
+      OS << " during '" << pPhase << "'";
+    OS << "; peak allocation was " << pMalloc->GetPeakBytes() << " bytes\n";
+    OS.flush();
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    IFT(DxcCreateBlobWithEncodingOnHeapCopy(msg.c_str(), msg.size(), CP_UTF8,
+                                            &pErrorBlob));
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(
+        nullptr, pErrorBlob, E_OUTOFMEMORY, ppResult));
+    static_cast<DxcOperationResult *>(*ppResult)->SetPeakMemoryUsage(
+        pMalloc->GetPeakBytes());
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
 static bool ShouldPartBeIncludedInPDB(UINT32 FourCC) {
   switch (FourCC) {
   case hlsl::DFCC_ShaderDebugName:
@@ -376,7 +409,176 @@ public:
   }
 };
 
-class DxcCompiler : public IDxcCompiler2,
+// Options parsed and validated for one target profile. Compiles only read
+// them, so compiles running at the same time can share them.
+struct DxcParsedOpts {
+  hlsl::options::MainArgs Args;
+  hlsl::options::DxcOpts Opts;
+  std::string TargetProfile; // Opts.TargetProfile may refer to this.
+  HRESULT Status = S_OK;
+  CComPtr<IDxcBlobEncoding> Errors;
+
+  void Parse(LPCWSTR pTargetProfile, _In_count_(argCount) LPCWSTR *pArguments,
+             UINT32 argCount) {
+    int argCountInt;
+    IFT(UIntToInt(argCount, &argCountInt));
+    Args = hlsl::options::MainArgs(argCountInt, pArguments, 0);
+    IFTBOOL(Unicode::UTF16ToUTF8String(pTargetProfile, &TargetProfile),
+            E_INVALIDARG);
+    Opts.TargetProfile = TargetProfile;
+
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pOutputStream));
+    CComPtr<IDxcOperationResult> pResult;
+    bool finished = false;
+    dxcutil::ReadOptsAndValidate(Args, Opts, pOutputStream, &pResult,
+                                 finished);
+    if (finished) {
+      IFT(pResult->GetStatus(&Status));
+      IFT(pResult->GetErrorBuffer(&Errors));
+    }
+  }
+};
+
+// Arguments cloned from one another share their command line, so they parse
+// it once per target profile.
+struct DxcCompilerArgsFamily {
+  std::vector<std::wstring> Arguments;
+  std::vector<LPCWSTR> ArgumentPtrs;
+  std::mutex Lock;
+  std::map<std::wstring, std::unique_ptr<DxcParsedOpts>> OptsByProfile;
+
+  DxcParsedOpts *GetParsedOpts(const std::wstring &targetProfile) {
+    std::lock_guard<std::mutex> lock(Lock);
+    std::unique_ptr<DxcParsedOpts> &pOpts = OptsByProfile[targetProfile];
+    if (!pOpts) {
+      std::unique_ptr<DxcParsedOpts> pNewOpts(new DxcParsedOpts());
+      pNewOpts->Parse(targetProfile.c_str(), ArgumentPtrs.data(),
+                      ArgumentPtrs.size());
+      pOpts = std::move(pNewOpts);
+    }
+    return pOpts.get();
+  }
+};
+
+// Only answered by DxcCompilerArgs, so that arguments passed back to this
+// library can be told apart from other IDxcCompilerArgs implementations.
+struct __declspec(uuid("27a5e24e-f913-4208-ab32-4f14b39c3a82"))
+IDxcCompilerArgsImpl : public IUnknown {
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompilerArgsImpl)
+};
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompilerArgsImpl)
+
+class DxcCompilerArgs : public IDxcCompilerArgs, public IDxcCompilerArgsImpl {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::shared_ptr<DxcCompilerArgsFamily> m_pFamily;
+  DxcParsedOpts *m_pParsedOpts = nullptr;
+  std::wstring m_entryPoint;
+  std::wstring m_targetProfile;
+  struct DefineStrings {
+    std::wstring Name;
+    std::wstring Value;
+    bool HasValue;
+  };
+  std::vector<DefineStrings> m_defineStrings;
+  std::vector<DxcDefine> m_defines; // Refers to m_defineStrings.
+
+  void AddDefines(_In_count_(defineCount) const DxcDefine *pDefines,
+                  UINT32 defineCount) {
+    for (UINT32 i = 0; i < defineCount; ++i) {
+      IFTARG(pDefines[i].Name);
+      const DxcDefine &D = pDefines[i];
+      m_defineStrings.push_back({D.Name, D.Value ? D.Value : L"",
+                                 D.Value != nullptr});
+    }
+    m_defines.resize(m_defineStrings.size());
+    for (size_t i = 0; i < m_defines.size(); ++i) {
+      const DefineStrings &S = m_defineStrings[i];
+      m_defines[i].Name = S.Name.c_str();
+      m_defines[i].Value = S.HasValue ? S.Value.c_str() : nullptr;
+    }
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcCompilerArgs)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompilerArgs, IDxcCompilerArgsImpl>(
+        this, iid, ppvObject);
+  }
+
+  void Init(LPCWSTR pEntryPoint, LPCWSTR pTargetProfile,
+            _In_count_(argCount) LPCWSTR *pArguments, UINT32 argCount,
+            _In_count_(defineCount) const DxcDefine *pDefines,
+            UINT32 defineCount) {
+    m_pFamily = std::make_shared<DxcCompilerArgsFamily>();
+    m_pFamily->Arguments.assign(pArguments, pArguments + argCount);
+    for (const std::wstring &argument : m_pFamily->Arguments)
+      m_pFamily->ArgumentPtrs.push_back(argument.c_str());
+    m_entryPoint = pEntryPoint;
+    m_targetProfile = pTargetProfile;
+    AddDefines(pDefines, defineCount);
+    m_pParsedOpts = m_pFamily->GetParsedOpts(m_targetProfile);
+  }
+
+  HRESULT STDMETHODCALLTYPE GetStatus(_Out_ HRESULT *pStatus) override {
+    if (pStatus == nullptr)
+      return E_INVALIDARG;
+    *pStatus = m_pParsedOpts->Status;
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetErrors(
+      _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppErrors) override {
+    if (ppErrors == nullptr)
+      return E_INVALIDARG;
+    *ppErrors = m_pParsedOpts->Errors;
+    if (*ppErrors)
+      (*ppErrors)->AddRef();
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE Clone(
+      _In_opt_ LPCWSTR pEntryPoint, _In_opt_ LPCWSTR pTargetProfile,
+      _In_count_(defineCount) const DxcDefine *pDefines, UINT32 defineCount,
+      _COM_Outptr_ IDxcCompilerArgs **ppResult) override {
+    if (ppResult == nullptr)
+      return E_POINTER;
+    *ppResult = nullptr;
+    if (defineCount > 0 && pDefines == nullptr)
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<DxcCompilerArgs> pClone = DxcCompilerArgs::Alloc(m_pMalloc);
+      IFROOM(pClone.p);
+      pClone->m_pFamily = m_pFamily;
+      pClone->m_entryPoint = pEntryPoint ? pEntryPoint : m_entryPoint;
+      pClone->m_targetProfile = pTargetProfile ? pTargetProfile : m_targetProfile;
+      pClone->m_defineStrings = m_defineStrings;
+      pClone->AddDefines(pDefines, defineCount);
+      pClone->m_pParsedOpts =
+          pClone->m_targetProfile == m_targetProfile
+              ? m_pParsedOpts
+              : m_pFamily->GetParsedOpts(pClone->m_targetProfile);
+      *ppResult = pClone.Detach();
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    return S_OK;
+  }
+
+  LPCWSTR GetEntryPoint() const { return m_entryPoint.c_str(); }
+  LPCWSTR GetTargetProfile() const { return m_targetProfile.c_str(); }
+  LPCWSTR *GetArguments() const { return m_pFamily->ArgumentPtrs.data(); }
+  UINT32 GetArgumentCount() const { return m_pFamily->ArgumentPtrs.size(); }
+  const DxcDefine *GetDefines() const { return m_defines.data(); }
+  UINT32 GetDefineCount() const { return m_defines.size(); }
+  DxcParsedOpts *GetParsedOpts() const { return m_pParsedOpts; }
+};
+
+class DxcCompiler : public IDxcCompiler3,
                     public IDxcLangExtensions,
                     public IDxcContainerEvent,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
@@ -424,6 +626,7 @@ public:
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
     return DoBasicQueryInterface<IDxcCompiler,
                                  IDxcCompiler2,
+                                 IDxcCompiler3,
                                  IDxcLangExtensions,
                                  IDxcContainerEvent,
                                  IDxcVersionInfo
@@ -467,6 +670,79 @@ public:
     _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,// Suggested file name for debug blob.
     _COM_Outptr_opt_ IDxcBlob **ppDebugBlob       // Debug blob
   ) override {
+    return CompileImpl(pSource, pSourceName, pEntryPoint, pTargetProfile,
+                       pArguments, argCount, pDefines, defineCount, nullptr,
+                       pIncludeHandler, ppResult, ppDebugBlobName, ppDebugBlob);
+  }
+
+  // Parse and validate arguments to compile with later.
+  HRESULT STDMETHODCALLTYPE CreateArgs(
+    _In_ LPCWSTR pEntryPoint,                     // Entry point name
+    _In_ LPCWSTR pTargetProfile,                  // Shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _COM_Outptr_ IDxcCompilerArgs **ppArgs        // Parsed arguments
+  ) override {
+    if (ppArgs == nullptr)
+      return E_POINTER;
+    *ppArgs = nullptr;
+    if ((defineCount > 0 && pDefines == nullptr) ||
+        (argCount > 0 && pArguments == nullptr) || pEntryPoint == nullptr ||
+        pTargetProfile == nullptr)
+      return E_INVALIDARG;
+    IFR(DxcInitializeCompilerComponents());
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<DxcCompilerArgs> pArgs = DxcCompilerArgs::Alloc(m_pMalloc);
+      IFROOM(pArgs.p);
+      pArgs->Init(pEntryPoint, pTargetProfile, pArguments, argCount, pDefines,
+                  defineCount);
+      *ppArgs = pArgs.Detach();
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    return S_OK;
+  }
+
+  // Compile with arguments created by CreateArgs.
+  HRESULT STDMETHODCALLTYPE CompileWithArgs(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ IDxcCompilerArgs *pArgs,                 // Parsed arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult,  // Compiler output status, buffer, and errors
+    _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,// Suggested file name for debug blob.
+    _COM_Outptr_opt_ IDxcBlob **ppDebugBlob       // Debug blob
+  ) override {
+    if (pArgs == nullptr)
+      return E_INVALIDARG;
+    // Only arguments from CreateArgs or Clone of this library can be used.
+    CComPtr<IDxcCompilerArgsImpl> pArgsImpl;
+    if (FAILED(pArgs->QueryInterface(__uuidof(IDxcCompilerArgsImpl),
+                                     (void **)&pArgsImpl)))
+      return E_INVALIDARG;
+    DxcCompilerArgs *pImpl = static_cast<DxcCompilerArgs *>(pArgsImpl.p);
+    return CompileImpl(pSource, pSourceName, pImpl->GetEntryPoint(),
+                       pImpl->GetTargetProfile(), pImpl->GetArguments(),
+                       pImpl->GetArgumentCount(), pImpl->GetDefines(),
+                       pImpl->GetDefineCount(), pImpl->GetParsedOpts(),
+                       pIncludeHandler, ppResult, ppDebugBlobName, ppDebugBlob);
+  }
+
+  // Compiles with options parsed ahead of time in pParsedOpts, or parses
+  // them from pArguments if it is null.
+  HRESULT CompileImpl(
+    _In_ IDxcBlob *pSource, _In_opt_ LPCWSTR pSourceName,
+    _In_ LPCWSTR pEntryPoint, _In_ LPCWSTR pTargetProfile,
+    _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+    _In_count_(defineCount) const DxcDefine *pDefines,
+    _In_ UINT32 defineCount, _In_opt_ DxcParsedOpts *pParsedOpts,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _COM_Outptr_ IDxcOperationResult **ppResult,
+    _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,
+    _COM_Outptr_opt_ IDxcBlob **ppDebugBlob) {
     if (pSource == nullptr || ppResult == nullptr ||
         (defineCount > 0 && pDefines == nullptr) ||
         (argCount > 0 && pArguments == nullptr) || pEntryPoint == nullptr ||
@@ -476,36 +752,62 @@ public:
     *ppResult = nullptr;
     AssignToOutOpt(nullptr, ppDebugBlobName);
     AssignToOutOpt(nullptr, ppDebugBlob);
+    IFR(DxcInitializeCompilerComponents());
 
     HRESULT hr = S_OK;
     CComPtr<IDxcBlobEncoding> utf8Source;
     CComPtr<AbstractMemoryStream> pOutputStream;
     CComHeapPtr<wchar_t> DebugBlobName;
     DxilShaderHash ShaderHashContent;
+    bool bIdenticalToKnown = false;
 
     DxcEtw_DXCompilerCompile_Start();
     pSourceName = (pSourceName && *pSourceName) ? pSourceName : L"hlsl.hlsl"; // declared optional, so pick a default
-    DxcThreadMalloc TM(m_pMalloc);
+    // Account for everything this compilation allocates, so that its peak
+    // can be reported and -memory-limit enforced.
+    CComPtr<DxcMemoryAccountingMalloc> pMalloc =
+        DxcMemoryAccountingMalloc::Alloc(m_pMalloc);
+    if (pMalloc == nullptr) {
+      DxcEtw_DXCompilerCompile_Stop(E_OUTOFMEMORY);
+      return E_OUTOFMEMORY;
+    }
+    DxcThreadMalloc TM(pMalloc);
+    DxcMemoryAccountingScope AS(pMalloc);
 
     try {
       DefaultFPEnvScope fpEnvScope;
 
-      IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+      IFT(CreateMemoryStream(pMalloc, &pOutputStream));
 
-      // Parse command-line options into DxcOpts
-      int argCountInt;
-      IFT(UIntToInt(argCount, &argCountInt));
-      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
-      hlsl::options::DxcOpts opts;
+      hlsl::options::MainArgs localMainArgs;
+      hlsl::options::DxcOpts localOpts;
       CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
-      // Set target profile before reading options and validate
-      opts.TargetProfile = pUtf8TargetProfile.m_psz;
-      bool finished = false;
-      dxcutil::ReadOptsAndValidate(mainArgs, opts, pOutputStream, ppResult, finished);
-      if (finished) {
+      if (pParsedOpts == nullptr) {
+        // Parse command-line options into DxcOpts
+        int argCountInt;
+        IFT(UIntToInt(argCount, &argCountInt));
+        localMainArgs = hlsl::options::MainArgs(argCountInt, pArguments, 0);
+        // Set target profile before reading options and validate
+        localOpts.TargetProfile = pUtf8TargetProfile.m_psz;
+        bool finished = false;
+        dxcutil::ReadOptsAndValidate(localMainArgs, localOpts, pOutputStream,
+                                     ppResult, finished);
+        if (finished) {
+          hr = S_OK;
+          goto Cleanup;
+        }
+      } else if (FAILED(pParsedOpts->Status)) {
+        IFT(DxcOperationResult::CreateFromResultErrorStatus(
+            nullptr, pParsedOpts->Errors, pParsedOpts->Status, ppResult));
         hr = S_OK;
         goto Cleanup;
       }
+      // Options parsed ahead of time may be shared with other compiles, so
+      // they are only read from here on.
+      const hlsl::options::DxcOpts &opts =
+          pParsedOpts ? pParsedOpts->Opts : localOpts;
+      if (opts.MemoryLimitMB != 0)
+        pMalloc->SetLimit(opts.MemoryLimitMB << 20);
 
 #ifdef ENABLE_SPIRV_CODEGEN
       // We want to embed the preprocessed source code in the final SPIR-V if
@@ -527,8 +829,9 @@ public:
       }
 #endif // ENABLE_SPIRV_CODEGEN
 
-      // Convert source code encoding
-      IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
+      // Convert source code encoding. A null-terminated source can be used
+      // by the compiler in place.
+      IFC(hlsl::DxcGetBlobAsUtf8NullTerm(pSource, &utf8Source));
 
       CComPtr<IDxcBlob> pOutputBlob;
       dxcutil::DxcArgsFileSystem *msfPtr =
@@ -546,23 +849,9 @@ public:
       // Prepare UTF8-encoded versions of API values.
       CW2A pUtf8EntryPoint(pEntryPoint, CP_UTF8);
       CW2A utf8SourceName(pSourceName, CP_UTF8);
-      const char *pUtf8SourceName = utf8SourceName.m_psz;
-      if (pUtf8SourceName == nullptr) {
-        if (opts.InputFile.empty()) {
-          pUtf8SourceName = "input.hlsl";
-        }
-        else {
-          pUtf8SourceName = opts.InputFile.data();
-        }
-      }
 
       IFT(msfPtr->RegisterOutputStream(L"output.bc", pOutputStream));
-      IFT(msfPtr->CreateStdStreams(m_pMalloc));
-
-      StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
-                     utf8Source->GetBufferSize());
-      std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-          llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
+      IFT(msfPtr->CreateStdStreams(pMalloc));
 
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
@@ -664,7 +953,7 @@ public:
           auto rootSigHandle = action.takeRootSigHandle();
 
           CComPtr<AbstractMemoryStream> pContainerStream;
-          IFT(CreateMemoryStream(m_pMalloc, &pContainerStream));
+          IFT(CreateMemoryStream(pMalloc, &pContainerStream));
           SerializeDxilContainerForRootSignature(rootSigHandle.get(),
                                                  pContainerStream);
 
@@ -678,16 +967,19 @@ public:
         // Since SpirvOptions is passed to the SPIR-V CodeGen as a whole
         // structure, we need to copy a few non-spirv-specific options into the
         // structure.
-        opts.SpirvOptions.enable16BitTypes = opts.Enable16BitTypes;
-        opts.SpirvOptions.codeGenHighLevel = opts.CodeGenHighLevel;
-        opts.SpirvOptions.defaultRowMajor = opts.DefaultRowMajor;
-        opts.SpirvOptions.disableValidation = opts.DisableValidation;
+        clang::spirv::SpirvCodeGenOptions &spirvOpts =
+            compiler.getCodeGenOpts().SpirvOptions;
+        spirvOpts = opts.SpirvOptions;
+        spirvOpts.enable16BitTypes = opts.Enable16BitTypes;
+        spirvOpts.codeGenHighLevel = opts.CodeGenHighLevel;
+        spirvOpts.defaultRowMajor = opts.DefaultRowMajor;
+        spirvOpts.disableValidation = opts.DisableValidation;
         // Store a string representation of command line options.
         if (opts.DebugInfo)
-          for (auto opt : mainArgs.getArrayRef())
-            opts.SpirvOptions.clOptions += " " + std::string(opt);
+          for (auto opt : (pParsedOpts ? pParsedOpts->Args
+                                       : localMainArgs).getArrayRef())
+            spirvOpts.clOptions += " " + std::string(opt);
 
-        compiler.getCodeGenOpts().SpirvOptions = opts.SpirvOptions;
         clang::EmitSpirvAction action;
         FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
         action.BeginSourceFile(compiler, file);
@@ -735,26 +1027,65 @@ public:
         if (opts.StripReflection) {
           SerializeFlags |= SerializeDxilFlags::StripReflectionFromDxilPart;
         }
+        if (opts.StatsJson) {
+          SerializeFlags |= SerializeDxilFlags::IncludeStatisticsPart;
+        }
 
         // Don't do work to put in a container if an error has occurred
         // Do not create a container when there is only a a high-level representation in the module.
         if (compileOK && !opts.CodeGenHighLevel) {
           HRESULT valHR = S_OK;
+          std::unique_ptr<llvm::Module> pModule = action.takeModule();
+          if (!opts.SourceStore.empty())
+            MoveDebugSourcesToStore(*pModule, opts.SourceStore);
+
+          // Fingerprint the optimized module so permutations that optimize
+          // to an already known shader can skip the rest of the pipeline.
+          DxilShaderFingerprint Fingerprint;
+          std::string IdenticalTo;
+          if (opts.Dedup) {
+            ComputeDxilModuleFingerprint(*pModule, Fingerprint);
+            llvm::SmallString<32> FingerprintHex;
+            llvm::MD5::stringifyResult(Fingerprint.Digest, FingerprintHex);
+            for (const std::string &Known : opts.DedupKnown) {
+              llvm::StringRef KnownFingerprint, KnownName;
+              std::tie(KnownFingerprint, KnownName) = llvm::StringRef(Known).split('=');
+              if (KnownFingerprint.equals_lower(FingerprintHex)) {
+                IdenticalTo = KnownName;
+                break;
+              }
+            }
+            if (!IdenticalTo.empty()) {
+              w << "note: shader is identical to '" << IdenticalTo
+                << "' (fingerprint " << FingerprintHex
+                << "); validation and container assembly skipped.\n";
+            }
+          }
 
-          if (needsValidation) {
+          if (!IdenticalTo.empty()) {
+            bIdenticalToKnown = true;
+            CComPtr<AbstractMemoryStream> pFingerprintStream;
+            IFT(CreateMemoryStream(pMalloc, &pFingerprintStream));
+            SerializeDxilContainerForFingerprint(Fingerprint, IdenticalTo,
+                                                 pFingerprintStream);
+            pOutputBlob.Release();
+            IFT(pFingerprintStream.QueryInterface(&pOutputBlob));
+          } else if (needsValidation) {
             valHR = dxcutil::ValidateAndAssembleToContainer(
-                action.takeModule(), pOutputBlob, m_pMalloc, SerializeFlags,
+                std::move(pModule), pOutputBlob, pMalloc, SerializeFlags,
                 pOutputStream, opts.IsDebugInfoEnabled(), opts.GetPDBName(), compiler.getDiagnostics(),
-                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr);
+                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr,
+                opts.Dedup ? &Fingerprint : nullptr);
           } else {
-            dxcutil::AssembleToContainer(action.takeModule(),
-                                         pOutputBlob, m_pMalloc,
+            dxcutil::AssembleToContainer(std::move(pModule),
+                                         pOutputBlob, pMalloc,
                                          SerializeFlags, pOutputStream,
-                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr);
+                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr,
+                opts.Dedup ? &Fingerprint : nullptr);
           }
 
           // Callback after valid DXIL is produced
-          if (SUCCEEDED(valHR)) {
+          if (SUCCEEDED(valHR) && !bIdenticalToKnown) {
             CComPtr<IDxcBlob> pTargetBlob;
             if (m_pDxcContainerEventsHandler != nullptr) {
               HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
@@ -789,17 +1120,19 @@ public:
       HRESULT status;
       DXVERIFY_NOMSG(SUCCEEDED((*ppResult)->GetStatus(&status)));
       if (SUCCEEDED(status)) {
-        if (opts.IsDebugInfoEnabled() && ppDebugBlob) {
+        if (opts.IsDebugInfoEnabled() && ppDebugBlob && !bIdenticalToKnown) {
           CComPtr<IDxcBlob> pStrippedContainer;
           CComPtr<IDxcBlob> pDebugBitcodeBlob;
           DXVERIFY_NOMSG(SUCCEEDED(pOutputStream.QueryInterface(&pDebugBitcodeBlob)));
-          DXVERIFY_NOMSG(SUCCEEDED(CreateContainerForPDB(m_pMalloc, pOutputBlob, pDebugBitcodeBlob, &pStrippedContainer)));
-          DXVERIFY_NOMSG(SUCCEEDED((hlsl::pdb::WriteDxilPDB(m_pMalloc, pStrippedContainer, ShaderHashContent.Digest, ppDebugBlob))));
+          DXVERIFY_NOMSG(SUCCEEDED(CreateContainerForPDB(pMalloc, pOutputBlob, pDebugBitcodeBlob, &pStrippedContainer)));
+          DXVERIFY_NOMSG(SUCCEEDED((hlsl::pdb::WriteDxilPDB(pMalloc, pStrippedContainer, ShaderHashContent.Digest, ppDebugBlob))));
         }
         if (ppDebugBlobName) {
           *ppDebugBlobName = DebugBlobName.Detach();
         }
       }
+      static_cast<DxcOperationResult *>(*ppResult)->SetPeakMemoryUsage(
+          pMalloc->GetPeakBytes());
 
       hr = S_OK;
     } catch (std::bad_alloc &) {
@@ -818,6 +1151,24 @@ public:
     } catch (...) {
       hr = E_FAIL;
     }
+    if (pMalloc->LimitExceeded()) {
+      // However the failed allocation surfaced, report the limit instead.
+      uint64_t limitBytes = pMalloc->GetLimit();
+      pMalloc->SetLimit(0);
+      if (*ppResult) {
+        (*ppResult)->Release();
+        *ppResult = nullptr;
+      }
+      if (ppDebugBlob && *ppDebugBlob) {
+        (*ppDebugBlob)->Release();
+        *ppDebugBlob = nullptr;
+      }
+      if (ppDebugBlobName && *ppDebugBlobName) {
+        CoTaskMemFree(*ppDebugBlobName);
+        *ppDebugBlobName = nullptr;
+      }
+      hr = CreateMemoryLimitResult(pMalloc, limitBytes, ppResult);
+    }
   Cleanup:
     DxcEtw_DXCompilerCompile_Stop(hr);
     return hr;
@@ -839,12 +1190,13 @@ public:
         (argCount > 0 && pArguments == nullptr))
       return E_INVALIDARG;
     *ppResult = nullptr;
+    IFR(DxcInitializeCompilerComponents());
 
     HRESULT hr = S_OK;
     DxcEtw_DXCompilerPreprocess_Start();
     DxcThreadMalloc TM(m_pMalloc);
     CComPtr<IDxcBlobEncoding> utf8Source;
-    IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
+    IFC(hlsl::DxcGetBlobAsUtf8NullTerm(pSource, &utf8Source));
 
     try {
       DefaultFPEnvScope fpEnvScope;
@@ -871,24 +1223,10 @@ public:
 
       // Prepare UTF8-encoded versions of API values.
       CW2A utf8SourceName(pSourceName, CP_UTF8);
-      const char *pUtf8SourceName = utf8SourceName.m_psz;
-      if (pUtf8SourceName == nullptr) {
-        if (opts.InputFile.empty()) {
-          pUtf8SourceName = "input.hlsl";
-        }
-        else {
-          pUtf8SourceName = opts.InputFile.data();
-        }
-      }
 
       IFT(msfPtr->RegisterOutputStream(L"output.hlsl", pOutputStream));
       IFT(msfPtr->CreateStdStreams(m_pMalloc));
 
-      StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
-        utf8Source->GetBufferSize());
-      std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-        llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
-
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
       CreateDefineStrings(pDefines, defineCount, defines);
@@ -985,7 +1323,7 @@ public:
                                _In_ DxcLangExtensionsHelper *helper,
                                _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
                                _In_ std::vector<std::string>& defines,
-                               _In_ hlsl::options::DxcOpts &Opts,
+                               _In_ const hlsl::options::DxcOpts &Opts,
                                _In_count_(argCount) LPCWSTR *pArguments,
                                _In_ UINT32 argCount) {
     // Setup a compiler instance.
@@ -1097,6 +1435,17 @@ public:
 
     compiler.getCodeGenOpts().HLSLHighLevel = Opts.CodeGenHighLevel;
     compiler.getCodeGenOpts().HLSLResMayAlias = Opts.ResMayAlias;
+    compiler.getCodeGenOpts().HLSLFormDotMad = Opts.FormDotMad;
+    compiler.getCodeGenOpts().HLSLFastTranscendentals = Opts.FastTranscendentals;
+    compiler.getCodeGenOpts().HLSLLowerIndexedArrays = Opts.LowerIndexedArrays;
+    compiler.getCodeGenOpts().HLSLIfConversion = Opts.IfConversion;
+    compiler.getCodeGenOpts().HLSLWaveAggregateAtomics = Opts.WaveAggregateAtomics;
+    compiler.getCodeGenOpts().HLSLRemoveRedundantBarriers = Opts.RemoveRedundantBarriers;
+    compiler.getCodeGenOpts().HLSLGroupsharedBankReport = Opts.GroupsharedBankReport;
+    compiler.getCodeGenOpts().HLSLPadGroupshared = Opts.PadGroupshared;
+    compiler.getCodeGenOpts().HLSLHotColdSplit = Opts.HotColdSplit;
+    compiler.getCodeGenOpts().HLSLHotColdReport = Opts.HotColdReport;
+    compiler.getCodeGenOpts().HLSLConstArrayBufferSpace = Opts.ConstArrayBufferSpace;
     compiler.getCodeGenOpts().HLSLAllResourcesBound = Opts.AllResourcesBound;
     compiler.getCodeGenOpts().HLSLDefaultRowMajor = Opts.DefaultRowMajor;
     compiler.getCodeGenOpts().HLSLPreferControlFlow = Opts.PreferFlowControl;
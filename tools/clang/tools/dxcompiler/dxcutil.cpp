@@ -75,12 +75,13 @@ public:
                                  AbstractMemoryStream *pModuleBitcode,
                                  CComPtr<IDxcBlob> &pDxilContainerBlob,
                                  SerializeDxilFlags Flags,
-                                 DxilShaderHash *pShaderHashOut) {
+                                 DxilShaderHash *pShaderHashOut,
+                                 const DxilShaderFingerprint *pFingerprint) {
     CComPtr<AbstractMemoryStream> pContainerStream;
     IFT(CreateMemoryStream(pMalloc, &pContainerStream));
     SerializeDxilContainerForModule(&m_llvmModule->GetOrCreateDxilModule(),
                                     pModuleBitcode, pContainerStream, m_debugName, Flags,
-                                    pShaderHashOut);
+                                    pShaderHashOut, pFingerprint);
 
     pDxilContainerBlob.Release();
     IFT(pContainerStream.QueryInterface(&pDxilContainerBlob));
@@ -123,12 +124,14 @@ void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          IMalloc *pMalloc,
                          SerializeDxilFlags SerializeFlags,
                          CComPtr<AbstractMemoryStream> &pOutputStream,
-                         DxilShaderHash *pShaderHashOut) {
+                         DxilShaderHash *pShaderHashOut,
+                         const DxilShaderFingerprint *pFingerprint) {
   // Take ownership of the module from the action.
   DxilCompilerLLVMModuleOutput llvmModule(std::move(pM));
 
   llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
-                                       SerializeFlags, pShaderHashOut);
+                                       SerializeFlags, pShaderHashOut,
+                                       pFingerprint);
 }
 
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
@@ -160,7 +163,8 @@ HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputBlob,
     IMalloc *pMalloc, SerializeDxilFlags SerializeFlags,
     CComPtr<AbstractMemoryStream> &pOutputStream, bool bDebugInfo, llvm::StringRef DebugName,
-    clang::DiagnosticsEngine &Diag, DxilShaderHash *pShaderHashOut) {
+    clang::DiagnosticsEngine &Diag, DxilShaderHash *pShaderHashOut,
+    const DxilShaderFingerprint *pFingerprint) {
   HRESULT valHR = S_OK;
 
   // Take ownership of the module from the action.
@@ -191,7 +195,8 @@ HRESULT ValidateAndAssembleToContainer(
   }
 
   llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
-                                       SerializeFlags, pShaderHashOut);
+                                       SerializeFlags, pShaderHashOut,
+                                       pFingerprint);
 
   CComPtr<IDxcOperationResult> pValResult;
   // Important: in-place edit is required so the blob is reused and thus
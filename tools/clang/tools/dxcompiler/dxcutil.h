@@ -31,6 +31,7 @@ class Twine;
 namespace hlsl {
 enum class SerializeDxilFlags : uint32_t;
 struct DxilShaderHash;
+struct DxilShaderFingerprint;
 class AbstractMemoryStream;
 namespace options {
 class MainArgs;
@@ -43,14 +44,16 @@ HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputContainerBlob,
     IMalloc *pMalloc, hlsl::SerializeDxilFlags SerializeFlags,
     CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode, bool bDebugInfo, llvm::StringRef DebugName,
-    clang::DiagnosticsEngine &Diag, hlsl::DxilShaderHash *pShaderHashOut = nullptr);
+    clang::DiagnosticsEngine &Diag, hlsl::DxilShaderHash *pShaderHashOut = nullptr,
+    const hlsl::DxilShaderFingerprint *pFingerprint = nullptr);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
 void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          CComPtr<IDxcBlob> &pOutputContainerBlob,
                          IMalloc *pMalloc,
                          hlsl::SerializeDxilFlags SerializeFlags,
                          CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode,
-                         hlsl::DxilShaderHash *pShaderHashOut = nullptr);
+                         hlsl::DxilShaderHash *pShaderHashOut = nullptr,
+                         const hlsl::DxilShaderFingerprint *pFingerprint = nullptr);
 HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                          hlsl::options::DxcOpts &opts,
@@ -28,6 +28,7 @@
 #ifdef _WIN32
 #include "dxcetw.h"
 #endif
+#include "dxc/Support/DxcTrace.h"
 
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
 #include "clang/Basic/Version.h"
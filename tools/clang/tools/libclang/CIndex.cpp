@@ -38,6 +38,7 @@
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/PreprocessingRecord.h"
 #include "clang/Lex/Preprocessor.h"
+#include "clang/Parse/ParseAST.h" // HLSL Change
 #include "clang/Serialization/SerializationDiagnostic.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
@@ -3013,6 +3014,7 @@ struct ParseTranslationUnitInfo {
   CXTranslationUnit *out_TU;
   CXErrorCode &result;
   ::llvm::sys::fs::MSFileSystemRef fsr;
+  const std::atomic<bool> *cancelled; // HLSL Change
 };
 static void clang_parseTranslationUnit_Impl(void *UserData) {
   const ParseTranslationUnitInfo *PTUI =
@@ -3040,6 +3042,7 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
     // (otherwise caller owns the thread and should set this up).
     ::llvm::sys::fs::SetCurrentThreadFileSystem(PTUI->fsr);
   }
+  ParseCancellationScope CancelScope(PTUI->cancelled);
   // HLSL Change Ends
 
   CIndexer *CXXIdx = static_cast<CIndexer *>(CIdx);
@@ -3199,7 +3202,8 @@ enum CXErrorCode clang_parseTranslationUnit2(
       options,
       out_TU,
       result,
-      nullptr};
+      nullptr,
+      ParseCancellationScope::getCurrent()}; // HLSL Change
   llvm::CrashRecoveryContext CRC;
 
   // HLSL Change Starts - allow an option to control this behavior.
@@ -3343,6 +3347,8 @@ struct ReparseTranslationUnitInfo {
   ArrayRef<CXUnsavedFile> unsaved_files;
   unsigned options;
   CXErrorCode &result;
+  const std::atomic<bool> *cancelled; // HLSL Change
+  ::llvm::sys::fs::MSFileSystemRef fsr; // HLSL Change
 };
 
 static void clang_reparseTranslationUnit_Impl(void *UserData) {
@@ -3369,6 +3375,13 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
 
   ASTUnit *CXXUnit = cxtu::getASTUnit(TU);
   ASTUnit::ConcurrencyCheck Check(*CXXUnit);
+  // HLSL Change Starts
+  if (RTUI->fsr && !::llvm::sys::fs::GetCurrentThreadFileSystem()) {
+    // As in clang_parseTranslationUnit_Impl, this runs in our own thread.
+    ::llvm::sys::fs::SetCurrentThreadFileSystem(RTUI->fsr);
+  }
+  ParseCancellationScope CancelScope(RTUI->cancelled);
+  // HLSL Change Ends
 
   std::unique_ptr<std::vector<ASTUnit::RemappedFile>> RemappedFiles(
       new std::vector<ASTUnit::RemappedFile>());
@@ -3404,7 +3417,8 @@ int clang_reparseTranslationUnit(CXTranslationUnit TU,
   CXErrorCode result = CXError_Failure;
   ReparseTranslationUnitInfo RTUI = {
       TU, llvm::makeArrayRef(unsaved_files, num_unsaved_files), options,
-      result};
+      result, ParseCancellationScope::getCurrent(), // HLSL Change
+      ::llvm::sys::fs::GetCurrentThreadFileSystem()}; // HLSL Change
 
   if (getenv("LIBCLANG_NOTHREADS")) {
     clang_reparseTranslationUnit_Impl(&RTUI);
@@ -26,6 +26,7 @@
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Parse/ParseAST.h" // HLSL Change
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Sema/Sema.h"
 #include "llvm/ADT/SmallString.h"
@@ -655,6 +656,7 @@ struct CodeCompleteAtInfo {
   ArrayRef<CXUnsavedFile> unsaved_files;
   unsigned options;
   CXCodeCompleteResults *result;
+  const std::atomic<bool> *cancelled; // HLSL Change
 };
 static void clang_codeCompleteAt_Impl(void *UserData) {
   CodeCompleteAtInfo *CCAI = static_cast<CodeCompleteAtInfo*>(UserData);
@@ -688,6 +690,7 @@ static void clang_codeCompleteAt_Impl(void *UserData) {
     setThreadBackgroundPriority();
 
   ASTUnit::ConcurrencyCheck Check(*AST);
+  ParseCancellationScope CancelScope(CCAI->cancelled); // HLSL Change
 
   // Perform the remapping of source files.
   SmallVector<ASTUnit::RemappedFile, 4> RemappedFiles;
@@ -823,7 +826,8 @@ CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
 
   CodeCompleteAtInfo CCAI = {TU, complete_filename, complete_line,
     complete_column, llvm::makeArrayRef(unsaved_files, num_unsaved_files),
-    options, nullptr};
+    options, nullptr,
+    ParseCancellationScope::getCurrent()}; // HLSL Change
 
   // HLSL Change - Force code completion to run on current thread.
   if (true || getenv("LIBCLANG_NOTHREADS")) {
@@ -32,6 +32,8 @@
 #include "dxcisenseimpl.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
+#include "llvm/ADT/StringMap.h"
+#include <thread>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -385,6 +387,33 @@ HRESULT SetupUnsavedFiles(
   return hr;
 }
 
+// Unsaved files read when a request is made, for use once it runs.
+struct UnsavedFileCopies
+{
+  CXUnsavedFile* Files;
+  unsigned Count;
+
+  UnsavedFileCopies() : Files(nullptr), Count(0) {}
+  ~UnsavedFileCopies()
+  {
+    if (Files != nullptr)
+      CleanupUnsavedFiles(Files, Count);
+  }
+};
+
+static HRESULT CopyUnsavedFiles(
+  _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+  unsigned num_unsaved_files,
+  std::shared_ptr<UnsavedFileCopies> *pCopies)
+{
+  std::shared_ptr<UnsavedFileCopies> copies = std::make_shared<UnsavedFileCopies>();
+  HRESULT hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &copies->Files);
+  if (FAILED(hr)) return hr;
+  copies->Count = num_unsaved_files;
+  *pCopies = copies;
+  return S_OK;
+}
+
 struct PagedCursorVisitorContext
 {
   unsigned skip;                // References to skip at the beginning.
@@ -658,12 +687,9 @@ HRESULT DxcCursor::GetKind(DxcCursorKind* pResult)
   return S_OK;
 }
 
-_Use_decl_annotations_
-HRESULT DxcCursor::GetKindFlags(DxcCursorKindFlags* pResult)
+static DxcCursorKindFlags GetCursorKindFlags(CXCursorKind kind)
 {
-  if (pResult == nullptr) return E_POINTER;
   DxcCursorKindFlags f = DxcCursorKind_None;
-  CXCursorKind kind = clang_getCursorKind(m_cursor);
   if (0 != clang_isDeclaration(kind)) f = (DxcCursorKindFlags)(f | DxcCursorKind_Declaration);
   if (0 != clang_isReference(kind)) f = (DxcCursorKindFlags)(f | DxcCursorKind_Reference);
   if (0 != clang_isExpression(kind)) f = (DxcCursorKindFlags)(f | DxcCursorKind_Expression);
@@ -673,7 +699,14 @@ HRESULT DxcCursor::GetKindFlags(DxcCursorKindFlags* pResult)
   if (0 != clang_isTranslationUnit(kind)) f = (DxcCursorKindFlags)(f | DxcCursorKind_TranslationUnit);
   if (0 != clang_isPreprocessing(kind)) f = (DxcCursorKindFlags)(f | DxcCursorKind_Preprocessing);
   if (0 != clang_isUnexposed(kind)) f = (DxcCursorKindFlags)(f | DxcCursorKind_Unexposed);
-  *pResult = f;
+  return f;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCursor::GetKindFlags(DxcCursorKindFlags* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = GetCursorKindFlags(clang_getCursorKind(m_cursor));
   return S_OK;
 }
 
@@ -1171,6 +1204,71 @@ HRESULT DxcIndex::ParseTranslationUnit(
   HRESULT hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &files);
   if (FAILED(hr)) return hr;
 
+  hr = ParseWithUnsavedFiles(source_filename, command_line_args,
+    num_command_line_args, files, num_unsaved_files, options, pTranslationUnit);
+  CleanupUnsavedFiles(files, num_unsaved_files);
+  return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::ParseTranslationUnitAsync(
+  const char *source_filename,
+  const char * const *command_line_args,
+  int num_command_line_args,
+  IDxcUnsavedFile** unsaved_files,
+  unsigned num_unsaved_files,
+  DxcTranslationUnitFlags options,
+  IDxcIntelliSenseCallback* callback,
+  IDxcIntelliSenseOperation** pOperation)
+{
+  if (pOperation == nullptr) return E_POINTER;
+  *pOperation = nullptr;
+
+  if (source_filename == nullptr || num_command_line_args < 0 ||
+      (num_command_line_args > 0 && command_line_args == nullptr))
+    return E_INVALIDARG;
+  if (m_index == 0) return E_FAIL;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try
+  {
+    std::shared_ptr<UnsavedFileCopies> files;
+    IFT(CopyUnsavedFiles(unsaved_files, num_unsaved_files, &files));
+    std::string fileName(source_filename);
+    std::vector<std::string> args(command_line_args,
+                                  command_line_args + num_command_line_args);
+    CComPtr<DxcIndex> index(this);
+    return DxcIntelliSenseOperation::Start(m_parseQueue,
+      static_cast<IDxcIndex *>(this), callback,
+      [index, fileName, args, files, options](
+          DxcIntelliSenseOperation *operation, IUnknown **pResult) -> HRESULT {
+        if (operation->IsCancelled()) return E_ABORT;
+        std::vector<const char *> argPtrs;
+        for (const std::string &arg : args)
+          argPtrs.push_back(arg.c_str());
+        CComPtr<IDxcTranslationUnit> tu;
+        HRESULT hr = index->ParseWithUnsavedFiles(fileName.c_str(),
+          argPtrs.data(), (int)argPtrs.size(), files->Files, files->Count,
+          options, &tu);
+        if (FAILED(hr)) return hr;
+        *pResult = tu.Detach();
+        return S_OK;
+      }, pOperation);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::ParseWithUnsavedFiles(
+  const char *source_filename,
+  const char * const *command_line_args,
+  int num_command_line_args,
+  CXUnsavedFile *files,
+  unsigned num_unsaved_files,
+  DxcTranslationUnitFlags options,
+  IDxcTranslationUnit** pTranslationUnit)
+{
   try
   {
     // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
@@ -1183,7 +1281,6 @@ HRESULT DxcIndex::ParseTranslationUnit(
     CXTranslationUnit tu = clang_parseTranslationUnit(m_index, source_filename,
       command_line_args, num_command_line_args,
       files, num_unsaved_files, options);
-    CleanupUnsavedFiles(files, num_unsaved_files);
     if (tu == nullptr)
     {
       return E_FAIL;
@@ -1205,6 +1302,234 @@ HRESULT DxcIndex::ParseTranslationUnit(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+DxcIntelliSenseQueue::DxcIntelliSenseQueue()
+  : m_nextTicket(0), m_servingTicket(0), m_workerRunning(false)
+{
+}
+
+uint64_t DxcIntelliSenseQueue::TakeTicket()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_nextTicket++;
+}
+
+void DxcIntelliSenseQueue::WaitForTicket(uint64_t ticket)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_served.wait(lock, [&] { return m_servingTicket == ticket; });
+}
+
+void DxcIntelliSenseQueue::FinishTicket()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    ++m_servingTicket;
+  }
+  m_served.notify_all();
+}
+
+namespace {
+// Holds the turn of a request while in scope.
+class RequestTurn
+{
+  DxcIntelliSenseQueue &m_queue;
+public:
+  RequestTurn(DxcIntelliSenseQueue &queue, uint64_t ticket) : m_queue(queue)
+  {
+    queue.WaitForTicket(ticket);
+  }
+  explicit RequestTurn(DxcIntelliSenseQueue &queue) : m_queue(queue)
+  {
+    queue.WaitForTicket(queue.TakeTicket());
+  }
+  ~RequestTurn() { m_queue.FinishTicket(); }
+};
+}
+
+HRESULT DxcIntelliSenseQueue::Enqueue(IUnknown *owner,
+                                      DxcIntelliSenseOperation *operation)
+{
+  uint64_t ticket = 0;
+  bool startWorker = false;
+  HRESULT hr = S_OK;
+  operation->AddRef(); // Released by RunWorker.
+  try
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pending.push_back(std::make_pair(m_nextTicket, operation));
+    ticket = m_nextTicket++;
+    startWorker = !m_workerRunning;
+    m_workerRunning = true;
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  if (FAILED(hr))
+  {
+    operation->Release();
+    return hr;
+  }
+  if (!startWorker)
+    return S_OK;
+
+  owner->AddRef(); // Released by RunWorker.
+  try
+  {
+    // The thread frees its state once RunWorker returns, with the allocator
+    // RunWorker leaves installed.
+    DxcThreadMalloc TM(nullptr);
+    std::thread(RunWorker, this, owner).detach();
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  if (FAILED(hr))
+  {
+    // No worker was running, so the operation is the only one queued.
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_pending.clear();
+      m_workerRunning = false;
+    }
+    operation->Release();
+    owner->Release();
+    // Take and give up the turn, so later requests are not held up.
+    RequestTurn skippedTurn(*this, ticket);
+  }
+  return hr;
+}
+
+void DxcIntelliSenseQueue::RunWorker(DxcIntelliSenseQueue *queue,
+                                     IUnknown *owner)
+{
+  // Left installed for the rest of the thread; see Enqueue.
+  DxcSetThreadMallocToDefault();
+  for (;;)
+  {
+    std::pair<uint64_t, DxcIntelliSenseOperation *> next;
+    {
+      std::lock_guard<std::mutex> lock(queue->m_lock);
+      if (queue->m_pending.empty())
+      {
+        queue->m_workerRunning = false;
+        break;
+      }
+      next = queue->m_pending.front();
+      queue->m_pending.pop_front();
+    }
+    next.second->Run(*queue, next.first);
+    next.second->Release();
+  }
+  // The queue may be freed with its owner here.
+  owner->Release();
+}
+
+DxcIntelliSenseOperation::DxcIntelliSenseOperation(
+  IDxcIntelliSenseCallback *callback, Work work)
+  : m_work(std::move(work)), m_cancelled(false), m_completed(false),
+    m_status(E_PENDING), m_callback(callback)
+{
+  m_pMalloc = DxcGetThreadMallocNoRef();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIntelliSenseOperation::Start(
+  DxcIntelliSenseQueue &queue, IUnknown *owner,
+  IDxcIntelliSenseCallback *callback, Work work,
+  IDxcIntelliSenseOperation **pOperation)
+{
+  *pOperation = nullptr;
+  CComPtr<DxcIntelliSenseOperation> operation =
+    new (std::nothrow) DxcIntelliSenseOperation(callback, std::move(work));
+  if (operation == nullptr) return E_OUTOFMEMORY;
+
+  HRESULT hr = queue.Enqueue(owner, operation);
+  if (FAILED(hr)) return hr;
+  *pOperation = operation.Detach();
+  return S_OK;
+}
+
+void DxcIntelliSenseOperation::Run(DxcIntelliSenseQueue &queue, uint64_t ticket)
+{
+  DxcThreadMalloc TM(m_pMalloc);
+  CComPtr<IUnknown> result;
+  HRESULT hr;
+  {
+    // The turn is given up before completion is reported, so the callback
+    // may queue further asynchronous requests.
+    RequestTurn turn(queue, ticket);
+    try
+    {
+      clang::ParseCancellationScope cancelScope(&m_cancelled);
+      hr = m_work(this, &result);
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    m_work = nullptr;
+  }
+  Complete(hr, result);
+}
+
+void DxcIntelliSenseOperation::Complete(HRESULT status, IUnknown *result)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_cancelled.load())
+      status = E_ABORT;
+    m_status = status;
+    if (SUCCEEDED(status))
+      m_result = result;
+    m_completed = true;
+  }
+  m_completedChanged.notify_all();
+
+  CComPtr<IDxcIntelliSenseCallback> callback;
+  callback.Attach(m_callback.Detach());
+  if (callback != nullptr)
+    callback->OnCompleted(this);
+}
+
+HRESULT DxcIntelliSenseOperation::Cancel()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (m_completed) return S_FALSE;
+  m_cancelled.store(true);
+  return S_OK;
+}
+
+HRESULT DxcIntelliSenseOperation::Wait()
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_completedChanged.wait(lock, [this] { return m_completed; });
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIntelliSenseOperation::IsCompleted(BOOL* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  std::lock_guard<std::mutex> lock(m_lock);
+  *pResult = m_completed;
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIntelliSenseOperation::GetStatus(HRESULT* pStatus)
+{
+  if (pStatus == nullptr) return E_POINTER;
+  std::lock_guard<std::mutex> lock(m_lock);
+  *pStatus = m_completed ? m_status : E_PENDING;
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIntelliSenseOperation::GetResult(REFIID iid, void** ppResult)
+{
+  if (ppResult == nullptr) return E_POINTER;
+  *ppResult = nullptr;
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (!m_completed) return E_PENDING;
+  if (FAILED(m_status)) return m_status;
+  return m_result->QueryInterface(iid, ppResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 DxcIntelliSense::DxcIntelliSense(IMalloc *pMalloc)
 {
   m_pMalloc = pMalloc;
@@ -1512,7 +1837,8 @@ HRESULT DxcToken::GetSpelling(LPSTR* pValue)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-DxcTranslationUnit::DxcTranslationUnit() : m_tu(nullptr)
+DxcTranslationUnit::DxcTranslationUnit()
+  : m_tu(nullptr)
 {
   m_pMalloc = DxcGetThreadMallocNoRef();
 }
@@ -1543,6 +1869,7 @@ _Use_decl_annotations_
 HRESULT DxcTranslationUnit::GetCursor(IDxcCursor** pCursor)
 {
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   if (m_tu == nullptr) return E_FAIL;
   return DxcCursor::Create(clang_getTranslationUnitCursor(m_tu), pCursor);
 }
@@ -1562,6 +1889,7 @@ HRESULT DxcTranslationUnit::Tokenize(
 
   // Only accept our own source range.
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   HRESULT hr = S_OK;
   DxcSourceRange* rangeImpl = reinterpret_cast<DxcSourceRange*>(range);
   IDxcToken** localTokens = nullptr;
@@ -1613,6 +1941,7 @@ HRESULT DxcTranslationUnit::GetLocation(
 
   if (file == nullptr) return E_INVALIDARG;
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   DxcFile* fileImpl = reinterpret_cast<DxcFile*>(file);
   return DxcSourceLocation::Create(clang_getLocation(m_tu, fileImpl->GetFile(), line, column), pResult);
 }
@@ -1621,6 +1950,7 @@ HRESULT DxcTranslationUnit::GetNumDiagnostics(_Out_ unsigned* pValue)
 {
   if (pValue == nullptr) return E_POINTER;
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   *pValue = clang_getNumDiagnostics(m_tu);
   return S_OK;
 }
@@ -1630,6 +1960,7 @@ HRESULT DxcTranslationUnit::GetDiagnostic(unsigned index, IDxcDiagnostic** pValu
 {
   if (pValue == nullptr) return E_POINTER;
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   return DxcDiagnostic::Create(clang_getDiagnostic(m_tu, index), pValue);
 }
 
@@ -1642,6 +1973,7 @@ HRESULT DxcTranslationUnit::GetFile(LPCSTR name, IDxcFile** pResult)
 
   // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   ::llvm::sys::fs::MSFileSystem* msfPtr;
   IFR(CreateMSFileSystemForDisk(&msfPtr));
   std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
@@ -1655,6 +1987,7 @@ _Use_decl_annotations_
 HRESULT DxcTranslationUnit::GetFileName(LPSTR* pResult)
 {
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   return CXStringToAnsiAndDispose(clang_getTranslationUnitSpelling(m_tu), pResult);
 }
 
@@ -1668,10 +2001,66 @@ HRESULT DxcTranslationUnit::Reparse(
   DxcThreadMalloc TM(m_pMalloc);
   hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &local_unsaved_files);
   if (FAILED(hr)) return hr;
-  int reparseResult = clang_reparseTranslationUnit(
-    m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
+  {
+    RequestTurn turn(m_queue);
+    hr = ReparseWithUnsavedFiles(local_unsaved_files, num_unsaved_files);
+  }
   CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
-  return reparseResult == 0 ? S_OK : E_FAIL;
+  return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::ReparseAsync(
+  IDxcUnsavedFile** unsaved_files,
+  unsigned num_unsaved_files,
+  IDxcIntelliSenseCallback* callback,
+  IDxcIntelliSenseOperation** pOperation)
+{
+  if (pOperation == nullptr) return E_POINTER;
+  *pOperation = nullptr;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try
+  {
+    std::shared_ptr<UnsavedFileCopies> files;
+    IFT(CopyUnsavedFiles(unsaved_files, num_unsaved_files, &files));
+    CComPtr<DxcTranslationUnit> tu(this);
+    return DxcIntelliSenseOperation::Start(m_queue,
+      static_cast<IDxcTranslationUnit *>(this), callback,
+      [tu, files](
+          DxcIntelliSenseOperation *operation, IUnknown **pResult) -> HRESULT {
+        if (operation->IsCancelled()) return E_ABORT;
+        HRESULT hr = tu->ReparseWithUnsavedFiles(files->Files, files->Count);
+        if (FAILED(hr)) return hr;
+        *pResult = static_cast<IDxcTranslationUnit *>(tu.p);
+        (*pResult)->AddRef();
+        return S_OK;
+      }, pOperation);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::ReparseWithUnsavedFiles(
+  CXUnsavedFile *unsaved_files,
+  unsigned num_unsaved_files)
+{
+  try
+  {
+    // Requests made with ReparseAsync run on a worker thread, which has no
+    // file system of its own.
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    int reparseResult = clang_reparseTranslationUnit(
+      m_tu, num_unsaved_files, unsaved_files, clang_defaultReparseOptions(m_tu));
+    return reparseResult == 0 ? S_OK : E_FAIL;
+  }
+  CATCH_CPP_RETURN_HRESULT();
 }
 
 _Use_decl_annotations_
@@ -1681,6 +2070,7 @@ HRESULT DxcTranslationUnit::GetCursorForLocation(IDxcSourceLocation* location, I
   if (pResult == nullptr) return E_POINTER;
   DxcSourceLocation* locationImpl = reinterpret_cast<DxcSourceLocation*>(location);
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   return DxcCursor::Create(clang_getCursor(m_tu, locationImpl->GetLocation()), pResult);
 }
 
@@ -1691,6 +2081,7 @@ HRESULT DxcTranslationUnit::GetLocationForOffset(IDxcFile* file, unsigned offset
   if (pResult == nullptr) return E_POINTER;
   DxcFile* fileImpl = reinterpret_cast<DxcFile*>(file);
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   return DxcSourceLocation::Create(clang_getLocationForOffset(m_tu, fileImpl->GetFile(), offset), pResult);
 }
 
@@ -1705,6 +2096,7 @@ HRESULT DxcTranslationUnit::GetSkippedRanges(IDxcFile* file, unsigned* pResultCo
   *pResult = nullptr;
 
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   DxcFile* fileImpl = reinterpret_cast<DxcFile*>(file);
 
   unsigned len = clang_ms_countSkippedRanges(m_tu, fileImpl->GetFile());
@@ -1769,6 +2161,7 @@ HRESULT DxcTranslationUnit::GetDiagnosticDetails(
 
   HRESULT hr = S_OK;
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   CXDiagnostic diag = clang_getDiagnostic(m_tu, index);
   hr = CXStringToBSTRAndDispose(clang_formatDiagnostic(diag, options), errorMessage);
   if (FAILED(hr))
@@ -1823,6 +2216,7 @@ HRESULT DxcTranslationUnit::GetInclusionList(unsigned *pResultCount,
   *pResultCount = 0;
   *pResult = nullptr;
   DxcThreadMalloc TM(m_pMalloc);
+  RequestTurn turn(m_queue);
   InclusionData D;
   D.result = S_OK;
   clang_getInclusions(m_tu, VisitInclusion, &D);
@@ -1858,24 +2252,228 @@ HRESULT DxcTranslationUnit::CodeCompleteAt(
   if (FAILED(hr))
     return hr;
 
-  CXCodeCompleteResults *results = clang_codeCompleteAt(
-      m_tu, fileName, line, column, files, numUnsavedFiles, options);
-
+  {
+    RequestTurn turn(m_queue);
+    hr = CodeCompleteWithUnsavedFiles(fileName, line, column, files,
+                                      numUnsavedFiles, options, pResult);
+  }
   CleanupUnsavedFiles(files, numUnsavedFiles);
+  return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::CodeCompleteAtAsync(
+  const char *fileName, unsigned line, unsigned column,
+  IDxcUnsavedFile **pUnsavedFiles, unsigned numUnsavedFiles,
+  DxcCodeCompleteFlags options, IDxcIntelliSenseCallback *callback,
+  IDxcIntelliSenseOperation **pOperation)
+{
+  if (pOperation == nullptr) return E_POINTER;
+  *pOperation = nullptr;
+  if (fileName == nullptr) return E_INVALIDARG;
 
-  if (results == nullptr) return E_FAIL;
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try
+  {
+    std::shared_ptr<UnsavedFileCopies> files;
+    IFT(CopyUnsavedFiles(pUnsavedFiles, numUnsavedFiles, &files));
+    std::string name(fileName);
+    CComPtr<DxcTranslationUnit> tu(this);
+    return DxcIntelliSenseOperation::Start(m_queue,
+      static_cast<IDxcTranslationUnit *>(this), callback,
+      [tu, files, name, line, column, options](
+          DxcIntelliSenseOperation *operation, IUnknown **pResult) -> HRESULT {
+        if (operation->IsCancelled()) return E_ABORT;
+        CComPtr<IDxcCodeCompleteResults> results;
+        HRESULT hr = tu->CodeCompleteWithUnsavedFiles(name.c_str(), line,
+          column, files->Files, files->Count, options, &results);
+        if (FAILED(hr)) return hr;
+        *pResult = results.Detach();
+        return S_OK;
+      }, pOperation);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::CodeCompleteWithUnsavedFiles(
+  const char *fileName, unsigned line, unsigned column,
+  CXUnsavedFile *files, unsigned numUnsavedFiles,
+  DxcCodeCompleteFlags options, IDxcCodeCompleteResults **pResult)
+{
+  try
+  {
+    // As in ReparseWithUnsavedFiles.
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    CXCodeCompleteResults *results = clang_codeCompleteAt(
+        m_tu, fileName, line, column, files, numUnsavedFiles, options);
+
+    if (results == nullptr) return E_FAIL;
+    *pResult = nullptr;
+    DxcCodeCompleteResults *newValue =
+        new (std::nothrow) DxcCodeCompleteResults();
+    if (newValue == nullptr)
+    {
+      clang_disposeCodeCompleteResults(results);
+      return E_OUTOFMEMORY;
+    }
+    newValue->Initialize(results);
+    newValue->AddRef();
+    *pResult = newValue;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+namespace {
+struct OutlineFrame
+{
+  CXCursor cursor;
+  unsigned nodeIndex; // The node of the cursor or of its closest ancestor.
+};
+
+struct OutlineVisitorContext
+{
+  CXFile file;
+  bool hasRange;
+  unsigned rangeStart;
+  unsigned rangeEnd;
+  std::vector<bool> kinds; // Empty to include all kinds.
+  std::vector<OutlineFrame> frames;
+  std::vector<DxcCursorOutlineNode> nodes;
+  std::string strings;
+  llvm::StringMap<unsigned> stringOffsets;
+
+  unsigned AddString(const char *value)
+  {
+    if (value == nullptr || *value == '\0')
+      return 0;
+    auto inserted = stringOffsets.insert(
+      std::make_pair(value, (unsigned)strings.size()));
+    if (inserted.second)
+    {
+      strings.append(value);
+      strings.push_back('\0');
+    }
+    return inserted.first->second;
+  }
+};
+}
+
+static
+CXChildVisitResult LIBCLANG_CC OutlineVisit(CXCursor cursor, CXCursor parent, CXClientData client_data)
+{
+  OutlineVisitorContext* context = (OutlineVisitorContext*)client_data;
+  CXSourceRange extent = clang_getCursorExtent(cursor);
+  CXFile startFile, endFile;
+  unsigned startLine, startColumn, startOffset;
+  unsigned endLine, endColumn, endOffset;
+  clang_getExpansionLocation(clang_getRangeStart(extent), &startFile, &startLine, &startColumn, &startOffset);
+  clang_getExpansionLocation(clang_getRangeEnd(extent), &endFile, &endLine, &endColumn, &endOffset);
+  if (startFile == nullptr || !clang_File_isEqual(startFile, context->file))
+    return CXChildVisit_Continue;
+  if (context->hasRange &&
+      (startOffset > context->rangeEnd || endOffset < context->rangeStart))
+    return CXChildVisit_Continue;
+
+  while (!context->frames.empty() &&
+         !clang_equalCursors(context->frames.back().cursor, parent))
+    context->frames.pop_back();
+  unsigned parentIndex = context->frames.empty()
+    ? DxcCursorOutlineNoParent : context->frames.back().nodeIndex;
+
+  CXCursorKind kind = clang_getCursorKind(cursor);
+  unsigned nodeIndex = parentIndex;
+  if (context->kinds.empty() ||
+      ((unsigned)kind < context->kinds.size() && context->kinds[kind]))
+  {
+    DxcCursorOutlineNode node;
+    node.Kind = (DxcCursorKind)kind;
+    node.KindFlags = GetCursorKindFlags(kind);
+    node.ParentIndex = parentIndex;
+    CXString name = clang_getCursorSpelling(cursor);
+    node.NameOffset = context->AddString(clang_getCString(name));
+    clang_disposeString(name);
+    node.StartOffset = startOffset;
+    node.StartLine = startLine;
+    node.StartColumn = startColumn;
+    node.EndOffset = endOffset;
+    node.EndLine = endLine;
+    node.EndColumn = endColumn;
+    nodeIndex = context->nodes.size();
+    context->nodes.push_back(node);
+  }
+
+  OutlineFrame frame = { cursor, nodeIndex };
+  context->frames.push_back(frame);
+  return CXChildVisit_Recurse;
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::GetCursorOutline(
+  IDxcSourceRange* range, const DxcCursorKind* kinds, unsigned numKinds,
+  DxcCursorOutline** pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
   *pResult = nullptr;
-  DxcCodeCompleteResults *newValue =
-      new (std::nothrow) DxcCodeCompleteResults();
-  if (newValue == nullptr)
+  if (numKinds > 0 && kinds == nullptr) return E_INVALIDARG;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
   {
-	  clang_disposeCodeCompleteResults(results);
-	  return E_OUTOFMEMORY;
+    RequestTurn turn(m_queue);
+    OutlineVisitorContext context;
+    context.hasRange = range != nullptr;
+    context.rangeStart = 0;
+    context.rangeEnd = 0;
+    if (range != nullptr)
+    {
+      const CXSourceRange &rangeImpl = reinterpret_cast<DxcSourceRange*>(range)->GetRange();
+      CXFile endFile;
+      unsigned line, column;
+      clang_getExpansionLocation(clang_getRangeStart(rangeImpl), &context.file, &line, &column, &context.rangeStart);
+      clang_getExpansionLocation(clang_getRangeEnd(rangeImpl), &endFile, &line, &column, &context.rangeEnd);
+    }
+    else
+    {
+      CXString fileName = clang_getTranslationUnitSpelling(m_tu);
+      context.file = clang_getFile(m_tu, clang_getCString(fileName));
+      clang_disposeString(fileName);
+    }
+    if (context.file == nullptr) return E_INVALIDARG;
+
+    for (unsigned i = 0; i < numKinds; ++i)
+    {
+      if ((unsigned)kinds[i] >= context.kinds.size())
+        context.kinds.resize((unsigned)kinds[i] + 1);
+      context.kinds[kinds[i]] = true;
+    }
+    context.strings.push_back('\0'); // Offset 0 is the empty name.
+
+    clang_visitChildren(clang_getTranslationUnitCursor(m_tu), OutlineVisit, &context);
+
+    size_t nodesSize = context.nodes.size() * sizeof(DxcCursorOutlineNode);
+    size_t totalSize = sizeof(DxcCursorOutline) + nodesSize + context.strings.size();
+    if (totalSize > UINT32_MAX) return E_OUTOFMEMORY;
+    DxcCursorOutline *outline = (DxcCursorOutline *)CoTaskMemAlloc(totalSize);
+    if (outline == nullptr) return E_OUTOFMEMORY;
+    outline->NodeCount = context.nodes.size();
+    outline->StringTableOffset = sizeof(DxcCursorOutline) + nodesSize;
+    outline->StringTableSize = context.strings.size();
+    outline->TotalSize = totalSize;
+    if (nodesSize != 0)
+      memcpy(outline + 1, context.nodes.data(), nodesSize);
+    memcpy((char *)outline + outline->StringTableOffset, context.strings.data(), context.strings.size());
+    *pResult = outline;
+    return S_OK;
   }
-  newValue->Initialize(results);
-  newValue->AddRef();
-  *pResult = newValue;
-  return S_OK;
+  CATCH_CPP_RETURN_HRESULT();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
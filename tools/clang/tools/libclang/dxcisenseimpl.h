@@ -17,6 +17,11 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 
 // Forward declarations.
 class DxcCursor;
@@ -24,6 +29,8 @@ class DxcDiagnostic;
 class DxcFile;
 class DxcIndex;
 class DxcIntelliSense;
+class DxcIntelliSenseOperation;
+class DxcIntelliSenseQueue;
 class DxcSourceLocation;
 class DxcSourceRange;
 class DxcTranslationUnit;
@@ -157,18 +164,102 @@ public:
   HRESULT STDMETHODCALLTYPE GetStackItem(unsigned index, _Outptr_result_nullonfailure_ IDxcSourceLocation **pResult) override;
 };
 
-class DxcIndex : public IDxcIndex
+// Runs the requests to an index or translation unit one at a time, in the
+// order they were made. Each request takes a ticket and runs when it is
+// served; the asynchronous ones are run by a single worker thread, which is
+// started by the first of them and ends once none are left.
+class DxcIntelliSenseQueue
+{
+private:
+    std::mutex m_lock;
+    std::condition_variable m_served;
+    uint64_t m_nextTicket;
+    uint64_t m_servingTicket;
+    std::deque<std::pair<uint64_t, DxcIntelliSenseOperation *>> m_pending;
+    bool m_workerRunning;
+
+    static void RunWorker(DxcIntelliSenseQueue *queue, IUnknown *owner);
+public:
+    DxcIntelliSenseQueue();
+
+    uint64_t TakeTicket();
+    void WaitForTicket(uint64_t ticket);
+    void FinishTicket();
+
+    /// Queues operation behind the requests already made. owner, which holds
+    /// the queue, is kept alive while the worker runs.
+    HRESULT Enqueue(IUnknown *owner, DxcIntelliSenseOperation *operation);
+};
+
+class DxcIntelliSenseOperation : public IDxcIntelliSenseOperation
+{
+public:
+    typedef std::function<HRESULT(DxcIntelliSenseOperation *, IUnknown **)> Work;
+
+private:
+    DXC_MICROCOM_TM_REF_FIELDS()
+    Work m_work;
+    std::atomic<bool> m_cancelled;
+    std::mutex m_lock;
+    std::condition_variable m_completedChanged;
+    bool m_completed;
+    HRESULT m_status;
+    CComPtr<IUnknown> m_result;
+    CComPtr<IDxcIntelliSenseCallback> m_callback;
+public:
+    DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
+    {
+      return DoBasicQueryInterface<IDxcIntelliSenseOperation>(this, iid, ppvObject);
+    }
+
+    DxcIntelliSenseOperation(IDxcIntelliSenseCallback *callback, Work work);
+
+    /// Queues work on the worker of queue, then completes the operation with
+    /// the object it produced or the error it returned.
+    static HRESULT Start(
+      DxcIntelliSenseQueue &queue, _In_ IUnknown *owner,
+      _In_opt_ IDxcIntelliSenseCallback *callback, Work work,
+      _COM_Outptr_ IDxcIntelliSenseOperation **pOperation);
+
+    /// Runs the work in the turn of ticket, then reports completion.
+    void Run(DxcIntelliSenseQueue &queue, uint64_t ticket);
+
+    const std::atomic<bool> *GetCancelledFlag() const { return &m_cancelled; }
+    bool IsCancelled() const { return m_cancelled.load(); }
+
+    HRESULT STDMETHODCALLTYPE Cancel() override;
+    HRESULT STDMETHODCALLTYPE Wait() override;
+    HRESULT STDMETHODCALLTYPE IsCompleted(_Out_ BOOL* pResult) override;
+    HRESULT STDMETHODCALLTYPE GetStatus(_Out_ HRESULT* pStatus) override;
+    HRESULT STDMETHODCALLTYPE GetResult(_In_ REFIID iid, _COM_Outptr_ void** ppResult) override;
+
+private:
+    void Complete(HRESULT status, IUnknown *result);
+};
+
+class DxcIndex : public IDxcIndex, public IDxcIndexAsync
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXIndex m_index;
     DxcGlobalOptions m_options;
     hlsl::DxcLangExtensionsHelper m_langHelper;
+    DxcIntelliSenseQueue m_parseQueue;
+
+    HRESULT ParseWithUnsavedFiles(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args,
+      _In_count_(num_unsaved_files) CXUnsavedFile *unsaved_files,
+      unsigned num_unsaved_files,
+      DxcTranslationUnitFlags options,
+      _Outptr_result_nullonfailure_ IDxcTranslationUnit** pTranslationUnit);
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
     {
-      return DoBasicQueryInterface<IDxcIndex>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcIndex, IDxcIndexAsync>(this, iid, ppvObject);
     }
 
     DxcIndex();
@@ -186,6 +277,16 @@ public:
       unsigned num_unsaved_files,
       DxcTranslationUnitFlags options,
       _Outptr_result_nullonfailure_ IDxcTranslationUnit** pTranslationUnit) override;
+
+    HRESULT STDMETHODCALLTYPE ParseTranslationUnitAsync(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args,
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files,
+      DxcTranslationUnitFlags options,
+      _In_opt_ IDxcIntelliSenseCallback* callback,
+      _COM_Outptr_ IDxcIntelliSenseOperation** pOperation) override;
 };
 
 class DxcIntelliSense : public IDxcIntelliSense, public IDxcLangExtensions {
@@ -298,16 +399,29 @@ public:
   HRESULT STDMETHODCALLTYPE GetSpelling(_Outptr_result_maybenull_ LPSTR* pValue) override;
 };
 
-class DxcTranslationUnit : public IDxcTranslationUnit
+class DxcTranslationUnit : public IDxcTranslationUnit2, public IDxcTranslationUnitAsync
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXTranslationUnit m_tu;
+
+    // Every request reads or replaces m_tu, so all of them, synchronous or
+    // not, run in turn.
+    DxcIntelliSenseQueue m_queue;
+
+    HRESULT ReparseWithUnsavedFiles(
+      _In_count_(num_unsaved_files) CXUnsavedFile *unsaved_files,
+      unsigned num_unsaved_files);
+    HRESULT CodeCompleteWithUnsavedFiles(
+      _In_z_ const char *fileName, unsigned line, unsigned column,
+      _In_count_(numUnsavedFiles) CXUnsavedFile *pUnsavedFiles,
+      unsigned numUnsavedFiles, DxcCodeCompleteFlags options,
+      _Outptr_result_nullonfailure_ IDxcCodeCompleteResults **pResult);
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
     {
-      return DoBasicQueryInterface<IDxcTranslationUnit>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcTranslationUnit, IDxcTranslationUnit2, IDxcTranslationUnitAsync>(this, iid, ppvObject);
     }
 
     DxcTranslationUnit();
@@ -348,6 +462,23 @@ public:
       _In_ DxcCodeCompleteFlags options,
       _Outptr_result_nullonfailure_ IDxcCodeCompleteResults **pResult)
       override;
+
+    HRESULT STDMETHODCALLTYPE GetCursorOutline(
+      _In_opt_ IDxcSourceRange* range,
+      _In_count_(numKinds) const DxcCursorKind* kinds, unsigned numKinds,
+      _Outptr_result_nullonfailure_ DxcCursorOutline** pResult) override;
+
+    HRESULT STDMETHODCALLTYPE ReparseAsync(
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files,
+      _In_opt_ IDxcIntelliSenseCallback* callback,
+      _COM_Outptr_ IDxcIntelliSenseOperation** pOperation) override;
+    HRESULT STDMETHODCALLTYPE CodeCompleteAtAsync(
+      _In_z_ const char *fileName, unsigned line, unsigned column,
+      _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles, unsigned numUnsavedFiles,
+      _In_ DxcCodeCompleteFlags options,
+      _In_opt_ IDxcIntelliSenseCallback* callback,
+      _COM_Outptr_ IDxcIntelliSenseOperation** pOperation) override;
 };
 
 class DxcType : public IDxcType
@@ -15,6 +15,8 @@
 #include "HlslTestUtils.h"
 
 #include "dxc/HLSL/DxilSpanAllocator.h"
+#include "dxc/Support/WinFunctions.h"
+#include "dxc/Support/DxcMemoryAccounting.h"
 #include <cstdlib>
 #include <random>
 #include <algorithm>
@@ -547,6 +549,7 @@ public:
   TEST_METHOD(Intersections)
   TEST_METHOD(GapFilling)
   TEST_METHOD(Allocate)
+  TEST_METHOD(MemoryAccounting)
 
   void InitScenarios() {
     struct P {
@@ -766,3 +769,62 @@ TEST_F(AllocatorTest, Allocate) {
     TestSizesFn();
   }
 }
+
+TEST_F(AllocatorTest, MemoryAccounting) {
+  // Sizes are recorded by the accounting allocator, so the inner allocator
+  // needn't report them, and blocks it didn't charge are freed uncharged.
+  CComPtr<IMalloc> pHost;
+  VERIFY_SUCCEEDED(CoGetMalloc(1, &pHost));
+  CComPtr<DxcMemoryAccountingMalloc> pAccounting =
+      DxcMemoryAccountingMalloc::Alloc(pHost);
+  VERIFY_IS_NOT_NULL(pAccounting.p);
+
+  void *pA = pAccounting->Alloc(100);
+  void *pB = pAccounting->Alloc(28);
+  VERIFY_IS_NOT_NULL(pA);
+  VERIFY_IS_NOT_NULL(pB);
+  VERIFY_ARE_EQUAL(128u, pAccounting->GetCurrentBytes());
+  pB = pAccounting->Realloc(pB, 1000);
+  VERIFY_IS_NOT_NULL(pB);
+  VERIFY_ARE_EQUAL(1100u, pAccounting->GetCurrentBytes());
+  pAccounting->Free(pA);
+  VERIFY_ARE_EQUAL(1000u, pAccounting->GetCurrentBytes());
+
+  void *pForeign = pHost->Alloc(64);
+  VERIFY_IS_NOT_NULL(pForeign);
+  pAccounting->Free(pForeign);
+  VERIFY_ARE_EQUAL(1000u, pAccounting->GetCurrentBytes());
+  // A foreign block that is reallocated is charged at its new size.
+  pForeign = pAccounting->Realloc(pHost->Alloc(16), 32);
+  VERIFY_IS_NOT_NULL(pForeign);
+  VERIFY_ARE_EQUAL(1032u, pAccounting->GetCurrentBytes());
+  pAccounting->Free(pForeign);
+  pAccounting->Free(pB);
+  VERIFY_ARE_EQUAL(0u, pAccounting->GetCurrentBytes());
+  // A reallocation is charged its new size before the old one is released.
+  VERIFY_ARE_EQUAL(1128u, pAccounting->GetPeakBytes());
+
+  // Blocks allocated elsewhere, as by operator new, are uncharged once.
+  int Block;
+  VERIFY_IS_TRUE(pAccounting->ChargeBlock(&Block, sizeof(Block)));
+  VERIFY_ARE_EQUAL(sizeof(Block), pAccounting->GetCurrentBytes());
+  pAccounting->UnchargeBlock(&Block);
+  pAccounting->UnchargeBlock(&Block);
+  VERIFY_ARE_EQUAL(0u, pAccounting->GetCurrentBytes());
+
+  // Enough blocks to grow the size table.
+  std::vector<void *> Blocks;
+  for (unsigned i = 0; i < 1000; ++i) {
+    Blocks.push_back(pAccounting->Alloc(8));
+    VERIFY_IS_NOT_NULL(Blocks.back());
+  }
+  VERIFY_ARE_EQUAL(8000u, pAccounting->GetCurrentBytes());
+  for (void *pBlock : Blocks)
+    pAccounting->Free(pBlock);
+  VERIFY_ARE_EQUAL(0u, pAccounting->GetCurrentBytes());
+
+  pAccounting->SetLimit(64);
+  VERIFY_IS_NULL(pAccounting->Alloc(100));
+  VERIFY_IS_TRUE(pAccounting->LimitExceeded());
+  VERIFY_ARE_EQUAL(0u, pAccounting->GetCurrentBytes());
+}
@@ -17,6 +17,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <cassert>
 #include <sstream>
 #include <algorithm>
@@ -36,6 +38,7 @@
 #include "llvm/Support/raw_os_ostream.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/dxcapi.use.h"
+#include "dxc/Support/DxcTrace.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/Support/Unicode.h"
@@ -206,6 +209,7 @@ public:
   TEST_METHOD(CompileWhenDebugThenDIPresent)
   TEST_METHOD(CompileDebugLines)
   TEST_METHOD(CompileDebugPDB)
+  TEST_METHOD(CompileDebugWhenSourceStoreThenDiaReadsStore)
 
   TEST_METHOD(CompileWhenDefinesThenApplied)
   TEST_METHOD(CompileWhenDefinesManyThenApplied)
@@ -216,9 +220,19 @@ public:
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
   TEST_METHOD(CompileThenAddCustomDebugName)
   TEST_METHOD(CompileWithRootSignatureThenStripRootSignature)
+  TEST_METHOD(CompileWhenStatsJsonThenStatisticsPart)
+  TEST_METHOD(CompileWhenDedupKnownThenIdenticalResult)
+  TEST_METHOD(CompileWhenDedupThenGlobalNamesIgnored)
+  TEST_METHOD(CompileWhenConstArrayDataDiffersThenHashDiffers)
+  TEST_METHOD(CompileWhenMemoryLimitThenPeakReported)
+  TEST_METHOD(CompileWhenArgsClonedThenApplied)
+  TEST_METHOD(CompileWhenArgsForeignThenInvalidArg)
+  TEST_METHOD(CompileWhenTraceCallbackThenPhasesReported)
+  TEST_METHOD(TraceWhenTraceFileThenChromeJsonWritten)
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
+  TEST_METHOD(CompileWhenIncludeNullTerminatedThenUsedInPlace)
   TEST_METHOD(CompileWhenIncludeAbsoluteThenLoadAbsolute)
   TEST_METHOD(CompileWhenIncludeLocalThenLoadRelative)
   TEST_METHOD(CompileWhenIncludeSystemThenLoadNotRelative)
@@ -1167,6 +1181,76 @@ TEST_F(CompilerTest, CompileDebugLines) {
   VERIFY_SUCCEEDED(pFile->get_fileName(&pName));
   VERIFY_ARE_EQUAL_WSTR(pName, L"source.hlsl");
 }
+
+TEST_F(CompilerTest, CompileDebugWhenSourceStoreThenDiaReadsStore) {
+  const char *hlsl = "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return abs(pos) * 42;\r\n"
+                     "}";
+  TempDirectoryForTest StoreDir;
+
+  CComPtr<IDxcLibrary> pLib;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLib));
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler2> pCompiler2;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pPdbBlob;
+  WCHAR *pDebugName = nullptr;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler2));
+  CreateBlobFromText(hlsl, &pSource);
+  LPCWSTR args[] = { L"/Zi", L"/Qsource_store", StoreDir.GetPath().c_str() };
+  VERIFY_SUCCEEDED(pCompiler2->CompileWithDebug(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult, &pDebugName, &pPdbBlob));
+  CoTaskMemFree(pDebugName);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // The PDB only refers to the source.
+  std::string pdb((const char *)pPdbBlob->GetBufferPointer(),
+                  pPdbBlob->GetBufferSize());
+  VERIFY_ARE_EQUAL(std::string::npos, pdb.find("abs(pos) * 42"));
+
+  CComPtr<IDiaDataSource> pDiaSource;
+  CComPtr<IStream> pProgramStream;
+  VERIFY_SUCCEEDED(pLib->CreateStreamFromBlobReadOnly(pPdbBlob, &pProgramStream));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcDiaDataSource, &pDiaSource));
+  VERIFY_SUCCEEDED(pDiaSource->loadDataFromIStream(pProgramStream));
+  std::wstring diaFileContent = GetDebugFileContent(pDiaSource);
+  VERIFY_IS_NOT_NULL(wcsstr(diaFileContent.c_str(), L"return abs(pos) * 42;"));
+
+  // A source that no longer matches its hash is not read from the store.
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW((StoreDir.GetPath() + L"\\*").c_str(),
+                                &findData);
+  VERIFY_ARE_NOT_EQUAL(INVALID_HANDLE_VALUE, hFind);
+  std::wstring storedName;
+  do {
+    if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+      storedName = findData.cFileName;
+  } while (FindNextFileW(hFind, &findData));
+  FindClose(hFind);
+  VERIFY_IS_FALSE(storedName.empty());
+  {
+    CHandle hStored(CreateFileW(
+        (StoreDir.GetPath() + L"\\" + storedName).c_str(), GENERIC_WRITE, 0,
+        nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    DWORD written;
+    VERIFY_WIN32_BOOL_SUCCEEDED(WriteFile(hStored, "tampered", 8, &written,
+                                          nullptr));
+  }
+
+  CComPtr<IDiaDataSource> pTamperedSource;
+  CComPtr<IStream> pTamperedStream;
+  CComPtr<IDiaSession> pSession;
+  CComPtr<IDiaEnumInjectedSources> pInjectedSources;
+  VERIFY_SUCCEEDED(pLib->CreateStreamFromBlobReadOnly(pPdbBlob, &pTamperedStream));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcDiaDataSource, &pTamperedSource));
+  VERIFY_SUCCEEDED(pTamperedSource->loadDataFromIStream(pTamperedStream));
+  VERIFY_SUCCEEDED(pTamperedSource->openSession(&pSession));
+  VERIFY_FAILED(pSession->findInjectedSource(L"source.hlsl", &pInjectedSources));
+}
 #endif // _WIN32 - exclude dia stuff
 
 TEST_F(CompilerTest, CompileWhenDefinesThenApplied) {
@@ -1577,6 +1661,48 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
   VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
 }
 
+TEST_F(CompilerTest, CompileWhenIncludeNullTerminatedThenUsedInPlace) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  // Large enough for the header to be mapped rather than read, and for a
+  // copy of it to outweigh everything else the compile allocates.
+  std::string header("#define ZERO 0\n");
+  header.append(16 * 1024 * 1024, ' ');
+  header.push_back('\n');
+
+  auto CompileWithHeader = [&](bool nullTerminated, UINT64 *pPeakBytes) {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back(header.c_str());
+    // The null terminator is not part of the header, so it draws no warning.
+    if (nullTerminated)
+      pInclude->CallResults.back().source.push_back('\0');
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+    CComPtr<IDxcBlobEncoding> pErrors;
+    VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrors));
+    VERIFY_ARE_EQUAL_STR("", BlobToUtf8(pErrors).c_str());
+    CComPtr<IDxcOperationResultMemoryUsage> pUsage;
+    VERIFY_SUCCEEDED(pResult.QueryInterface(&pUsage));
+    VERIFY_SUCCEEDED(pUsage->GetPeakMemoryUsage(pPeakBytes));
+  };
+
+  // Used in place, the header is never copied into compiler memory; read
+  // into a copy, it is.
+  UINT64 mappedPeakBytes = 0, copiedPeakBytes = 0;
+  CompileWithHeader(true, &mappedPeakBytes);
+  CompileWithHeader(false, &copiedPeakBytes);
+  VERIFY_IS_TRUE(mappedPeakBytes < header.size());
+  VERIFY_IS_TRUE(copiedPeakBytes > mappedPeakBytes + header.size() / 2);
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2826,6 +2952,513 @@ TEST_F(CompilerTest, SanitizePDBName) {
   VERIFY_IS_TRUE(0 == strcmp(Name, "my_pdb.pdb"));
 }
 
+TEST_F(CompilerTest, CompileWhenStatsJsonThenStatisticsPart) {
+  const char *hlsl = R"(
+    Texture2D<float4> tex : register(t0);
+    SamplerState samp : register(s0);
+    float4 main(float2 uv : TEXCOORD) : SV_Target {
+      float4 c = 0;
+      [unroll] for (int i = 0; i < 4; i++)
+        c += tex.Sample(samp, uv * i);
+      return c;
+    }
+  )";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(hlsl, &pSource);
+  LPCWSTR args[] = { L"-fstats-json" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  CComPtr<IDxcContainerReflection> pReflection;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pReflection));
+  VERIFY_SUCCEEDED(pReflection->Load(pProgram));
+
+  CComPtr<IDxcBlob> pStatsBlob;
+  UINT32 uStatsIndex = 0;
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_CompileStatistics, &uStatsIndex));
+  VERIFY_SUCCEEDED(pReflection->GetPartContent(uStatsIndex, &pStatsBlob));
+  VERIFY_ARE_EQUAL(0u, pStatsBlob->GetBufferSize() % 4);
+  // The JSON has its own part; STAT is left to the binary statistics readers
+  // expect there.
+  UINT32 uShaderStatsIndex = 0;
+  VERIFY_FAILED(pReflection->FindFirstPartKind(hlsl::DFCC_ShaderStatistics, &uShaderStatsIndex));
+
+  std::string Stats((const char *)pStatsBlob->GetBufferPointer(),
+                    pStatsBlob->GetBufferSize());
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, Stats.find("\"shaderModel\": \"ps_6_0\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, Stats.find("\"sample\": 4"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, Stats.find("\"name\": \"tex\", \"space\": 0, \"lowerBound\": 0, \"dxilOpCalls\": 4"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, Stats.find("\"DxilLoopUnroll.UnrolledLoops\": 1"));
+}
+
+namespace {
+// Trace events received on one thread; the callback is process-wide and other
+// tests may be compiling concurrently.
+struct TraceEventLog {
+  struct Event {
+    std::string Name;
+    bool IsBegin;
+    HRESULT Status;
+    UINT64 TimestampNs;
+  };
+  std::thread::id ThreadId = std::this_thread::get_id();
+  std::mutex Mutex;
+  std::vector<Event> Events;
+};
+}
+
+static void __stdcall RecordTraceEvent(void *pUserData, LPCSTR pEventName,
+                                       BOOL isBegin, HRESULT status,
+                                       UINT64 timestampNs) {
+  TraceEventLog *pLog = (TraceEventLog *)pUserData;
+  if (std::this_thread::get_id() != pLog->ThreadId)
+    return;
+  std::lock_guard<std::mutex> lock(pLog->Mutex);
+  pLog->Events.push_back({ pEventName, isBegin != FALSE, status, timestampNs });
+}
+
+TEST_F(CompilerTest, CompileWhenTraceCallbackThenPhasesReported) {
+  DxcSetTraceCallbackProc pSetTraceCallback =
+      m_dllSupport.GetProcedure<DxcSetTraceCallbackProc>("DxcSetTraceCallback");
+  VERIFY_IS_NOT_NULL(pSetTraceCallback);
+
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return pos * 2;\r\n"
+                     "}", &pSource);
+
+  TraceEventLog Log;
+  VERIFY_SUCCEEDED(pSetTraceCallback(RecordTraceEvent, &Log));
+  HRESULT hrCompile = pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult);
+  VERIFY_SUCCEEDED(pSetTraceCallback(nullptr, nullptr));
+  VERIFY_SUCCEEDED(hrCompile);
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+
+  // Every end matches the innermost open begin, times don't go backwards,
+  // and all phases succeeded.
+  std::vector<std::string> Open;
+  std::vector<std::string> Completed;
+  UINT64 LastTimestampNs = 0;
+  for (const TraceEventLog::Event &E : Log.Events) {
+    VERIFY_IS_TRUE(E.TimestampNs >= LastTimestampNs);
+    LastTimestampNs = E.TimestampNs;
+    if (E.IsBegin) {
+      Open.push_back(E.Name);
+      continue;
+    }
+    VERIFY_IS_FALSE(Open.empty());
+    VERIFY_ARE_EQUAL(Open.back(), E.Name);
+    VERIFY_SUCCEEDED(E.Status);
+    Open.pop_back();
+    Completed.push_back(E.Name);
+  }
+  VERIFY_IS_TRUE(Open.empty());
+
+  const char *ExpectedPhases[] = { "Frontend.IRGeneration",
+                                   "Backend.PerModulePasses",
+                                   "Validation.Module",
+                                   "SerializeDxilContainer" };
+  for (const char *pPhase : ExpectedPhases) {
+    VERIFY_IS_TRUE(std::find(Completed.begin(), Completed.end(), pPhase) !=
+                   Completed.end());
+  }
+
+  // Nothing is reported once the callback is cleared.
+  size_t EventCount = Log.Events.size();
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VERIFY_ARE_EQUAL(EventCount, Log.Events.size());
+}
+
+static void SetTraceFileVariable(const char *pValue) {
+#ifdef _WIN32
+  VERIFY_ARE_EQUAL(0, _putenv_s("DXC_TRACE_FILE", pValue));
+#else
+  VERIFY_ARE_EQUAL(0, *pValue ? setenv("DXC_TRACE_FILE", pValue, 1)
+                              : unsetenv("DXC_TRACE_FILE"));
+#endif
+}
+
+TEST_F(CompilerTest, TraceWhenTraceFileThenChromeJsonWritten) {
+  // This drives the trace writer linked into the test itself; the loaded
+  // compiler opened (or didn't open) its own trace file when it was loaded.
+  TempDirectoryForTest TraceDir;
+  std::wstring TracePath = TraceDir.GetFilePath(L"trace.json");
+  std::string TracePathUtf8;
+  VERIFY_IS_TRUE(Unicode::UTF16ToUTF8String(TracePath.c_str(), &TracePathUtf8));
+
+  SetTraceFileVariable(TracePathUtf8.c_str());
+  DxcTraceInitialize();
+  SetTraceFileVariable("");
+  VERIFY_IS_TRUE(DxcIsTraceEnabled());
+  {
+    DxcTraceScope Outer("Outer");
+    DxcTraceScope Inner("Inner\"Quoted");
+    Inner.SetStatus(E_FAIL);
+  }
+  DxcTraceShutdown();
+  VERIFY_IS_FALSE(DxcIsTraceEnabled());
+
+  CComPtr<IDxcLibrary> pLib;
+  CComPtr<IDxcBlobEncoding> pTrace;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLib));
+  VERIFY_SUCCEEDED(pLib->CreateBlobFromFile(TracePath.c_str(), nullptr, &pTrace));
+  std::string Trace((const char *)pTrace->GetBufferPointer(),
+                    pTrace->GetBufferSize());
+
+  // A JSON array of trace events, closed by the process-name metadata event.
+  VERIFY_ARE_EQUAL(0u, Trace.find("[\n"));
+  VERIFY_IS_TRUE(Trace.size() > 4);
+  VERIFY_ARE_EQUAL(Trace.size() - 4, Trace.rfind("}\n]\n"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, Trace.find(
+      "{\"name\":\"process_name\",\"ph\":\"M\""));
+
+  // Begin and end events nest, and names are escaped for JSON.
+  size_t OuterBegin = Trace.find("{\"name\":\"Outer\",\"cat\":\"dxc\",\"ph\":\"B\"");
+  size_t InnerBegin = Trace.find("{\"name\":\"Inner_Quoted\",\"cat\":\"dxc\",\"ph\":\"B\"");
+  size_t InnerEnd = Trace.find("{\"name\":\"Inner_Quoted\",\"cat\":\"dxc\",\"ph\":\"E\"");
+  size_t OuterEnd = Trace.find("{\"name\":\"Outer\",\"cat\":\"dxc\",\"ph\":\"E\"");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, OuterBegin);
+  VERIFY_IS_TRUE(OuterBegin < InnerBegin);
+  VERIFY_IS_TRUE(InnerBegin < InnerEnd);
+  VERIFY_IS_TRUE(InnerEnd < OuterEnd);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, OuterEnd);
+
+  // End events carry the phase status.
+  size_t InnerStatus = Trace.find("\"args\":{\"hr\":\"0x80004005\"}", InnerEnd);
+  VERIFY_IS_TRUE(InnerStatus < OuterEnd);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+      Trace.find("\"args\":{\"hr\":\"0x00000000\"}", OuterEnd));
+}
+
+TEST_F(CompilerTest, CompileWhenMemoryLimitThenPeakReported) {
+  const char *hlsl = R"(
+    float4 main(float4 pos : SV_Position) : SV_Target { return pos * 2; }
+  )";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(hlsl, &pSource);
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcOperationResultMemoryUsage> pUsage;
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pUsage));
+  UINT64 peakBytes = 0;
+  VERIFY_SUCCEEDED(pUsage->GetPeakMemoryUsage(&peakBytes));
+  VERIFY_IS_TRUE(peakBytes > 0);
+
+  pResult.Release();
+  LPCWSTR args[] = { L"-memory-limit", L"1" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_ARE_EQUAL(E_OUTOFMEMORY, status);
+  CComPtr<IDxcBlobEncoding> pErrors;
+  VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrors));
+  std::string Errors((const char *)pErrors->GetBufferPointer(),
+                     pErrors->GetBufferSize());
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       Errors.find("exceeded the memory limit of 1 MB"));
+}
+
+TEST_F(CompilerTest, CompileWhenArgsClonedThenApplied) {
+  const char *hlsl = R"(
+    float4 main(float4 pos : SV_Position) : SV_Target {
+    #ifndef SCALE
+    #error SCALE not defined
+    #endif
+      return pos * SCALE;
+    }
+    float4 other(float4 pos : SV_Position) : SV_Target { return pos; }
+  )";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler3> pCompiler3;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler3));
+  CreateBlobFromText(hlsl, &pSource);
+
+  // 16-bit types need shader model 6.2, so these arguments are invalid.
+  LPCWSTR args[] = { L"-enable-16bit-types" };
+  CComPtr<IDxcCompilerArgs> pArgs;
+  VERIFY_SUCCEEDED(pCompiler3->CreateArgs(L"main", L"ps_6_0", args,
+    _countof(args), nullptr, 0, &pArgs));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pArgs->GetStatus(&status));
+  VERIFY_FAILED(status);
+  VERIFY_SUCCEEDED(pCompiler3->CompileWithArgs(pSource, L"source.hlsl", pArgs,
+    nullptr, &pResult, nullptr, nullptr));
+  std::string failLog = VerifyOperationFailed(pResult);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       failLog.find("enable-16bit-types is only allowed"));
+
+  // A new profile validates the arguments again.
+  DxcDefine defines[] = {{L"SCALE", L"2"}};
+  CComPtr<IDxcCompilerArgs> pScaled;
+  VERIFY_SUCCEEDED(pArgs->Clone(nullptr, L"ps_6_2", defines,
+    _countof(defines), &pScaled));
+  VERIFY_SUCCEEDED(pScaled->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler3->CompileWithArgs(pSource, L"source.hlsl",
+    pScaled, nullptr, &pResult, nullptr, nullptr));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pArgsProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pArgsProgram));
+
+  // The same as compiling with those values directly.
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_2", args, _countof(args), defines, _countof(defines), nullptr,
+    &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pArgsProgram->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pProgram->GetBufferPointer(),
+                             pArgsProgram->GetBufferPointer(),
+                             pProgram->GetBufferSize()));
+
+  // A clone keeps the defines and profile it does not change.
+  CComPtr<IDxcCompilerArgs> pOther;
+  VERIFY_SUCCEEDED(pScaled->Clone(L"other", nullptr, nullptr, 0, &pOther));
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler3->CompileWithArgs(pSource, L"source.hlsl",
+    pOther, nullptr, &pResult, nullptr, nullptr));
+  VerifyOperationSucceeded(pResult);
+}
+
+namespace {
+// Arguments that the compiler did not create.
+class ForeignCompilerArgs : public IDxcCompilerArgs {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  ForeignCompilerArgs() : m_dwRef(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompilerArgs>(this, iid, ppvObject);
+  }
+  HRESULT STDMETHODCALLTYPE GetStatus(HRESULT *pStatus) override {
+    *pStatus = S_OK;
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE GetErrors(IDxcBlobEncoding **ppErrors) override {
+    *ppErrors = nullptr;
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE Clone(LPCWSTR, LPCWSTR, const DxcDefine *, UINT32,
+                                  IDxcCompilerArgs **ppResult) override {
+    *ppResult = nullptr;
+    return E_NOTIMPL;
+  }
+};
+}
+
+TEST_F(CompilerTest, CompileWhenArgsForeignThenInvalidArg) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler3> pCompiler3;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler3));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+
+  CComPtr<IDxcCompilerArgs> pArgs = new ForeignCompilerArgs();
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pCompiler3->CompileWithArgs(pSource,
+    L"source.hlsl", pArgs, nullptr, &pResult, nullptr, nullptr));
+  VERIFY_IS_NULL(pResult.p);
+}
+
+TEST_F(CompilerTest, CompileWhenDedupKnownThenIdenticalResult) {
+  // The define only renames a local, so both permutations optimize to the
+  // same module.
+  const char *hlsl = R"(
+    float4 main(float4 pos : SV_Position) : SV_Target {
+    #ifdef VARIANT
+      float4 variantColor = pos * 2;
+      return variantColor;
+    #else
+      float4 color = pos * 2;
+      return color;
+    #endif
+    }
+  )";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(hlsl, &pSource);
+
+  auto GetFingerprint = [](IDxcBlob *pProgram, const char **ppIdenticalTo) {
+    const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    const hlsl::DxilPartHeader *pPart = hlsl::GetDxilPartByType(
+        pContainer, hlsl::DxilFourCC::DFCC_ShaderFingerprint);
+    VERIFY_IS_NOT_NULL(pPart);
+    const hlsl::DxilShaderFingerprint *pFingerprint = nullptr;
+    VERIFY_IS_TRUE(hlsl::GetDxilShaderFingerprint(pPart, &pFingerprint, ppIdenticalTo));
+    return *pFingerprint;
+  };
+
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pProgram;
+  LPCWSTR args[] = { L"-fdedup" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  const char *pIdenticalTo = nullptr;
+  hlsl::DxilShaderFingerprint Fingerprint = GetFingerprint(pProgram, &pIdenticalTo);
+  VERIFY_IS_NULL(pIdenticalTo);
+
+  const wchar_t HexDigits[] = L"0123456789abcdef";
+  std::wstring Known;
+  for (uint8_t Byte : Fingerprint.Digest) {
+    Known += HexDigits[Byte >> 4];
+    Known += HexDigits[Byte & 0xf];
+  }
+  Known += L"=base.cso";
+
+  pResult.Release();
+  pProgram.Release();
+  LPCWSTR variantArgs[] = { L"-fdedup-known", Known.c_str() };
+  DxcDefine variantDefine = { L"VARIANT", L"1" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", variantArgs, _countof(variantArgs), &variantDefine, 1, nullptr,
+    &pResult));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  hlsl::DxilShaderFingerprint VariantFingerprint = GetFingerprint(pProgram, &pIdenticalTo);
+  VERIFY_IS_NOT_NULL(pIdenticalTo);
+  VERIFY_ARE_EQUAL(0, strcmp(pIdenticalTo, "base.cso"));
+  VERIFY_ARE_EQUAL(0, memcmp(Fingerprint.Digest, VariantFingerprint.Digest,
+                             sizeof(Fingerprint.Digest)));
+}
+
+TEST_F(CompilerTest, CompileWhenDedupThenGlobalNamesIgnored) {
+  // The define only renames the groupshared array, which is a global.
+  const char *hlsl = R"(
+    #ifdef VARIANT
+    #define SharedData variantSharedData
+    #endif
+    RWStructuredBuffer<uint> output;
+    groupshared uint SharedData[64];
+    [numthreads(64, 1, 1)]
+    void main(uint index : SV_GroupIndex) {
+      SharedData[index] = index;
+      GroupMemoryBarrierWithGroupSync();
+      output[index] = SharedData[63 - index];
+    }
+  )";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(hlsl, &pSource);
+
+  auto CompileFingerprint = [&](const DxcDefine *pDefines, UINT32 defineCount) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    LPCWSTR args[] = { L"-fdedup" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"cs_6_0", args, _countof(args), pDefines, defineCount, nullptr,
+      &pResult));
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    const hlsl::DxilPartHeader *pPart = hlsl::GetDxilPartByType(
+        pContainer, hlsl::DxilFourCC::DFCC_ShaderFingerprint);
+    VERIFY_IS_NOT_NULL(pPart);
+    const hlsl::DxilShaderFingerprint *pFingerprint = nullptr;
+    const char *pIdenticalTo = nullptr;
+    VERIFY_IS_TRUE(hlsl::GetDxilShaderFingerprint(pPart, &pFingerprint, &pIdenticalTo));
+    return *pFingerprint;
+  };
+
+  DxcDefine variantDefine = { L"VARIANT", L"1" };
+  hlsl::DxilShaderFingerprint Fingerprint = CompileFingerprint(nullptr, 0);
+  hlsl::DxilShaderFingerprint VariantFingerprint = CompileFingerprint(&variantDefine, 1);
+  VERIFY_ARE_EQUAL(0, memcmp(Fingerprint.Digest, VariantFingerprint.Digest,
+                             sizeof(Fingerprint.Digest)));
+}
+
+TEST_F(CompilerTest, CompileWhenConstArrayDataDiffersThenHashDiffers) {
+  // Both shaders have the same code; only the table moved into the
+  // generated buffer differs.
+  auto GetSource = [](float First) {
+    std::string hlsl = "static const float table[256] = { ";
+    hlsl += std::to_string(First);
+    for (int i = 1; i < 256; ++i)
+      hlsl += ", " + std::to_string(i) + ".5";
+    hlsl += " };\n"
+            "float main(nointerpolation uint i : I) : SV_Target {\n"
+            "  return table[i];\n"
+            "}\n";
+    return hlsl;
+  };
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  struct Parts {
+    std::vector<uint8_t> Hash, Fingerprint, Data;
+  };
+  auto Compile = [&](float First) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    CreateBlobFromText(GetSource(First).c_str(), &pSource);
+    LPCWSTR args[] = { L"-const-array-buffer-space", L"7", L"-fdedup" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    auto GetPart = [&](hlsl::DxilFourCC FourCC) {
+      const hlsl::DxilPartHeader *pPart =
+          hlsl::GetDxilPartByType(pContainer, FourCC);
+      VERIFY_IS_NOT_NULL(pPart);
+      const uint8_t *pData = (const uint8_t *)hlsl::GetDxilPartData(pPart);
+      return std::vector<uint8_t>(pData, pData + pPart->PartSize);
+    };
+    Parts Result;
+    Result.Hash = GetPart(hlsl::DFCC_ShaderHash);
+    Result.Fingerprint = GetPart(hlsl::DFCC_ShaderFingerprint);
+    Result.Data = GetPart(hlsl::DFCC_ConstantArrayData);
+    return Result;
+  };
+
+  Parts First = Compile(0.5f);
+  Parts Second = Compile(100.5f);
+  VERIFY_IS_TRUE(First.Data != Second.Data);
+  VERIFY_IS_TRUE(First.Hash != Second.Hash);
+  VERIFY_IS_TRUE(First.Fingerprint != Second.Fingerprint);
+  // The same table still gives the same results.
+  Parts Again = Compile(0.5f);
+  VERIFY_IS_TRUE(First.Hash == Again.Hash);
+  VERIFY_IS_TRUE(First.Fingerprint == Again.Fingerprint);
+}
+
 #ifdef _WIN32
 TEST_F(CompilerTest, ManualFileCheckTest) {
 #else
@@ -12,6 +12,8 @@
 #include "CompilationResult.h"
 #include "HLSLTestData.h"
 #include <stdint.h>
+#include <condition_variable>
+#include <mutex>
 
 #ifdef _WIN32
 #include "WexTestClass.h"
@@ -124,6 +126,9 @@ protected:
   TEST_METHOD(TypeWhenICEThenEval)
 
   TEST_METHOD(CompletionWhenResultsAvailable)
+  TEST_METHOD(CompletionWhenAsyncThenQueuedAfterReparse)
+
+  TEST_METHOD(OutlineWhenKindsFilteredThenParentsAreClosestIncluded)
 };
 
 bool DXIntellisenseTest::DXIntellisenseTestClassSetup() {
@@ -879,3 +884,116 @@ TEST_F(DXIntellisenseTest, CompletionWhenResultsAvailable)
   VERIFY_SUCCEEDED(completionString->GetCompletionChunkText(0, &completionChunkText));
   VERIFY_ARE_EQUAL_STR("MyStruct", completionChunkText);
 }
+
+namespace {
+// Holds up the worker of an operation in its completion callback until
+// Release is called.
+class BlockingCallback : public IDxcIntelliSenseCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  std::mutex m_lock;
+  std::condition_variable m_released;
+  bool m_isReleased;
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  BlockingCallback() : m_dwRef(0), m_isReleased(false) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcIntelliSenseCallback>(this, iid, ppvObject);
+  }
+  HRESULT STDMETHODCALLTYPE OnCompleted(IDxcIntelliSenseOperation *) override {
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_released.wait(lock, [this] { return m_isReleased; });
+    return S_OK;
+  }
+  void ReleaseWorker() {
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_isReleased = true;
+    }
+    m_released.notify_all();
+  }
+};
+}
+
+TEST_F(DXIntellisenseTest, CompletionWhenAsyncThenQueuedAfterReparse)
+{
+  char program[] =
+	"struct MyStruct {};"
+	"MyStr";
+  CompilationResult result(CompilationResult::CreateForProgram(program, _countof(program)));
+  VERIFY_ARE_EQUAL(false, result.ParseSucceeded());
+  char* fileName = "filename.hlsl";
+  CComPtr<IDxcUnsavedFile> unsavedFile;
+  VERIFY_SUCCEEDED(TrivialDxcUnsavedFile::Create(fileName, program, &unsavedFile));
+  CComPtr<IDxcTranslationUnitAsync> asyncTU;
+  VERIFY_SUCCEEDED(result.TU.QueryInterface(&asyncTU));
+
+  // Requests are made without waiting and run in order. The callback of the
+  // reparse holds up the worker, so the later requests are still queued when
+  // one of them is cancelled.
+  CComPtr<BlockingCallback> callback = new BlockingCallback();
+  CComPtr<IDxcIntelliSenseOperation> reparse, completion, cancelled;
+  VERIFY_SUCCEEDED(asyncTU->ReparseAsync(&unsavedFile.p, 1, callback, &reparse));
+  VERIFY_SUCCEEDED(asyncTU->CodeCompleteAtAsync(fileName, 2, 1, &unsavedFile.p, 1, DxcCodeCompleteFlags_None, nullptr, &completion));
+  VERIFY_SUCCEEDED(asyncTU->CodeCompleteAtAsync(fileName, 2, 1, &unsavedFile.p, 1, DxcCodeCompleteFlags_None, nullptr, &cancelled));
+  VERIFY_ARE_EQUAL(S_OK, cancelled->Cancel());
+  BOOL completed;
+  VERIFY_SUCCEEDED(completion->IsCompleted(&completed));
+  VERIFY_IS_FALSE(completed);
+
+  // The reparse reports completion before its callback runs.
+  VERIFY_SUCCEEDED(reparse->Wait());
+  HRESULT status;
+  VERIFY_SUCCEEDED(reparse->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  callback->ReleaseWorker();
+
+  // A synchronous request waits for the ones queued before it.
+  unsigned numDiagnostics;
+  VERIFY_SUCCEEDED(result.TU->GetNumDiagnostics(&numDiagnostics));
+
+  VERIFY_SUCCEEDED(completion->Wait());
+  CComPtr<IDxcCodeCompleteResults> codeCompleteResults;
+  VERIFY_SUCCEEDED(completion->GetResult(__uuidof(IDxcCodeCompleteResults), (void **)&codeCompleteResults));
+  unsigned numResults;
+  VERIFY_SUCCEEDED(codeCompleteResults->GetNumResults(&numResults));
+  VERIFY_IS_GREATER_THAN_OR_EQUAL(numResults, 1u);
+
+  VERIFY_SUCCEEDED(cancelled->Wait());
+  VERIFY_SUCCEEDED(cancelled->GetStatus(&status));
+  VERIFY_ARE_EQUAL(E_ABORT, status);
+  CComPtr<IDxcCodeCompleteResults> cancelledResults;
+  VERIFY_ARE_EQUAL(E_ABORT, cancelled->GetResult(__uuidof(IDxcCodeCompleteResults), (void **)&cancelledResults));
+  VERIFY_IS_NULL(cancelledResults.p);
+}
+
+TEST_F(DXIntellisenseTest, OutlineWhenKindsFilteredThenParentsAreClosestIncluded)
+{
+  char program[] =
+    "struct S { int i; };\n"
+    "float f(float a) { return a; }";
+  CompilationResult result(CompilationResult::CreateForProgram(program, _countof(program)));
+  VERIFY_IS_TRUE(result.ParseSucceeded());
+
+  CComPtr<IDxcTranslationUnit2> tu2;
+  VERIFY_SUCCEEDED(result.TU.QueryInterface(&tu2));
+  const DxcCursorKind kinds[] = { DxcCursor_StructDecl, DxcCursor_FieldDecl, DxcCursor_FunctionDecl, DxcCursor_ParmDecl };
+  CComHeapPtr<DxcCursorOutline> outline;
+  VERIFY_SUCCEEDED(tu2->GetCursorOutline(nullptr, kinds, _countof(kinds), &outline));
+  VERIFY_ARE_EQUAL(4u, outline->NodeCount);
+  const DxcCursorOutlineNode *nodes = (const DxcCursorOutlineNode *)(outline.m_pData + 1);
+  const char *strings = (const char *)outline.m_pData + outline->StringTableOffset;
+
+  VERIFY_ARE_EQUAL(DxcCursor_StructDecl, nodes[0].Kind);
+  VERIFY_ARE_EQUAL_STR("S", strings + nodes[0].NameOffset);
+  VERIFY_ARE_EQUAL(DxcCursorOutlineNoParent, nodes[0].ParentIndex);
+  VERIFY_ARE_EQUAL(DxcCursor_FieldDecl, nodes[1].Kind);
+  VERIFY_ARE_EQUAL_STR("i", strings + nodes[1].NameOffset);
+  VERIFY_ARE_EQUAL(0u, nodes[1].ParentIndex);
+  VERIFY_ARE_EQUAL(DxcCursor_FunctionDecl, nodes[2].Kind);
+  VERIFY_ARE_EQUAL_STR("f", strings + nodes[2].NameOffset);
+  VERIFY_ARE_EQUAL(2u, nodes[2].StartLine);
+  VERIFY_ARE_EQUAL(DxcCursorOutlineNoParent, nodes[2].ParentIndex);
+  VERIFY_ARE_EQUAL(DxcCursor_ParmDecl, nodes[3].Kind);
+  VERIFY_ARE_EQUAL_STR("a", strings + nodes[3].NameOffset);
+  VERIFY_ARE_EQUAL(2u, nodes[3].ParentIndex);
+}
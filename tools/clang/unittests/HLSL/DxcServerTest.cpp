@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcServerTest.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides tests for the compile server and client modes of dxc.            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+#include "HlslTestUtils.h"
+#include "dxclib/dxcserver.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class DxcServerTest : public ::testing::Test {
+public:
+  BEGIN_TEST_CLASS(DxcServerTest)
+    TEST_METHOD_PROPERTY(L"Priority", L"0")
+  END_TEST_CLASS()
+
+  TEST_METHOD(RunClientWhenServerListeningThenCommandRuns)
+  TEST_METHOD(RunServerWhenPathNotSocketThenFail)
+  TEST_METHOD(RunServerWhenServerListeningThenFail)
+  TEST_METHOD(RunServerWhenSocketStaleThenTakeOver)
+  TEST_METHOD(RunServerWhenRequestDoneThenReaped)
+};
+
+namespace {
+
+// A temporary directory for the socket, removed with everything in it.
+class TempSocketDir {
+  std::string m_Dir;
+
+public:
+  TempSocketDir() {
+    char dirTemplate[] = "/tmp/dxcserver-XXXXXX";
+    if (mkdtemp(dirTemplate))
+      m_Dir = dirTemplate;
+  }
+  ~TempSocketDir() {
+    if (!m_Dir.empty()) {
+      unlink(GetSocketPath().c_str());
+      rmdir(m_Dir.c_str());
+    }
+  }
+  bool IsValid() const { return !m_Dir.empty(); }
+  std::string GetSocketPath() const { return m_Dir + "/dxc.sock"; }
+};
+
+// Reports the command line and working directory of each request on its
+// standard output.
+int EchoCommand(int argc, const char **argv) {
+  char cwd[PATH_MAX];
+  printf("%d %s %s\n", argc, argv[argc - 1],
+         getcwd(cwd, sizeof(cwd)) ? cwd : "");
+  return 42;
+}
+
+bool WaitForSocket(const std::string &path) {
+  for (int i = 0; i < 500; ++i) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+      return true;
+    usleep(10000);
+  }
+  return false;
+}
+
+// Starts a server on path in a child process.
+pid_t StartServer(const std::string &path) {
+  fflush(nullptr);
+  pid_t server = fork();
+  if (server == 0) {
+    alarm(30);
+    _exit(dxc::RunServer(path, EchoCommand));
+  }
+  return server;
+}
+
+void StopServer(pid_t server) {
+  kill(server, SIGTERM);
+  int status;
+  waitpid(server, &status, 0);
+}
+
+// Sends a request with its output discarded and returns the exit code, or
+// -1 if no server took it.
+int RunQuietClient(const std::string &path) {
+  fflush(stdout);
+  int savedStdout = dup(STDOUT_FILENO);
+  int nullFd = open("/dev/null", O_WRONLY);
+  dup2(nullFd, STDOUT_FILENO);
+  close(nullFd);
+  const char *argv[] = {"dxc", "-help"};
+  int exitCode = 0;
+  bool connected = dxc::RunClient(path, 2, argv, &exitCode);
+  fflush(stdout);
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  return connected ? exitCode : -1;
+}
+
+} // namespace
+
+TEST_F(DxcServerTest, RunClientWhenServerListeningThenCommandRuns) {
+  TempSocketDir dir;
+  VERIFY_IS_TRUE(dir.IsValid());
+  std::string socketPath = dir.GetSocketPath();
+
+  fflush(nullptr);
+  pid_t server = fork();
+  VERIFY_IS_TRUE(server >= 0);
+  if (server == 0)
+    _exit(dxc::RunServer(socketPath, EchoCommand));
+  VERIFY_IS_TRUE(WaitForSocket(socketPath));
+
+  // Only the owner may connect.
+  struct stat st;
+  VERIFY_ARE_EQUAL(0, lstat(socketPath.c_str(), &st));
+  VERIFY_ARE_EQUAL(0u, (unsigned)(st.st_mode & (S_IRWXG | S_IRWXO)));
+
+  // The request writes to the standard output of the client.
+  int pipeFds[2];
+  VERIFY_ARE_EQUAL(0, pipe(pipeFds));
+  fflush(stdout);
+  int savedStdout = dup(STDOUT_FILENO);
+  dup2(pipeFds[1], STDOUT_FILENO);
+  close(pipeFds[1]);
+  const char *argv[] = {"dxc", "-help"};
+  int exitCode = 0;
+  bool connected = dxc::RunClient(socketPath, 2, argv, &exitCode);
+  fflush(stdout);
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  std::string output;
+  char buffer[256];
+  ssize_t count;
+  while ((count = read(pipeFds[0], buffer, sizeof(buffer))) > 0)
+    output.append(buffer, count);
+  close(pipeFds[0]);
+
+  char cwd[PATH_MAX];
+  VERIFY_IS_NOT_NULL(getcwd(cwd, sizeof(cwd)));
+  VERIFY_IS_TRUE(connected);
+  VERIFY_ARE_EQUAL(42, exitCode);
+  VERIFY_ARE_EQUAL(std::string("2 -help ") + cwd + "\n", output);
+
+  // Command lines beyond the request limits stay with the client.
+  std::string longArg(128 * 1024, 'x');
+  const char *longArgv[] = {"dxc", longArg.c_str()};
+  VERIFY_IS_FALSE(dxc::RunClient(socketPath, 2, longArgv, &exitCode));
+
+  kill(server, SIGTERM);
+  int status;
+  waitpid(server, &status, 0);
+
+  // With no server listening, the client leaves the command to the caller.
+  VERIFY_IS_FALSE(dxc::RunClient(socketPath, 2, argv, &exitCode));
+}
+
+TEST_F(DxcServerTest, RunServerWhenPathNotSocketThenFail) {
+  TempSocketDir dir;
+  VERIFY_IS_TRUE(dir.IsValid());
+  std::string socketPath = dir.GetSocketPath();
+  int fd = open(socketPath.c_str(), O_CREAT | O_WRONLY, 0600);
+  VERIFY_IS_TRUE(fd >= 0);
+  close(fd);
+
+  // The server only returns on failure, so run it where it can be stopped.
+  fflush(nullptr);
+  pid_t server = fork();
+  VERIFY_IS_TRUE(server >= 0);
+  if (server == 0) {
+    alarm(10);
+    _exit(dxc::RunServer(socketPath, EchoCommand));
+  }
+  int status;
+  VERIFY_ARE_EQUAL(server, waitpid(server, &status, 0));
+  VERIFY_IS_TRUE(WIFEXITED(status));
+  VERIFY_ARE_EQUAL(1, WEXITSTATUS(status));
+
+  // The file is left alone.
+  struct stat st;
+  VERIFY_ARE_EQUAL(0, lstat(socketPath.c_str(), &st));
+  VERIFY_IS_TRUE(S_ISREG(st.st_mode));
+}
+
+TEST_F(DxcServerTest, RunServerWhenServerListeningThenFail) {
+  TempSocketDir dir;
+  VERIFY_IS_TRUE(dir.IsValid());
+  std::string socketPath = dir.GetSocketPath();
+  pid_t first = StartServer(socketPath);
+  VERIFY_IS_TRUE(first > 0);
+  VERIFY_IS_TRUE(WaitForSocket(socketPath));
+  VERIFY_ARE_EQUAL(42, RunQuietClient(socketPath));
+
+  // A second server refuses to take over the socket of a live one.
+  pid_t second = StartServer(socketPath);
+  VERIFY_IS_TRUE(second > 0);
+  int status;
+  VERIFY_ARE_EQUAL(second, waitpid(second, &status, 0));
+  VERIFY_IS_TRUE(WIFEXITED(status));
+  VERIFY_ARE_EQUAL(1, WEXITSTATUS(status));
+
+  // The first server still gets the requests.
+  VERIFY_ARE_EQUAL(42, RunQuietClient(socketPath));
+  StopServer(first);
+}
+
+TEST_F(DxcServerTest, RunServerWhenSocketStaleThenTakeOver) {
+  TempSocketDir dir;
+  VERIFY_IS_TRUE(dir.IsValid());
+  std::string socketPath = dir.GetSocketPath();
+
+  // A socket bound and closed without listening is left behind, as by a
+  // server that was killed.
+  int staleFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  VERIFY_IS_TRUE(staleFd >= 0);
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+  VERIFY_ARE_EQUAL(0, bind(staleFd, (sockaddr *)&addr, sizeof(addr)));
+  close(staleFd);
+  VERIFY_IS_TRUE(WaitForSocket(socketPath));
+  VERIFY_ARE_EQUAL(-1, RunQuietClient(socketPath));
+
+  pid_t server = StartServer(socketPath);
+  VERIFY_IS_TRUE(server > 0);
+  int result = -1;
+  for (int i = 0; i < 500 && result == -1; ++i) {
+    result = RunQuietClient(socketPath);
+    if (result == -1)
+      usleep(10000);
+  }
+  VERIFY_ARE_EQUAL(42, result);
+  StopServer(server);
+}
+
+TEST_F(DxcServerTest, RunServerWhenRequestDoneThenReaped) {
+  TempSocketDir dir;
+  VERIFY_IS_TRUE(dir.IsValid());
+  std::string socketPath = dir.GetSocketPath();
+  pid_t server = StartServer(socketPath);
+  VERIFY_IS_TRUE(server > 0);
+  VERIFY_IS_TRUE(WaitForSocket(socketPath));
+  VERIFY_ARE_EQUAL(42, RunQuietClient(socketPath));
+
+  // The request process is reaped while the server waits for the next
+  // connection, so it does not stay behind as a zombie. Child lists are only
+  // available where /proc has them.
+  std::string childrenPath = "/proc/" + std::to_string(server) + "/task/" +
+                             std::to_string(server) + "/children";
+  bool reaped = false;
+  bool checked = false;
+  for (int i = 0; i < 500 && !reaped; ++i) {
+    FILE *children = fopen(childrenPath.c_str(), "r");
+    if (!children)
+      break;
+    checked = true;
+    int child;
+    reaped = fscanf(children, "%d", &child) != 1;
+    fclose(children);
+    if (!reaped)
+      usleep(10000);
+  }
+  StopServer(server);
+  if (checked)
+    VERIFY_IS_TRUE(reaped);
+}
+
+#endif // _WIN32
@@ -19,6 +19,13 @@
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/FileSystem.h"
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 using namespace hlsl_test;
 
@@ -380,3 +387,93 @@ bool VersionSupportInfo::SkipDxilVersion(unsigned major, unsigned minor) {
   return false;
 }
 bool VersionSupportInfo::SkipOutOfMemoryTest() { return false; }
+
+#ifdef _WIN32
+TempDirectoryForTest::TempDirectoryForTest() {
+  wchar_t TempPath[MAX_PATH];
+  VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(MAX_PATH, TempPath) != 0);
+  for (unsigned i = 0;; ++i) {
+    std::wstring Path = TempPath;
+    Path += L"dxc-test-" + std::to_wstring(GetCurrentProcessId()) + L"-" +
+            std::to_wstring(i);
+    if (CreateDirectoryW(Path.c_str(), nullptr)) {
+      m_Path = Path;
+      return;
+    }
+    DWORD Error = GetLastError();
+    if (Error != ERROR_ALREADY_EXISTS) {
+      VERIFY_WIN32_BOOL_SUCCEEDED(FALSE);
+      return;
+    }
+  }
+}
+
+std::wstring TempDirectoryForTest::GetFilePath(const std::wstring &Name) const {
+  return m_Path + L"\\" + Name;
+}
+
+std::vector<std::wstring> TempDirectoryForTest::GetFileNames() const {
+  std::vector<std::wstring> Names;
+  WIN32_FIND_DATAW FindData;
+  HANDLE hFind = FindFirstFileW(GetFilePath(L"*").c_str(), &FindData);
+  if (hFind != INVALID_HANDLE_VALUE) {
+    do {
+      if (!(FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        Names.emplace_back(FindData.cFileName);
+    } while (FindNextFileW(hFind, &FindData));
+    FindClose(hFind);
+  }
+  return Names;
+}
+
+TempDirectoryForTest::~TempDirectoryForTest() {
+  if (m_Path.empty())
+    return;
+  for (const std::wstring &Name : GetFileNames())
+    DeleteFileW(GetFilePath(Name).c_str());
+  RemoveDirectoryW(m_Path.c_str());
+}
+#else
+TempDirectoryForTest::TempDirectoryForTest() {
+  const char *pTempDir = getenv("TMPDIR");
+  std::string Path = pTempDir && *pTempDir ? pTempDir : "/tmp";
+  Path += "/dxc-test-XXXXXX";
+  char *pPath = mkdtemp(&Path[0]);
+  VERIFY_IS_NOT_NULL(pPath);
+  if (pPath)
+    Unicode::UTF8ToUTF16String(pPath, &m_Path);
+}
+
+std::wstring TempDirectoryForTest::GetFilePath(const std::wstring &Name) const {
+  return m_Path + L"/" + Name;
+}
+
+std::vector<std::wstring> TempDirectoryForTest::GetFileNames() const {
+  std::vector<std::wstring> Names;
+  std::string Path;
+  if (m_Path.empty() || !Unicode::UTF16ToUTF8String(m_Path.c_str(), &Path))
+    return Names;
+  if (DIR *pDir = opendir(Path.c_str())) {
+    while (struct dirent *pEntry = readdir(pDir)) {
+      std::wstring Name;
+      if (strcmp(pEntry->d_name, ".") && strcmp(pEntry->d_name, "..") &&
+          Unicode::UTF8ToUTF16String(pEntry->d_name, &Name))
+        Names.emplace_back(std::move(Name));
+    }
+    closedir(pDir);
+  }
+  return Names;
+}
+
+TempDirectoryForTest::~TempDirectoryForTest() {
+  std::string Path;
+  if (m_Path.empty() || !Unicode::UTF16ToUTF8String(m_Path.c_str(), &Path))
+    return;
+  for (const std::wstring &Name : GetFileNames()) {
+    std::string FilePath;
+    if (Unicode::UTF16ToUTF8String(GetFilePath(Name).c_str(), &FilePath))
+      unlink(FilePath.c_str());
+  }
+  rmdir(Path.c_str());
+}
+#endif
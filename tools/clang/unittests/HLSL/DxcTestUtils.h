@@ -180,3 +180,16 @@ public:
   // Return true if out-of-memory test should be skipped, and log comment
   bool SkipOutOfMemoryTest();
 };
+
+// A uniquely named directory under the temporary directory, removed along
+// with the files in it.
+class TempDirectoryForTest {
+private:
+  std::wstring m_Path;
+public:
+  TempDirectoryForTest();
+  ~TempDirectoryForTest();
+  const std::wstring &GetPath() const { return m_Path; }
+  std::wstring GetFilePath(const std::wstring &Name) const;
+  std::vector<std::wstring> GetFileNames() const;
+};
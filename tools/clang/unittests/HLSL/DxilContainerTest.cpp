@@ -47,6 +47,7 @@
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
+#include "dxc/DxilContainer/DxilShaderPack.h"
 #include "dxc/DXIL/DxilShaderFlags.h"
 #include "dxc/DXIL/DxilUtil.h"
 
@@ -99,6 +100,7 @@ public:
   TEST_METHOD(DisassemblyWhenValidThenOK)
   TEST_METHOD(ValidateFromLL_Abs2)
   TEST_METHOD(DxilContainerUnitTest)
+  TEST_METHOD(ShaderPackWhenPackedThenRoundTrips)
 
   TEST_METHOD(ReflectionMatchesDXBC_CheckIn)
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
@@ -1571,3 +1573,58 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(&header, hlsl::DxilFourCC::DFCC_DXIL));
 
 }
+
+TEST_F(DxilContainerTest, ShaderPackWhenPackedThenRoundTrips) {
+  CComPtr<IDxcBlob> pPrograms[2];
+  CompileToProgram("float4 main() : SV_Target { return 0; }", L"main",
+                   L"ps_6_0", nullptr, 0, &pPrograms[0]);
+  CompileToProgram("float4 main() : SV_Target { return 1; }", L"main",
+                   L"ps_6_0", nullptr, 0, &pPrograms[1]);
+
+  hlsl::DxilShaderPackWriter writer;
+  for (IDxcBlob *pProgram : pPrograms) {
+    VERIFY_IS_TRUE(writer.AddContainer(
+        (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer(),
+        pProgram->GetBufferSize()));
+  }
+  VERIFY_IS_FALSE(writer.AddContainer(
+      (const hlsl::DxilContainerHeader *)pPrograms[0]->GetBufferPointer(),
+      pPrograms[0]->GetBufferSize()));
+  VERIFY_ARE_EQUAL(2U, writer.GetShaderCount());
+  // The shaders only differ in their program and hash parts.
+  VERIFY_IS_TRUE(writer.GetDistinctPartCount() < writer.GetPartRefCount());
+
+  std::string pack;
+  llvm::raw_string_ostream OS(pack);
+  writer.Write(OS);
+  OS.flush();
+
+  hlsl::DxilShaderPackReader reader;
+  VERIFY_IS_TRUE(reader.Init(pack.data(), pack.size()));
+  VERIFY_IS_FALSE(reader.Init(pack.data(), pack.size() - 1));
+  VERIFY_IS_TRUE(reader.Init(pack.data(), pack.size()));
+  VERIFY_ARE_EQUAL(2U, reader.GetShaderCount());
+  for (IDxcBlob *pProgram : pPrograms) {
+    const hlsl::DxilContainerHeader *pHeader =
+        (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer();
+    const hlsl::DxilPartHeader *pHashPart =
+        hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderHash);
+    VERIFY_IS_NOT_NULL(pHashPart);
+    const hlsl::DxilShaderHash *pHash =
+        (const hlsl::DxilShaderHash *)hlsl::GetDxilPartData(pHashPart);
+    uint32_t index;
+    VERIFY_IS_TRUE(reader.FindShader(pHash->Digest, &index));
+    VERIFY_IS_NOT_NULL(reader.GetPartByType(index, hlsl::DFCC_DXIL));
+
+    std::string container;
+    llvm::raw_string_ostream ContainerOS(container);
+    reader.WriteContainer(index, ContainerOS);
+    ContainerOS.flush();
+    VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), container.size());
+    VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(), container.data(),
+                               container.size()));
+  }
+  uint8_t missingHash[hlsl::DxilContainerHashSize] = {};
+  uint32_t index;
+  VERIFY_IS_FALSE(reader.FindShader(missingHash, &index));
+}
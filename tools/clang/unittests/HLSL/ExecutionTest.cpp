@@ -33,6 +33,7 @@
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/Unicode.h"
+#include "dxc/DxilContainer/DxilContainer.h"
 
 //
 // d3d12.h and dxgi1_4.h are included in the Windows 10 SDK
@@ -294,6 +295,7 @@ public:
   TEST_METHOD(WaveIntrinsicsTest);
   TEST_METHOD(WaveIntrinsicsDDITest);
   TEST_METHOD(WaveIntrinsicsInPSTest);
+  TEST_METHOD(PixelHitWaveAggregateTest);
   TEST_METHOD(PartialDerivTest);
 
   BEGIN_TEST_METHOD(CBufferTestHalf)
@@ -755,7 +757,15 @@ public:
       CompileFromText(pShaders, L"VSMain", L"vs_6_0", &vertexShader);
       CompileFromText(pShaders, L"PSMain", L"ps_6_0", &pixelShader);
     }
+    CreateGraphicsPSO(pDevice, pInputLayout, pRootSignature, vertexShader,
+                      pixelShader, ppPSO);
+  }
 
+  void CreateGraphicsPSO(ID3D12Device *pDevice,
+                         D3D12_INPUT_LAYOUT_DESC *pInputLayout,
+                         ID3D12RootSignature *pRootSignature,
+                         ID3DBlob *vertexShader, ID3DBlob *pixelShader,
+                         ID3D12PipelineState **ppPSO) {
     // Describe and create the graphics pipeline state object (PSO).
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
     psoDesc.InputLayout = *pInputLayout;
@@ -1893,6 +1903,158 @@ TEST_F(ExecutionTest, WaveIntrinsicsTest) {
 #endif
 }
 
+TEST_F(ExecutionTest, PixelHitWaveAggregateTest) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+
+  struct Vertex {
+    XMFLOAT3 position;
+  };
+
+  // Horizontally adjacent pixels share a counter, so every wave aggregates
+  // hits on several distinct addresses, with two lanes on each of them.
+  const UINT RTWidth = 16;
+  const UINT RTHeight = 16;
+  const UINT TileWidth = 2;
+  const UINT CounterCount = (RTWidth / TileWidth) * RTHeight;
+
+  static const char pShaders[] =
+    "float4 VSMain(float4 position : POSITION) : SV_POSITION {\r\n"
+    "  return position;\r\n"
+    "}\r\n\r\n"
+    "float4 PSMain(float4 position : SV_POSITION) : SV_TARGET {\r\n"
+    "  return position / 16;\r\n"
+    "}\r\n";
+
+  CComPtr<ID3D12Device> pDevice;
+  if (!CreateDevice(&pDevice))
+    return;
+  if (UseDxbc()) {
+    WEX::Logging::Log::Comment(L"Pixel hit instrumentation requires DXIL.");
+    return;
+  }
+  if (!DoesDeviceSupportWaveOps(pDevice)) {
+    // Optional feature, so it's correct to not support it if declared as such.
+    WEX::Logging::Log::Comment(L"Device does not support wave operations.");
+    return;
+  }
+
+  // Instrument the pixel shader the way PIX does, and sign it again.
+  CComPtr<ID3DBlob> pVertexShader;
+  CComPtr<ID3DBlob> pPixelShader;
+  CComPtr<IDxcBlob> pInstrumentedShader;
+  CompileFromText(pShaders, L"VSMain", L"vs_6_0", &pVertexShader);
+  CompileFromText(pShaders, L"PSMain", L"ps_6_0", &pPixelShader);
+  {
+    CComPtr<IDxcContainerReflection> pReflection;
+    CComPtr<IDxcOptimizer> pOptimizer;
+    CComPtr<IDxcAssembler> pAssembler;
+    CComPtr<IDxcValidator> pValidator;
+    CComPtr<IDxcBlob> pProgram;
+    CComPtr<IDxcBlob> pInstrumentedModule;
+    CComPtr<IDxcOperationResult> pResult;
+    HRESULT resultCode;
+    UINT32 partIndex;
+    VERIFY_SUCCEEDED(m_support.CreateInstance(CLSID_DxcContainerReflection, &pReflection));
+    VERIFY_SUCCEEDED(m_support.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+    VERIFY_SUCCEEDED(m_support.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+    VERIFY_SUCCEEDED(m_support.CreateInstance(CLSID_DxcValidator, &pValidator));
+    VERIFY_SUCCEEDED(pReflection->Load((IDxcBlob *)pPixelShader.p));
+    VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &partIndex));
+    VERIFY_SUCCEEDED(pReflection->GetPartContent(partIndex, &pProgram));
+
+    wchar_t passOptions[256];
+    VERIFY_SUCCEEDED(StringCchPrintfW(passOptions, _countof(passOptions),
+      L"-hlsl-dxil-add-pixel-hit-instrmentation,rt-width=%u,num-pixels=%u,"
+      L"wave-aggregate=1,tile-width=%u", RTWidth, CounterCount, TileWidth));
+    LPCWSTR options[] = { passOptions };
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pProgram, options, _countof(options),
+                                              &pInstrumentedModule, nullptr));
+    VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pInstrumentedModule, &pResult));
+    VERIFY_SUCCEEDED(pResult->GetStatus(&resultCode));
+    VERIFY_SUCCEEDED(resultCode);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pInstrumentedShader));
+    pResult.Release();
+    VERIFY_SUCCEEDED(pValidator->Validate(pInstrumentedShader, DxcValidatorFlags_InPlaceEdit, &pResult));
+    VERIFY_SUCCEEDED(pResult->GetStatus(&resultCode));
+    VERIFY_SUCCEEDED(resultCode);
+  }
+
+  FenceObj FO;
+  InitFenceObj(pDevice, &FO);
+
+  CComPtr<ID3D12DescriptorHeap> pRtvHeap;
+  CComPtr<ID3D12Resource> pRenderTarget, pReadBuffer;
+  UINT rtvDescriptorSize;
+  CreateRtvDescriptorHeap(pDevice, 1, &pRtvHeap, &rtvDescriptorSize);
+  CreateRenderTargetAndReadback(pDevice, pRtvHeap, RTWidth, RTHeight, &pRenderTarget, &pReadBuffer);
+
+  // The counters are a raw buffer at u0 in the space reserved for tools.
+  CComPtr<ID3D12RootSignature> pRootSignature;
+  {
+    CD3DX12_ROOT_PARAMETER rootParameters[1];
+    rootParameters[0].InitAsUnorderedAccessView(0, (UINT)-2);
+
+    CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+    rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+    CreateRootSignatureFromDesc(pDevice, &rootSignatureDesc, &pRootSignature);
+  }
+
+  D3D12_INPUT_ELEMENT_DESC elementDesc[] = {
+      {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
+       D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
+  D3D12_INPUT_LAYOUT_DESC InputLayout = {elementDesc, _countof(elementDesc)};
+  CComPtr<ID3D12PipelineState> pPSO;
+  CreateGraphicsPSO(pDevice, &InputLayout, pRootSignature, pVertexShader,
+                    (ID3DBlob *)pInstrumentedShader.p, &pPSO);
+
+  CComPtr<ID3D12CommandQueue> pCommandQueue;
+  CComPtr<ID3D12CommandAllocator> pCommandAllocator;
+  CComPtr<ID3D12GraphicsCommandList> pCommandList;
+  CreateGraphicsCommandQueueAndList(pDevice, &pCommandQueue, &pCommandAllocator,
+                                    &pCommandList, pPSO);
+
+  // Single triangle covering the whole target, so every pixel is hit once.
+  Vertex vertices[] = {
+    { { -1.0f,  1.0f, 0.0f } },
+    { {  3.0f,  1.0f, 0.0f } },
+    { { -1.0f, -3.0f, 0.0f } } };
+  CComPtr<ID3D12Resource> pVertexBuffer;
+  D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+  CreateVertexBuffer(pDevice, vertices, &pVertexBuffer, &vertexBufferView);
+
+  std::vector<uint32_t> counters(CounterCount);
+  UINT countersSizeInBytes = CounterCount * sizeof(uint32_t);
+  CComPtr<ID3D12Resource> pUavResource;
+  CComPtr<ID3D12Resource> pUavReadBuffer;
+  CComPtr<ID3D12Resource> pUploadResource;
+  CreateTestUavs(pDevice, pCommandList, counters.data(), countersSizeInBytes, &pUavResource, &pUavReadBuffer, &pUploadResource);
+
+  pCommandList->Close();
+  ExecuteCommandList(pCommandQueue, pCommandList);
+  WaitForSignal(pCommandQueue, FO);
+  VERIFY_SUCCEEDED(pCommandAllocator->Reset());
+  VERIFY_SUCCEEDED(pCommandList->Reset(pCommandAllocator, pPSO));
+
+  pCommandList->SetGraphicsRootSignature(pRootSignature);
+  pCommandList->SetGraphicsRootUnorderedAccessView(0, pUavResource->GetGPUVirtualAddress());
+  RecordRenderAndReadback(pCommandList, pRtvHeap, rtvDescriptorSize, 1, &vertexBufferView, nullptr, pRenderTarget, pReadBuffer);
+  RecordTransitionBarrier(pCommandList, pUavResource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+  pCommandList->CopyResource(pUavReadBuffer, pUavResource);
+  VERIFY_SUCCEEDED(pCommandList->Close());
+  ExecuteCommandList(pCommandQueue, pCommandList);
+  WaitForSignal(pCommandQueue, FO);
+
+  {
+    MappedData mappedData(pUavReadBuffer, countersSizeInBytes);
+    const uint32_t *pCounters = (const uint32_t *)mappedData.data();
+    for (UINT i = 0; i < CounterCount; ++i) {
+      LogCommentFmt(L"Counter %u: %u hits", i, pCounters[i]);
+      VERIFY_ARE_EQUAL(TileWidth, pCounters[i]);
+    }
+  }
+}
+
 // This test is assuming that the adapter implements WaveReadLaneFirst correctly
 TEST_F(ExecutionTest, WaveIntrinsicsInPSTest) {
   WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
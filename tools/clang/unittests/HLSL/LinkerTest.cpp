@@ -21,6 +21,7 @@
 #include "WexTestClass.h"
 #include "HlslTestUtils.h"
 #include "dxc/dxcapi.h"
+#include "dxc/Support/FileIOHelper.h"
 #include "DxcTestUtils.h"
 
 using namespace std;
@@ -61,6 +62,9 @@ public:
   TEST_METHOD(RunLinkToLibWithUnusedExport);
   TEST_METHOD(RunLinkToLibWithNoExports);
   TEST_METHOD(RunLinkWithPotentialIntrinsicNameCollisions);
+  TEST_METHOD(RunLinkOptimize);
+  TEST_METHOD(RunLinkWithCacheThenReusesOutput);
+  TEST_METHOD(RunLinkWithCacheDirThenSharedAcrossLinkers);
 
 
   dxc::DxcDllSupport m_dllSupport;
@@ -636,3 +640,114 @@ TEST_F(LinkerTest, RunLinkWithPotentialIntrinsicNameCollisions) {
     "declare %dx.types.Handle @\"dx.op.createHandleForLib.class.Texture2D<float>\"(i32, %\"class.Texture2D<float>\")"
   }, { });
 }
+
+TEST_F(LinkerTest, RunLinkOptimize) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_opt_entry.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_opt_helper.hlsl", &pLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"entry";
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  LPCWSTR libName2 = L"helper";
+  RegisterDxcModule(libName2, pLib, pLinker);
+
+  // Both calls to the helper are inlined, then folded into one.
+  Link(L"ps_main", L"ps_6_0", pLinker, {libName, libName2},
+       {"Sin\\(value\\)"}, {"Sin\\(value\\).*Sin\\(value\\)", "shade@@"},
+       {L"-flink-optimize"}, /*bRegEx*/ true);
+}
+
+TEST_F(LinkerTest, RunLinkWithCacheThenReusesOutput) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  LPCWSTR libNames[] = {L"res", L"entry"};
+  RegisterDxcModule(libNames[0], pResLib, pLinker);
+  RegisterDxcModule(libNames[1], pEntryLib, pLinker);
+
+  auto LinkBlob = [&](LPCWSTR pEntry, LPCWSTR pArgs[], UINT32 argCount,
+                      IDxcBlob **ppBlob) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(pEntry, L"cs_6_0", libNames, 2, pArgs,
+                                   argCount, &pResult));
+    CheckOperationSucceeded(pResult, ppBlob);
+  };
+
+  LPCWSTR args[] = {L"-flink-cache"};
+  CComPtr<IDxcBlob> pFirst, pSecond, pUncached;
+  LinkBlob(L"entry", args, 1, &pFirst);
+  LinkBlob(L"entry", args, 1, &pSecond);
+  // The second link returns the container of the first.
+  VERIFY_ARE_EQUAL(pFirst.p, pSecond.p);
+
+  // Links without the option are not served from the cache.
+  LinkBlob(L"entry", nullptr, 0, &pUncached);
+  VERIFY_IS_TRUE(pUncached.p != pFirst.p);
+  VERIFY_ARE_EQUAL(pFirst->GetBufferSize(), pUncached->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pFirst->GetBufferPointer(),
+                             pUncached->GetBufferPointer(),
+                             pFirst->GetBufferSize()));
+}
+
+TEST_F(LinkerTest, RunLinkWithCacheDirThenSharedAcrossLinkers) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+  TempDirectoryForTest cacheDir;
+  LPCWSTR libNames[] = {L"res", L"entry"};
+
+  auto LinkBlob = [&](IDxcLinker *pLinker, std::vector<LPCWSTR> args,
+                      IDxcBlob **ppBlob) {
+    args.insert(args.begin(),
+                {L"-flink-cache-dir", cacheDir.GetPath().c_str()});
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(L"entry", L"cs_6_0", libNames, 2,
+                                   args.data(), (UINT32)args.size(),
+                                   &pResult));
+    CheckOperationSucceeded(pResult, ppBlob);
+  };
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  RegisterDxcModule(libNames[0], pResLib, pLinker);
+  RegisterDxcModule(libNames[1], pEntryLib, pLinker);
+  CComPtr<IDxcBlob> pFirst;
+  LinkBlob(pLinker, {}, &pFirst);
+
+  // The output is moved into place once written.
+  std::vector<std::wstring> fileNames = cacheDir.GetFileNames();
+  VERIFY_ARE_EQUAL(1u, fileNames.size());
+  std::wstring cachedName = fileNames[0];
+  VERIFY_IS_TRUE(cachedName.size() > 5 &&
+                 cachedName.compare(cachedName.size() - 5, 5, L".dxil") == 0);
+
+  // An option that changes the output misses the cache.
+  CComPtr<IDxcBlob> pOptimized;
+  LinkBlob(pLinker, {L"-flink-optimize"}, &pOptimized);
+  VERIFY_ARE_EQUAL(2u, cacheDir.GetFileNames().size());
+
+  // Another linker reads the first output from the directory. Replace it
+  // with a different container to tell it apart from a new link.
+  WriteBinaryFile(cacheDir.GetFilePath(cachedName).c_str(),
+                  pEntryLib->GetBufferPointer(), pEntryLib->GetBufferSize());
+  CComPtr<IDxcLinker> pOtherLinker;
+  CreateLinker(&pOtherLinker);
+  RegisterDxcModule(libNames[0], pResLib, pOtherLinker);
+  RegisterDxcModule(libNames[1], pEntryLib, pOtherLinker);
+  CComPtr<IDxcBlob> pShared;
+  LinkBlob(pOtherLinker, {}, &pShared);
+  VERIFY_ARE_EQUAL(pEntryLib->GetBufferSize(), pShared->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pEntryLib->GetBufferPointer(),
+                             pShared->GetBufferPointer(),
+                             pShared->GetBufferSize()));
+}
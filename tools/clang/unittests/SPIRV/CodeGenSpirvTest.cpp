@@ -1696,6 +1696,10 @@ TEST_F(FileTest, VulkanLayoutSBufferNestedStd430) {
   setGlLayout();
   runFileTest("vk.layout.sbuffer.nested.std430.hlsl");
 }
+TEST_F(FileTest, VulkanLayoutSharedStructStd140AndStd430) {
+  setGlLayout();
+  runFileTest("vk.layout.shared-struct.hlsl");
+}
 TEST_F(FileTest, VulkanLayoutAppendSBufferStd430) {
   setGlLayout();
   runFileTest("vk.layout.asbuffer.std430.hlsl");
@@ -0,0 +1,136 @@
+# Copyright (C) Microsoft Corporation. All rights reserved.
+# This file is distributed under the University of Illinois Open Source License. See LICENSE.TXT for details.
+"""Measures the time dxc takes to compile the CodeGenSPIRV tests to SPIR-V.
+
+Each test is compiled with the profile, entry point and options from its
+'// Run:' line. The fastest of --repeat runs is kept for every test, and the
+totals are reported for each dxc given, so that a baseline build can be
+compared with a candidate:
+
+  hctbench-spirv.py --dxc base/bin/dxc --dxc new/bin/dxc
+
+--stress adds a generated shader whose structured buffers use deeply nested
+struct element types many times, which stresses type lowering and layout
+computation far more than the individual tests do.
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+RUN_PREFIX = "// Run: %dxc"
+
+def ReadRunArgs(path):
+    with open(path) as f:
+        for line in f:
+            if line.startswith(RUN_PREFIX):
+                return line[len(RUN_PREFIX):].split()
+    return None
+
+def WriteStressShader(path, depth, uses):
+    lines = []
+    lines.append("struct S0 { float4 v; float3x4 m; uint2 u; };")
+    for d in range(1, depth + 1):
+        lines.append("struct S%d { S%d a[2]; float f; S%d b; row_major float2x3 m; };"
+                     % (d, d - 1, d - 1))
+    top = "S%d" % depth
+    lines.append("StructuredBuffer<%s> sbuf;" % top)
+    lines.append("RWStructuredBuffer<%s> rwbuf;" % top)
+    lines.append("cbuffer C { %s cb; };" % top)
+    lines.append("[numthreads(64, 1, 1)]")
+    lines.append("void main(uint tid : SV_DispatchThreadID) {")
+    for i in range(uses):
+        lines.append("  { %s t = sbuf[tid + %d]; t.f += cb.f; rwbuf[tid + %d] = t; }"
+                     % (top, i, i))
+    lines.append("}")
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    return ["-T", "cs_6_0", "-E", "main"]
+
+def TimeCompile(dxc, args, path, repeat):
+    cmd = [dxc, "-spirv"] + args + [path]
+    best = None
+    ok = True
+    with open(os.devnull, "w") as devnull:
+        for _ in range(repeat):
+            start = time.time()
+            ok = subprocess.call(cmd, stdout=devnull, stderr=devnull) == 0
+            elapsed = time.time() - start
+            best = elapsed if best is None else min(best, elapsed)
+    return best, ok
+
+def main():
+    root = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--dxc", action="append", required=True,
+                        help="dxc binary to measure; give twice to compare")
+    parser.add_argument("--tests", default=os.path.join(
+        root, "tools", "clang", "test", "CodeGenSPIRV"),
+                        help="directory of SPIR-V file tests")
+    parser.add_argument("--filter", default="",
+                        help="only run tests whose name matches this regex")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per test; the fastest is kept")
+    parser.add_argument("--stress", action="store_true",
+                        help="also compile a generated shader with deeply nested buffer types")
+    parser.add_argument("--stress-depth", type=int, default=4)
+    parser.add_argument("--stress-uses", type=int, default=100)
+    parser.add_argument("--top", type=int, default=10,
+                        help="number of slowest tests to list")
+    opts = parser.parse_args()
+
+    cases = []
+    name_re = re.compile(opts.filter)
+    for name in sorted(os.listdir(opts.tests)):
+        if not name.endswith(".hlsl") or not name_re.search(name):
+            continue
+        path = os.path.join(opts.tests, name)
+        args = ReadRunArgs(path)
+        if args is not None:
+            cases.append((name, path, args))
+    if opts.stress:
+        fd, path = tempfile.mkstemp(suffix=".hlsl")
+        os.close(fd)
+        args = WriteStressShader(path, opts.stress_depth, opts.stress_uses)
+        cases.append(("<stress>", path, args))
+
+    results = []
+    for dxc in opts.dxc:
+        times = {}
+        failed = 0
+        for name, path, args in cases:
+            elapsed, ok = TimeCompile(dxc, args, path, opts.repeat)
+            times[name] = elapsed
+            failed += 0 if ok else 1
+        results.append((dxc, times, failed))
+
+    if opts.stress:
+        os.remove(cases[-1][1])
+
+    for dxc, times, failed in results:
+        print("%s: %d tests, %.3f s total, %d failed to compile"
+              % (dxc, len(times), sum(times.values()), failed))
+    base = results[0][1]
+    ranked = sorted(base, key=lambda n: base[n], reverse=True)[:opts.top]
+    print("")
+    print("slowest tests:")
+    for name in ranked:
+        row = "  %-50s" % name
+        for _, times, _ in results:
+            row += " %8.3f" % times[name]
+        if len(results) > 1 and base[name] > 0:
+            row += "  (%+.1f%%)" % (100.0 * (results[-1][1][name] / base[name] - 1))
+        print(row)
+    if len(results) > 1:
+        total_base = sum(base.values())
+        total_new = sum(results[-1][1].values())
+        print("")
+        print("total: %.3f s -> %.3f s (%+.1f%%)"
+              % (total_base, total_new, 100.0 * (total_new / total_base - 1)))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1903,7 +1903,10 @@ class db_dxil(object):
             {'n':'add-pixel-cost','t':'int','c':1},
             {'n':'rt-width','t':'int','c':1},
             {'n':'sv-position-index','t':'int','c':1},
-            {'n':'num-pixels','t':'int','c':1}])
+            {'n':'num-pixels','t':'int','c':1},
+            {'n':'wave-aggregate','t':'int','c':1},
+            {'n':'tile-width','t':'int','c':1},
+            {'n':'tile-height','t':'int','c':1}])
         add_pass('hlsl-dxil-constantColor', 'DxilOutputColorBecomesConstant', 'DXIL Constant Color Mod', [
             {'n':'mod-mode','t':'int','c':1},
             {'n':'constant-red','t':'float','c':1},
@@ -1947,6 +1950,23 @@ class db_dxil(object):
         add_pass('hlsl-dxil-precise', 'DxilPrecisePropagatePass', 'DXIL precise attribute propagate', [])
         add_pass('dxil-legalize-sample-offset', 'DxilLegalizeSampleOffsetPass', 'DXIL legalize sample offset', [])
         add_pass('dxil-gvn-hoist', 'DxilSimpleGVNHoist', 'DXIL simple gvn hoist', [])
+        add_pass('dxil-wave-aggregate-atomics', 'DxilWaveAggregateAtomics', 'DXIL wave-aggregate atomics', [])
+        add_pass('dxil-remove-redundant-barriers', 'DxilRemoveRedundantBarriers', 'DXIL remove redundant barriers', [])
+        add_pass('dxil-form-dot-mad', 'DxilFormDotMad', 'DXIL form dot and mad', [])
+        add_pass('dxil-const-array-to-buffer', 'DxilConstArrayToBuffer', 'DXIL constant array to buffer', [
+                {'n':'space', 't':'unsigned', 'c':1, 'd':'Register space of the generated buffer'},
+                {'n':'min-bytes', 't':'unsigned', 'c':1, 'd':'Minimum size of the arrays to move'}])
+        add_pass('dxil-lower-indexed-arrays', 'DxilLowerIndexedArrays', 'DXIL lower indexed arrays', [
+                {'n':'indexed-access-cost', 't':'unsigned', 'c':1, 'd':'Estimated cost of a dynamically indexed access to an indexable register'}])
+        add_pass('dxil-if-conversion', 'DxilIfConversion', 'DXIL if-conversion', [
+                {'n':'uniform-threshold', 't':'unsigned', 'c':1, 'd':'Maximum cost of flattening a branch on a wave-uniform condition'},
+                {'n':'divergent-threshold', 't':'unsigned', 'c':1, 'd':'Maximum cost of flattening a branch on a divergent condition'}])
+        add_pass('dxil-groupshared-bank-conflicts', 'DxilGroupsharedBankConflicts', 'DXIL groupshared bank conflicts', [
+                {'n':'report', 't':'bool', 'c':1, 'd':'Warn about accesses with bank conflicts'},
+                {'n':'pad', 't':'bool', 'c':1, 'd':'Pad the innermost dimension of arrays to avoid bank conflicts'}])
+        add_pass('dxil-hot-cold-split', 'DxilHotColdSplit', 'DXIL hot/cold split', [
+                {'n':'split', 't':'bool', 'c':1, 'd':'Move cold regions out of the hot path'},
+                {'n':'cold-percent', 't':'unsigned', 'c':1, 'd':'Largest profiled edge probability, in percent, considered cold'}])
         add_pass('hlsl-hlensure', 'HLEnsureMetadata', 'HLSL High-Level Metadata Ensure', [])
         add_pass('multi-dim-one-dim', 'MultiDimArrayToOneDimArray', 'Flatten multi-dim array into one-dim array', [])
         add_pass('resource-handle', 'ResourceToHandle', 'Lower resource into handle', [])
@@ -1965,7 +1985,8 @@ class db_dxil(object):
         add_pass('dxil-dfe', 'DxilDeadFunctionElimination', 'Remove all unused function except entry from DxilModule', [])
         add_pass('hl-dfe', 'HLDeadFunctionElimination', 'Remove all unused function except entry from HLModule', [])
         add_pass('hl-preprocess', 'HLPreprocess', 'Preprocess HLModule after inline', [])
-        add_pass('hlsl-dxil-expand-trig', 'DxilExpandTrigIntrinsics', 'DXIL expand trig intrinsics', [])
+        add_pass('hlsl-dxil-expand-trig-intrinsics', 'DxilExpandTrigIntrinsics', 'DXIL expand trig intrinsics', [
+                {'n':'fast-transcendentals', 't':'bool', 'c':1, 'd':'Lower non-precise operations to faster approximations'}])
         add_pass('hlsl-hca', 'HoistConstantArray', 'HLSL constant array hoisting', [])
         add_pass('hlsl-dxil-preserve-all-outputs', 'DxilPreserveAllOutputs', 'DXIL write to all outputs in signature', [])
         add_pass('red', 'ReducibilityAnalysis', 'Reducibility Analysis', [])
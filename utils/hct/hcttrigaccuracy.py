@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+# Copyright (C) Microsoft Corporation. All rights reserved.
+# This file is distributed under the University of Illinois Open Source License. See LICENSE.TXT for details.
+
+"""Measures the accuracy of the DxilExpandTrigIntrinsics expansions.
+
+Each function is compiled as a one-line pixel shader with dxc, expanded with
+opt -hlsl-dxil-expand-trig-intrinsics with and without fast-transcendentals,
+and evaluated on the CPU with lli. The dxil operations the expansions use are
+defined in terms of llvm intrinsics and libm, so the shader IR runs unchanged.
+The results are compared with Python's libm in double precision and the
+maximum absolute error and float ulp error are reported for each mode.
+
+Example:
+  hcttrigaccuracy.py --bin <build>/bin --lli lli
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import subprocess
+import sys
+
+# name: (hlsl expression in x, reference, input range)
+FUNCTIONS = {
+    'acos':       ('acos(x)',      math.acos,              (-1.0, 1.0)),
+    'asin':       ('asin(x)',      math.asin,              (-1.0, 1.0)),
+    'atan':       ('atan(x)',      math.atan,              (-100.0, 100.0)),
+    'atan2':      ('atan2(x, 0.75)', lambda x: math.atan2(x, 0.75), (-100.0, 100.0)),
+    'cosh':       ('cosh(x)',      math.cosh,              (-10.0, 10.0)),
+    'sinh':       ('sinh(x)',      math.sinh,              (-10.0, 10.0)),
+    'tanh':       ('tanh(x)',      math.tanh,              (-10.0, 10.0)),
+    'tan':        ('tan(x)',       math.tan,               (-1.5, 1.5)),
+    'pow_half':   ('pow(x, 0.5)',  math.sqrt,              (0.0, 100.0)),
+    'pow_mhalf':  ('pow(x, -0.5)', lambda x: 1 / math.sqrt(x), (0.01, 100.0)),
+    'div_sqrt':   ('2.5 / sqrt(x)', lambda x: 2.5 / math.sqrt(x), (0.01, 100.0)),
+}
+
+# dx.op.unary opcodes and the llvm or libm function that implements them.
+UNARY_OPS = [
+    (6, 'llvm.fabs.f32'), (12, 'cosf'), (13, 'sinf'), (14, 'tanf'),
+    (15, 'acosf'), (16, 'asinf'), (17, 'atanf'), (18, 'coshf'),
+    (19, 'sinhf'), (20, 'tanhf'), (21, 'llvm.exp2.f32'),
+    (23, 'llvm.log2.f32'), (24, 'llvm.sqrt.f32'),
+]
+
+def to_float(v):
+    return struct.unpack('f', struct.pack('f', v))[0]
+
+def float_ulp(v):
+    '''Returns the spacing of floats at v.'''
+    v = abs(to_float(v))
+    if math.isinf(v):
+        return math.inf
+    bits = struct.unpack('I', struct.pack('f', v))[0]
+    return struct.unpack('f', struct.pack('I', bits + 1))[0] - v
+
+def runtime_ir():
+    '''Returns definitions of the dxil operations used by the expansions.'''
+    ir = ['@__x = global float 0.0', '@__r = global float 0.0']
+    ir += ['declare float @%s(float)' % f for _, f in UNARY_OPS]
+    ir.append('define float @dx.op.unary.f32(i32 %op, float %v) {')
+    ir.append('  switch i32 %op, label %rsqrt [')
+    ir += ['    i32 %d, label %%op%d' % (op, op) for op, _ in UNARY_OPS]
+    ir.append('  ]')
+    for op, f in UNARY_OPS:
+        ir.append('op%d:' % op)
+        ir.append('  %%r%d = call float @%s(float %%v)' % (op, f))
+        ir.append('  ret float %%r%d' % op)
+    ir.append('rsqrt:')
+    ir.append('  %s = call float @llvm.sqrt.f32(float %v)')
+    ir.append('  %rs = fdiv float 1.0, %s')
+    ir.append('  ret float %rs')
+    ir.append('}')
+    ir.append('define float @dx.op.loadInput.f32(i32, i32, i32, i8, i32) {')
+    ir.append('  %v = load float, float* @__x')
+    ir.append('  ret float %v')
+    ir.append('}')
+    ir.append('define void @dx.op.storeOutput.f32(i32, i32, i32, i8, float %v) {')
+    ir.append('  store float %v, float* @__r')
+    ir.append('  ret void')
+    ir.append('}')
+    return ir
+
+def driver_ir(inputs):
+    '''Returns a main that runs the shader on each input and prints results.'''
+    n = len(inputs)
+    # Float constants are written as the hex bits of the equivalent double.
+    values = ', '.join('float 0x%016X' % struct.unpack('Q', struct.pack('d', to_float(x)))[0]
+                       for x in inputs)
+    return [
+        '@__inputs = constant [%d x float] [%s]' % (n, values),
+        '@__fmt = constant [4 x i8] c"%a\\0A\\00"',
+        'declare i32 @printf(i8*, ...)',
+        'define i32 @main() {',
+        'entry:',
+        '  br label %loop',
+        'loop:',
+        '  %i = phi i32 [ 0, %entry ], [ %next, %loop ]',
+        '  %%p = getelementptr [%d x float], [%d x float]* @__inputs, i32 0, i32 %%i' % (n, n),
+        '  %x = load float, float* %p',
+        '  store float %x, float* @__x',
+        '  call void @__shader()',
+        '  %r = load float, float* @__r',
+        '  %d = fpext float %r to double',
+        '  %f = getelementptr [4 x i8], [4 x i8]* @__fmt, i32 0, i32 0',
+        '  call i32 (i8*, ...) @printf(i8* %f, double %d)',
+        '  %next = add i32 %i, 1',
+        '  %%done = icmp eq i32 %%next, %d' % n,
+        '  br i1 %done, label %exit, label %loop',
+        'exit:',
+        '  ret i32 0',
+        '}',
+    ]
+
+def make_runnable(shader_ir, inputs):
+    '''Turns the expanded shader module into a module lli can run.'''
+    lines = []
+    for line in shader_ir.splitlines():
+        if line.startswith('target ') or line.startswith('!'):
+            continue
+        if re.match(r'declare .*@dx\.op\.', line):
+            continue
+        # Drop metadata attachments such as !dx.precise.
+        line = re.sub(r',\s*!([\w.]+)\s+!\d+', '', line)
+        line = line.replace('define void @main()', 'define void @__shader()')
+        lines.append(line)
+    return '\n'.join(lines + runtime_ir() + driver_ir(inputs)) + '\n'
+
+def expand(args, expr, fast):
+    '''Compiles expr and returns the expanded shader IR.'''
+    source = '[RootSignature("")]\nfloat main(float x : A) : SV_Target {\n  return %s;\n}\n' % expr
+    path = os.path.join(args.temp, 'hcttrigaccuracy.hlsl')
+    with open(path, 'w') as f:
+        f.write(source)
+    dxc = os.path.join(args.bin, 'dxc') if args.bin else 'dxc'
+    opt = os.path.join(args.bin, 'opt') if args.bin else 'opt'
+    dxil = subprocess.check_output([dxc, '-E', 'main', '-T', 'ps_6_0', path],
+                                   universal_newlines=True)
+    pass_arg = '-hlsl-dxil-expand-trig-intrinsics'
+    if fast:
+        pass_arg += ',fast-transcendentals=1'
+    return subprocess.check_output([opt, '-S', pass_arg], input=dxil,
+                                   universal_newlines=True)
+
+def evaluate(args, shader_ir, inputs):
+    '''Runs the shader on each input with lli and returns the results.'''
+    path = os.path.join(args.temp, 'hcttrigaccuracy.ll')
+    with open(path, 'w') as f:
+        f.write(make_runnable(shader_ir, inputs))
+    out = subprocess.check_output([args.lli, path], universal_newlines=True)
+    return [float.fromhex(v) for v in out.split()]
+
+def measure(results, inputs, reference):
+    '''Returns the maximum absolute and ulp error, and where they occur.'''
+    max_abs, max_ulp, at_abs, at_ulp = 0.0, 0.0, None, None
+    for x, r in zip(inputs, results):
+        expected = reference(to_float(x))
+        err = abs(r - expected)
+        if math.isnan(r) != math.isnan(expected):
+            err = math.inf
+        elif math.isnan(r) or r == expected:
+            continue
+        ulps = err / float_ulp(expected) if expected != 0 else math.inf
+        if err > max_abs:
+            max_abs, at_abs = err, x
+        if ulps > max_ulp:
+            max_ulp, at_ulp = ulps, x
+    return max_abs, at_abs, max_ulp, at_ulp
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--bin', help='directory with dxc and opt (default: PATH)')
+    parser.add_argument('--lli', default='lli', help='lli to evaluate with')
+    parser.add_argument('--samples', type=int, default=4001,
+                        help='inputs per function, evenly spaced over its range')
+    parser.add_argument('--temp', default='.', help='directory for scratch files')
+    parser.add_argument('functions', nargs='*', help='functions to measure (default: all)')
+    args = parser.parse_args()
+
+    names = args.functions or sorted(FUNCTIONS)
+    print('%-10s %-8s %12s %12s %12s %12s' %
+          ('function', 'mode', 'max abs', 'at x', 'max ulp', 'at x'))
+    for name in names:
+        expr, reference, (lo, hi) = FUNCTIONS[name]
+        n = args.samples
+        inputs = [lo + (hi - lo) * i / (n - 1) for i in range(n)]
+        for fast in (False, True):
+            results = evaluate(args, expand(args, expr, fast), inputs)
+            max_abs, at_abs, max_ulp, at_ulp = measure(results, inputs, reference)
+            print('%-10s %-8s %12.3g %12.6g %12.4g %12.6g' %
+                  (name, 'fast' if fast else 'default', max_abs,
+                   at_abs if at_abs is not None else 0, max_ulp,
+                   at_ulp if at_ulp is not None else 0))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())